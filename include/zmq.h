@@ -178,10 +178,12 @@ ZMQ_EXPORT void zmq_version (int *major, int *minor, int *patch);
 /*  Context options                                                           */
 #define ZMQ_IO_THREADS  1
 #define ZMQ_MAX_SOCKETS 2
+#define ZMQ_CRYPTO_THREADS 3
 
 /*  Default for new contexts                                                  */
 #define ZMQ_IO_THREADS_DFLT  1
 #define ZMQ_MAX_SOCKETS_DFLT 1023
+#define ZMQ_CRYPTO_THREADS_DFLT 0
 
 ZMQ_EXPORT void *zmq_ctx_new (void);
 ZMQ_EXPORT int zmq_ctx_term (void *context);
@@ -294,6 +296,33 @@ ZMQ_EXPORT int zmq_msg_set (zmq_msg_t *msg, int option, int optval);
 #define ZMQ_IPC_FILTER_UID 59
 #define ZMQ_IPC_FILTER_GID 60
 #define ZMQ_ZAP_IPC_CREDS 61
+#define ZMQ_SPILL_PATH 62
+#define ZMQ_SPILL_MAXSIZE 63
+#define ZMQ_STAT_MSGS_SENT 64
+#define ZMQ_STAT_BYTES_SENT 65
+#define ZMQ_STAT_MSGS_RECEIVED 66
+#define ZMQ_STAT_BYTES_RECEIVED 67
+#define ZMQ_STAT_MSGS_DROPPED 68
+#define ZMQ_STAT_QUEUE_DEPTH 69
+#define ZMQ_STAT_HWM_BLOCK_TIME 70
+#define ZMQ_STAT_RECONNECTS 71
+#define ZMQ_LATENCY_TRACKING 72
+#define ZMQ_STAT_LATENCY 73
+#define ZMQ_MONITOR_INTERVAL 74
+#define ZMQ_ZAP_CACHE_TTL 75
+#define ZMQ_STAT_ZAP_CACHE_HITS 76
+#define ZMQ_STAT_ZAP_CACHE_MISSES 77
+#define ZMQ_CURVE_AEAD 78
+#define ZMQ_IPC_BULK_THRESHOLD 79
+#define ZMQ_HEARTBEAT_IVL 80
+#define ZMQ_HEARTBEAT_TTL 81
+#define ZMQ_HEARTBEAT_TIMEOUT 82
+#define ZMQ_TCP_STRIPES 83
+#define ZMQ_IN_BATCH_SIZE 84
+#define ZMQ_OUT_BATCH_SIZE 85
+#define ZMQ_ADAPTIVE_BATCH 86
+#define ZMQ_COALESCE_IVL 87
+#define ZMQ_COALESCE_SIZE 88
 
 /*  Message options                                                           */
 #define ZMQ_MORE 1
@@ -334,6 +363,12 @@ ZMQ_EXPORT int zmq_msg_set (zmq_msg_t *msg, int option, int optval);
 #define ZMQ_EVENT_DISCONNECTED 512
 #define ZMQ_EVENT_MONITOR_STOPPED 1024
 
+#define ZMQ_EVENT_HWM_REACHED 2048
+#define ZMQ_EVENT_LWM_DRAINED 4096
+#define ZMQ_EVENT_MSGS_DROPPED 8192
+#define ZMQ_EVENT_HANDSHAKE_SUCCEEDED 16384
+#define ZMQ_EVENT_THROUGHPUT 32768
+
 #define ZMQ_EVENT_ALL ( ZMQ_EVENT_CONNECTED | ZMQ_EVENT_CONNECT_DELAYED | \
                         ZMQ_EVENT_CONNECT_RETRIED | ZMQ_EVENT_LISTENING | \
                         ZMQ_EVENT_BIND_FAILED | ZMQ_EVENT_ACCEPTED | \
@@ -395,10 +430,83 @@ typedef struct
 
 ZMQ_EXPORT int zmq_poll (zmq_pollitem_t *items, int nitems, long timeout);
 
+/*  Persistent poller                                                         */
+
+typedef struct
+{
+    void *socket;
+#if defined _WIN32
+    SOCKET fd;
+#else
+    int fd;
+#endif
+    void *user_data;
+    short events;
+} zmq_poller_event_t;
+
+ZMQ_EXPORT void *zmq_poller_new (void);
+ZMQ_EXPORT int zmq_poller_destroy (void **poller_p);
+ZMQ_EXPORT int zmq_poller_add (void *poller, void *socket, void *user_data,
+    short events);
+ZMQ_EXPORT int zmq_poller_modify (void *poller, void *socket, short events);
+ZMQ_EXPORT int zmq_poller_remove (void *poller, void *socket);
+ZMQ_EXPORT int zmq_poller_wait (void *poller, zmq_poller_event_t *event,
+    long timeout);
+ZMQ_EXPORT int zmq_poller_wait_all (void *poller, zmq_poller_event_t *events,
+    int n_events, long timeout);
+
+#if defined _WIN32
+ZMQ_EXPORT int zmq_poller_add_fd (void *poller, SOCKET fd, void *user_data,
+    short events);
+ZMQ_EXPORT int zmq_poller_modify_fd (void *poller, SOCKET fd, short events);
+ZMQ_EXPORT int zmq_poller_remove_fd (void *poller, SOCKET fd);
+#else
+ZMQ_EXPORT int zmq_poller_add_fd (void *poller, int fd, void *user_data,
+    short events);
+ZMQ_EXPORT int zmq_poller_modify_fd (void *poller, int fd, short events);
+ZMQ_EXPORT int zmq_poller_remove_fd (void *poller, int fd);
+#endif
+
+/*  Reactor                                                                   */
+
+/*  Handlers return 0 to continue or -1 to stop the reactor.                  */
+typedef int (zmq_reactor_fn) (void *reactor, zmq_poller_event_t *event,
+    void *arg);
+typedef int (zmq_timer_fn) (void *reactor, int timer_id, void *arg);
+
+ZMQ_EXPORT void *zmq_reactor_new (void);
+ZMQ_EXPORT int zmq_reactor_destroy (void **reactor_p);
+ZMQ_EXPORT int zmq_reactor_add (void *reactor, void *socket, short events,
+    zmq_reactor_fn *handler, void *arg);
+ZMQ_EXPORT int zmq_reactor_remove (void *reactor, void *socket);
+#if defined _WIN32
+ZMQ_EXPORT int zmq_reactor_add_fd (void *reactor, SOCKET fd, short events,
+    zmq_reactor_fn *handler, void *arg);
+ZMQ_EXPORT int zmq_reactor_remove_fd (void *reactor, SOCKET fd);
+#else
+ZMQ_EXPORT int zmq_reactor_add_fd (void *reactor, int fd, short events,
+    zmq_reactor_fn *handler, void *arg);
+ZMQ_EXPORT int zmq_reactor_remove_fd (void *reactor, int fd);
+#endif
+ZMQ_EXPORT int zmq_reactor_add_timer (void *reactor, long interval, int times,
+    zmq_timer_fn *handler, void *arg);
+ZMQ_EXPORT int zmq_reactor_cancel_timer (void *reactor, int timer_id);
+ZMQ_EXPORT int zmq_reactor_run (void *reactor);
+ZMQ_EXPORT int zmq_reactor_run_once (void *reactor, long timeout);
+
 /*  Built-in message proxy (3-way) */
 
 ZMQ_EXPORT int zmq_proxy (void *frontend, void *backend, void *capture);
 ZMQ_EXPORT int zmq_proxy_steerable (void *frontend, void *backend, void *capture, void *control);
+ZMQ_EXPORT int zmq_proxy_detached (void *frontend, void *backend, void *capture, void *control);
+
+/*  Sharding strategies of zmq_proxy_sharded                                  */
+#define ZMQ_PROXY_SHARD_ROUND_ROBIN 1
+#define ZMQ_PROXY_SHARD_HASH 2
+
+ZMQ_EXPORT int zmq_proxy_sharded (void **frontends, void **backends,
+    int shards, const char *frontend_endpoint, const char *backend_endpoint,
+    int strategy, void *control);
 
 /*  Encode a binary key as printable text using ZMQ RFC 32  */
 ZMQ_EXPORT char *zmq_z85_encode (char *dest, uint8_t *data, size_t size);
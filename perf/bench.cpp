@@ -0,0 +1,833 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+//  Benchmark runner covering the common messaging patterns. All the peers
+//  run as threads of a single process so that one-way latency can be
+//  measured by stamping each message with the time it was sent.
+
+struct config_t
+{
+    const char *scenario;
+    const char *transport;
+    size_t message_size;
+    int parts;
+    int count;
+    int peers;
+    int connections;
+    int stripes;
+    int io_threads;
+    bool curve;
+    bool json;
+};
+
+static config_t config;
+
+//  Endpoint and CURVE keys used by the scenario being run.
+static char endpoint [256];
+static char server_public [41];
+static char server_secret [41];
+static char client_public [41];
+static char client_secret [41];
+
+typedef std::vector <uint64_t> samples_t;
+
+struct peer_t
+{
+    void *ctx;
+    int id;
+    int count;
+    samples_t samples;
+};
+
+static void fail (const char *what_)
+{
+    printf ("error in %s: %s\n", what_, zmq_strerror (errno));
+    exit (1);
+}
+
+static uint64_t now_ns ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    LARGE_INTEGER ticks, frequency;
+    QueryPerformanceCounter (&ticks);
+    QueryPerformanceFrequency (&frequency);
+    return (uint64_t) (ticks.QuadPart * 1000000000.0 / frequency.QuadPart);
+#elif defined CLOCK_MONOTONIC
+    struct timespec ts;
+    int rc = clock_gettime (CLOCK_MONOTONIC, &ts);
+    if (rc != 0)
+        fail ("clock_gettime");
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    struct timeval tv;
+    int rc = gettimeofday (&tv, NULL);
+    if (rc != 0)
+        fail ("gettimeofday");
+    return (uint64_t) tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+//  CPU time used by the whole process, I/O threads included, in nanoseconds.
+//  Unlike the throughput, it doesn't depend on what else the machine is
+//  busy with, which makes it the better figure to compare builds by.
+static uint64_t cpu_ns ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes (GetCurrentProcess (), &creation, &exit, &kernel,
+          &user))
+        fail ("GetProcessTimes");
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 100;
+#else
+    struct rusage usage;
+    int rc = getrusage (RUSAGE_SELF, &usage);
+    if (rc != 0)
+        fail ("getrusage");
+    return ((uint64_t) usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+        1000000000 + ((uint64_t) usage.ru_utime.tv_usec +
+        usage.ru_stime.tv_usec) * 1000;
+#endif
+}
+
+//  CPU time used by the process when the scenario being run started.
+static uint64_t cpu_start;
+
+//  Creates a socket with no HWM so that no messages are dropped and sets
+//  up the security mechanism for it.
+static void *open_socket (void *ctx_, int type_, bool server_)
+{
+    void *s = zmq_socket (ctx_, type_);
+    if (!s)
+        fail ("zmq_socket");
+
+    int hwm = 0;
+    int rc = zmq_setsockopt (s, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+    rc = zmq_setsockopt (s, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+
+    //  Only the tcp connections of some socket types are striped.
+    rc = zmq_setsockopt (s, ZMQ_TCP_STRIPES, &config.stripes,
+        sizeof (config.stripes));
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+
+    if (config.curve) {
+        if (server_) {
+            int as_server = 1;
+            rc = zmq_setsockopt (s, ZMQ_CURVE_SERVER, &as_server,
+                sizeof (as_server));
+            if (rc == 0)
+                rc = zmq_setsockopt (s, ZMQ_CURVE_SECRETKEY, server_secret, 40);
+        }
+        else {
+            rc = zmq_setsockopt (s, ZMQ_CURVE_SERVERKEY, server_public, 40);
+            if (rc == 0)
+                rc = zmq_setsockopt (s, ZMQ_CURVE_PUBLICKEY, client_public, 40);
+            if (rc == 0)
+                rc = zmq_setsockopt (s, ZMQ_CURVE_SECRETKEY, client_secret, 40);
+        }
+        if (rc != 0)
+            fail ("zmq_setsockopt");
+    }
+    return s;
+}
+
+static void close_socket (void *s_)
+{
+    int linger = 0;
+    int rc = zmq_setsockopt (s_, ZMQ_LINGER, &linger, sizeof (linger));
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+    rc = zmq_close (s_);
+    if (rc != 0)
+        fail ("zmq_close");
+}
+
+//  Sends a message of the configured size and number of parts. The first
+//  part carries the time the message was sent.
+static void send_message (void *s_, uint64_t stamp_)
+{
+    for (int i = 0; i != config.parts; i++) {
+        zmq_msg_t msg;
+        size_t size = config.message_size;
+        if (i == 0 && size < sizeof (stamp_))
+            size = sizeof (stamp_);
+        int rc = zmq_msg_init_size (&msg, size);
+        if (rc != 0)
+            fail ("zmq_msg_init_size");
+        if (i == 0)
+            memcpy (zmq_msg_data (&msg), &stamp_, sizeof (stamp_));
+        rc = zmq_sendmsg (s_, &msg, i == config.parts - 1 ? 0 : ZMQ_SNDMORE);
+        if (rc < 0)
+            fail ("zmq_sendmsg");
+    }
+}
+
+//  Receives a message sent by send_message and returns its timestamp.
+//  If routed is true, the message is prefixed by the peer identity.
+static uint64_t recv_message (void *s_, bool routed_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    if (rc != 0)
+        fail ("zmq_msg_init");
+
+    if (routed_) {
+        rc = zmq_recvmsg (s_, &msg, 0);
+        if (rc < 0)
+            fail ("zmq_recvmsg");
+    }
+
+    uint64_t stamp = 0;
+    for (int i = 0; i != config.parts; i++) {
+        rc = zmq_recvmsg (s_, &msg, 0);
+        if (rc < 0)
+            fail ("zmq_recvmsg");
+        if (i == 0)
+            memcpy (&stamp, zmq_msg_data (&msg), sizeof (stamp));
+        if ((zmq_msg_more (&msg) != 0) != (i != config.parts - 1)) {
+            printf ("message with incorrect number of parts received\n");
+            exit (1);
+        }
+    }
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0)
+        fail ("zmq_msg_close");
+    return stamp;
+}
+
+//  Forwards all the parts of a message back to the sender.
+static void echo_message (void *s_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    if (rc != 0)
+        fail ("zmq_msg_init");
+    do {
+        rc = zmq_recvmsg (s_, &msg, 0);
+        if (rc < 0)
+            fail ("zmq_recvmsg");
+        rc = zmq_sendmsg (s_, &msg, zmq_msg_more (&msg) ? ZMQ_SNDMORE : 0);
+        if (rc < 0)
+            fail ("zmq_sendmsg");
+    } while (zmq_msg_more (&msg));
+    rc = zmq_msg_close (&msg);
+    if (rc != 0)
+        fail ("zmq_msg_close");
+}
+
+static void rep_worker (void *arg_)
+{
+    peer_t *peer = (peer_t*) arg_;
+    void *s = open_socket (peer->ctx, ZMQ_REP, false);
+    int rc = zmq_connect (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_connect");
+    for (int i = 0; i != peer->count; i++)
+        echo_message (s);
+    close_socket (s);
+}
+
+static void push_worker (void *arg_)
+{
+    peer_t *peer = (peer_t*) arg_;
+    void *s = open_socket (peer->ctx, ZMQ_PUSH, false);
+    int rc = zmq_connect (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_connect");
+    for (int i = 0; i != peer->count; i++)
+        send_message (s, now_ns ());
+
+    //  Default linger makes sure all the messages are delivered.
+    rc = zmq_close (s);
+    if (rc != 0)
+        fail ("zmq_close");
+}
+
+static void sub_worker (void *arg_)
+{
+    peer_t *peer = (peer_t*) arg_;
+    void *s = open_socket (peer->ctx, ZMQ_SUB, false);
+    int rc = zmq_setsockopt (s, ZMQ_SUBSCRIBE, "", 0);
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+    rc = zmq_connect (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_connect");
+    peer->samples.reserve (peer->count);
+    for (int i = 0; i != peer->count; i++) {
+        uint64_t stamp = recv_message (s, false);
+        peer->samples.push_back (now_ns () - stamp);
+    }
+    close_socket (s);
+}
+
+static void dealer_worker (void *arg_)
+{
+    peer_t *peer = (peer_t*) arg_;
+    void *s = open_socket (peer->ctx, ZMQ_DEALER, false);
+    int rc = zmq_connect (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_connect");
+    for (int i = 0; i != peer->count; i++)
+        send_message (s, now_ns ());
+
+    //  Default linger makes sure all the messages are delivered.
+    rc = zmq_close (s);
+    if (rc != 0)
+        fail ("zmq_close");
+}
+
+//  Opens a new connection for each message and waits for the reply, so
+//  that every message goes through connection setup and the handshake.
+static void connect_worker (void *arg_)
+{
+    peer_t *peer = (peer_t*) arg_;
+    for (int i = 0; i != peer->count; i++) {
+        void *s = open_socket (peer->ctx, ZMQ_DEALER, false);
+        int rc = zmq_connect (s, endpoint);
+        if (rc != 0)
+            fail ("zmq_connect");
+        send_message (s, now_ns ());
+        char reply;
+        rc = zmq_recv (s, &reply, 1, 0);
+        if (rc < 0)
+            fail ("zmq_recv");
+        close_socket (s);
+    }
+}
+
+//  Subscribes to and unsubscribes from unique topics. Each topic carries
+//  the time the subscription was made.
+static void churn_worker (void *arg_)
+{
+    peer_t *peer = (peer_t*) arg_;
+    void *s = open_socket (peer->ctx, ZMQ_SUB, false);
+    int rc = zmq_connect (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_connect");
+    unsigned char topic [16];
+    for (int i = 0; i != peer->count; i++) {
+        uint64_t stamp = now_ns ();
+        memcpy (topic, &stamp, sizeof (stamp));
+        memcpy (topic + 8, &peer->id, 4);
+        memcpy (topic + 12, &i, 4);
+        rc = zmq_setsockopt (s, ZMQ_SUBSCRIBE, topic, sizeof (topic));
+        if (rc != 0)
+            fail ("zmq_setsockopt");
+        rc = zmq_setsockopt (s, ZMQ_UNSUBSCRIBE, topic, sizeof (topic));
+        if (rc != 0)
+            fail ("zmq_setsockopt");
+    }
+
+    //  Wait for the publisher to get all the subscriptions.
+    rc = zmq_setsockopt (s, ZMQ_SUBSCRIBE, "", 0);
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+    char done;
+    rc = zmq_recv (s, &done, 1, 0);
+    if (rc < 0)
+        fail ("zmq_recv");
+    close_socket (s);
+}
+
+//  Starts the peer threads, splitting the messages among them.
+static void start_peers (void *ctx_, zmq_thread_fn *fn_, int peers_,
+    int count_, bool split_, std::vector <peer_t> &state_,
+    std::vector <void*> &threads_)
+{
+    state_.resize (peers_);
+    for (int i = 0; i != peers_; i++) {
+        state_ [i].ctx = ctx_;
+        state_ [i].id = i;
+        state_ [i].count = split_ ?
+            count_ / peers_ + (i < count_ % peers_ ? 1 : 0) : count_;
+    }
+    for (int i = 0; i != peers_; i++)
+        threads_.push_back (zmq_threadstart (fn_, &state_ [i]));
+}
+
+static void join_peers (std::vector <void*> &threads_)
+{
+    for (size_t i = 0; i != threads_.size (); i++)
+        zmq_threadclose (threads_ [i]);
+    threads_.clear ();
+}
+
+static void report (const char *scenario_, int peers_, uint64_t messages_,
+    uint64_t elapsed_ns_, samples_t &samples_)
+{
+    std::sort (samples_.begin (), samples_.end ());
+    const double quantiles [] = {0.5, 0.99, 0.999};
+    uint64_t percentiles [3] = {0, 0, 0};
+    uint64_t max = 0;
+    if (!samples_.empty ()) {
+        for (int i = 0; i != 3; i++) {
+            size_t rank = (size_t) (quantiles [i] * samples_.size () + 0.5);
+            if (rank > 0)
+                rank--;
+            percentiles [i] = samples_ [rank];
+        }
+        max = samples_.back ();
+    }
+
+    const double seconds = elapsed_ns_ / 1000000000.0;
+    const double throughput = seconds > 0 ? messages_ / seconds : 0;
+    const double megabits = throughput * config.message_size *
+        config.parts * 8 / 1000000;
+    const char *mechanism = config.curve ? "curve" : "null";
+    const double cpu_per_message = messages_ > 0 ?
+        (double) (cpu_ns () - cpu_start) / messages_ : 0;
+
+    if (config.json) {
+        printf ("{\"scenario\": \"%s\", \"transport\": \"%s\", "
+            "\"mechanism\": \"%s\", \"message_size\": %d, "
+            "\"message_parts\": %d, \"peers\": %d, \"stripes\": %d, "
+            "\"messages\": %llu, "
+            "\"throughput_msgs\": %.0f, \"throughput_mbits\": %.3f, "
+            "\"cpu_ns_per_msg\": %.0f, "
+            "\"latency_ns\": {\"samples\": %llu, \"p50\": %llu, "
+            "\"p99\": %llu, \"p99.9\": %llu, \"max\": %llu}}\n",
+            scenario_, config.transport, mechanism, (int) config.message_size,
+            config.parts, peers_, config.stripes,
+            (unsigned long long) messages_, throughput,
+            megabits, cpu_per_message, (unsigned long long) samples_.size (),
+            (unsigned long long) percentiles [0],
+            (unsigned long long) percentiles [1],
+            (unsigned long long) percentiles [2], (unsigned long long) max);
+        return;
+    }
+
+    printf ("scenario: %s\n", scenario_);
+    printf ("transport: %s\n", config.transport);
+    printf ("mechanism: %s\n", mechanism);
+    printf ("message size: %d [B]\n", (int) config.message_size);
+    printf ("message parts: %d\n", config.parts);
+    printf ("peers: %d\n", peers_);
+    printf ("tcp stripes: %d\n", config.stripes);
+    printf ("message count: %llu\n", (unsigned long long) messages_);
+    printf ("mean throughput: %.0f [msg/s]\n", throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", megabits);
+    printf ("cpu time: %.0f [ns/msg]\n", cpu_per_message);
+    printf ("latency p50: %.3f [us]\n", percentiles [0] / 1000.0);
+    printf ("latency p99: %.3f [us]\n", percentiles [1] / 1000.0);
+    printf ("latency p99.9: %.3f [us]\n", percentiles [2] / 1000.0);
+    printf ("latency max: %.3f [us]\n", max / 1000.0);
+    printf ("\n");
+}
+
+//  REQ/REP roundtrips. Latency is half of the roundtrip time, the same as
+//  reported by local_lat.
+static void run_lat (void *ctx_)
+{
+    void *s = open_socket (ctx_, ZMQ_REQ, true);
+    int rc = zmq_bind (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_bind");
+
+    std::vector <peer_t> peers;
+    std::vector <void*> threads;
+    start_peers (ctx_, rep_worker, 1, config.count, false, peers, threads);
+
+    samples_t samples;
+    samples.reserve (config.count);
+    uint64_t start = now_ns ();
+    for (int i = 0; i != config.count; i++) {
+        send_message (s, now_ns ());
+        uint64_t stamp = recv_message (s, false);
+        samples.push_back ((now_ns () - stamp) / 2);
+    }
+    uint64_t elapsed = now_ns () - start;
+
+    join_peers (threads);
+    close_socket (s);
+    report ("lat", 1, config.count, elapsed, samples);
+}
+
+//  PUSH/PULL throughput with one-way latency.
+static void run_thr (void *ctx_)
+{
+    void *s = open_socket (ctx_, ZMQ_PULL, true);
+    int rc = zmq_bind (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_bind");
+
+    std::vector <peer_t> peers;
+    std::vector <void*> threads;
+    start_peers (ctx_, push_worker, 1, config.count, false, peers, threads);
+
+    samples_t samples;
+    samples.reserve (config.count);
+    uint64_t start = 0;
+    for (int i = 0; i != config.count; i++) {
+        uint64_t stamp = recv_message (s, false);
+        uint64_t now = now_ns ();
+        if (i == 0)
+            start = stamp;
+        samples.push_back (now - stamp);
+    }
+    uint64_t elapsed = now_ns () - start;
+
+    join_peers (threads);
+    close_socket (s);
+    report ("thr", 1, config.count, elapsed, samples);
+}
+
+//  PUB/SUB fan-out from one publisher to the configured number of
+//  subscribers. XPUB is used so that the publisher can wait for all the
+//  subscriptions before it starts sending.
+static void run_fanout (void *ctx_)
+{
+    void *s = open_socket (ctx_, ZMQ_XPUB, true);
+    int verbose = 1;
+    int rc = zmq_setsockopt (s, ZMQ_XPUB_VERBOSE, &verbose, sizeof (verbose));
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+    rc = zmq_bind (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_bind");
+
+    std::vector <peer_t> peers;
+    std::vector <void*> threads;
+    start_peers (ctx_, sub_worker, config.peers, config.count, false,
+        peers, threads);
+
+    char subscription [1];
+    for (int i = 0; i != config.peers; i++) {
+        rc = zmq_recv (s, subscription, sizeof (subscription), 0);
+        if (rc < 0)
+            fail ("zmq_recv");
+    }
+
+    uint64_t start = now_ns ();
+    for (int i = 0; i != config.count; i++)
+        send_message (s, now_ns ());
+    join_peers (threads);
+    uint64_t elapsed = now_ns () - start;
+
+    samples_t samples;
+    for (int i = 0; i != config.peers; i++)
+        samples.insert (samples.end (), peers [i].samples.begin (),
+            peers [i].samples.end ());
+    close_socket (s);
+    report ("fanout", config.peers, (uint64_t) config.count * config.peers,
+        elapsed, samples);
+}
+
+//  DEALER/ROUTER fan-in from the configured number of senders.
+static void run_fanin (void *ctx_)
+{
+    void *s = open_socket (ctx_, ZMQ_ROUTER, true);
+    int rc = zmq_bind (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_bind");
+
+    std::vector <peer_t> peers;
+    std::vector <void*> threads;
+    start_peers (ctx_, dealer_worker, config.peers, config.count, true,
+        peers, threads);
+
+    samples_t samples;
+    samples.reserve (config.count);
+    uint64_t start = 0;
+    for (int i = 0; i != config.count; i++) {
+        uint64_t stamp = recv_message (s, true);
+        uint64_t now = now_ns ();
+        if (i == 0)
+            start = stamp;
+        samples.push_back (now - stamp);
+    }
+    uint64_t elapsed = now_ns () - start;
+
+    join_peers (threads);
+    close_socket (s);
+    report ("fanin", config.peers, config.count, elapsed, samples);
+}
+
+//  XPUB subscription churn. Latency is the time from the subscription
+//  being made to the publisher receiving it.
+static void run_churn (void *ctx_)
+{
+    void *s = open_socket (ctx_, ZMQ_XPUB, true);
+    int verbose = 1;
+    int rc = zmq_setsockopt (s, ZMQ_XPUB_VERBOSE, &verbose, sizeof (verbose));
+    if (rc != 0)
+        fail ("zmq_setsockopt");
+    rc = zmq_bind (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_bind");
+
+    std::vector <peer_t> peers;
+    std::vector <void*> threads;
+    start_peers (ctx_, churn_worker, config.peers, config.count, true,
+        peers, threads);
+
+    //  Each topic is subscribed and unsubscribed, then each peer subscribes
+    //  to all the messages to signal it's done.
+    samples_t samples;
+    samples.reserve (config.count);
+    uint64_t start = 0;
+    int subscriptions = 0;
+    int done = 0;
+    unsigned char topic [17];
+    while (done != config.peers) {
+        rc = zmq_recv (s, topic, sizeof (topic), 0);
+        if (rc < 0)
+            fail ("zmq_recv");
+        if (rc == 1) {
+            done++;
+            continue;
+        }
+        if (topic [0] == 1) {
+            uint64_t stamp;
+            memcpy (&stamp, topic + 1, sizeof (stamp));
+            uint64_t now = now_ns ();
+            if (subscriptions++ == 0)
+                start = stamp;
+            samples.push_back (now - stamp);
+        }
+    }
+    uint64_t elapsed = now_ns () - start;
+
+    rc = zmq_send (s, "", 0, 0);
+    if (rc < 0)
+        fail ("zmq_send");
+    join_peers (threads);
+    close_socket (s);
+    report ("churn", config.peers, subscriptions, elapsed, samples);
+}
+
+//  Connection storm. Each peer connects repeatedly, sending a single
+//  message over each connection. Latency is the time from connecting to
+//  the message being received, including the security handshake.
+static void run_connect (void *ctx_)
+{
+    void *s = open_socket (ctx_, ZMQ_ROUTER, true);
+    int rc = zmq_bind (s, endpoint);
+    if (rc != 0)
+        fail ("zmq_bind");
+
+    std::vector <peer_t> peers;
+    std::vector <void*> threads;
+    start_peers (ctx_, connect_worker, config.peers, config.connections, true,
+        peers, threads);
+
+    samples_t samples;
+    samples.reserve (config.connections);
+    uint64_t start = 0;
+    zmq_msg_t identity;
+    rc = zmq_msg_init (&identity);
+    if (rc != 0)
+        fail ("zmq_msg_init");
+    for (int i = 0; i != config.connections; i++) {
+        rc = zmq_recvmsg (s, &identity, 0);
+        if (rc < 0)
+            fail ("zmq_recvmsg");
+        uint64_t stamp = recv_message (s, false);
+        uint64_t now = now_ns ();
+        if (i == 0)
+            start = stamp;
+        samples.push_back (now - stamp);
+
+        //  Let the peer move on to the next connection.
+        rc = zmq_sendmsg (s, &identity, ZMQ_SNDMORE);
+        if (rc < 0)
+            fail ("zmq_sendmsg");
+        rc = zmq_send (s, "", 1, 0);
+        if (rc < 0)
+            fail ("zmq_send");
+    }
+    uint64_t elapsed = now_ns () - start;
+    rc = zmq_msg_close (&identity);
+    if (rc != 0)
+        fail ("zmq_msg_close");
+
+    join_peers (threads);
+    close_socket (s);
+    report ("connect", config.peers, config.connections, elapsed, samples);
+}
+
+struct scenario_t
+{
+    const char *name;
+    void (*run) (void *ctx_);
+};
+
+static const scenario_t scenarios [] = {
+    {"lat", run_lat},
+    {"thr", run_thr},
+    {"fanout", run_fanout},
+    {"fanin", run_fanin},
+    {"churn", run_churn},
+    {"connect", run_connect}
+};
+
+static void usage ()
+{
+    printf ("usage: bench [-s lat|thr|fanout|fanin|churn|connect|all] "
+        "[-t inproc|ipc|tcp]\n"
+        "             [-m <message-size>] [-p <message-parts>] "
+        "[-n <message-count>]\n"
+        "             [-N <peers>] [-C <connection-count>] "
+        "[-S <tcp-stripes>] [-I <io-threads>]\n"
+        "             [-c] [-j]\n");
+    exit (1);
+}
+
+int main (int argc, char *argv [])
+{
+    config.scenario = "all";
+    config.transport = "inproc";
+    config.message_size = 100;
+    config.parts = 1;
+    config.count = 100000;
+    config.peers = 4;
+    config.connections = 1000;
+    config.stripes = 1;
+    config.io_threads = 1;
+    config.curve = false;
+    config.json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp (argv [i], "-c") == 0)
+            config.curve = true;
+        else
+        if (strcmp (argv [i], "-j") == 0)
+            config.json = true;
+        else
+        if (i + 1 == argc || argv [i][0] != '-' || strlen (argv [i]) != 2)
+            usage ();
+        else {
+            const char *value = argv [++i];
+            switch (argv [i - 1][1]) {
+            case 's':
+                config.scenario = value;
+                break;
+            case 't':
+                config.transport = value;
+                break;
+            case 'm':
+                config.message_size = atoi (value);
+                break;
+            case 'p':
+                config.parts = atoi (value);
+                break;
+            case 'n':
+                config.count = atoi (value);
+                break;
+            case 'N':
+                config.peers = atoi (value);
+                break;
+            case 'C':
+                config.connections = atoi (value);
+                break;
+            case 'S':
+                config.stripes = atoi (value);
+                break;
+            case 'I':
+                config.io_threads = atoi (value);
+                break;
+            default:
+                usage ();
+            }
+        }
+    }
+    if (config.parts < 1 || config.count < 1 || config.peers < 1 ||
+          config.connections < 1 || config.stripes < 1 ||
+          config.io_threads < 1)
+        usage ();
+
+    if (strcmp (config.transport, "inproc") != 0 &&
+          strcmp (config.transport, "ipc") != 0 &&
+          strcmp (config.transport, "tcp") != 0)
+        usage ();
+    if (config.curve) {
+        if (strcmp (config.transport, "inproc") == 0) {
+            printf ("CURVE is not supported over inproc\n");
+            return 1;
+        }
+        int rc = zmq_curve_keypair (server_public, server_secret);
+        if (rc == 0)
+            rc = zmq_curve_keypair (client_public, client_secret);
+        if (rc != 0)
+            fail ("zmq_curve_keypair");
+    }
+
+    void *ctx = zmq_ctx_new ();
+    if (!ctx)
+        fail ("zmq_ctx_new");
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, config.io_threads);
+    if (rc != 0)
+        fail ("zmq_ctx_set");
+
+    bool found = false;
+    const int count = sizeof (scenarios) / sizeof (scenarios [0]);
+    for (int i = 0; i != count; i++) {
+        if (strcmp (config.scenario, "all") != 0 &&
+              strcmp (config.scenario, scenarios [i].name) != 0)
+            continue;
+        found = true;
+
+        //  Each scenario gets an endpoint of its own so that it doesn't
+        //  collide with the connections of the previous one.
+        if (strcmp (config.transport, "tcp") == 0)
+            sprintf (endpoint, "tcp://127.0.0.1:%d", 5575 + i);
+        else
+            sprintf (endpoint, "%s://bench-%s", config.transport,
+                scenarios [i].name);
+        cpu_start = cpu_ns ();
+        scenarios [i].run (ctx);
+    }
+    if (!found)
+        usage ();
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0)
+        fail ("zmq_ctx_term");
+
+    return 0;
+}
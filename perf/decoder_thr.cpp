@@ -0,0 +1,249 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <vector>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+
+int main (void)
+{
+    printf ("decoder_thr is not supported on this platform\n");
+    return 1;
+}
+
+#else
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+//  Measures how fast a PULL socket decodes messages. The peer is a plain
+//  TCP socket writing frames prepared in advance, so that the cost of the
+//  sending side doesn't enter the picture.
+
+static const unsigned short port = 5570;
+static int message_count;
+static size_t message_size;
+
+static void fail (const char *what_)
+{
+    printf ("error in %s: %s\n", what_, strerror (errno));
+    exit (1);
+}
+
+static void write_all (int s_, const unsigned char *data_, size_t size_)
+{
+    while (size_ > 0) {
+        const ssize_t n = send (s_, data_, size_, 0);
+        if (n == -1)
+            fail ("send");
+        data_ += n;
+        size_ -= n;
+    }
+}
+
+static void read_all (int s_, unsigned char *data_, size_t size_)
+{
+    while (size_ > 0) {
+        const ssize_t n = recv (s_, data_, size_, 0);
+        if (n == -1)
+            fail ("recv");
+        if (n == 0) {
+            errno = ECONNRESET;
+            fail ("recv");
+        }
+        data_ += n;
+        size_ -= n;
+    }
+}
+
+static void feeder (void *)
+{
+    int s = socket (AF_INET, SOCK_STREAM, 0);
+    if (s == -1)
+        fail ("socket");
+    struct sockaddr_in addr;
+    memset (&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    addr.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    if (connect (s, (struct sockaddr*) &addr, sizeof addr) != 0)
+        fail ("connect");
+
+    //  ZMTP 3.0 greeting with the NULL mechanism, then the READY command.
+    unsigned char greeting [64];
+    memset (greeting, 0, sizeof greeting);
+    greeting [0] = 0xff;
+    greeting [9] = 0x7f;
+    greeting [10] = 3;
+    memcpy (greeting + 12, "NULL", 4);
+    write_all (s, greeting, sizeof greeting);
+    const unsigned char ready [] = {
+        0x04, 26, 5, 'R', 'E', 'A', 'D', 'Y',
+        11, 'S', 'o', 'c', 'k', 'e', 't', '-', 'T', 'y', 'p', 'e',
+        0, 0, 0, 4, 'P', 'U', 'S', 'H'
+    };
+    write_all (s, ready, sizeof ready);
+
+    //  Wait for the peer's greeting and READY command; messages sent
+    //  before the handshake completes are a protocol error.
+    unsigned char buffer [256];
+    read_all (s, buffer, sizeof greeting);
+    read_all (s, buffer, 2);
+    read_all (s, buffer, buffer [1]);
+
+    //  Frames are written in chunks of about 64kB.
+    const size_t header_size = message_size < 256 ? 2 : 9;
+    const size_t frame_size = header_size + message_size;
+    int frames_per_chunk = (int) (65536 / frame_size);
+    if (frames_per_chunk < 1)
+        frames_per_chunk = 1;
+    std::vector <unsigned char> chunk (frames_per_chunk * frame_size, 'x');
+    for (int i = 0; i != frames_per_chunk; i++) {
+        unsigned char *frame = &chunk [i * frame_size];
+        if (header_size == 2) {
+            frame [0] = 0;
+            frame [1] = (unsigned char) message_size;
+        }
+        else {
+            frame [0] = 0x02;
+            for (int j = 0; j != 8; j++)
+                frame [1 + j] = (unsigned char) (
+                    (uint64_t) message_size >> (56 - 8 * j));
+        }
+    }
+
+    for (int sent = 0; sent < message_count; sent += frames_per_chunk) {
+        int frames = message_count - sent;
+        if (frames > frames_per_chunk)
+            frames = frames_per_chunk;
+        write_all (s, &chunk [0], frames * frame_size);
+    }
+
+    //  Wait for the receiver to close the connection.
+    while (recv (s, buffer, sizeof buffer, 0) > 0)
+        ;
+    close (s);
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 3) {
+        printf ("usage: decoder_thr <message-size> <message-count>\n");
+        return 1;
+    }
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    if (message_count < 1) {
+        printf ("message-count must be positive\n");
+        return 1;
+    }
+
+    void *ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    void *s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    int hwm = 0;
+    int rc = zmq_setsockopt (s, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    char endpoint [64];
+    sprintf (endpoint, "tcp://127.0.0.1:%d", (int) port);
+    rc = zmq_bind (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *thread = zmq_threadstart (feeder, NULL);
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    void *watch = NULL;
+    for (int i = 0; i != message_count; i++) {
+        rc = zmq_msg_recv (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+        if (i == 0)
+            watch = zmq_stopwatch_start ();
+    }
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    zmq_threadclose (thread);
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    const double throughput = (double) (message_count - 1) /
+        (double) elapsed * 1000000;
+    const double megabits = throughput * message_size * 8 / 1000000;
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+    printf ("mean throughput: %.0f [msg/s]\n", throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", megabits);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,230 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <vector>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+
+int main (void)
+{
+    printf ("encoder_thr is not supported on this platform\n");
+    return 1;
+}
+
+#else
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+//  Measures how fast a PUSH socket encodes messages. The messages are all
+//  queued before the peer, a plain TCP socket, completes the handshake;
+//  the time taken for the encoded stream to arrive is measured then.
+
+static const unsigned short port = 5571;
+static int message_count;
+static size_t message_size;
+static unsigned long elapsed;
+
+static void fail (const char *what_)
+{
+    printf ("error in %s: %s\n", what_, strerror (errno));
+    exit (1);
+}
+
+static void write_all (int s_, const unsigned char *data_, size_t size_)
+{
+    while (size_ > 0) {
+        const ssize_t n = send (s_, data_, size_, 0);
+        if (n == -1)
+            fail ("send");
+        data_ += n;
+        size_ -= n;
+    }
+}
+
+static void read_all (int s_, unsigned char *data_, size_t size_)
+{
+    while (size_ > 0) {
+        const ssize_t n = recv (s_, data_, size_, 0);
+        if (n == -1)
+            fail ("recv");
+        if (n == 0) {
+            errno = ECONNRESET;
+            fail ("recv");
+        }
+        data_ += n;
+        size_ -= n;
+    }
+}
+
+static void sink (void *listener_)
+{
+    const int listener = *(int*) listener_;
+    const int s = accept (listener, NULL, NULL);
+    if (s == -1)
+        fail ("accept");
+
+    //  ZMTP 3.0 greeting with the NULL mechanism, then the READY command.
+    unsigned char greeting [64];
+    memset (greeting, 0, sizeof greeting);
+    greeting [0] = 0xff;
+    greeting [9] = 0x7f;
+    greeting [10] = 3;
+    memcpy (greeting + 12, "NULL", 4);
+    write_all (s, greeting, sizeof greeting);
+    const unsigned char ready [] = {
+        0x04, 26, 5, 'R', 'E', 'A', 'D', 'Y',
+        11, 'S', 'o', 'c', 'k', 'e', 't', '-', 'T', 'y', 'p', 'e',
+        0, 0, 0, 4, 'P', 'U', 'L', 'L'
+    };
+    write_all (s, ready, sizeof ready);
+
+    //  Skip the peer's greeting and READY command.
+    std::vector <unsigned char> buffer (65536);
+    read_all (s, &buffer [0], sizeof greeting);
+    read_all (s, &buffer [0], 2);
+    read_all (s, &buffer [0], buffer [1]);
+
+    const size_t header_size = message_size < 256 ? 2 : 9;
+    uint64_t to_read = (uint64_t) message_count * (header_size + message_size);
+
+    void *watch = zmq_stopwatch_start ();
+    while (to_read > 0) {
+        const ssize_t n = recv (s, &buffer [0], buffer.size (), 0);
+        if (n == -1)
+            fail ("recv");
+        if (n == 0) {
+            errno = ECONNRESET;
+            fail ("recv");
+        }
+        to_read -= n;
+    }
+    elapsed = zmq_stopwatch_stop (watch);
+    close (s);
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 3) {
+        printf ("usage: encoder_thr <message-size> <message-count>\n");
+        return 1;
+    }
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    if (message_count < 1) {
+        printf ("message-count must be positive\n");
+        return 1;
+    }
+
+    int listener = socket (AF_INET, SOCK_STREAM, 0);
+    if (listener == -1)
+        fail ("socket");
+    int reuse = 1;
+    setsockopt (listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
+    struct sockaddr_in addr;
+    memset (&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    addr.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    if (bind (listener, (struct sockaddr*) &addr, sizeof addr) != 0)
+        fail ("bind");
+    if (listen (listener, 1) != 0)
+        fail ("listen");
+
+    void *ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    int hwm = 0;
+    int rc = zmq_setsockopt (s, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    char endpoint [64];
+    sprintf (endpoint, "tcp://127.0.0.1:%d", (int) port);
+    rc = zmq_connect (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    zmq_msg_t msg;
+    for (int i = 0; i != message_count; i++) {
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        memset (zmq_msg_data (&msg), 'x', message_size);
+        rc = zmq_msg_send (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    void *thread = zmq_threadstart (sink, &listener);
+    zmq_threadclose (thread);
+    close (listener);
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    if (elapsed == 0)
+        elapsed = 1;
+    const double throughput = (double) message_count /
+        (double) elapsed * 1000000;
+    const double megabits = throughput * message_size * 8 / 1000000;
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+    printf ("mean throughput: %.0f [msg/s]\n", throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", megabits);
+
+    return 0;
+}
+
+#endif
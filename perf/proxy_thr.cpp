@@ -0,0 +1,255 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//  Measures the throughput of messages passed from a PUSH socket through
+//  a proxy to a PULL socket, all over inproc. The proxy runs either in
+//  its own thread (zmq_proxy_steerable) or in an I/O thread
+//  (zmq_proxy_detached).
+
+static int message_count;
+static size_t message_size;
+
+struct proxy_args_t
+{
+    void *frontend;
+    void *backend;
+    void *control;
+};
+
+static void proxy (void *args_)
+{
+    proxy_args_t *args = (proxy_args_t*) args_;
+    int rc = zmq_proxy_steerable (args->frontend, args->backend, NULL,
+        args->control);
+    if (rc != 0) {
+        printf ("error in zmq_proxy_steerable: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+static void producer (void *ctx_)
+{
+    void *s = zmq_socket (ctx_, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    int rc = zmq_connect (s, "inproc://frontend");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (int i = 0; i != message_count; i++) {
+        zmq_msg_t msg;
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+#if defined ZMQ_MAKE_VALGRIND_HAPPY
+        memset (zmq_msg_data (&msg), 0, message_size);
+#endif
+        rc = zmq_msg_send (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+static void *create_bound (void *ctx_, int type_, const char *addr_)
+{
+    void *s = zmq_socket (ctx_, type_);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    int rc = zmq_bind (s, addr_);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    return s;
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 3 && argc != 4) {
+        printf ("usage: proxy_thr <message-size> <message-count> "
+            "[thread|detached]\n");
+        return 1;
+    }
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    const bool detached = argc == 4 && strcmp (argv [3], "detached") == 0;
+
+    void *ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    proxy_args_t args;
+    args.frontend = create_bound (ctx, ZMQ_PULL, "inproc://frontend");
+    args.backend = create_bound (ctx, ZMQ_PUSH, "inproc://backend");
+    args.control = create_bound (ctx, ZMQ_PAIR, "inproc://control");
+
+    void *steer = zmq_socket (ctx, ZMQ_PAIR);
+    if (!steer) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    int rc = zmq_connect (steer, "inproc://control");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_connect (s, "inproc://backend");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *proxy_thread = NULL;
+    if (detached) {
+        rc = zmq_proxy_detached (args.frontend, args.backend, NULL,
+            args.control);
+        if (rc != 0) {
+            printf ("error in zmq_proxy_detached: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    else
+        proxy_thread = zmq_threadstart (&proxy, &args);
+
+    void *producer_thread = zmq_threadstart (&producer, ctx);
+
+    printf ("proxy: %s\n", detached ? "detached" : "thread");
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", (int) message_count);
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_msg_recv (&msg, s, 0);
+    if (rc < 0) {
+        printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *watch = zmq_stopwatch_start ();
+
+    for (int i = 0; i != message_count - 1; i++) {
+        rc = zmq_msg_recv (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+    }
+
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Ask the proxy what it has seen.
+    rc = zmq_send (steer, "STATISTICS", 10, 0);
+    if (rc != 10) {
+        printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    uint64_t stats [8];
+    for (int i = 0; i != 8; i++) {
+        rc = zmq_recv (steer, &stats [i], sizeof stats [i], 0);
+        if (rc != sizeof stats [i]) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    rc = zmq_send (steer, "TERMINATE", 9, 0);
+    if (rc != 9) {
+        printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    zmq_threadclose (producer_thread);
+    if (proxy_thread) {
+        zmq_threadclose (proxy_thread);
+        zmq_close (args.frontend);
+        zmq_close (args.backend);
+        zmq_close (args.control);
+    }
+    zmq_close (steer);
+    zmq_close (s);
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    unsigned long throughput = (unsigned long)
+        ((double) message_count / (double) elapsed * 1000000);
+    double megabits = (double) (throughput * message_size * 8) / 1000000;
+
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", (double) megabits);
+    printf ("frontend: %llu frames, %llu bytes in\n",
+        (unsigned long long) stats [0], (unsigned long long) stats [1]);
+    printf ("backend: %llu frames, %llu bytes out\n",
+        (unsigned long long) stats [6], (unsigned long long) stats [7]);
+
+    return 0;
+}
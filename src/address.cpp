@@ -23,6 +23,7 @@
 #include "tcp_address.hpp"
 #include "ipc_address.hpp"
 #include "tipc_address.hpp"
+#include "udp_address.hpp"
 
 #include <string>
 #include <sstream>
@@ -45,12 +46,19 @@ zmq::address_t::~address_t ()
     }
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     else
-    if (protocol == "ipc") {
+    if (protocol == "ipc" || protocol == "shm") {
         if (resolved.ipc_addr) {
             delete resolved.ipc_addr;
             resolved.ipc_addr = 0;
         }
     }
+    else
+    if (protocol == "udp") {
+        if (resolved.udp_addr) {
+            delete resolved.udp_addr;
+            resolved.udp_addr = 0;
+        }
+    }
 #endif
 #if defined ZMQ_HAVE_TIPC
     else if (protocol == "tipc") {
@@ -74,6 +82,21 @@ int zmq::address_t::to_string (std::string &addr_) const
         if (resolved.ipc_addr)
             return resolved.ipc_addr->to_string(addr_);
     }
+    else
+    if (protocol == "shm") {
+        if (resolved.ipc_addr) {
+            //  The peers of a shm endpoint meet at the ipc one.
+            int rc = resolved.ipc_addr->to_string (addr_);
+            if (rc == 0)
+                addr_.replace (0, 3, "shm");
+            return rc;
+        }
+    }
+    else
+    if (protocol == "udp") {
+        if (resolved.udp_addr)
+            return resolved.udp_addr->to_string (addr_);
+    }
 #endif
 #if defined ZMQ_HAVE_TIPC
     else if (protocol == "tipc") {
@@ -182,6 +182,73 @@ namespace zmq
         const atomic_counter_t& operator = (const atomic_counter_t&);
     };
 
+    //  64-bit counter for statistics that must not wrap. Unlike with
+    //  atomic_counter_t, reading the value is atomic as well, so that it
+    //  doesn't tear on 32-bit platforms.
+
+    class atomic_counter64_t
+    {
+    public:
+
+        typedef uint64_t integer_t;
+
+        inline atomic_counter64_t (integer_t value_ = 0) :
+            value (value_)
+        {
+        }
+
+        inline ~atomic_counter64_t ()
+        {
+        }
+
+        //  Atomic addition. Returns the old value.
+        inline integer_t add (integer_t increment_)
+        {
+#if defined ZMQ_ATOMIC_COUNTER_WINDOWS
+            return (integer_t) InterlockedExchangeAdd64 (
+                (LONGLONG volatile*) &value, (LONGLONG) increment_);
+#elif defined ZMQ_ATOMIC_COUNTER_ATOMIC_H
+            return atomic_add_64_nv (&value, increment_) - increment_;
+#elif defined ZMQ_ATOMIC_COUNTER_MUTEX
+            sync.lock ();
+            integer_t old_value = value;
+            value += increment_;
+            sync.unlock ();
+            return old_value;
+#else
+            return __sync_fetch_and_add (&value, increment_);
+#endif
+        }
+
+        //  Atomic read.
+        inline integer_t get ()
+        {
+#if defined ZMQ_ATOMIC_COUNTER_WINDOWS
+            return (integer_t) InterlockedCompareExchange64 (
+                (LONGLONG volatile*) &value, 0, 0);
+#elif defined ZMQ_ATOMIC_COUNTER_ATOMIC_H
+            return atomic_add_64_nv (&value, 0);
+#elif defined ZMQ_ATOMIC_COUNTER_MUTEX
+            sync.lock ();
+            integer_t result = value;
+            sync.unlock ();
+            return result;
+#else
+            return __sync_fetch_and_add (&value, 0);
+#endif
+        }
+
+    private:
+
+        volatile integer_t value;
+#if defined ZMQ_ATOMIC_COUNTER_MUTEX
+        mutex_t sync;
+#endif
+
+        atomic_counter64_t (const atomic_counter64_t&);
+        const atomic_counter64_t& operator = (const atomic_counter64_t&);
+    };
+
 }
 
 //  Remove macros local to this file.
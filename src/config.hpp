@@ -46,21 +46,36 @@ namespace zmq
         //  Maximal batching size for engines with receiving functionality.
         //  So, if there are 10 messages that fit into the batch size, all of
         //  them may be read by a single 'recv' system call, thus avoiding
-        //  unnecessary network stack traversals.
+        //  unnecessary network stack traversals. This is the default for
+        //  ZMQ_IN_BATCH_SIZE.
         in_batch_size = 8192,
 
         //  Maximal batching size for engines with sending functionality.
         //  So, if there are 10 messages that fit into the batch size, all of
         //  them may be written by a single 'send' system call, thus avoiding
-        //  unnecessary network stack traversals.
+        //  unnecessary network stack traversals. This is the default for
+        //  ZMQ_OUT_BATCH_SIZE.
         out_batch_size = 8192,
 
+        //  Upper limit of ZMQ_IN_BATCH_SIZE and ZMQ_OUT_BATCH_SIZE. Each
+        //  connection allocates buffers of this size, so larger values
+        //  would only waste memory.
+        max_batch_size = 16777216,
+
         //  Maximal delta between high and low watermark.
         max_wm_delta = 1024,
 
         //  Maximum number of events the I/O thread can process in one go.
         max_io_events = 256,
 
+        //  Maximum number of socket and file descriptor handlers a reactor
+        //  dispatches in one iteration.
+        reactor_max_events = 64,
+
+        //  Maximum number of messages a proxy forwards in one direction
+        //  before it turns to the other direction and the control socket.
+        proxy_burst_size = 256,
+
         //  Maximal delay to process command in API thread (in CPU ticks).
         //  3,000,000 ticks equals to 1 - 2 milliseconds on current CPUs.
         //  Note that delay is only applied when there is continuous stream of
@@ -79,7 +94,57 @@ namespace zmq
 
         //  On some OSes the signaler has to be emulated using a TCP
         //  connection. In such cases following port is used.
-        signaler_port = 5905
+        signaler_port = 5905,
+
+        //  Size of a single segment file used to spill messages to disk
+        //  when the pipe reaches its high water mark. Messages larger than
+        //  this get a segment of their own.
+        spill_segment_size = 16777216,
+
+        //  Maximal number of messages encrypted or decrypted in one go when
+        //  the work is spread over the crypto worker threads.
+        crypto_batch_size = 64,
+
+        //  Number of short-term key pairs kept ready for CURVE servers to
+        //  hand out to new connections.
+        curve_keypool_size = 256,
+
+        //  Size of the ring each direction of a shm connection gets. Must be
+        //  a power of two. Messages larger than half of it are split up.
+        shm_ring_size = 4194304,
+
+        //  Messages at least this large are lent to the receiving application
+        //  straight out of a shm ring instead of being copied out of it.
+        shm_borrow_threshold = 65536,
+
+        //  Maximum number of bulk frame descriptors (ZMQ_IPC_BULK_THRESHOLD)
+        //  passed along with a single write to an ipc socket.
+        ipc_bulk_max_fds = 64,
+
+        //  Maximum number of datagrams a udp engine sends or receives with
+        //  a single system call.
+        udp_batch_size = 16,
+
+        //  Largest datagram a udp engine handles. Messages that do not fit
+        //  into a single datagram are dropped.
+        udp_max_datagram = 65507,
+
+        //  When a tcp endpoint resolves to several addresses, delay before
+        //  connecting to the next one while the previous attempts are still
+        //  in progress, in milliseconds (RFC 8305).
+        tcp_attempt_delay = 250,
+
+        //  Size of the CPU cache line. Data modified by different threads
+        //  are kept this far apart to avoid false sharing.
+        cache_line_size = 64,
+
+        //  With ZMQ_ADAPTIVE_BATCH, engine buffers double in size up to this
+        //  many bytes while reads or writes fill them...
+        adaptive_batch_max = 262144,
+
+        //  ...and halve once this many reads or writes in a row used less
+        //  than a quarter of them.
+        adaptive_batch_shrink_after = 16
     };
 
 }
@@ -0,0 +1,114 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <new>
+
+#include "crypto_pool.hpp"
+#include "err.hpp"
+
+zmq::crypto_pool_t::crypto_pool_t (int thread_count_) :
+    thread_count (thread_count_),
+    fn (NULL),
+    arg (NULL),
+    count (0),
+    stopping (false)
+{
+    zmq_assert (thread_count > 0);
+    workers = new (std::nothrow) worker_t [thread_count];
+    alloc_assert (workers);
+    for (int i = 0; i != thread_count; i++) {
+        workers [i].pool = this;
+        workers [i].thread.start (worker_routine, &workers [i]);
+    }
+}
+
+zmq::crypto_pool_t::~crypto_pool_t ()
+{
+    stopping = true;
+    for (int i = 0; i != thread_count; i++)
+        workers [i].wakeup.send ();
+    for (int i = 0; i != thread_count; i++)
+        workers [i].thread.stop ();
+    delete [] workers;
+}
+
+void zmq::crypto_pool_t::run (task_fn *fn_, void *arg_, int count_)
+{
+    //  Single tasks are not worth the hand-over. Concurrent batches
+    //  are processed by their submitters rather than serialised.
+    if (count_ < 2 || !sync.try_lock ()) {
+        for (int i = 0; i != count_; i++)
+            fn_ (arg_, i);
+        return;
+    }
+
+    fn = fn_;
+    arg = arg_;
+    count = count_;
+    next.set (0);
+
+    //  The submitting thread takes one share of the work itself.
+    const int helpers = count_ - 1 < thread_count ? count_ - 1 : thread_count;
+    active.set (helpers);
+    for (int i = 0; i != helpers; i++)
+        workers [i].wakeup.send ();
+
+    process ();
+
+    //  Wait for the helpers to finish their last task.
+    int rc = done.wait (-1);
+    while (rc == -1 && errno == EINTR)
+        rc = done.wait (-1);
+    errno_assert (rc == 0);
+    done.recv ();
+
+    sync.unlock ();
+}
+
+void zmq::crypto_pool_t::worker_routine (void *arg_)
+{
+    worker_t *self = (worker_t*) arg_;
+    crypto_pool_t *pool = self->pool;
+
+    while (true) {
+        int rc = self->wakeup.wait (-1);
+        if (rc == -1) {
+            errno_assert (errno == EINTR);
+            continue;
+        }
+        self->wakeup.recv ();
+        if (pool->stopping)
+            break;
+
+        pool->process ();
+        if (!pool->active.sub (1))
+            pool->done.send ();
+    }
+}
+
+void zmq::crypto_pool_t::process ()
+{
+    while (true) {
+        const int index = (int) next.add (1);
+        if (index >= count)
+            break;
+        fn (arg, index);
+    }
+}
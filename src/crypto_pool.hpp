@@ -0,0 +1,93 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_CRYPTO_POOL_HPP_INCLUDED__
+#define __ZMQ_CRYPTO_POOL_HPP_INCLUDED__
+
+#include "thread.hpp"
+#include "signaler.hpp"
+#include "mutex.hpp"
+#include "atomic_counter.hpp"
+
+namespace zmq
+{
+
+    //  Pool of worker threads for CPU-bound per-message work such as
+    //  encryption. The work is submitted as a batch of independent tasks,
+    //  identified by their index. The submitting thread participates in
+    //  processing the batch and returns once all the tasks are done.
+
+    class crypto_pool_t
+    {
+    public:
+
+        typedef void (task_fn) (void *arg_, int index_);
+
+        crypto_pool_t (int thread_count_);
+        ~crypto_pool_t ();
+
+        //  Invokes 'fn_' for each index in [0, count_). If the pool is
+        //  already processing a batch submitted by other thread, the tasks
+        //  are run by the calling thread instead of waiting for the pool.
+        void run (task_fn *fn_, void *arg_, int count_);
+
+    private:
+
+        struct worker_t
+        {
+            crypto_pool_t *pool;
+            thread_t thread;
+            signaler_t wakeup;
+        };
+
+        //  Main routine of the worker threads.
+        static void worker_routine (void *arg_);
+
+        //  Claims and runs tasks of the current batch until none is left.
+        void process ();
+
+        worker_t *workers;
+        int thread_count;
+
+        //  Only one batch at a time is processed by the pool.
+        mutex_t sync;
+
+        //  The batch being processed.
+        task_fn *fn;
+        void *arg;
+        int count;
+
+        //  Index of the next task to claim.
+        atomic_counter_t next;
+
+        //  Number of workers yet to finish the current batch. The last
+        //  one to finish signals the submitting thread.
+        atomic_counter_t active;
+        signaler_t done;
+
+        volatile bool stopping;
+
+        crypto_pool_t (const crypto_pool_t&);
+        const crypto_pool_t &operator = (const crypto_pool_t&);
+    };
+
+}
+
+#endif
@@ -31,6 +31,8 @@
 #include "socket_base.hpp"
 #include "io_thread.hpp"
 #include "reaper.hpp"
+#include "crypto_pool.hpp"
+#include "curve_keypool.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
@@ -51,15 +53,25 @@ zmq::ctx_t::ctx_t () :
     starting (true),
     terminating (false),
     reaper (NULL),
+    crypto_pool (NULL),
+    curve_keypool (NULL),
     slot_count (0),
     slots (NULL),
     max_sockets (clipped_maxsocket (ZMQ_MAX_SOCKETS_DFLT)),
     io_thread_count (ZMQ_IO_THREADS_DFLT),
+    crypto_thread_count (ZMQ_CRYPTO_THREADS_DFLT),
     ipv6 (false)
 {
 #ifdef HAVE_FORK
     pid = getpid();
 #endif
+#ifdef HAVE_LIBSODIUM
+    //  Lets libsodium pick the fastest implementations for this CPU
+    int rc = sodium_init ();
+    zmq_assert (rc != -1);
+    curve_keypool = new (std::nothrow) curve_keypool_t ();
+    alloc_assert (curve_keypool);
+#endif
 }
 
 bool zmq::ctx_t::check_tag ()
@@ -81,6 +93,13 @@ zmq::ctx_t::~ctx_t ()
     for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
         delete io_threads [i];
 
+    //  Crypto workers are only used by I/O threads, so they can go now.
+    delete crypto_pool;
+
+#ifdef HAVE_LIBSODIUM
+    delete curve_keypool;
+#endif
+
     //  Deallocate the reaper thread object.
     delete reaper;
 
@@ -181,6 +200,12 @@ int zmq::ctx_t::set (int option_, int optval_)
         opt_sync.unlock ();
     }
     else
+    if (option_ == ZMQ_CRYPTO_THREADS && optval_ >= 0) {
+        opt_sync.lock ();
+        crypto_thread_count = optval_;
+        opt_sync.unlock ();
+    }
+    else
     if (option_ == ZMQ_IPV6 && optval_ >= 0) {
         opt_sync.lock ();
         ipv6 = (optval_ != 0);
@@ -202,6 +227,9 @@ int zmq::ctx_t::get (int option_)
     if (option_ == ZMQ_IO_THREADS)
         rc = io_thread_count;
     else
+    if (option_ == ZMQ_CRYPTO_THREADS)
+        rc = crypto_thread_count;
+    else
     if (option_ == ZMQ_IPV6)
         rc = ipv6;
     else {
@@ -222,6 +250,7 @@ zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
         opt_sync.lock ();
         int mazmq = max_sockets;
         int ios = io_thread_count;
+        int cryptos = crypto_thread_count;
         opt_sync.unlock ();
         slot_count = mazmq + ios + 2;
         slots = (mailbox_t**) malloc (sizeof (mailbox_t*) * slot_count);
@@ -236,6 +265,12 @@ zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
         slots [reaper_tid] = reaper->get_mailbox ();
         reaper->start ();
 
+        //  Create the crypto workers before any I/O thread can use them.
+        if (cryptos > 0) {
+            crypto_pool = new (std::nothrow) crypto_pool_t (cryptos);
+            alloc_assert (crypto_pool);
+        }
+
         //  Create I/O thread objects and launch them.
         for (int i = 2; i != ios + 2; i++) {
             io_thread_t *io_thread = new (std::nothrow) io_thread_t (this, i);
@@ -313,6 +348,21 @@ zmq::object_t *zmq::ctx_t::get_reaper ()
     return reaper;
 }
 
+zmq::crypto_pool_t *zmq::ctx_t::get_crypto_pool ()
+{
+    return crypto_pool;
+}
+
+zmq::curve_keypool_t *zmq::ctx_t::get_curve_keypool ()
+{
+    return curve_keypool;
+}
+
+zmq::zap_cache_t *zmq::ctx_t::get_zap_cache ()
+{
+    return &zap_cache;
+}
+
 void zmq::ctx_t::send_command (uint32_t tid_, const command_t &command_)
 {
     slots [tid_]->send (command_);
@@ -323,10 +373,16 @@ zmq::io_thread_t *zmq::ctx_t::choose_io_thread (uint64_t affinity_)
     if (io_threads.empty ())
         return NULL;
 
-    //  Find the I/O thread with minimum load.
+    //  Find the I/O thread with minimum load. The search starts with
+    //  a different thread each time. The load is only updated once the
+    //  new object is plugged in, so a burst of connections would
+    //  otherwise end up in the same thread, handshakes and all.
+    const io_threads_t::size_type count = io_threads.size ();
+    const io_threads_t::size_type first = next_io_thread.add (1) % count;
     int min_load = -1;
     io_thread_t *selected_io_thread = NULL;
-    for (io_threads_t::size_type i = 0; i != io_threads.size (); i++) {
+    for (io_threads_t::size_type n = 0; n != count; n++) {
+        const io_threads_t::size_type i = (first + n) % count;
         if (!affinity_ || (affinity_ & (uint64_t (1) << i))) {
             int load = io_threads [i]->get_load ();
             if (selected_io_thread == NULL || load < min_load) {
@@ -342,8 +398,27 @@ int zmq::ctx_t::register_endpoint (const char *addr_, endpoint_t &endpoint_)
 {
     endpoints_sync.lock ();
 
-    bool inserted = endpoints.insert (endpoints_t::value_type (
-        std::string (addr_), endpoint_)).second;
+    bool inserted = false;
+    if (endpoint_.options.shard_strategy == 0) {
+        if (shared_endpoints.find (addr_) == shared_endpoints.end ())
+            inserted = endpoints.insert (endpoints_t::value_type (
+                std::string (addr_), endpoint_)).second;
+    }
+    else
+    if (endpoints.find (addr_) == endpoints.end ()) {
+
+        //  Sockets can only share an endpoint if they agree on the way
+        //  the peers are spread across them.
+        shared_endpoint_t &shared = shared_endpoints [addr_];
+        if (shared.members.empty ()) {
+            shared.strategy = endpoint_.options.shard_strategy;
+            shared.next = 0;
+        }
+        if (shared.strategy == endpoint_.options.shard_strategy) {
+            shared.members.push_back (endpoint_);
+            inserted = true;
+        }
+    }
 
     endpoints_sync.unlock ();
 
@@ -370,21 +445,39 @@ void zmq::ctx_t::unregister_endpoints (socket_base_t *socket_)
         ++it;
     }
 
+    shared_endpoints_t::iterator sit = shared_endpoints.begin ();
+    while (sit != shared_endpoints.end ()) {
+        std::vector <endpoint_t> &members = sit->second.members;
+        for (size_t i = 0; i != members.size (); i++)
+            if (members [i].socket == socket_) {
+                members.erase (members.begin () + i);
+                break;
+            }
+        if (members.empty ()) {
+            shared_endpoints_t::iterator to_erase = sit;
+            ++sit;
+            shared_endpoints.erase (to_erase);
+            continue;
+        }
+        ++sit;
+    }
+
     endpoints_sync.unlock ();
 }
 
-zmq::endpoint_t zmq::ctx_t::find_endpoint (const char *addr_)
+zmq::endpoint_t zmq::ctx_t::find_endpoint (const char *addr_,
+    const options_t &options_)
 {
      endpoints_sync.lock ();
 
-     endpoints_t::iterator it = endpoints.find (addr_);
-     if (it == endpoints.end ()) {
+     endpoint_t *found = choose_endpoint (addr_, options_);
+     if (!found) {
          endpoints_sync.unlock ();
          errno = ECONNREFUSED;
          endpoint_t empty = {NULL, options_t()};
          return empty;
      }
-     endpoint_t endpoint = it->second;
+     endpoint_t endpoint = *found;
 
      //  Increment the command sequence number of the peer so that it won't
      //  get deallocated until "bind" command is issued by the caller.
@@ -396,12 +489,40 @@ zmq::endpoint_t zmq::ctx_t::find_endpoint (const char *addr_)
      return endpoint;
 }
 
+zmq::endpoint_t *zmq::ctx_t::choose_endpoint (const char *addr_,
+    const options_t &options_)
+{
+    endpoints_t::iterator it = endpoints.find (addr_);
+    if (it != endpoints.end ())
+        return &it->second;
+
+    shared_endpoints_t::iterator sit = shared_endpoints.find (addr_);
+    if (sit == shared_endpoints.end ())
+        return NULL;
+    shared_endpoint_t &shared = sit->second;
+
+    //  Peers with an explicit identity always land on the same member
+    //  (FNV-1a hash). Anonymous peers are dealt out in turn.
+    uint32_t index;
+    if (shared.strategy == ZMQ_PROXY_SHARD_HASH && options_.identity_size) {
+        index = 2166136261u;
+        for (unsigned char i = 0; i != options_.identity_size; i++) {
+            index ^= options_.identity [i];
+            index *= 16777619u;
+        }
+    }
+    else
+        index = shared.next++;
+    return &shared.members [index % shared.members.size ()];
+}
+
 void zmq::ctx_t::pend_connection (const char *addr_, pending_connection_t &pending_connection_)
 {
     endpoints_sync.lock ();
 
-    endpoints_t::iterator it = endpoints.find (addr_);
-    if (it == endpoints.end ())
+    endpoint_t *endpoint = choose_endpoint (addr_,
+        pending_connection_.endpoint.options);
+    if (!endpoint)
     {
         // Still no bind.
         pending_connection_.endpoint.socket->inc_seqnum ();
@@ -410,7 +531,7 @@ void zmq::ctx_t::pend_connection (const char *addr_, pending_connection_t &pendi
     else
     {
         // Bind has happened in the mean time, connect directly
-        connect_inproc_sockets(it->second.socket, it->second.options, pending_connection_, connect_side);
+        connect_inproc_sockets(endpoint->socket, endpoint->options, pending_connection_, connect_side);
     }
 
     endpoints_sync.unlock ();
@@ -422,9 +543,24 @@ void zmq::ctx_t::connect_pending (const char *addr_, zmq::socket_base_t *bind_so
 
     std::pair<pending_connections_t::iterator, pending_connections_t::iterator> pending = pending_connections.equal_range(addr_);
 
+    //  Connections made before a shared endpoint was bound all go to the
+    //  first socket binding it.
+    options_t bind_options;
+    endpoints_t::iterator it = endpoints.find (addr_);
+    if (it != endpoints.end ())
+        bind_options = it->second.options;
+    else {
+        shared_endpoints_t::iterator sit = shared_endpoints.find (addr_);
+        zmq_assert (sit != shared_endpoints.end ());
+        std::vector <endpoint_t> &members = sit->second.members;
+        for (size_t i = 0; i != members.size (); i++)
+            if (members [i].socket == bind_socket_)
+                bind_options = members [i].options;
+    }
+
     for (pending_connections_t::iterator p = pending.first; p != pending.second; ++p)
     {
-        connect_inproc_sockets(bind_socket_, endpoints[addr_].options, p->second, bind_side);
+        connect_inproc_sockets(bind_socket_, bind_options, p->second, bind_side);
     }
 
     pending_connections.erase(pending.first, pending.second);
@@ -32,6 +32,7 @@
 #include "stdint.hpp"
 #include "options.hpp"
 #include "atomic_counter.hpp"
+#include "zap_cache.hpp"
 
 namespace zmq
 {
@@ -41,6 +42,8 @@ namespace zmq
     class socket_base_t;
     class reaper_t;
     class pipe_t;
+    class crypto_pool_t;
+    class curve_keypool_t;
 
     //  Information associated with inproc endpoint. Note that endpoint options
     //  are registered as well so that the peer can access them without a need
@@ -105,10 +108,20 @@ namespace zmq
         //  Returns reaper thread object.
         zmq::object_t *get_reaper ();
 
+        //  Returns the pool of crypto worker threads, NULL if there's none.
+        zmq::crypto_pool_t *get_crypto_pool ();
+
+        //  Returns the stock of short-term keys for CURVE servers. NULL if
+        //  the library is built without CURVE support.
+        zmq::curve_keypool_t *get_curve_keypool ();
+
+        //  Returns the cache of ZAP authentication results.
+        zmq::zap_cache_t *get_zap_cache ();
+
         //  Management of inproc endpoints.
         int register_endpoint (const char *addr_, endpoint_t &endpoint_);
         void unregister_endpoints (zmq::socket_base_t *socket_);
-        endpoint_t find_endpoint (const char *addr_);
+        endpoint_t find_endpoint (const char *addr_, const options_t &options_);
         void pend_connection (const char *addr_, pending_connection_t &pending_connection_);
         void connect_pending (const char *addr_, zmq::socket_base_t *bind_socket_);
 
@@ -155,6 +168,18 @@ namespace zmq
         typedef std::vector <zmq::io_thread_t*> io_threads_t;
         io_threads_t io_threads;
 
+        //  I/O thread to start the search for the least busy one with.
+        atomic_counter_t next_io_thread;
+
+        //  Worker threads offloading message encryption from I/O threads.
+        zmq::crypto_pool_t *crypto_pool;
+
+        //  Pregenerated short-term keys shared by the CURVE servers.
+        zmq::curve_keypool_t *curve_keypool;
+
+        //  Successful ZAP authentications, shared by all the sockets.
+        zap_cache_t zap_cache;
+
         //  Array of pointers to mailboxes for both application and I/O threads.
         uint32_t slot_count;
         mailbox_t **slots;
@@ -166,6 +191,24 @@ namespace zmq
         typedef std::map <std::string, endpoint_t> endpoints_t;
         endpoints_t endpoints;
 
+        //  Inproc endpoints bound by several sockets at once, see
+        //  options_t::shard_strategy. Each peer connecting to such an
+        //  endpoint is handed to one of the members.
+        struct shared_endpoint_t
+        {
+            int strategy;
+            uint32_t next;
+            std::vector <endpoint_t> members;
+        };
+        typedef std::map <std::string, shared_endpoint_t> shared_endpoints_t;
+        shared_endpoints_t shared_endpoints;
+
+        //  Returns the endpoint a peer with the given options should connect
+        //  to, NULL if the address isn't bound. Called with endpoints_sync
+        //  held.
+        endpoint_t *choose_endpoint (const char *addr_,
+            const options_t &options_);
+
         // List of inproc connection endpoints pending a bind
         typedef std::multimap <std::string, pending_connection_t> pending_connections_t;
         pending_connections_t pending_connections;
@@ -182,6 +225,9 @@ namespace zmq
         //  Number of I/O threads to launch.
         int io_thread_count;
 
+        //  Number of crypto worker threads to launch.
+        int crypto_thread_count;
+
         //  Is IPv6 enabled on this context?
         bool ipv6;
 
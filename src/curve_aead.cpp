@@ -0,0 +1,179 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+
+#include <string.h>
+
+#include "curve_aead.hpp"
+#include "err.hpp"
+
+//  The AEAD constructions appeared in libsodium 1.0.4. With older versions
+//  no cipher is offered and the peers stick to the standard boxes.
+#ifdef crypto_aead_aes256gcm_NPUBBYTES
+#define ZMQ_HAVE_CURVE_AEAD
+#endif
+
+zmq::curve_aead_t::curve_aead_t () :
+    cipher (none)
+{
+}
+
+zmq::curve_aead_t::~curve_aead_t ()
+{
+    memset (send_key, 0, sizeof send_key);
+    memset (recv_key, 0, sizeof recv_key);
+}
+
+std::string zmq::curve_aead_t::offer ()
+{
+    std::string ciphers;
+#ifdef ZMQ_HAVE_CURVE_AEAD
+    //  AES-GCM is only fast, and constant-time, with hardware support.
+    if (crypto_aead_aes256gcm_is_available ()) {
+        ciphers += name (aes256_gcm);
+        ciphers += ",";
+    }
+    ciphers += name (chacha20_poly1305);
+#endif
+    return ciphers;
+}
+
+zmq::curve_aead_t::cipher_t zmq::curve_aead_t::choose (
+    const std::string &offer_)
+{
+    const std::string available = "," + offer () + ",";
+    size_t start = 0;
+    while (start <= offer_.length ()) {
+        size_t end = offer_.find (',', start);
+        if (end == std::string::npos)
+            end = offer_.length ();
+        const std::string candidate = offer_.substr (start, end - start);
+        if (!candidate.empty () &&
+              available.find ("," + candidate + ",") != std::string::npos)
+            return find (candidate);
+        start = end + 1;
+    }
+    return none;
+}
+
+zmq::curve_aead_t::cipher_t zmq::curve_aead_t::find (const std::string &name_)
+{
+    if (name_ == name (chacha20_poly1305))
+        return chacha20_poly1305;
+    if (name_ == name (aes256_gcm))
+        return aes256_gcm;
+    return none;
+}
+
+const char *zmq::curve_aead_t::name (cipher_t cipher_)
+{
+    switch (cipher_) {
+        case chacha20_poly1305:
+            return "CHACHA20-POLY1305";
+        case aes256_gcm:
+            return "AES-256-GCM";
+        default:
+            return "";
+    }
+}
+
+void zmq::curve_aead_t::init (cipher_t cipher_, const uint8_t *precom_,
+    bool as_server_)
+{
+    zmq_assert (cipher_ != none);
+    cipher = cipher_;
+
+    //  K = BLAKE2b (key = precomputed secret, label + cipher + direction)
+    const std::string label = std::string ("CurveZMQ-AEAD-") + name (cipher);
+    const std::string c2s = label + "-C";
+    const std::string s2c = label + "-S";
+    const std::string &send_label = as_server_ ? s2c : c2s;
+    const std::string &recv_label = as_server_ ? c2s : s2c;
+
+    int rc = crypto_generichash (send_key, key_size,
+        (const unsigned char *) send_label.data (), send_label.length (),
+        precom_, crypto_box_BEFORENMBYTES);
+    zmq_assert (rc == 0);
+    rc = crypto_generichash (recv_key, key_size,
+        (const unsigned char *) recv_label.data (), recv_label.length (),
+        precom_, crypto_box_BEFORENMBYTES);
+    zmq_assert (rc == 0);
+}
+
+#ifdef ZMQ_HAVE_CURVE_AEAD
+
+void zmq::curve_aead_t::seal (uint8_t *data_, size_t len_,
+    uint64_t nonce_) const
+{
+    //  96-bit nonce: zero padding followed by the message counter
+    uint8_t nonce [12];
+    memset (nonce, 0, 4);
+    memcpy (nonce + 4, &nonce_, 8);
+
+    unsigned long long clen;
+    int rc = -1;
+    if (cipher == aes256_gcm)
+        rc = crypto_aead_aes256gcm_encrypt (data_, &clen, data_, len_,
+            NULL, 0, NULL, nonce, send_key);
+    else
+    if (cipher == chacha20_poly1305)
+        rc = crypto_aead_chacha20poly1305_ietf_encrypt (data_, &clen, data_,
+            len_, NULL, 0, NULL, nonce, send_key);
+    zmq_assert (rc == 0);
+    zmq_assert (clen == len_ + tag_size);
+}
+
+int zmq::curve_aead_t::open (uint8_t *data_, size_t len_,
+    uint64_t nonce_) const
+{
+    uint8_t nonce [12];
+    memset (nonce, 0, 4);
+    memcpy (nonce + 4, &nonce_, 8);
+
+    unsigned long long mlen;
+    int rc = -1;
+    if (cipher == aes256_gcm)
+        rc = crypto_aead_aes256gcm_decrypt (data_, &mlen, NULL, data_, len_,
+            NULL, 0, nonce, recv_key);
+    else
+    if (cipher == chacha20_poly1305)
+        rc = crypto_aead_chacha20poly1305_ietf_decrypt (data_, &mlen, NULL,
+            data_, len_, NULL, 0, nonce, recv_key);
+    return rc == 0 ? 0 : -1;
+}
+
+#else
+
+void zmq::curve_aead_t::seal (uint8_t *, size_t, uint64_t) const
+{
+    zmq_assert (false);
+}
+
+int zmq::curve_aead_t::open (uint8_t *, size_t, uint64_t) const
+{
+    return -1;
+}
+
+#endif
+
+#endif
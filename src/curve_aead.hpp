@@ -0,0 +1,103 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_CURVE_AEAD_HPP_INCLUDED__
+#define __ZMQ_CURVE_AEAD_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+#include <sodium.h>
+
+#include <string>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Symmetric cipher used for CURVE MESSAGE commands instead of the
+    //  XSalsa20-Poly1305 box when both peers agree on it during the
+    //  handshake. The client lists the ciphers it supports in the "Cipher"
+    //  property of INITIATE, the server names the one it picked in READY.
+    //  Each direction gets a key of its own, derived from the secret the
+    //  short-term keys share, so the message counter alone makes a unique
+    //  nonce. MESSAGE keeps its layout, with the tag after the data.
+
+    class curve_aead_t
+    {
+    public:
+
+        enum cipher_t {
+            none,
+            chacha20_poly1305,
+            aes256_gcm
+        };
+
+        curve_aead_t ();
+        ~curve_aead_t ();
+
+        //  Returns the list of ciphers available on this host, most
+        //  preferred first, as sent in the "Cipher" property.
+        static std::string offer ();
+
+        //  Picks the first cipher from the peer's list that's available
+        //  here. Returns 'none' if there's no such cipher.
+        static cipher_t choose (const std::string &offer_);
+
+        //  Returns the cipher of the given name, 'none' if unknown.
+        static cipher_t find (const std::string &name_);
+
+        static const char *name (cipher_t cipher_);
+
+        //  Starts using the cipher, deriving the keys from the secret
+        //  precomputed for the short-term keys.
+        void init (cipher_t cipher_, const uint8_t *precom_, bool as_server_);
+
+        bool active () const { return cipher != none; }
+
+        //  Encrypts 'len_' bytes in place and appends the tag.
+        void seal (uint8_t *data_, size_t len_, uint64_t nonce_) const;
+
+        //  Decrypts 'len_' bytes, including the tag, in place. Returns -1
+        //  if the data are not authentic.
+        int open (uint8_t *data_, size_t len_, uint64_t nonce_) const;
+
+        enum {
+            tag_size = 16,
+            key_size = 32
+        };
+
+    private:
+
+        cipher_t cipher;
+
+        uint8_t send_key [key_size];
+        uint8_t recv_key [key_size];
+
+        curve_aead_t (const curve_aead_t&);
+        const curve_aead_t &operator = (const curve_aead_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -29,13 +29,15 @@
 
 #include "msg.hpp"
 #include "session_base.hpp"
+#include "crypto_pool.hpp"
 #include "err.hpp"
 #include "curve_client.hpp"
 #include "wire.hpp"
 
 zmq::curve_client_t::curve_client_t (const options_t &options_) :
     mechanism_t (options_),
-    state (send_hello)
+    state (send_hello),
+    cipher (curve_aead_t::none)
 {
     memcpy (public_key, options_.curve_public_key, crypto_box_PUBLICKEYBYTES);
     memcpy (secret_key, options_.curve_secret_key, crypto_box_SECRETKEYBYTES);
@@ -105,48 +107,56 @@ int zmq::curve_client_t::encode (msg_t *msg_)
 {
     zmq_assert (state == connected);
 
+    const int rc = encode_message (msg_, cn_nonce);
+    if (rc == 0)
+        cn_nonce++;
+    return rc;
+}
+
+int zmq::curve_client_t::encode_message (msg_t *msg_, uint64_t nonce_)
+{
     uint8_t flags = 0;
     if (msg_->flags () & msg_t::more)
         flags |= 0x01;
+    if (msg_->flags () & msg_t::command)
+        flags |= 0x02;
 
     uint8_t message_nonce [crypto_box_NONCEBYTES];
     memcpy (message_nonce, "CurveZMQMESSAGEC", 16);
-    memcpy (message_nonce + 16, &cn_nonce, 8);
-
-    const size_t mlen = crypto_box_ZEROBYTES + 1 + msg_->size ();
+    memcpy (message_nonce + 16, &nonce_, 8);
 
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_plaintext);
+    const size_t mlen = 1 + msg_->size ();
 
-    memset (message_plaintext, 0, crypto_box_ZEROBYTES);
-    message_plaintext [crypto_box_ZEROBYTES] = flags;
-    memcpy (message_plaintext + crypto_box_ZEROBYTES + 1,
-            msg_->data (), msg_->size ());
-
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_box);
-
-    int rc = crypto_box_afternm (message_box, message_plaintext,
-                                 mlen, message_nonce, cn_precom);
+    //  The box is built directly in the resulting message. The flags and
+    //  the payload are placed behind the header and the MAC and encrypted
+    //  in place, so that there's a single allocation and copy per message.
+    //  The negotiated cipher, if any, puts its tag after the data instead.
+    msg_t encoded;
+    int rc = encoded.init_size (16 + crypto_box_MACBYTES + mlen);
     zmq_assert (rc == 0);
 
-    rc = msg_->close ();
-    zmq_assert (rc == 0);
-
-    rc = msg_->init_size (16 + mlen - crypto_box_BOXZEROBYTES);
-    zmq_assert (rc == 0);
-
-    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
+    uint8_t *message = static_cast <uint8_t *> (encoded.data ());
 
     memcpy (message, "\x07MESSAGE", 8);
-    memcpy (message + 8, &cn_nonce, 8);
-    memcpy (message + 16, message_box + crypto_box_BOXZEROBYTES,
-            mlen - crypto_box_BOXZEROBYTES);
-
-    free (message_plaintext);
-    free (message_box);
+    memcpy (message + 8, &nonce_, 8);
+
+    uint8_t *message_plaintext = message + 16;
+    if (!aead.active ())
+        message_plaintext += crypto_box_MACBYTES;
+    message_plaintext [0] = flags;
+    memcpy (message_plaintext + 1, msg_->data (), msg_->size ());
+
+    if (aead.active ())
+        aead.seal (message_plaintext, mlen, nonce_);
+    else {
+        rc = crypto_box_easy_afternm (message + 16, message_plaintext, mlen,
+                                      message_nonce, cn_precom);
+        zmq_assert (rc == 0);
+    }
 
-    cn_nonce++;
+    //  move closes the original message.
+    rc = msg_->move (encoded);
+    zmq_assert (rc == 0);
 
     return 0;
 }
@@ -155,12 +165,12 @@ int zmq::curve_client_t::decode (msg_t *msg_)
 {
     zmq_assert (state == connected);
 
-    if (msg_->size () < 33) {
+    if (msg_->size () < 16 + crypto_box_MACBYTES + 1) {
         errno = EPROTO;
         return -1;
     }
 
-    const uint8_t *message = static_cast <uint8_t *> (msg_->data ());
+    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
     if (memcmp (message, "\x07MESSAGE", 8)) {
         errno = EPROTO;
         return -1;
@@ -170,42 +180,90 @@ int zmq::curve_client_t::decode (msg_t *msg_)
     memcpy (message_nonce, "CurveZMQMESSAGES", 16);
     memcpy (message_nonce + 16, message + 8, 8);
 
-    const size_t clen = crypto_box_BOXZEROBYTES + (msg_->size () - 16);
+    const size_t clen = msg_->size () - 16;
 
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_plaintext);
+    //  Decrypt in place, the plaintext overwrites the box.
+    int rc;
+    if (aead.active ()) {
+        uint64_t nonce;
+        memcpy (&nonce, message + 8, 8);
+        rc = aead.open (message + 16, clen, nonce);
+    }
+    else
+        rc = crypto_box_open_easy_afternm (message + 16, message + 16,
+                                           clen, message_nonce, cn_precom);
+    if (rc != 0) {
+        errno = EPROTO;
+        return -1;
+    }
 
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_box);
+    const uint8_t flags = message [16];
 
-    memset (message_box, 0, crypto_box_BOXZEROBYTES);
-    memcpy (message_box + crypto_box_BOXZEROBYTES,
-            message + 16, msg_->size () - 16);
+    msg_t decoded;
+    rc = decoded.init_size (clen - crypto_box_MACBYTES - 1);
+    zmq_assert (rc == 0);
+    memcpy (decoded.data (), message + 17, decoded.size ());
 
-    int rc = crypto_box_open_afternm (message_plaintext, message_box,
-                                      clen, message_nonce, cn_precom);
-    if (rc == 0) {
-        rc = msg_->close ();
-        zmq_assert (rc == 0);
+    //  move closes the original message.
+    rc = msg_->move (decoded);
+    zmq_assert (rc == 0);
 
-        rc = msg_->init_size (clen - 1 - crypto_box_ZEROBYTES);
-        zmq_assert (rc == 0);
+    if (flags & 0x01)
+        msg_->set_flags (msg_t::more);
+    if (flags & 0x02)
+        msg_->set_flags (msg_t::command);
 
-        const uint8_t flags = message_plaintext [crypto_box_ZEROBYTES];
-        if (flags & 0x01)
-            msg_->set_flags (msg_t::more);
+    return 0;
+}
 
-        memcpy (msg_->data (),
-                message_plaintext + crypto_box_ZEROBYTES + 1,
-                msg_->size ());
-    }
-    else
+int zmq::curve_client_t::encode_batch (msg_t *msgs_, int count_,
+    crypto_pool_t *pool_)
+{
+    zmq_assert (state == connected);
+
+    //  Nonces are handed out in the order the messages are sent, so the
+    //  boxes themselves can be sealed in any order, in parallel.
+    batch_t batch = {this, msgs_, cn_nonce, false};
+    pool_->run (encode_task, &batch, count_);
+    zmq_assert (!batch.failed);
+    cn_nonce += count_;
+
+    return 0;
+}
+
+int zmq::curve_client_t::decode_batch (msg_t *msgs_, int count_,
+    crypto_pool_t *pool_)
+{
+    zmq_assert (state == connected);
+
+    batch_t batch = {this, msgs_, 0, false};
+    pool_->run (decode_task, &batch, count_);
+    if (batch.failed) {
         errno = EPROTO;
+        return -1;
+    }
 
-    free (message_plaintext);
-    free (message_box);
+    return 0;
+}
 
-    return rc;
+bool zmq::curve_client_t::batch_capable () const
+{
+    return true;
+}
+
+void zmq::curve_client_t::encode_task (void *arg_, int index_)
+{
+    batch_t *batch = (batch_t*) arg_;
+    if (batch->mechanism->encode_message (&batch->msgs [index_],
+          batch->nonce + index_) == -1)
+        batch->failed = true;
+}
+
+void zmq::curve_client_t::decode_task (void *arg_, int index_)
+{
+    batch_t *batch = (batch_t*) arg_;
+    if (batch->mechanism->decode (&batch->msgs [index_]) == -1)
+        batch->failed = true;
 }
 
 bool zmq::curve_client_t::is_handshake_complete () const
@@ -313,10 +371,11 @@ int zmq::curve_client_t::produce_initiate (msg_t *msg_)
                          vouch_nonce, cn_server, secret_key);
     zmq_assert (rc == 0);
 
-    //  Assume here that metadata is limited to 256 bytes
+    //  Assume here that metadata is limited to 256 bytes, plus the list
+    //  of ciphers offered
     uint8_t initiate_nonce [crypto_box_NONCEBYTES];
-    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256];
-    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256];
+    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256 + 64];
+    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256 + 64];
 
     //  Create Box [C + vouch + metadata](C'->S')
     memset (initiate_plaintext, 0, crypto_box_ZEROBYTES);
@@ -341,6 +400,14 @@ int zmq::curve_client_t::produce_initiate (msg_t *msg_)
         ptr += add_property (ptr, "Identity",
                              options.identity, options.identity_size);
 
+    //  Offer faster ciphers for the messages
+    if (options.curve_aead) {
+        const std::string offer = curve_aead_t::offer ();
+        if (!offer.empty ())
+            ptr += add_property (ptr, "Cipher",
+                                 offer.c_str (), offer.length ());
+    }
+
     const size_t mlen = ptr - initiate_plaintext;
 
     memcpy (initiate_nonce, "CurveZMQINITIATE", 16);
@@ -384,8 +451,8 @@ int zmq::curve_client_t::process_ready (msg_t *msg_)
     const size_t clen = (msg_->size () - 14) + crypto_box_BOXZEROBYTES;
 
     uint8_t ready_nonce [crypto_box_NONCEBYTES];
-    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256];
-    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256];
+    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256 + 64];
+    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256 + 64];
 
     memset (ready_box, 0, crypto_box_BOXZEROBYTES);
     memcpy (ready_box + crypto_box_BOXZEROBYTES,
@@ -404,7 +471,28 @@ int zmq::curve_client_t::process_ready (msg_t *msg_)
 
     rc = parse_metadata (ready_plaintext + crypto_box_ZEROBYTES,
                          clen - crypto_box_ZEROBYTES);
+
+    //  Switch to the cipher the server picked, if any
+    if (rc == 0 && cipher != curve_aead_t::none)
+        aead.init (cipher, cn_precom, false);
+
     return rc;
 }
 
+int zmq::curve_client_t::property (const std::string name_,
+    const void *value_, size_t length_)
+{
+    if (name_ == "Cipher") {
+        //  The server may only pick one of the ciphers offered
+        const std::string name ((const char *) value_, length_);
+        if (!options.curve_aead ||
+              curve_aead_t::choose (name) == curve_aead_t::none) {
+            errno = EPROTO;
+            return -1;
+        }
+        cipher = curve_aead_t::find (name);
+    }
+    return 0;
+}
+
 #endif
@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+
+#include <string.h>
+
+#include "curve_keypool.hpp"
+#include "err.hpp"
+
+zmq::curve_keypool_t::curve_keypool_t () :
+    count (0),
+    started (false),
+    stopping (false),
+    refill_pending (false)
+{
+}
+
+zmq::curve_keypool_t::~curve_keypool_t ()
+{
+    sync.lock ();
+    const bool running = started;
+    stopping = true;
+    if (running && !refill_pending) {
+        refill_pending = true;
+        wakeup.send ();
+    }
+    sync.unlock ();
+
+    if (running)
+        worker.stop ();
+
+    //  The key pairs never handed out must not linger in memory either.
+    sodium_memzero (keys, sizeof keys);
+}
+
+void zmq::curve_keypool_t::start ()
+{
+    sync.lock ();
+    if (!started) {
+        started = true;
+        worker.start (worker_routine, this);
+        request_refill ();
+    }
+    sync.unlock ();
+}
+
+void zmq::curve_keypool_t::get (uint8_t *public_key_, uint8_t *secret_key_)
+{
+    sync.lock ();
+    if (!started) {
+        started = true;
+        worker.start (worker_routine, this);
+    }
+    if (count > 0) {
+        count--;
+        memcpy (public_key_, keys [count].public_key,
+            crypto_box_PUBLICKEYBYTES);
+        memcpy (secret_key_, keys [count].secret_key,
+            crypto_box_SECRETKEYBYTES);
+
+        //  The used up key pair must not linger in memory.
+        sodium_memzero (keys [count].secret_key, crypto_box_SECRETKEYBYTES);
+
+        if (count < curve_keypool_size / 2)
+            request_refill ();
+        sync.unlock ();
+        return;
+    }
+    request_refill ();
+    sync.unlock ();
+
+    const int rc = crypto_box_keypair (public_key_, secret_key_);
+    zmq_assert (rc == 0);
+}
+
+void zmq::curve_keypool_t::request_refill ()
+{
+    if (!refill_pending) {
+        refill_pending = true;
+        wakeup.send ();
+    }
+}
+
+void zmq::curve_keypool_t::worker_routine (void *arg_)
+{
+    curve_keypool_t *self = (curve_keypool_t*) arg_;
+
+    while (true) {
+        int rc = self->wakeup.wait (-1);
+        if (rc == -1) {
+            errno_assert (errno == EINTR);
+            continue;
+        }
+        self->wakeup.recv ();
+
+        self->sync.lock ();
+        self->refill_pending = false;
+        bool stop = self->stopping;
+        bool full = self->count == curve_keypool_size;
+        self->sync.unlock ();
+
+        //  Key pairs are generated without holding the lock so that the
+        //  I/O threads can take them while the stock is being filled.
+        while (!stop && !full) {
+            keypair_t keypair;
+            rc = crypto_box_keypair (keypair.public_key, keypair.secret_key);
+            zmq_assert (rc == 0);
+
+            self->sync.lock ();
+            if (self->count < curve_keypool_size)
+                self->keys [self->count++] = keypair;
+            stop = self->stopping;
+            full = self->count == curve_keypool_size;
+            self->sync.unlock ();
+
+            sodium_memzero (keypair.secret_key, crypto_box_SECRETKEYBYTES);
+        }
+
+        if (stop)
+            break;
+    }
+}
+
+#endif
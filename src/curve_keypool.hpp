@@ -0,0 +1,95 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_CURVE_KEYPOOL_HPP_INCLUDED__
+#define __ZMQ_CURVE_KEYPOOL_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+#include <sodium.h>
+
+#include "config.hpp"
+#include "thread.hpp"
+#include "signaler.hpp"
+#include "mutex.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Stock of pregenerated short-term key pairs for CURVE servers.
+    //  Generating the key pair is the costliest part of setting up a
+    //  connection, so a background thread keeps the stock filled and
+    //  the I/O threads only take the pairs when accepting connections.
+
+    class curve_keypool_t
+    {
+    public:
+
+        curve_keypool_t ();
+        ~curve_keypool_t ();
+
+        //  Starts filling the stock. Called when a socket is set up as
+        //  CURVE server so that there are keys ready for the first clients.
+        void start ();
+
+        //  Retrieves a fresh key pair. If the stock is exhausted, the key
+        //  pair is generated by the calling thread.
+        void get (uint8_t *public_key_, uint8_t *secret_key_);
+
+    private:
+
+        struct keypair_t
+        {
+            uint8_t public_key [crypto_box_PUBLICKEYBYTES];
+            uint8_t secret_key [crypto_box_SECRETKEYBYTES];
+        };
+
+        //  Main routine of the refill thread.
+        static void worker_routine (void *arg_);
+
+        //  Asks the refill thread to top up the stock. Must be called
+        //  with the lock held.
+        void request_refill ();
+
+        keypair_t keys [curve_keypool_size];
+        int count;
+
+        //  Synchronisation of access to the stock and the flags below.
+        mutex_t sync;
+
+        thread_t worker;
+        bool started;
+        bool stopping;
+
+        //  At most one refill request may be pending at any time.
+        signaler_t wakeup;
+        bool refill_pending;
+
+        curve_keypool_t (const curve_keypool_t&);
+        const curve_keypool_t &operator = (const curve_keypool_t&);
+    };
+
+}
+
+#endif
+
+#endif
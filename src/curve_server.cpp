@@ -28,6 +28,9 @@
 
 #include "msg.hpp"
 #include "session_base.hpp"
+#include "ctx.hpp"
+#include "curve_keypool.hpp"
+#include "crypto_pool.hpp"
 #include "err.hpp"
 #include "curve_server.hpp"
 #include "wire.hpp"
@@ -40,14 +43,14 @@ zmq::curve_server_t::curve_server_t (session_base_t *session_,
     peer_address (peer_address_),
     state (expect_hello),
     expecting_zap_reply (false),
-    cn_nonce (1)
+    cn_nonce (1),
+    cipher (curve_aead_t::none)
 {
     //  Fetch our secret key from socket options
     memcpy (secret_key, options_.curve_secret_key, crypto_box_SECRETKEYBYTES);
 
-    //  Generate short-term key pair
-    const int rc = crypto_box_keypair (cn_public, cn_secret);
-    zmq_assert (rc == 0);
+    //  Take a short-term key pair, generated in advance if possible
+    session_->get_ctx ()->get_curve_keypool ()->get (cn_public, cn_secret);
 }
 
 zmq::curve_server_t::~curve_server_t ()
@@ -110,48 +113,56 @@ int zmq::curve_server_t::encode (msg_t *msg_)
 {
     zmq_assert (state == connected);
 
-    const size_t mlen = crypto_box_ZEROBYTES + 1 + msg_->size ();
-
-    uint8_t message_nonce [crypto_box_NONCEBYTES];
-    memcpy (message_nonce, "CurveZMQMESSAGES", 16);
-    memcpy (message_nonce + 16, &cn_nonce, 8);
+    const int rc = encode_message (msg_, cn_nonce);
+    if (rc == 0)
+        cn_nonce++;
+    return rc;
+}
 
+int zmq::curve_server_t::encode_message (msg_t *msg_, uint64_t nonce_)
+{
     uint8_t flags = 0;
     if (msg_->flags () & msg_t::more)
         flags |= 0x01;
+    if (msg_->flags () & msg_t::command)
+        flags |= 0x02;
 
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_plaintext);
-
-    memset (message_plaintext, 0, crypto_box_ZEROBYTES);
-    message_plaintext [crypto_box_ZEROBYTES] = flags;
-    memcpy (message_plaintext + crypto_box_ZEROBYTES + 1,
-            msg_->data (), msg_->size ());
-
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (mlen));
-    alloc_assert (message_box);
-
-    int rc = crypto_box_afternm (message_box, message_plaintext,
-                                 mlen, message_nonce, cn_precom);
-    zmq_assert (rc == 0);
+    uint8_t message_nonce [crypto_box_NONCEBYTES];
+    memcpy (message_nonce, "CurveZMQMESSAGES", 16);
+    memcpy (message_nonce + 16, &nonce_, 8);
 
-    rc = msg_->close ();
-    zmq_assert (rc == 0);
+    const size_t mlen = 1 + msg_->size ();
 
-    rc = msg_->init_size (16 + mlen - crypto_box_BOXZEROBYTES);
+    //  The box is built directly in the resulting message. The flags and
+    //  the payload are placed behind the header and the MAC and encrypted
+    //  in place, so that there's a single allocation and copy per message.
+    //  The negotiated cipher, if any, puts its tag after the data instead.
+    msg_t encoded;
+    int rc = encoded.init_size (16 + crypto_box_MACBYTES + mlen);
     zmq_assert (rc == 0);
 
-    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
+    uint8_t *message = static_cast <uint8_t *> (encoded.data ());
 
     memcpy (message, "\x07MESSAGE", 8);
-    memcpy (message + 8, &cn_nonce, 8);
-    memcpy (message + 16, message_box + crypto_box_BOXZEROBYTES,
-            mlen - crypto_box_BOXZEROBYTES);
-
-    free (message_plaintext);
-    free (message_box);
+    memcpy (message + 8, &nonce_, 8);
+
+    uint8_t *message_plaintext = message + 16;
+    if (!aead.active ())
+        message_plaintext += crypto_box_MACBYTES;
+    message_plaintext [0] = flags;
+    memcpy (message_plaintext + 1, msg_->data (), msg_->size ());
+
+    if (aead.active ())
+        aead.seal (message_plaintext, mlen, nonce_);
+    else {
+        rc = crypto_box_easy_afternm (message + 16, message_plaintext, mlen,
+                                      message_nonce, cn_precom);
+        zmq_assert (rc == 0);
+    }
 
-    cn_nonce++;
+    //  move closes the original message.
+    rc = msg_->move (encoded);
+    zmq_assert (rc == 0);
 
     return 0;
 }
@@ -160,12 +171,12 @@ int zmq::curve_server_t::decode (msg_t *msg_)
 {
     zmq_assert (state == connected);
 
-    if (msg_->size () < 33) {
+    if (msg_->size () < 16 + crypto_box_MACBYTES + 1) {
         errno = EPROTO;
         return -1;
     }
 
-    const uint8_t *message = static_cast <uint8_t *> (msg_->data ());
+    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
     if (memcmp (message, "\x07MESSAGE", 8)) {
         errno = EPROTO;
         return -1;
@@ -175,42 +186,90 @@ int zmq::curve_server_t::decode (msg_t *msg_)
     memcpy (message_nonce, "CurveZMQMESSAGEC", 16);
     memcpy (message_nonce + 16, message + 8, 8);
 
-    const size_t clen = crypto_box_BOXZEROBYTES + msg_->size () - 16;
+    const size_t clen = msg_->size () - 16;
 
-    uint8_t *message_plaintext = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_plaintext);
+    //  Decrypt in place, the plaintext overwrites the box.
+    int rc;
+    if (aead.active ()) {
+        uint64_t nonce;
+        memcpy (&nonce, message + 8, 8);
+        rc = aead.open (message + 16, clen, nonce);
+    }
+    else
+        rc = crypto_box_open_easy_afternm (message + 16, message + 16,
+                                           clen, message_nonce, cn_precom);
+    if (rc != 0) {
+        errno = EPROTO;
+        return -1;
+    }
 
-    uint8_t *message_box = static_cast <uint8_t *> (malloc (clen));
-    alloc_assert (message_box);
+    const uint8_t flags = message [16];
 
-    memset (message_box, 0, crypto_box_BOXZEROBYTES);
-    memcpy (message_box + crypto_box_BOXZEROBYTES,
-            message + 16, msg_->size () - 16);
+    msg_t decoded;
+    rc = decoded.init_size (clen - crypto_box_MACBYTES - 1);
+    zmq_assert (rc == 0);
+    memcpy (decoded.data (), message + 17, decoded.size ());
 
-    int rc = crypto_box_open_afternm (message_plaintext, message_box,
-                                      clen, message_nonce, cn_precom);
-    if (rc == 0) {
-        rc = msg_->close ();
-        zmq_assert (rc == 0);
+    //  move closes the original message.
+    rc = msg_->move (decoded);
+    zmq_assert (rc == 0);
 
-        rc = msg_->init_size (clen - 1 - crypto_box_ZEROBYTES);
-        zmq_assert (rc == 0);
+    if (flags & 0x01)
+        msg_->set_flags (msg_t::more);
+    if (flags & 0x02)
+        msg_->set_flags (msg_t::command);
 
-        const uint8_t flags = message_plaintext [crypto_box_ZEROBYTES];
-        if (flags & 0x01)
-            msg_->set_flags (msg_t::more);
+    return 0;
+}
 
-        memcpy (msg_->data (),
-                message_plaintext + crypto_box_ZEROBYTES + 1,
-                msg_->size ());
-    }
-    else
+int zmq::curve_server_t::encode_batch (msg_t *msgs_, int count_,
+    crypto_pool_t *pool_)
+{
+    zmq_assert (state == connected);
+
+    //  Nonces are handed out in the order the messages are sent, so the
+    //  boxes themselves can be sealed in any order, in parallel.
+    batch_t batch = {this, msgs_, cn_nonce, false};
+    pool_->run (encode_task, &batch, count_);
+    zmq_assert (!batch.failed);
+    cn_nonce += count_;
+
+    return 0;
+}
+
+int zmq::curve_server_t::decode_batch (msg_t *msgs_, int count_,
+    crypto_pool_t *pool_)
+{
+    zmq_assert (state == connected);
+
+    batch_t batch = {this, msgs_, 0, false};
+    pool_->run (decode_task, &batch, count_);
+    if (batch.failed) {
         errno = EPROTO;
+        return -1;
+    }
 
-    free (message_plaintext);
-    free (message_box);
+    return 0;
+}
 
-    return rc;
+bool zmq::curve_server_t::batch_capable () const
+{
+    return true;
+}
+
+void zmq::curve_server_t::encode_task (void *arg_, int index_)
+{
+    batch_t *batch = (batch_t*) arg_;
+    if (batch->mechanism->encode_message (&batch->msgs [index_],
+          batch->nonce + index_) == -1)
+        batch->failed = true;
+}
+
+void zmq::curve_server_t::decode_task (void *arg_, int index_)
+{
+    batch_t *batch = (batch_t*) arg_;
+    if (batch->mechanism->decode (&batch->msgs [index_]) == -1)
+        batch->failed = true;
 }
 
 int zmq::curve_server_t::zap_msg_available ()
@@ -264,10 +323,13 @@ int zmq::curve_server_t::process_hello (msg_t *msg_)
     memset (hello_box, 0, crypto_box_BOXZEROBYTES);
     memcpy (hello_box + crypto_box_BOXZEROBYTES, hello + 120, 80);
 
+    //  Precompute the secret shared by C' and S, it's used for WELCOME too
+    int rc = crypto_box_beforenm (hello_precom, cn_client, secret_key);
+    zmq_assert (rc == 0);
+
     //  Open Box [64 * %x0](C'->S)
-    int rc = crypto_box_open (hello_plaintext, hello_box,
-                              sizeof hello_box,
-                              hello_nonce, cn_client, secret_key);
+    rc = crypto_box_open_afternm (hello_plaintext, hello_box,
+                                  sizeof hello_box, hello_nonce, hello_precom);
     if (rc != 0) {
         errno = EPROTO;
         return -1;
@@ -320,9 +382,9 @@ int zmq::curve_server_t::produce_welcome (msg_t *msg_)
     memcpy (welcome_plaintext + crypto_box_ZEROBYTES + 48,
             cookie_ciphertext + crypto_secretbox_BOXZEROBYTES, 80);
 
-    rc = crypto_box (welcome_ciphertext, welcome_plaintext,
-                     sizeof welcome_plaintext,
-                     welcome_nonce, cn_client, secret_key);
+    rc = crypto_box_afternm (welcome_ciphertext, welcome_plaintext,
+                             sizeof welcome_plaintext,
+                             welcome_nonce, hello_precom);
     zmq_assert (rc == 0);
 
     rc = msg_->init_size (168);
@@ -378,8 +440,8 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
     const size_t clen = (msg_->size () - 113) + crypto_box_BOXZEROBYTES;
 
     uint8_t initiate_nonce [crypto_box_NONCEBYTES];
-    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256];
-    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256];
+    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256 + 64];
+    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256 + 64];
 
     //  Open Box [C + vouch + metadata](C'->S')
     memset (initiate_box, 0, crypto_box_BOXZEROBYTES);
@@ -389,8 +451,13 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
     memcpy (initiate_nonce, "CurveZMQINITIATE", 16);
     memcpy (initiate_nonce + 16, initiate + 105, 8);
 
-    rc = crypto_box_open (initiate_plaintext, initiate_box,
-                          clen, initiate_nonce, cn_client, cn_secret);
+    //  Precompute connection secret from client key. It opens this box
+    //  and all the boxes that follow.
+    rc = crypto_box_beforenm (cn_precom, cn_client, cn_secret);
+    zmq_assert (rc == 0);
+
+    rc = crypto_box_open_afternm (initiate_plaintext, initiate_box,
+                                  clen, initiate_nonce, cn_precom);
     if (rc != 0) {
         errno = EPROTO;
         return -1;
@@ -425,19 +492,27 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
         return -1;
     }
 
-    //  Precompute connection secret from client key
-    rc = crypto_box_beforenm (cn_precom, cn_client, cn_secret);
-    zmq_assert (rc == 0);
-
     //  Use ZAP protocol (RFC 27) to authenticate the user.
     rc = session->zap_connect ();
     if (rc == 0) {
-        send_zap_request (client_key);
-        rc = receive_and_process_zap_reply ();
-        if (rc != 0) {
-            if (errno != EAGAIN)
+        init_zap_key ("CURVE", peer_address);
+        add_zap_key (client_key, crypto_box_PUBLICKEYBYTES);
+
+        //  Skip the round-trip if the client was authenticated recently.
+        std::string metadata;
+        if (session->find_zap_result (zap_key, metadata)) {
+            if (parse_metadata ((const unsigned char *) metadata.data (),
+                  metadata.size ()) != 0)
                 return -1;
-            expecting_zap_reply = true;
+        }
+        else {
+            send_zap_request (client_key);
+            rc = receive_and_process_zap_reply ();
+            if (rc != 0) {
+                if (errno != EAGAIN)
+                    return -1;
+                expecting_zap_reply = true;
+            }
         }
     }
 
@@ -448,8 +523,8 @@ int zmq::curve_server_t::process_initiate (msg_t *msg_)
 int zmq::curve_server_t::produce_ready (msg_t *msg_)
 {
     uint8_t ready_nonce [crypto_box_NONCEBYTES];
-    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256];
-    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256];
+    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256 + 64];
+    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256 + 64];
 
     //  Create Box [metadata](S'->C')
     memset (ready_plaintext, 0, crypto_box_ZEROBYTES);
@@ -466,6 +541,12 @@ int zmq::curve_server_t::produce_ready (msg_t *msg_)
         ptr += add_property (ptr, "Identity",
             options.identity, options.identity_size);
 
+    //  Tell the client which of its ciphers we picked
+    if (cipher != curve_aead_t::none) {
+        const char *cipher_name = curve_aead_t::name (cipher);
+        ptr += add_property (ptr, "Cipher", cipher_name, strlen (cipher_name));
+    }
+
     const size_t mlen = ptr - ready_plaintext;
 
     memcpy (ready_nonce, "CurveZMQREADY---", 16);
@@ -489,6 +570,19 @@ int zmq::curve_server_t::produce_ready (msg_t *msg_)
 
     cn_nonce++;
 
+    //  Messages after READY use the negotiated cipher, if any
+    if (cipher != curve_aead_t::none)
+        aead.init (cipher, cn_precom, true);
+
+    return 0;
+}
+
+int zmq::curve_server_t::property (const std::string name_,
+    const void *value_, size_t length_)
+{
+    if (name_ == "Cipher" && options.curve_aead)
+        cipher = curve_aead_t::choose (
+            std::string ((const char *) value_, length_));
     return 0;
 }
 
@@ -616,6 +710,9 @@ int zmq::curve_server_t::receive_and_process_zap_reply ()
     //  Process metadata frame
     rc = parse_metadata (static_cast <const unsigned char*> (msg [6].data ()),
                          msg [6].size ());
+    if (rc == 0)
+        session->store_zap_result (zap_key, std::string (
+            static_cast <const char*> (msg [6].data ()), msg [6].size ()));
 
 error:
     for (int i = 0; i < 7; i++) {
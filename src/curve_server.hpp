@@ -38,12 +38,14 @@
 
 #include "mechanism.hpp"
 #include "options.hpp"
+#include "curve_aead.hpp"
 
 namespace zmq
 {
 
     class msg_t;
     class session_base_t;
+    class crypto_pool_t;
 
     class curve_server_t : public mechanism_t
     {
@@ -59,6 +61,11 @@ namespace zmq
         virtual int process_handshake_command (msg_t *msg_);
         virtual int encode (msg_t *msg_);
         virtual int decode (msg_t *msg_);
+        virtual int encode_batch (msg_t *msgs_, int count_,
+            crypto_pool_t *pool_);
+        virtual int decode_batch (msg_t *msgs_, int count_,
+            crypto_pool_t *pool_);
+        virtual bool batch_capable () const;
         virtual int zap_msg_available ();
         virtual bool is_handshake_complete () const;
 
@@ -103,6 +110,32 @@ namespace zmq
         //  Intermediary buffer used to speed up boxing and unboxing.
         uint8_t cn_precom [crypto_box_BEFORENMBYTES];
 
+        //  Cipher for the MESSAGE commands, if one was negotiated.
+        curve_aead_t::cipher_t cipher;
+        curve_aead_t aead;
+
+        //  Precomputed secret shared by C' and S, used by HELLO and WELCOME.
+        uint8_t hello_precom [crypto_box_BEFORENMBYTES];
+
+        //  Batch of messages being processed by the crypto pool.
+        struct batch_t
+        {
+            curve_server_t *mechanism;
+            msg_t *msgs;
+            uint64_t nonce;
+            volatile bool failed;
+        };
+
+        //  Encrypts the message using the given nonce.
+        int encode_message (msg_t *msg_, uint64_t nonce_);
+
+        static void encode_task (void *arg_, int index_);
+        static void decode_task (void *arg_, int index_);
+
+        //  Handles the cipher negotiation property.
+        virtual int property (const std::string name_,
+            const void *value_, size_t length_);
+
         int process_hello (msg_t *msg_);
         int produce_welcome (msg_t *msg_);
         int process_initiate (msg_t *msg_);
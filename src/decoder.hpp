@@ -85,6 +85,16 @@ namespace zmq
             *size_ = bufsize;
         }
 
+        inline void resize_buffer (size_t size_)
+        {
+            if (size_ == bufsize)
+                return;
+            free (buf);
+            buf = (unsigned char*) malloc (size_);
+            alloc_assert (buf);
+            bufsize = size_;
+        }
+
         //  Processes the data in the buffer previously allocated using
         //  get_buffer function. size_ argument specifies nemuber of bytes
         //  actually filled into the buffer. Function returns 1 when the
@@ -27,7 +27,9 @@ zmq::dist_t::dist_t () :
     matching (0),
     active (0),
     eligible (0),
-    more (false)
+    more (false),
+    dropped (0),
+    dropping (0)
 {
 }
 
@@ -60,9 +62,13 @@ void zmq::dist_t::match (pipe_t *pipe_)
     if (pipes.index (pipe_) < matching)
         return;
 
-    //  If the pipe isn't eligible, ignore it.
-    if (pipes.index (pipe_) >= eligible)
+    //  If the pipe isn't eligible, ignore it. If it's because the pipe is
+    //  full, the message is effectively dropped.
+    if (pipes.index (pipe_) >= eligible) {
+        if (!more)
+            dropped++;
         return;
+    }
 
     //  Mark the pipe as matching.
     pipes.swap (pipes.index (pipe_), matching);
@@ -110,6 +116,10 @@ void zmq::dist_t::activated (pipe_t *pipe_)
 
 int zmq::dist_t::send_to_all (msg_t *msg_)
 {
+    //  Pipes that reached the high watermark miss the message.
+    if (!more)
+        dropped += pipes.size () - eligible;
+
     matching = active;
     return send_to_matching (msg_);
 }
@@ -122,9 +132,13 @@ int zmq::dist_t::send_to_matching (msg_t *msg_)
     //  Push the message to matching pipes.
     distribute (msg_);
 
-    //  If mutlipart message is fully sent, activate all the eligible pipes.
-    if (!msg_more)
+    //  If mutlipart message is fully sent, activate all the eligible pipes
+    //  and account for the pipes that missed it.
+    if (!msg_more) {
         active = eligible;
+        dropped += dropping;
+        dropping = 0;
+    }
 
     more = msg_more;
 
@@ -178,9 +192,15 @@ bool zmq::dist_t::has_out ()
     return true;
 }
 
+uint64_t zmq::dist_t::get_dropped ()
+{
+    return dropped;
+}
+
 bool zmq::dist_t::write (pipe_t *pipe_, msg_t *msg_)
 {
     if (!pipe_->write (msg_)) {
+        dropping++;
         pipes.swap (pipes.index (pipe_), matching - 1);
         matching--;
         pipes.swap (pipes.index (pipe_), active - 1);
@@ -64,6 +64,10 @@ namespace zmq
 
         bool has_out ();
 
+        //  Returns the number of messages that were not passed to some of
+        //  the matching pipes because those had reached the high watermark.
+        uint64_t get_dropped ();
+
     private:
 
         //  Write the message to the pipe. Make the pipe inactive if writing
@@ -95,6 +99,14 @@ namespace zmq
         //  True if last we are in the middle of a multipart message.
         bool more;
 
+        //  Number of messages dropped because of the high watermark.
+        uint64_t dropped;
+
+        //  Number of pipes that failed to take the message being sent. It's
+        //  added to 'dropped' once the last frame is distributed, so that
+        //  a multipart message is counted once.
+        uint64_t dropping;
+
         dist_t (const dist_t&);
         const dist_t &operator = (const dist_t&);
     };
@@ -132,6 +132,16 @@ namespace zmq
             return to_write > 0;
         }
 
+        inline void resize_buffer (size_t size_)
+        {
+            if (size_ == bufsize)
+                return;
+            free (buf);
+            buf = (unsigned char*) malloc (size_);
+            alloc_assert (buf);
+            bufsize = size_;
+        }
+
     protected:
 
         //  Prototype of state machine action.
@@ -162,15 +172,15 @@ namespace zmq
 
         bool new_msg_flag;
 
-        //  The buffer for encoded data.
-        size_t bufsize;
-        unsigned char *buf;
-
         encoder_base_t (const encoder_base_t&);
         void operator = (const encoder_base_t&);
 
     protected:
 
+        //  The buffer for encoded data.
+        size_t bufsize;
+        unsigned char *buf;
+
         msg_t *in_progress;
 
     };
@@ -44,6 +44,11 @@ namespace zmq
                             size_t &processed) = 0;
 
         virtual msg_t *msg () = 0;
+
+        //  Replaces the buffer returned by get_buffer with one of the given
+        //  size. Must only be called once all the data read into the buffer
+        //  were decoded.
+        virtual void resize_buffer (size_t size_) = 0;
     };
 
 }
@@ -44,6 +44,11 @@ namespace zmq
         virtual void load_msg (msg_t *msg_) = 0;
 
         virtual bool has_data () = 0;
+
+        //  Replaces the buffer used when encode is given none with one of
+        //  the given size. Must not be called while the data encode returned
+        //  in it are still in use.
+        virtual void resize_buffer (size_t size_) = 0;
     };
 
 }
@@ -0,0 +1,46 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+ 
+
+#ifndef __ZMQ_I_STATE_EVENTS_HPP_INCLUDED__
+#define __ZMQ_I_STATE_EVENTS_HPP_INCLUDED__
+
+namespace zmq
+{
+
+    //  Virtual interface to be exposed by objects that want to be notified
+    //  about changes of a socket's state. Called in the thread that uses
+    //  the socket.
+
+    struct i_state_events
+    {
+        virtual ~i_state_events () {}
+
+        //  Called when the socket's events may have changed without its
+        //  ZMQ_FD being signaled.
+        virtual void state_changed () = 0;
+
+        //  Called when the socket is closed. The object must not use the
+        //  socket afterwards.
+        virtual void socket_closed () = 0;
+    };
+
+}
+
+#endif
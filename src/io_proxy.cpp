@@ -0,0 +1,261 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "io_proxy.hpp"
+#include "io_thread.hpp"
+#include "socket_base.hpp"
+#include "command.hpp"
+#include "config.hpp"
+#include "likely.hpp"
+#include "ctx.hpp"
+#include "err.hpp"
+
+zmq::io_proxy_t::io_proxy_t (io_thread_t *io_thread_,
+      socket_base_t *frontend_, socket_base_t *backend_,
+      socket_base_t *capture_, socket_base_t *control_) :
+    object_t (io_thread_),
+    io_object_t (io_thread_),
+    state (active),
+    timer_pending (false)
+{
+    sockets [frontend] = frontend_;
+    sockets [backend] = backend_;
+    sockets [capture] = capture_;
+    sockets [control] = control_;
+    for (int i = 0; i != socket_count; i++)
+        handles [i] = NULL;
+    memset (stats, 0, sizeof stats);
+
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+}
+
+zmq::io_proxy_t::~io_proxy_t ()
+{
+    int rc = msg.close ();
+    errno_assert (rc == 0);
+}
+
+void zmq::io_proxy_t::start ()
+{
+    command_t cmd;
+    cmd.destination = this;
+    cmd.type = command_t::plug;
+    get_ctx ()->send_command (get_tid (), cmd);
+}
+
+void zmq::io_proxy_t::process_plug ()
+{
+    //  Get woken up whenever any of the sockets gets a command.
+    for (int i = 0; i != socket_count; i++)
+        if (sockets [i]) {
+            handles [i] = add_fd (sockets [i]->get_mailbox ()->get_fd ());
+            set_pollin (handles [i]);
+        }
+
+    //  There may be messages waiting already. They are forwarded from the
+    //  timer, as the proxy may terminate straight away and it can't delete
+    //  itself while processing a command.
+    add_timer (0, burst_timer_id);
+    timer_pending = true;
+}
+
+void zmq::io_proxy_t::process_seqnum ()
+{
+    //  The proxy has no owner keeping count of the commands sent to it.
+}
+
+void zmq::io_proxy_t::in_event ()
+{
+    forward ();
+}
+
+void zmq::io_proxy_t::timer_event (int id_)
+{
+    zmq_assert (id_ == burst_timer_id);
+    timer_pending = false;
+    forward ();
+}
+
+void zmq::io_proxy_t::forward ()
+{
+    //  Process the commands of all the sockets. This also clears their
+    //  file descriptors, so the proxy is woken up by the next command.
+    for (int i = 0; i != socket_count; i++)
+        if (sockets [i]) {
+            int events;
+            size_t events_size = sizeof events;
+            if (sockets [i]->getsockopt (ZMQ_EVENTS, &events,
+                  &events_size) == -1) {
+                terminate ();
+                return;
+            }
+        }
+
+    if (sockets [control] && process_control () != 0) {
+        terminate ();
+        return;
+    }
+
+    if (state != active)
+        return;
+
+    bool more_work = false;
+    if (transfer (frontend, backend, &more_work) == -1
+    ||  transfer (backend, frontend, &more_work) == -1) {
+        terminate ();
+        return;
+    }
+
+    //  There may be more messages, but the sockets' file descriptors won't
+    //  signal them. Come back for them once other objects in this thread
+    //  had a chance to run.
+    if (more_work && !timer_pending) {
+        add_timer (0, burst_timer_id);
+        timer_pending = true;
+    }
+}
+
+int zmq::io_proxy_t::process_control ()
+{
+    while (true) {
+        int rc = sockets [control]->recv (&msg, ZMQ_DONTWAIT);
+        if (rc != 0)
+            return errno == EAGAIN ? 0 : -1;
+
+        int more;
+        size_t moresz = sizeof more;
+        rc = sockets [control]->getsockopt (ZMQ_RCVMORE, &more, &moresz);
+        if (unlikely (rc < 0) || more)
+            return -1;
+
+        capture_msg (0);
+
+        if (msg.size () == 5 && memcmp (msg.data (), "PAUSE", 5) == 0)
+            state = paused;
+        else
+        if (msg.size () == 6 && memcmp (msg.data (), "RESUME", 6) == 0)
+            state = active;
+        else
+        if (msg.size () == 9 && memcmp (msg.data (), "TERMINATE", 9) == 0)
+            return 1;
+        else
+        if (msg.size () == 10 && memcmp (msg.data (), "STATISTICS", 10) == 0) {
+            rc = reply_proxy_stats (sockets [control], stats [frontend],
+                stats [backend], ZMQ_DONTWAIT);
+            if (unlikely (rc < 0) && errno != EAGAIN)
+                return -1;
+        }
+        else {
+            //  This is an API error, we should assert
+            puts ("E: invalid command sent to proxy");
+            zmq_assert (false);
+        }
+    }
+}
+
+int zmq::io_proxy_t::transfer (int from_, int to_, bool *more_work_)
+{
+    for (int count = 0; count != proxy_burst_size; count++) {
+
+        //  Leave the messages queued while the other side can't take
+        //  them. Its file descriptor signals when that changes.
+        if (!sockets [to_]->has_out ())
+            return 0;
+
+        int rc = sockets [from_]->recv (&msg, ZMQ_DONTWAIT);
+        if (rc != 0)
+            return errno == EAGAIN ? 0 : -1;
+
+        //  The remaining frames of a multipart message are always
+        //  available, and can always be sent once the first one was.
+        while (true) {
+            const int more = msg.flags () & msg_t::more;
+            const size_t size = msg.size ();
+            stats [from_].msg_in++;
+            stats [from_].bytes_in += size;
+
+            capture_msg (more ? ZMQ_SNDMORE : 0);
+
+            rc = sockets [to_]->send (&msg,
+                (more ? ZMQ_SNDMORE : 0) | ZMQ_DONTWAIT);
+            if (likely (rc == 0)) {
+                stats [to_].msg_out++;
+                stats [to_].bytes_out += size;
+            }
+            else {
+                if (errno != EAGAIN)
+                    return -1;
+
+                //  The frame is dropped.
+                rc = msg.close ();
+                errno_assert (rc == 0);
+                rc = msg.init ();
+                errno_assert (rc == 0);
+            }
+            if (!more)
+                break;
+
+            rc = sockets [from_]->recv (&msg, ZMQ_DONTWAIT);
+            if (unlikely (rc < 0))
+                return -1;
+        }
+    }
+
+    *more_work_ = true;
+    return 0;
+}
+
+void zmq::io_proxy_t::capture_msg (int flags_)
+{
+    if (!sockets [capture])
+        return;
+
+    //  The copy is dropped if the capture socket can't take it.
+    msg_t copy;
+    int rc = copy.init ();
+    errno_assert (rc == 0);
+    rc = copy.copy (msg);
+    errno_assert (rc == 0);
+    rc = sockets [capture]->send (&copy, flags_ | ZMQ_DONTWAIT);
+    if (rc != 0) {
+        rc = copy.close ();
+        errno_assert (rc == 0);
+    }
+}
+
+void zmq::io_proxy_t::terminate ()
+{
+    if (timer_pending)
+        cancel_timer (burst_timer_id);
+
+    //  Give the sockets to the reaper, as zmq_close would.
+    for (int i = 0; i != socket_count; i++)
+        if (sockets [i]) {
+            rm_fd (handles [i]);
+            int rc = sockets [i]->close ();
+            errno_assert (rc == 0);
+        }
+
+    delete this;
+}
@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_IO_PROXY_HPP_INCLUDED__
+#define __ZMQ_IO_PROXY_HPP_INCLUDED__
+
+#include "object.hpp"
+#include "io_object.hpp"
+#include "msg.hpp"
+#include "proxy.hpp"
+
+namespace zmq
+{
+
+    class io_thread_t;
+    class socket_base_t;
+
+    //  Steerable proxy that runs inside an I/O thread, so that no
+    //  application thread has to be dedicated to it. The sockets are
+    //  handed over to the proxy, which polls their mailboxes in the I/O
+    //  thread's poller, forwards messages without blocking and closes the
+    //  sockets when it's terminated by the control socket or the context.
+
+    class io_proxy_t : public object_t, public io_object_t
+    {
+    public:
+
+        io_proxy_t (zmq::io_thread_t *io_thread_,
+            socket_base_t *frontend_, socket_base_t *backend_,
+            socket_base_t *capture_, socket_base_t *control_);
+
+        //  Passes the proxy to its I/O thread. The sockets must not be
+        //  used by the caller afterwards.
+        void start ();
+
+    private:
+
+        //  The proxy deletes itself once it terminates.
+        ~io_proxy_t ();
+
+        //  Handlers for incoming commands.
+        void process_plug ();
+        void process_seqnum ();
+
+        //  i_poll_events interface implementation.
+        void in_event ();
+        void timer_event (int id_);
+
+        //  Does all the work that can be done without blocking.
+        void forward ();
+
+        //  Executes the pending control commands. Returns 1 if the proxy
+        //  is to terminate, -1 on error.
+        int process_control ();
+
+        //  Forwards up to proxy_burst_size messages. Sets 'more_work_' if
+        //  it stopped because of the limit.
+        int transfer (int from_, int to_, bool *more_work_);
+
+        //  Sends a copy of the current message to the capture socket.
+        void capture_msg (int flags_);
+
+        //  Closes the sockets and deletes the proxy.
+        void terminate ();
+
+        enum {
+            frontend,
+            backend,
+            capture,
+            control,
+            socket_count
+        };
+
+        //  The timer used to resume forwarding after a burst.
+        enum {burst_timer_id = 0x50};
+
+        socket_base_t *sockets [socket_count];
+        handle_t handles [socket_count];
+
+        //  Frames and bytes passed through the frontend and the backend.
+        proxy_stats_t stats [2];
+
+        enum {
+            active,
+            paused
+        } state;
+
+        bool timer_pending;
+
+        msg_t msg;
+
+        io_proxy_t (const io_proxy_t&);
+        const io_proxy_t &operator = (const io_proxy_t&);
+    };
+
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include <string>
 
 #include "stream_engine.hpp"
+#include "shm_engine.hpp"
 #include "io_thread.hpp"
 #include "platform.hpp"
 #include "random.hpp"
@@ -53,7 +54,7 @@ zmq::ipc_connecter_t::ipc_connecter_t (class io_thread_t *io_thread_,
     current_reconnect_ivl(options.reconnect_ivl)
 {
     zmq_assert (addr);
-    zmq_assert (addr->protocol == "ipc");
+    zmq_assert (addr->protocol == "ipc" || addr->protocol == "shm");
     addr->to_string (endpoint);
     socket = session-> get_socket();
 }
@@ -112,8 +113,14 @@ void zmq::ipc_connecter_t::out_event ()
         return;
     }
     //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+    i_engine *engine;
+#if defined ZMQ_HAVE_SHM
+    if (addr->protocol == "shm")
+        engine = new (std::nothrow)
+            shm_engine_t (fd, options, endpoint, true);
+    else
+#endif
+        engine = new (std::nothrow) stream_engine_t (fd, options, endpoint);
     alloc_assert (engine);
 
     //  Attach the engine to the corresponding session object.
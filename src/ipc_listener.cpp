@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "stream_engine.hpp"
+#include "shm_engine.hpp"
 #include "ipc_address.hpp"
 #include "io_thread.hpp"
 #include "session_base.hpp"
@@ -48,11 +49,12 @@
 #endif
 
 zmq::ipc_listener_t::ipc_listener_t (io_thread_t *io_thread_,
-      socket_base_t *socket_, const options_t &options_) :
+      socket_base_t *socket_, const options_t &options_, bool shm_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     has_file (false),
     s (retired_fd),
+    shm (shm_),
     socket (socket_)
 {
 }
@@ -88,8 +90,14 @@ void zmq::ipc_listener_t::in_event ()
     }
 
     //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+    i_engine *engine;
+#if defined ZMQ_HAVE_SHM
+    if (shm)
+        engine = new (std::nothrow)
+            shm_engine_t (fd, options, endpoint, false);
+    else
+#endif
+        engine = new (std::nothrow) stream_engine_t (fd, options, endpoint);
     alloc_assert (engine);
 
     //  Choose I/O thread to run connecter in. Given that we are already
@@ -122,7 +130,10 @@ int zmq::ipc_listener_t::get_address (std::string &addr_)
     }
 
     ipc_address_t addr ((struct sockaddr *) &ss, sl);
-    return addr.to_string (addr_);
+    rc = addr.to_string (addr_);
+    if (rc == 0 && shm)
+        addr_.replace (0, 3, "shm");
+    return rc;
 }
 
 int zmq::ipc_listener_t::set_address (const char *addr_)
@@ -154,6 +165,8 @@ int zmq::ipc_listener_t::set_address (const char *addr_)
         return -1;
 
     address.to_string (endpoint);
+    if (shm)
+        endpoint.replace (0, 3, "shm");
 
     //  Bind the socket to the file path.
     rc = bind (s, address.addr (), address.addrlen ());
@@ -41,8 +41,11 @@ namespace zmq
     {
     public:
 
+        //  If 'shm_' is true, the connections are handed to shm engines;
+        //  the UNIX domain socket only serves for the peers to meet.
         ipc_listener_t (zmq::io_thread_t *io_thread_,
-            zmq::socket_base_t *socket_, const options_t &options_);
+            zmq::socket_base_t *socket_, const options_t &options_,
+            bool shm_);
         ~ipc_listener_t ();
 
         //  Set address to listen on.
@@ -86,6 +89,9 @@ namespace zmq
         //  Handle corresponding to the listening socket.
         handle_t handle;
 
+        //  True for the listener of a shm endpoint.
+        const bool shm;
+
         //  Socket the listerner belongs to.
         zmq::socket_base_t *socket;
 
@@ -0,0 +1,212 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+#if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+#include <string.h>
+
+#include "latency.hpp"
+#include "clock.hpp"
+#include "err.hpp"
+
+//  Keeps the accesses to a stamp on either side of it in order. x86 orders
+//  stores with stores and loads with loads by itself, so there it only
+//  has to stop the compiler.
+static inline void stamp_barrier ()
+{
+#if (defined __i386__ || defined __x86_64__) && defined __GNUC__
+    __asm__ volatile ("" : : : "memory");
+#elif defined ZMQ_HAVE_WINDOWS
+    MemoryBarrier ();
+#else
+    __sync_synchronize ();
+#endif
+}
+
+zmq::histogram_t::histogram_t ()
+{
+}
+
+zmq::histogram_t::~histogram_t ()
+{
+}
+
+int zmq::histogram_t::bucket_index (uint64_t value_)
+{
+    if (value_ < sub_bucket_count)
+        return (int) value_;
+
+    //  Position of the highest bit set.
+    int exponent = 0;
+    for (uint64_t v = value_; v > 1; v >>= 1)
+        exponent++;
+
+    return (exponent - sub_bucket_bits + 1) * sub_bucket_count +
+        (int) ((value_ >> (exponent - sub_bucket_bits)) &
+        (sub_bucket_count - 1));
+}
+
+uint64_t zmq::histogram_t::bucket_value (int index_)
+{
+    if (index_ < sub_bucket_count)
+        return (uint64_t) index_;
+
+    const int exponent = index_ / sub_bucket_count + sub_bucket_bits - 1;
+    const uint64_t sub = index_ % sub_bucket_count;
+    const int shift = exponent - sub_bucket_bits;
+    return (((sub_bucket_count + sub) << shift) | ((1ULL << shift) - 1));
+}
+
+void zmq::histogram_t::record (uint64_t value_)
+{
+    buckets [bucket_index (value_)].add (1);
+}
+
+void zmq::histogram_t::merge (histogram_t &other_)
+{
+    for (int i = 0; i != bucket_count; i++) {
+        const atomic_counter64_t::integer_t n = other_.buckets [i].get ();
+        if (n)
+            buckets [i].add (n);
+    }
+}
+
+uint64_t zmq::histogram_t::count ()
+{
+    uint64_t total = 0;
+    for (int i = 0; i != bucket_count; i++)
+        total += buckets [i].get ();
+    return total;
+}
+
+uint64_t zmq::histogram_t::percentile (double quantile_)
+{
+    //  Take a snapshot so that the values recorded in the meantime
+    //  don't skew the result.
+    atomic_counter64_t::integer_t snapshot [bucket_count];
+    uint64_t total = 0;
+    for (int i = 0; i != bucket_count; i++) {
+        snapshot [i] = buckets [i].get ();
+        total += snapshot [i];
+    }
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t) (quantile_ * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i != bucket_count; i++) {
+        seen += snapshot [i];
+        if (seen >= rank)
+            return bucket_value (i);
+    }
+    return bucket_value (bucket_count - 1);
+}
+
+zmq::latency_t::latency_t (const std::string &endpoint_) :
+    endpoint (endpoint_),
+    refs (2)
+{
+    memset (ring, 0, sizeof ring);
+}
+
+zmq::latency_t::~latency_t ()
+{
+}
+
+const std::string &zmq::latency_t::get_endpoint ()
+{
+    return endpoint;
+}
+
+void zmq::latency_t::stamp (uint64_t seqnum_)
+{
+    stamp_t &s = ring [seqnum_ % ring_size];
+
+    //  Make the version odd while the slot is updated so that the reader
+    //  never uses a torn or mismatched sequence number and timestamp.
+    const uint64_t time = now ();
+    s.version++;
+    stamp_barrier ();
+    s.seqnum = seqnum_ + 1;
+    s.time = time;
+    stamp_barrier ();
+    s.version++;
+}
+
+void zmq::latency_t::record (uint64_t seqnum_)
+{
+    stamp_t &s = ring [seqnum_ % ring_size];
+    const uint32_t version = s.version;
+    if (version & 1)
+        return;
+    stamp_barrier ();
+    const uint64_t seqnum = s.seqnum;
+    const uint64_t time = s.time;
+    stamp_barrier ();
+    if (s.version != version || seqnum != seqnum_ + 1)
+        return;
+    const uint64_t current = now ();
+    histogram.record (current > time ? current - time : 0);
+}
+
+void zmq::latency_t::release ()
+{
+    if (!refs.sub (1))
+        delete this;
+}
+
+uint64_t zmq::latency_t::now ()
+{
+    const uint64_t tsc = clock_t::rdtsc ();
+    if (tsc)
+        return tsc;
+    return clock_t::now_us () * 1000;
+}
+
+double zmq::latency_t::ticks_per_ns ()
+{
+    //  Without TSC the values are in nanoseconds already.
+    if (!clock_t::rdtsc ())
+        return 1.0;
+
+    //  Calibrate TSC against the system clock. The first invocation
+    //  takes a few milliseconds, the result is cached afterwards. Racing
+    //  invocations compute roughly the same value so no locking is needed.
+    static volatile double rate = 0;
+    if (rate == 0) {
+        const uint64_t start_tsc = clock_t::rdtsc ();
+        const uint64_t start_us = clock_t::now_us ();
+        uint64_t elapsed_us;
+        do {
+            elapsed_us = clock_t::now_us () - start_us;
+        } while (elapsed_us < 10000);
+        rate = (double) (clock_t::rdtsc () - start_tsc) /
+            (elapsed_us * 1000.0);
+    }
+    return rate;
+}
@@ -0,0 +1,145 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_LATENCY_HPP_INCLUDED__
+#define __ZMQ_LATENCY_HPP_INCLUDED__
+
+#include <string>
+
+#include "atomic_counter.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Histogram of values with logarithmic bucket boundaries, each power
+    //  of two being split into a fixed number of linear sub-buckets. This
+    //  keeps the relative error of any value below 1/sub_bucket_count.
+    //  Values can be recorded by one thread and read by another one
+    //  without locking.
+
+    class histogram_t
+    {
+    public:
+
+        histogram_t ();
+        ~histogram_t ();
+
+        //  Adds a value to the histogram.
+        void record (uint64_t value_);
+
+        //  Adds all the values from another histogram.
+        void merge (histogram_t &other_);
+
+        //  Returns the number of values recorded.
+        uint64_t count ();
+
+        //  Returns the value below which the 'quantile_' fraction of
+        //  the recorded values fall. Returns 0 if the histogram is empty.
+        uint64_t percentile (double quantile_);
+
+    private:
+
+        enum
+        {
+            sub_bucket_bits = 4,
+            sub_bucket_count = 1 << sub_bucket_bits,
+            bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count
+        };
+
+        //  Mapping between values and bucket indices. For the bucket,
+        //  the highest value that falls into it is returned.
+        static int bucket_index (uint64_t value_);
+        static uint64_t bucket_value (int index_);
+
+        atomic_counter64_t buckets [bucket_count];
+
+        histogram_t (const histogram_t&);
+        const histogram_t &operator = (const histogram_t&);
+    };
+
+    //  Queueing latency tracking for one direction of a pipe. The writer
+    //  stamps each message with the time it was enqueued; the reader
+    //  records the time it has spent in the queue into the histogram.
+    //  Timestamps are kept in a fixed-size ring indexed by the message
+    //  sequence number, so when more messages are queued than the ring can
+    //  hold, the older ones are not recorded.
+    //
+    //  Object is shared by both ends of the pipe and is deallocated when
+    //  both of them release it.
+
+    class latency_t
+    {
+    public:
+
+        latency_t (const std::string &endpoint_);
+
+        //  Endpoint the pipe belongs to, empty if not known.
+        const std::string &get_endpoint ();
+
+        //  Called by the writer when 'seqnum_' message was enqueued.
+        void stamp (uint64_t seqnum_);
+
+        //  Called by the reader when 'seqnum_' message was dequeued.
+        void record (uint64_t seqnum_);
+
+        histogram_t histogram;
+
+        //  Drops a reference to the object. If it was the last one, object
+        //  is deallocated.
+        void release ();
+
+        //  Current time in the units recorded to the histograms.
+        static uint64_t now ();
+
+        //  Conversion rate between the units recorded to the histograms
+        //  and nanoseconds.
+        static double ticks_per_ns ();
+
+    private:
+
+        ~latency_t ();
+
+        enum {ring_size = 1024};
+
+        std::string endpoint;
+
+        //  Sequence number of the message (plus one, so that zero means
+        //  there's no stamp) and its timestamp. The 64-bit fields may tear
+        //  on 32-bit platforms, so they are guarded by 'version', which
+        //  is odd while the writer updates them.
+        struct stamp_t
+        {
+            volatile uint32_t version;
+            volatile uint64_t seqnum;
+            volatile uint64_t time;
+        };
+        stamp_t ring [ring_size];
+
+        //  Number of pipe ends referencing the object.
+        atomic_counter_t refs;
+
+        latency_t (const latency_t&);
+        const latency_t &operator = (const latency_t&);
+    };
+
+}
+
+#endif
@@ -26,7 +26,9 @@
 #include "wire.hpp"
 
 zmq::mechanism_t::mechanism_t (const options_t &options_) :
-    options (options_)
+    options (options_),
+    bulk_offered (false),
+    peer_bulk (false)
 {
 }
 
@@ -34,6 +36,41 @@ zmq::mechanism_t::~mechanism_t ()
 {
 }
 
+int zmq::mechanism_t::encode_batch (msg_t *msgs_, int count_,
+    crypto_pool_t *)
+{
+    for (int i = 0; i != count_; i++)
+        if (encode (&msgs_ [i]) == -1)
+            return -1;
+    return 0;
+}
+
+int zmq::mechanism_t::decode_batch (msg_t *msgs_, int count_,
+    crypto_pool_t *)
+{
+    for (int i = 0; i != count_; i++)
+        if (decode (&msgs_ [i]) == -1)
+            return -1;
+    return 0;
+}
+
+void zmq::mechanism_t::init_zap_key (const char *mechanism_,
+    const std::string &peer_address_)
+{
+    zap_key.clear ();
+    add_zap_key (options.zap_domain.c_str (), options.zap_domain.length ());
+    add_zap_key (mechanism_, strlen (mechanism_));
+    add_zap_key (peer_address_.c_str (), peer_address_.length ());
+}
+
+void zmq::mechanism_t::add_zap_key (const void *data_, size_t size_)
+{
+    unsigned char length [4];
+    put_uint32 (length, static_cast <uint32_t> (size_));
+    zap_key.append ((const char *) length, sizeof length);
+    zap_key.append ((const char *) data_, size_);
+}
+
 void zmq::mechanism_t::set_peer_identity (const void *id_ptr, size_t id_size)
 {
     identity = blob_t (static_cast <const unsigned char*> (id_ptr), id_size);
@@ -56,6 +93,21 @@ const char *zmq::mechanism_t::socket_type_string (int socket_type) const
     return names [socket_type];
 }
 
+void zmq::mechanism_t::offer_bulk ()
+{
+    bulk_offered = true;
+}
+
+bool zmq::mechanism_t::bulk_agreed () const
+{
+    return bulk_offered && peer_bulk;
+}
+
+bool zmq::mechanism_t::bulk_expected () const
+{
+    return bulk_offered && (peer_bulk || !is_handshake_complete ());
+}
+
 size_t zmq::mechanism_t::add_property (unsigned char *ptr, const char *name,
     const void *value, size_t value_len) const
 {
@@ -103,6 +155,9 @@ int zmq::mechanism_t::parse_metadata (const unsigned char *ptr_,
         if (name == "Identity" && options.recv_identity)
             set_peer_identity (value, value_length);
         else
+        if (name == "Bulk-Fd")
+            peer_bulk = true;
+        else
         if (name == "Socket-Type") {
             const std::string socket_type ((char *) value, value_length);
             if (!check_socket_type (socket_type)) {
@@ -31,6 +31,7 @@ namespace zmq
     //  Different mechanism extedns this class.
 
     class msg_t;
+    class crypto_pool_t;
 
     class mechanism_t
     {
@@ -50,6 +51,17 @@ namespace zmq
 
         virtual int decode (msg_t *msg_) { return 0; }
 
+        //  Encodes or decodes a batch of messages. Mechanisms that can
+        //  process the messages independently of each other may spread
+        //  the work over the pool, the default processes them in order.
+        virtual int encode_batch (msg_t *msgs_, int count_,
+            crypto_pool_t *pool_);
+        virtual int decode_batch (msg_t *msgs_, int count_,
+            crypto_pool_t *pool_);
+
+        //  True iff the mechanism gains from processing messages in batches.
+        virtual bool batch_capable () const { return false; }
+
         //  Notifies mechanism about availability of ZAP message.
         virtual int zap_msg_available () { return 0; }
 
@@ -60,6 +72,18 @@ namespace zmq
 
         void peer_identity (msg_t *msg_);
 
+        //  Offers the peer to pass frames as file descriptors (see
+        //  ZMQ_IPC_BULK_THRESHOLD). Must be called before the handshake;
+        //  only mechanisms that leave the frames alone honour it.
+        void offer_bulk ();
+
+        //  True iff both peers offered to pass frames as descriptors.
+        bool bulk_agreed () const;
+
+        //  True iff the peer may pass frames as descriptors: they were
+        //  offered and the handshake didn't show the peer declining.
+        bool bulk_expected () const;
+
     protected:
 
         //  Only used to identify the socket for the Socket-Type
@@ -85,12 +109,27 @@ namespace zmq
         virtual int property (const std::string name_,
                               const void *value_, size_t length_);
 
+        //  Starts building the key the result of ZAP authentication is
+        //  cached under. The key is made of the ZAP domain, mechanism, peer
+        //  address and the credentials, each prefixed by its length.
+        void init_zap_key (const char *mechanism_,
+            const std::string &peer_address_);
+        void add_zap_key (const void *data_, size_t size_);
+
         options_t options;
 
+        std::string zap_key;
+
+        //  True iff bulk frames were offered to the peer.
+        bool bulk_offered;
+
     private:
 
         blob_t identity;
 
+        //  True iff the peer offered to take bulk frames.
+        bool peer_bulk;
+
         //  Returns true iff socket associated with the mechanism
         //  is compatible with a given socket type 'type_'.
         bool check_socket_type (const std::string type_) const;
@@ -112,6 +112,13 @@ int zmq::msg_t::init_delimiter ()
     return 0;
 }
 
+int zmq::msg_t::init_spill_marker ()
+{
+    u.delimiter.type = type_spill_marker;
+    u.delimiter.flags = 0;
+    return 0;
+}
+
 int zmq::msg_t::close ()
 {
     //  Check the validity of the message.
@@ -257,6 +264,11 @@ bool zmq::msg_t::is_delimiter ()
     return u.base.type == type_delimiter;
 }
 
+bool zmq::msg_t::is_spill_marker ()
+{
+    return u.base.type == type_spill_marker;
+}
+
 bool zmq::msg_t::is_vsm ()
 {
     return u.base.type == type_vsm;
@@ -49,6 +49,7 @@ namespace zmq
         {
             more = 1,           //  Followed by more parts
             command = 2,        //  Command frame (see ZMTP spec)
+            bulk = 4,           //  Body passed as a file descriptor
             identity = 64,
             shared = 128
         };
@@ -59,6 +60,7 @@ namespace zmq
         int init_data (void *data_, size_t size_, msg_free_fn *ffn_,
             void *hint_);
         int init_delimiter ();
+        int init_spill_marker ();
         int close ();
         int move (msg_t &src_);
         int copy (msg_t &src_);
@@ -69,6 +71,7 @@ namespace zmq
         void reset_flags (unsigned char flags_);
         bool is_identity () const;
         bool is_delimiter ();
+        bool is_spill_marker ();
         bool is_vsm ();
         bool is_cmsg ();
 
@@ -114,7 +117,10 @@ namespace zmq
             type_delimiter = 103,
             //  CMSG messages point to constant data
             type_cmsg = 104,
-            type_max = 104
+            //  Spill markers tell the pipe reader to continue reading
+            //  from the spill
+            type_spill_marker = 105,
+            type_max = 105
         };
 
         //  Note that fields shared between different message types are not
@@ -66,11 +66,22 @@ int zmq::null_mechanism_t::next_handshake_command (msg_t *msg_)
             errno = EAGAIN;
             return -1;
         }
-        send_zap_request ();
-        zap_request_sent = true;
-        const int rc = receive_and_process_zap_reply ();
-        if (rc != 0)
-            return -1;
+
+        //  Skip the round-trip if the peer was authenticated recently.
+        init_zap_key ("NULL", peer_address);
+        std::string metadata;
+        if (session->find_zap_result (zap_key, metadata)) {
+            if (parse_metadata ((const unsigned char *) metadata.data (),
+                  metadata.size ()) != 0)
+                return -1;
+        }
+        else {
+            send_zap_request ();
+            zap_request_sent = true;
+            const int rc = receive_and_process_zap_reply ();
+            if (rc != 0)
+                return -1;
+        }
         zap_reply_received = true;
     }
 
@@ -95,6 +106,10 @@ int zmq::null_mechanism_t::next_handshake_command (msg_t *msg_)
             options.identity, options.identity_size);
     }
 
+    //  Add bulk transfer property
+    if (bulk_offered)
+        ptr += add_property (ptr, "Bulk-Fd", "", 0);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
@@ -271,6 +286,9 @@ int zmq::null_mechanism_t::receive_and_process_zap_reply ()
     //  Process metadata frame
     rc = parse_metadata (static_cast <const unsigned char*> (msg [6].data ()),
                          msg [6].size ());
+    if (rc == 0)
+        session->store_zap_result (zap_key, std::string (
+            static_cast <const char*> (msg [6].data ()), msg [6].size ()));
 
 error:
     for (int i = 0; i < 7; i++) {
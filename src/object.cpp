@@ -147,9 +147,10 @@ void zmq::object_t::unregister_endpoints (socket_base_t *socket_)
     return ctx->unregister_endpoints (socket_);
 }
 
-zmq::endpoint_t zmq::object_t::find_endpoint (const char *addr_)
+zmq::endpoint_t zmq::object_t::find_endpoint (const char *addr_,
+    const options_t &options_)
 {
-    return ctx->find_endpoint (addr_);
+    return ctx->find_endpoint (addr_, options_);
 }
 
 void zmq::object_t::pend_connection (const char *addr_, pending_connection_t &pending_connection_)
@@ -27,6 +27,7 @@ namespace zmq
 
     struct i_engine;
     struct endpoint_t;
+    struct options_t;
     struct pending_connection_t;
     struct command_t;
     class ctx_t;
@@ -60,7 +61,8 @@ namespace zmq
         //  repository of inproc endpoints.
         int register_endpoint (const char *addr_, zmq::endpoint_t &endpoint_);
         void unregister_endpoints (zmq::socket_base_t *socket_);
-        zmq::endpoint_t find_endpoint (const char *addr_);
+        zmq::endpoint_t find_endpoint (const char *addr_,
+            const options_t &options_);
         void pend_connection (const char *addr_, pending_connection_t &pending_connection_);
         void connect_pending (const char *addr_, zmq::socket_base_t *bind_socket_);
 
@@ -21,6 +21,7 @@
 
 #include "options.hpp"
 #include "err.hpp"
+#include "config.hpp"
 #include "../include/zmq_utils.h"
 
 zmq::options_t::options_t () :
@@ -56,8 +57,24 @@ zmq::options_t::options_t () :
 #   endif
     mechanism (ZMQ_NULL),
     as_server (0),
+    curve_aead (false),
     socket_id (0),
-    conflate (false)
+    conflate (false),
+    spill_maxsize (-1),
+    latency_tracking (false),
+    monitor_interval (1000),
+    zap_cache_ttl (0),
+    ipc_bulk_threshold (0),
+    heartbeat_interval (0),
+    heartbeat_ttl (0),
+    heartbeat_timeout (-1),
+    tcp_stripes (1),
+    in_batch_size (zmq::in_batch_size),
+    out_batch_size (zmq::out_batch_size),
+    adaptive_batch (false),
+    coalesce_ivl (0),
+    coalesce_size (0),
+    shard_strategy (0)
 {
 }
 
@@ -403,6 +420,13 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
                 return 0;
             }
             break;
+
+        case ZMQ_CURVE_AEAD:
+            if (is_int && (value == 0 || value == 1)) {
+                curve_aead = (value != 0);
+                return 0;
+            }
+            break;
 #       endif
 
         case ZMQ_CONFLATE:
@@ -412,6 +436,117 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_SPILL_PATH:
+            if (optval_ == NULL && optvallen_ == 0) {
+                spill_path.clear ();
+                return 0;
+            }
+            else
+            if (optval_ != NULL) {
+                spill_path.assign ((const char *) optval_, optvallen_);
+                return 0;
+            }
+            break;
+
+        case ZMQ_SPILL_MAXSIZE:
+            if (optvallen_ == sizeof (int64_t)) {
+                spill_maxsize = *((int64_t *) optval_);
+                return 0;
+            }
+            break;
+
+        case ZMQ_LATENCY_TRACKING:
+            if (is_int && (value == 0 || value == 1)) {
+                latency_tracking = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_MONITOR_INTERVAL:
+            if (is_int && value >= 0) {
+                monitor_interval = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ZAP_CACHE_TTL:
+            if (is_int && value >= 0) {
+                zap_cache_ttl = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IPC_BULK_THRESHOLD:
+            if (is_int && value >= 0) {
+                ipc_bulk_threshold = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_IVL:
+            if (is_int && value >= 0) {
+                heartbeat_interval = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TTL:
+            //  The TTL is sent in deciseconds, as a 16-bit number.
+            if (is_int && value >= 0 && value <= 6553599) {
+                heartbeat_ttl = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TIMEOUT:
+            if (is_int && value >= -1) {
+                heartbeat_timeout = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_STRIPES:
+            if (is_int && value >= 1) {
+                tcp_stripes = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                in_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                out_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_BATCH:
+            if (is_int && (value == 0 || value == 1)) {
+                adaptive_batch = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_IVL:
+            if (is_int && value >= 0) {
+                coalesce_ivl = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_SIZE:
+            if (is_int && value >= 0) {
+                coalesce_size = value;
+                return 0;
+            }
+            break;
+
         default:
             break;
     }
@@ -692,6 +827,13 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
                 return 0;
             }
             break;
+
+        case ZMQ_CURVE_AEAD:
+            if (is_int) {
+                *value = curve_aead;
+                return 0;
+            }
+            break;
 #       endif
 
         case ZMQ_CONFLATE:
@@ -701,6 +843,113 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_SPILL_PATH:
+            if (*optvallen_ >= spill_path.size () + 1) {
+                memcpy (optval_, spill_path.c_str (), spill_path.size () + 1);
+                *optvallen_ = spill_path.size () + 1;
+                return 0;
+            }
+            break;
+
+        case ZMQ_SPILL_MAXSIZE:
+            if (*optvallen_ == sizeof (int64_t)) {
+                *((int64_t *) optval_) = spill_maxsize;
+                *optvallen_ = sizeof (int64_t);
+                return 0;
+            }
+            break;
+
+        case ZMQ_LATENCY_TRACKING:
+            if (is_int) {
+                *value = latency_tracking;
+                return 0;
+            }
+            break;
+
+        case ZMQ_MONITOR_INTERVAL:
+            if (is_int) {
+                *value = monitor_interval;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ZAP_CACHE_TTL:
+            if (is_int) {
+                *value = zap_cache_ttl;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IPC_BULK_THRESHOLD:
+            if (is_int) {
+                *value = ipc_bulk_threshold;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_IVL:
+            if (is_int) {
+                *value = heartbeat_interval;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TTL:
+            if (is_int) {
+                *value = heartbeat_ttl;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HEARTBEAT_TIMEOUT:
+            if (is_int) {
+                *value = heartbeat_timeout;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_STRIPES:
+            if (is_int) {
+                *value = tcp_stripes;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int) {
+                *value = in_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int) {
+                *value = out_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_BATCH:
+            if (is_int) {
+                *value = adaptive_batch;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_IVL:
+            if (is_int) {
+                *value = coalesce_ivl;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_SIZE:
+            if (is_int) {
+                *value = coalesce_size;
+                return 0;
+            }
+            break;
+
     }
     errno = EINVAL;
     return -1;
@@ -156,6 +156,10 @@ namespace zmq
         uint8_t curve_secret_key [CURVE_KEYSIZE];
         uint8_t curve_server_key [CURVE_KEYSIZE];
 
+        //  If true, CURVE negotiates an AEAD cipher for the messages
+        //  sent after the handshake.
+        bool curve_aead;
+
         //  ID of the socket.
         int socket_id;
 
@@ -164,6 +168,64 @@ namespace zmq
         //  Cannot receive multi-part messages.
         //  Ignores hwm
         bool conflate;
+
+        //  Directory to spill outbound messages to when the pipe reaches
+        //  the high water mark. Empty string means no spilling.
+        std::string spill_path;
+
+        //  Maximum number of bytes spilled per pipe, -1 means no limit.
+        int64_t spill_maxsize;
+
+        //  If true, time messages spend in the pipes is measured.
+        bool latency_tracking;
+
+        //  Minimum interval between the rate-limited monitor events,
+        //  in milliseconds.
+        int monitor_interval;
+
+        //  Time for which successful ZAP authentications are cached,
+        //  in milliseconds. Zero means no caching.
+        int zap_cache_ttl;
+
+        //  Frames at least this large are passed to ipc peers as file
+        //  descriptors instead of through the socket. Zero disables it.
+        int ipc_bulk_threshold;
+
+        //  Interval between the ZMTP heartbeats sent to the peer, in
+        //  milliseconds. Zero disables heartbeats.
+        int heartbeat_interval;
+
+        //  Time after which the peer is to drop the connection unless
+        //  it hears from us, in milliseconds. Zero means no limit.
+        int heartbeat_ttl;
+
+        //  Time to wait for any traffic after a heartbeat before the
+        //  connection is dropped, in milliseconds. -1 means the interval.
+        int heartbeat_timeout;
+
+        //  Number of connections opened by each tcp connect.
+        int tcp_stripes;
+
+        //  Sizes of the buffers engines read into and write from, in bytes.
+        int in_batch_size;
+        int out_batch_size;
+
+        //  If true, engines grow the buffers beyond the sizes above while
+        //  the traffic fills them, and shrink them back once it calms down.
+        bool adaptive_batch;
+
+        //  Longest time engines hold small writes back to send them along
+        //  with the following ones, in microseconds. Zero disables that.
+        int coalesce_ivl;
+
+        //  Amount of data held back that is written out without waiting
+        //  any longer, in bytes. Zero means the size of the send buffer.
+        int coalesce_size;
+
+        //  Non-zero while the socket binds an endpoint other sockets may
+        //  bind too (ZMQ_PROXY_SHARD_*). Not settable by the user; it's set
+        //  by socket_base_t::bind_shared.
+        int shard_strategy;
     };
 }
 
@@ -21,6 +21,8 @@
 #include <stddef.h>
 
 #include "pipe.hpp"
+#include "spill.hpp"
+#include "latency.hpp"
 #include "err.hpp"
 
 #include "ypipe.hpp"
@@ -67,6 +69,12 @@ zmq::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
     object_t (parent_),
     inpipe (inpipe_),
     outpipe (outpipe_),
+    inspill (NULL),
+    outspill (NULL),
+    in_spilling (false),
+    out_spilling (false),
+    inlatency (NULL),
+    outlatency (NULL),
     in_active (true),
     out_active (true),
     hwm (outhwm_),
@@ -84,6 +92,10 @@ zmq::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
 
 zmq::pipe_t::~pipe_t ()
 {
+    if (inlatency)
+        inlatency->release ();
+    if (outlatency)
+        outlatency->release ();
 }
 
 void zmq::pipe_t::set_peer (pipe_t *peer_)
@@ -117,12 +129,34 @@ bool zmq::pipe_t::check_read ()
     if (unlikely (state != active && state != waiting_for_delimiter))
         return false;
 
+    //  While reading from the spill, go back to the pipe only once the end
+    //  of the spilled sequence was reached.
+    if (unlikely (in_spilling)) {
+        if (inspill->check_read ())
+            return true;
+        if (!inspill->read_finish ()) {
+            in_active = false;
+            return false;
+        }
+        in_spilling = false;
+    }
+
     //  Check if there's an item in the pipe.
     if (!inpipe->check_read ()) {
         in_active = false;
         return false;
     }
 
+    //  If the next item in the pipe is spill marker, the following
+    //  messages are to be read from the spill.
+    if (unlikely (inpipe->probe (is_spill_marker))) {
+        msg_t msg;
+        bool ok = inpipe->read (&msg);
+        zmq_assert (ok);
+        in_spilling = true;
+        return check_read ();
+    }
+
     //  If the next item in the pipe is message delimiter,
     //  initiate termination process.
     if (inpipe->probe (is_delimiter)) {
@@ -143,19 +177,40 @@ bool zmq::pipe_t::read (msg_t *msg_)
     if (unlikely (state != active && state != waiting_for_delimiter))
         return false;
 
-    if (!inpipe->read (msg_)) {
-        in_active = false;
-        return false;
+    if (unlikely (in_spilling)) {
+        if (!inspill->read (msg_)) {
+            if (!inspill->read_finish ()) {
+                in_active = false;
+                return false;
+            }
+            in_spilling = false;
+            return read (msg_);
+        }
     }
+    else {
+        if (!inpipe->read (msg_)) {
+            in_active = false;
+            return false;
+        }
 
-    //  If delimiter was read, start termination process of the pipe.
-    if (msg_->is_delimiter ()) {
-        process_delimiter ();
-        return false;
+        //  If spill marker was read, continue reading from the spill.
+        if (unlikely (msg_->is_spill_marker ())) {
+            in_spilling = true;
+            return read (msg_);
+        }
+
+        //  If delimiter was read, start termination process of the pipe.
+        if (msg_->is_delimiter ()) {
+            process_delimiter ();
+            return false;
+        }
     }
 
-    if (!(msg_->flags () & msg_t::more))
+    if (!(msg_->flags () & msg_t::more)) {
+        if (unlikely (inlatency != NULL))
+            inlatency->record (msgs_read);
         msgs_read++;
+    }
 
     if (lwm > 0 && msgs_read % lwm == 0)
         send_activate_write (peer, msgs_read);
@@ -168,10 +223,19 @@ bool zmq::pipe_t::check_write ()
     if (unlikely (!out_active || state != active))
         return false;
 
-    bool full = hwm > 0 && msgs_written - peers_msgs_read == uint64_t (hwm);
+    //  Note that the spilled messages count against the watermark as well
+    //  and so the number of messages can exceed it.
+    bool full = hwm > 0 && msgs_written - peers_msgs_read >= uint64_t (hwm);
 
     if (unlikely (full)) {
+
+        //  Rather than blocking, spill the message if possible. Note that
+        //  the parts of a message already started have to be accepted.
+        if (outspill && (outspill->incomplete () || outspill->check_write ()))
+            return true;
+
         out_active = false;
+        sink->hwm_reached (this);
         return false;
     }
 
@@ -184,9 +248,47 @@ bool zmq::pipe_t::write (msg_t *msg_)
         return false;
 
     bool more = msg_->flags () & msg_t::more ? true : false;
+
+    if (unlikely (outspill != NULL)) {
+        bool full = hwm > 0 &&
+            msgs_written - peers_msgs_read >= uint64_t (hwm);
+
+        //  When the pipe overflows, tell the reader to continue reading
+        //  from the spill. Once the reader catches up, finish the spilled
+        //  sequence and switch back to the pipe. Switching is possible
+        //  only on message boundaries.
+        if (!out_spilling && full) {
+            msg_t marker;
+            marker.init_spill_marker ();
+            outpipe->write (marker, false);
+            out_spilling = true;
+        }
+        else
+        if (out_spilling && !full && !outspill->incomplete ()) {
+            if (!outspill->finish ())
+                send_activate_read (peer);
+            out_spilling = false;
+        }
+
+        if (out_spilling) {
+            outspill->write (msg_);
+            if (!more) {
+                if (unlikely (outlatency != NULL))
+                    outlatency->stamp (msgs_written);
+                msgs_written++;
+                if (!outspill->commit ())
+                    send_activate_read (peer);
+            }
+            return true;
+        }
+    }
+
     outpipe->write (*msg_, more);
-    if (!more)
+    if (!more) {
+        if (unlikely (outlatency != NULL))
+            outlatency->stamp (msgs_written);
         msgs_written++;
+    }
 
     return true;
 }
@@ -195,6 +297,8 @@ void zmq::pipe_t::rollback ()
 {
     //  Remove incomplete message from the outbound pipe.
     msg_t msg;
+    if (outpipe && outspill)
+        outspill->rollback ();
     if (outpipe) {
         while (outpipe->unwrite (&msg)) {
             zmq_assert (msg.flags () & msg_t::more);
@@ -251,6 +355,13 @@ void zmq::pipe_t::process_hiccup (void *pipe_)
     outpipe = (upipe_t*) pipe_;
     out_active = true;
 
+    //  Spilled messages are dropped along with the ones in the old pipe.
+    //  The reader has already stopped reading from the spill.
+    if (outspill) {
+        outspill->clear ();
+        out_spilling = false;
+    }
+
     //  If appropriate, notify the user about the hiccup.
     if (state == active)
         sink->hiccuped (this);
@@ -329,6 +440,7 @@ void zmq::pipe_t::process_pipe_term_ack ()
     }
 
     delete inpipe;
+    delete inspill;
 
     //  Deallocate the pipe object
     delete this;
@@ -397,6 +509,15 @@ void zmq::pipe_t::terminate (bool delay_)
         //  Drop any unfinished outbound messages.
         rollback ();
 
+        //  If the messages are being spilled, let the reader get back to
+        //  the pipe once it reads all of them, so that it finds the
+        //  delimiter.
+        if (out_spilling) {
+            if (!outspill->finish ())
+                send_activate_read (peer);
+            out_spilling = false;
+        }
+
         //  Write the delimiter into the pipe. Note that watermarks are not
         //  checked; thus the delimiter can be written even when the pipe is full.
         msg_t msg;
@@ -411,6 +532,11 @@ bool zmq::pipe_t::is_delimiter (msg_t &msg_)
     return msg_.is_delimiter ();
 }
 
+bool zmq::pipe_t::is_spill_marker (msg_t &msg_)
+{
+    return msg_.is_spill_marker ();
+}
+
 int zmq::pipe_t::compute_lwm (int hwm_)
 {
     //  Compute the low water mark. Following point should be taken
@@ -473,6 +599,7 @@ void zmq::pipe_t::hiccup ()
 
     alloc_assert (inpipe);
     in_active = true;
+    in_spilling = false;
 
     //  Notify the peer about the hiccup.
     send_hiccup (peer, (void*) inpipe);
@@ -483,3 +610,45 @@ void zmq::pipe_t::set_hwms (int inhwm_, int outhwm_)
     lwm = compute_lwm (inhwm_);
     hwm = outhwm_;
 }
+
+uint64_t zmq::pipe_t::get_queue_depth ()
+{
+    return msgs_written - peers_msgs_read;
+}
+
+void zmq::pipe_t::set_spill (const std::string &path_, int64_t maxsize_)
+{
+    //  Spill can be set once only.
+    zmq_assert (!outspill);
+    zmq_assert (!conflate);
+
+    //  Spill is deallocated by the reader, same as the underlying pipe.
+    outspill = new (std::nothrow) spill_t (path_, maxsize_);
+    alloc_assert (outspill);
+    peer->inspill = outspill;
+}
+
+void zmq::pipe_t::set_latency_tracking (const std::string &endpoint_)
+{
+    //  Latency tracking can be set once only.
+    zmq_assert (!inlatency && !outlatency);
+
+    //  Each tracker is referenced by both ends of the pipe and it's
+    //  deallocated when both of them are gone.
+    outlatency = new (std::nothrow) latency_t (endpoint_);
+    alloc_assert (outlatency);
+    peer->inlatency = outlatency;
+    inlatency = new (std::nothrow) latency_t (endpoint_);
+    alloc_assert (inlatency);
+    peer->outlatency = inlatency;
+}
+
+zmq::latency_t *zmq::pipe_t::get_inlatency ()
+{
+    return inlatency;
+}
+
+zmq::latency_t *zmq::pipe_t::get_outlatency ()
+{
+    return outlatency;
+}
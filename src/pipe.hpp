@@ -33,6 +33,8 @@ namespace zmq
 
     class object_t;
     class pipe_t;
+    class spill_t;
+    class latency_t;
 
     //  Create a pipepair for bi-directional transfer of messages.
     //  First HWM is for messages passed from first pipe to the second pipe.
@@ -52,6 +54,7 @@ namespace zmq
         virtual void read_activated (zmq::pipe_t *pipe_) = 0;
         virtual void write_activated (zmq::pipe_t *pipe_) = 0;
         virtual void hiccuped (zmq::pipe_t *pipe_) = 0;
+        virtual void hwm_reached (zmq::pipe_t *pipe_) = 0;
         virtual void pipe_terminated (zmq::pipe_t *pipe_) = 0;
     };
 
@@ -115,6 +118,28 @@ namespace zmq
         // set the high water marks.
         void set_hwms (int inhwm_, int outhwm_);
 
+        //  Returns the number of messages written to the pipe and not yet
+        //  read by the peer, as far as the writer knows.
+        uint64_t get_queue_depth ();
+
+        //  Lets the outbound messages that don't fit into the pipe because
+        //  of the high watermark to be spilled to the disk. The files are
+        //  stored in the directory specified and their total size is
+        //  limited by maxsize (-1 means no limit). Has to be called before
+        //  the pipe or its peer is handed to another thread.
+        void set_spill (const std::string &path_, int64_t maxsize_);
+
+        //  Starts measuring how long the messages spend in the pipe, in
+        //  both directions. The measurements are labeled with the endpoint
+        //  specified. Has to be called before the pipe or its peer is
+        //  handed to another thread.
+        void set_latency_tracking (const std::string &endpoint_);
+
+        //  Latency trackers for the inbound and outbound messages, NULL
+        //  if latency tracking is not enabled.
+        latency_t *get_inlatency ();
+        latency_t *get_outlatency ();
+
     private:
 
         //  Type of the underlying lock-free pipe.
@@ -146,6 +171,22 @@ namespace zmq
         upipe_t *inpipe;
         upipe_t *outpipe;
 
+        //  Overflow stores for both directions, if any. Same as with the
+        //  underlying pipes, inbound spill is owned by this pipe while
+        //  the outbound one is owned by the peer.
+        spill_t *inspill;
+        spill_t *outspill;
+
+        //  True if the messages are currently read from / written to
+        //  the spill rather than the underlying pipe.
+        bool in_spilling;
+        bool out_spilling;
+
+        //  Latency trackers for both directions, if any. Each of them is
+        //  shared with the peer.
+        latency_t *inlatency;
+        latency_t *outlatency;
+
         //  Can the pipe be read from / written to?
         bool in_active;
         bool out_active;
@@ -201,6 +242,9 @@ namespace zmq
         //  Returns true if the message is delimiter; false otherwise.
         static bool is_delimiter (msg_t &msg_);
 
+        //  Returns true if the message is spill marker; false otherwise.
+        static bool is_spill_marker (msg_t &msg_);
+
         //  Computes appropriate low watermark from the given high watermark.
         static int compute_lwm (int hwm_);
 
@@ -214,6 +214,16 @@ int zmq::plain_mechanism_t::process_hello (msg_t *msg_)
     //  Use ZAP protocol (RFC 27) to authenticate the user.
     int rc = session->zap_connect ();
     if (rc == 0) {
+        init_zap_key ("PLAIN", peer_address);
+        add_zap_key (username.c_str (), username.length ());
+        add_zap_key (password.c_str (), password.length ());
+
+        //  Skip the round-trip if the user was authenticated recently.
+        std::string metadata;
+        if (session->find_zap_result (zap_key, metadata))
+            return parse_metadata (
+                (const unsigned char *) metadata.data (), metadata.size ());
+
         send_zap_request (username, password);
         rc = receive_and_process_zap_reply ();
         if (rc != 0) {
@@ -471,6 +481,9 @@ int zmq::plain_mechanism_t::receive_and_process_zap_reply ()
     //  Process metadata frame
     rc = parse_metadata (static_cast <const unsigned char*> (msg [6].data ()),
                          msg [6].size ());
+    if (rc == 0)
+        session->store_zap_result (zap_key, std::string (
+            static_cast <const char*> (msg [6].data ()), msg [6].size ()));
 
 error:
     for (int i = 0; i < 7; i++) {
@@ -17,7 +17,9 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <new>
 #include <stddef.h>
+#include <stdio.h>
 #include "platform.hpp"
 #include "proxy.hpp"
 #include "likely.hpp"
@@ -48,12 +50,104 @@
 // These headers end up pulling in zmq.h somewhere in their include
 // dependency chain
 #include "socket_base.hpp"
+#include "ctx.hpp"
+#include "thread.hpp"
+#include "config.hpp"
 #include "err.hpp"
 
 // zmq.h must be included *after* poll.h for AIX to build properly
 #include "../include/zmq.h"
 
 
+//  Copies the message to the capture socket, if any.
+static int capture (zmq::socket_base_t *capture_, zmq::msg_t &msg_,
+    int more_ = 0)
+{
+    if (capture_) {
+        zmq::msg_t ctrl;
+        int rc = ctrl.init ();
+        if (unlikely (rc < 0))
+            return -1;
+        rc = ctrl.copy (msg_);
+        if (unlikely (rc < 0))
+            return -1;
+        rc = capture_->send (&ctrl, more_ ? ZMQ_SNDMORE : 0);
+        if (unlikely (rc < 0))
+            return -1;
+    }
+    return 0;
+}
+
+//  Forwards up to proxy_burst_size whole messages that are available on
+//  the 'from_' socket. At least one message must be available.
+static int forward (
+    zmq::socket_base_t *from_, zmq::proxy_stats_t *from_stats_,
+    zmq::socket_base_t *to_, zmq::proxy_stats_t *to_stats_,
+    zmq::socket_base_t *capture_, zmq::msg_t &msg_)
+{
+    for (int count = 0; count != zmq::proxy_burst_size; count++) {
+
+        //  The remaining messages of the burst are only taken if there
+        //  are any. The rest of a multipart message is always there.
+        int rc = from_->recv (&msg_, count ? ZMQ_DONTWAIT : 0);
+        if (unlikely (rc < 0))
+            return count && errno == EAGAIN ? 0 : -1;
+
+        while (true) {
+            const int more = msg_.flags () & zmq::msg_t::more;
+            const size_t size = msg_.size ();
+            from_stats_->msg_in++;
+            from_stats_->bytes_in += size;
+
+            rc = capture (capture_, msg_, more);
+            if (unlikely (rc < 0))
+                return -1;
+
+            rc = to_->send (&msg_, more ? ZMQ_SNDMORE : 0);
+            if (unlikely (rc < 0))
+                return -1;
+            to_stats_->msg_out++;
+            to_stats_->bytes_out += size;
+
+            if (!more)
+                break;
+
+            rc = from_->recv (&msg_, 0);
+            if (unlikely (rc < 0))
+                return -1;
+        }
+    }
+    return 0;
+}
+
+int zmq::reply_proxy_stats (socket_base_t *control_,
+    const proxy_stats_t &frontend_, const proxy_stats_t &backend_,
+    int flags_)
+{
+    const uint64_t values [] = {
+        frontend_.msg_in, frontend_.bytes_in,
+        frontend_.msg_out, frontend_.bytes_out,
+        backend_.msg_in, backend_.bytes_in,
+        backend_.msg_out, backend_.bytes_out
+    };
+    const int count = sizeof values / sizeof values [0];
+
+    for (int i = 0; i != count; i++) {
+        msg_t msg;
+        int rc = msg.init_size (sizeof (uint64_t));
+        if (unlikely (rc < 0))
+            return -1;
+        memcpy (msg.data (), &values [i], sizeof (uint64_t));
+        rc = control_->send (&msg,
+            (i < count - 1 ? ZMQ_SNDMORE : 0) | flags_);
+        if (unlikely (rc < 0)) {
+            msg.close ();
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int zmq::proxy (
     class socket_base_t *frontend_,
     class socket_base_t *backend_,
@@ -77,6 +171,10 @@ int zmq::proxy (
     };
     int qt_poll_items = (control_ ? 3 : 2);
 
+    //  Frames and bytes passed through each side.
+    proxy_stats_t frontend_stats = {0, 0, 0, 0};
+    proxy_stats_t backend_stats = {0, 0, 0, 0};
+
     //  Proxy can be in these three states
     enum {
         active,
@@ -102,18 +200,10 @@ int zmq::proxy (
                 return -1;
 
             //  Copy message to capture socket if any
-            if (capture_) {
-                msg_t ctrl;
-                rc = ctrl.init ();
-                if (unlikely (rc < 0))
-                    return -1;
-                rc = ctrl.copy (msg);
-                if (unlikely (rc < 0))
-                    return -1;
-                rc = capture_->send (&ctrl, 0);
-                if (unlikely (rc < 0))
-                    return -1;
-            }
+            rc = capture (capture_, msg);
+            if (unlikely (rc < 0))
+                return -1;
+
             if (msg.size () == 5 && memcmp (msg.data (), "PAUSE", 5) == 0)
                 state = paused;
             else
@@ -122,78 +212,255 @@ int zmq::proxy (
             else
             if (msg.size () == 9 && memcmp (msg.data (), "TERMINATE", 9) == 0)
                 state = terminated;
+            else
+            if (msg.size () == 10 &&
+                  memcmp (msg.data (), "STATISTICS", 10) == 0) {
+                rc = reply_proxy_stats (control_, frontend_stats,
+                    backend_stats, 0);
+                if (unlikely (rc < 0))
+                    return -1;
+            }
             else {
                 //  This is an API error, we should assert
                 puts ("E: invalid command sent to proxy");
                 assert (false);
             }
         }
-        //  Process a request
+        //  Process a burst of requests
         if (state == active
         &&  items [0].revents & ZMQ_POLLIN) {
-            while (true) {
-                rc = frontend_->recv (&msg, 0);
-                if (unlikely (rc < 0))
-                    return -1;
-
-                moresz = sizeof more;
-                rc = frontend_->getsockopt (ZMQ_RCVMORE, &more, &moresz);
-                if (unlikely (rc < 0))
-                    return -1;
-
-                //  Copy message to capture socket if any
-                if (capture_) {
-                    msg_t ctrl;
-                    rc = ctrl.init ();
-                    if (unlikely (rc < 0))
-                        return -1;
-                    rc = ctrl.copy (msg);
-                    if (unlikely (rc < 0))
-                        return -1;
-                    rc = capture_->send (&ctrl, more? ZMQ_SNDMORE: 0);
-                    if (unlikely (rc < 0))
-                        return -1;
-                }
-                rc = backend_->send (&msg, more? ZMQ_SNDMORE: 0);
-                if (unlikely (rc < 0))
-                    return -1;
-                if (more == 0)
-                    break;
-            }
+            rc = forward (frontend_, &frontend_stats,
+                backend_, &backend_stats, capture_, msg);
+            if (unlikely (rc < 0))
+                return -1;
         }
-        //  Process a reply
+        //  Process a burst of replies
         if (state == active
         &&  items [1].revents & ZMQ_POLLIN) {
-            while (true) {
-                rc = backend_->recv (&msg, 0);
+            rc = forward (backend_, &backend_stats,
+                frontend_, &frontend_stats, capture_, msg);
             if (unlikely (rc < 0))
                 return -1;
+        }
+    }
+    return 0;
+}
 
-            moresz = sizeof more;
-            rc = backend_->getsockopt (ZMQ_RCVMORE, &more, &moresz);
-            if (unlikely (rc < 0))
-                return -1;
+//  One worker of a sharded proxy.
+struct proxy_shard_t
+{
+    zmq::socket_base_t *frontend;
+    zmq::socket_base_t *backend;
 
-            //  Copy message to capture socket if any
-            if (capture_) {
-                msg_t ctrl;
-                rc = ctrl.init ();
-                if (unlikely (rc < 0))
-                    return -1;
-                rc = ctrl.copy (msg);
-                if (unlikely (rc < 0))
-                    return -1;
-                rc = capture_->send (&ctrl, more? ZMQ_SNDMORE: 0);
-                if (unlikely (rc < 0))
-                    return -1;
-            }
-            rc = frontend_->send (&msg, more? ZMQ_SNDMORE: 0);
-            if (unlikely (rc < 0))
+    //  Both ends of the PAIR the worker is steered over.
+    zmq::socket_base_t *steer;
+    zmq::socket_base_t *control;
+
+    zmq::thread_t thread;
+};
+
+static void run_shard (void *arg_)
+{
+    proxy_shard_t *shard = (proxy_shard_t*) arg_;
+    zmq::proxy (shard->frontend, shard->backend, NULL, shard->control);
+}
+
+//  Binds the sockets of all the shards to the endpoint, if any.
+static int bind_shards (zmq::socket_base_t **sockets_, int shards_,
+    const char *endpoint_, int strategy_)
+{
+    if (!endpoint_)
+        return 0;
+
+    int rc = sockets_ [0]->bind_shared (endpoint_, strategy_);
+    if (rc != 0)
+        return -1;
+
+    //  A wildcard address is resolved by the first bind; the other shards
+    //  bind to whatever it got.
+    char endpoint [256];
+    size_t size = sizeof endpoint;
+    rc = sockets_ [0]->getsockopt (ZMQ_LAST_ENDPOINT, endpoint, &size);
+    if (rc != 0)
+        return -1;
+
+    for (int i = 1; i != shards_; i++) {
+        rc = sockets_ [i]->bind_shared (endpoint, strategy_);
+        if (rc != 0)
+            return -1;
+    }
+    return 0;
+}
+
+//  Passes a control command to every shard. If totals_ is not NULL, the
+//  shards' replies to STATISTICS are summed up into its eight counters.
+static int steer_shards (proxy_shard_t *shards_, int count_,
+    zmq::msg_t &command_, uint64_t *totals_)
+{
+    for (int i = 0; i != count_; i++) {
+        zmq::msg_t msg;
+        int rc = msg.init ();
+        if (unlikely (rc < 0))
+            return -1;
+        rc = msg.copy (command_);
+        if (unlikely (rc < 0))
+            return -1;
+        rc = shards_ [i].steer->send (&msg, 0);
+        if (unlikely (rc < 0)) {
+            msg.close ();
+            return -1;
+        }
+    }
+
+    if (!totals_)
+        return 0;
+
+    zmq::msg_t msg;
+    int rc = msg.init ();
+    if (unlikely (rc < 0))
+        return -1;
+    for (int i = 0; i != count_; i++)
+        for (int j = 0; j != 8; j++) {
+            rc = shards_ [i].steer->recv (&msg, 0);
+            if (unlikely (rc < 0) || msg.size () != sizeof (uint64_t)) {
+                msg.close ();
                 return -1;
-            if (more == 0)
-                break;
+            }
+            uint64_t value;
+            memcpy (&value, msg.data (), sizeof value);
+            totals_ [j] += value;
+        }
+    return msg.close ();
+}
+
+int zmq::proxy_sharded (
+    socket_base_t **frontends_,
+    socket_base_t **backends_,
+    int shards_,
+    const char *frontend_endpoint_,
+    const char *backend_endpoint_,
+    int strategy_,
+    socket_base_t *control_)
+{
+    //  The shared endpoints are bound before the sockets are handed over
+    //  to the workers.
+    int rc = bind_shards (frontends_, shards_, frontend_endpoint_, strategy_);
+    if (rc != 0)
+        return -1;
+    rc = bind_shards (backends_, shards_, backend_endpoint_, strategy_);
+    if (rc != 0)
+        return -1;
+
+    msg_t msg;
+    rc = msg.init ();
+    if (rc != 0)
+        return -1;
+
+    ctx_t *ctx = frontends_ [0]->get_ctx ();
+    proxy_shard_t *shards = new (std::nothrow) proxy_shard_t [shards_];
+    alloc_assert (shards);
+
+    //  Create all the control pairs before starting any of the workers so
+    //  that there's nothing to stop if that fails.
+    int ready = 0;
+    for (; ready != shards_; ready++) {
+        proxy_shard_t &shard = shards [ready];
+        shard.frontend = frontends_ [ready];
+        shard.backend = backends_ [ready];
+        shard.steer = ctx->create_socket (ZMQ_PAIR);
+        shard.control = ctx->create_socket (ZMQ_PAIR);
+        if (!shard.steer || !shard.control)
+            break;
+
+        char endpoint [64];
+        sprintf (endpoint, "inproc://zmq.proxy.shard.%p", (void*) &shard);
+        rc = shard.steer->bind (endpoint);
+        if (rc == 0)
+            rc = shard.control->connect (endpoint);
+        if (rc != 0)
+            break;
+    }
+    const bool running = ready == shards_;
+    if (running)
+        for (int i = 0; i != shards_; i++)
+            shards [i].thread.start (run_shard, &shards [i]);
+
+    //  Commands received on the control socket are applied to all the
+    //  shards, and the statistics they return are aggregated.
+    bool terminated = false;
+    rc = running ? 0 : -1;
+    while (control_ && rc == 0 && !terminated) {
+        rc = control_->recv (&msg, 0);
+        if (unlikely (rc < 0))
+            break;
+
+        int more;
+        size_t moresz = sizeof more;
+        rc = control_->getsockopt (ZMQ_RCVMORE, &more, &moresz);
+        if (unlikely (rc < 0) || more) {
+            rc = -1;
+            break;
+        }
+
+        if (msg.size () == 10 &&
+              memcmp (msg.data (), "STATISTICS", 10) == 0) {
+            uint64_t totals [8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            rc = steer_shards (shards, shards_, msg, totals);
+            if (rc == 0) {
+                const proxy_stats_t frontend_stats =
+                    {totals [0], totals [1], totals [2], totals [3]};
+                const proxy_stats_t backend_stats =
+                    {totals [4], totals [5], totals [6], totals [7]};
+                rc = reply_proxy_stats (control_, frontend_stats,
+                    backend_stats, 0);
             }
         }
+        else
+        if ((msg.size () == 5 && memcmp (msg.data (), "PAUSE", 5) == 0)
+        ||  (msg.size () == 6 && memcmp (msg.data (), "RESUME", 6) == 0))
+            rc = steer_shards (shards, shards_, msg, NULL);
+        else
+        if (msg.size () == 9 && memcmp (msg.data (), "TERMINATE", 9) == 0) {
+            rc = steer_shards (shards, shards_, msg, NULL);
+            terminated = rc == 0;
+        }
+        else {
+            //  This is an API error, we should assert
+            puts ("E: invalid command sent to proxy");
+            assert (false);
+        }
+    }
+    //  Without a control socket the shards run until the context is
+    //  terminated, which is all there is to wait for.
+    const int err = control_ || !running ? errno : ETERM;
+    msg.close ();
+
+    //  On error the workers are asked to stop, which fails harmlessly if
+    //  the context is being terminated: they stop on their own then.
+    if (running) {
+        if (control_ && !terminated)
+            for (int i = 0; i != shards_; i++) {
+                msg_t stop;
+                rc = stop.init_size (9);
+                errno_assert (rc == 0);
+                memcpy (stop.data (), "TERMINATE", 9);
+                if (shards [i].steer->send (&stop, ZMQ_DONTWAIT) != 0)
+                    stop.close ();
+            }
+        for (int i = 0; i != shards_; i++)
+            shards [i].thread.stop ();
+    }
+    for (int i = 0; i != shards_ && i <= ready; i++) {
+        if (shards [i].steer)
+            shards [i].steer->close ();
+        if (shards [i].control)
+            shards [i].control->close ();
+    }
+    delete [] shards;
+
+    if (!terminated) {
+        errno = err;
+        return -1;
     }
     return 0;
 }
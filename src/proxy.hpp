@@ -20,13 +20,44 @@
 #ifndef __ZMQ_PROXY_HPP_INCLUDED__
 #define __ZMQ_PROXY_HPP_INCLUDED__
 
+#include "stdint.hpp"
+
 namespace zmq
 {
+    class socket_base_t;
+
+    //  Frames and bytes passed through one side of a proxy.
+    struct proxy_stats_t
+    {
+        uint64_t msg_in;
+        uint64_t bytes_in;
+        uint64_t msg_out;
+        uint64_t bytes_out;
+    };
+
+    //  Replies to the STATISTICS command with eight 64-bit frames, the
+    //  statistics of the frontend followed by those of the backend.
+    int reply_proxy_stats (socket_base_t *control_,
+        const proxy_stats_t &frontend_, const proxy_stats_t &backend_,
+        int flags_);
+
     int proxy (
         class socket_base_t *frontend_,
         class socket_base_t *backend_,
         class socket_base_t *capture_,
         class socket_base_t *control_ = NULL); // backward compatibility without this argument
+
+    //  Runs one proxy thread per frontend/backend pair and steers them all
+    //  from the calling thread. The endpoints, if not NULL, are bound by
+    //  all the frontends (backends) at once, see socket_base_t::bind_shared.
+    int proxy_sharded (
+        socket_base_t **frontends_,
+        socket_base_t **backends_,
+        int shards_,
+        const char *frontend_endpoint_,
+        const char *backend_endpoint_,
+        int strategy_,
+        socket_base_t *control_);
 }
 
 #endif
@@ -52,6 +52,16 @@ void zmq::raw_decoder_t::get_buffer (unsigned char **data_, size_t *size_)
     *size_ = bufsize;
 }
 
+void zmq::raw_decoder_t::resize_buffer (size_t size_)
+{
+    if (size_ == bufsize)
+        return;
+    free (buffer);
+    buffer = (unsigned char *) malloc (size_);
+    alloc_assert (buffer);
+    bufsize = size_;
+}
+
 int zmq::raw_decoder_t::decode (const uint8_t *data_, size_t size_,
     size_t &bytes_used_)
 {
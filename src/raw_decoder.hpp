@@ -46,13 +46,15 @@ namespace zmq
 
         virtual msg_t *msg () { return &in_progress; }
 
+        virtual void resize_buffer (size_t size_);
+
 
     private:
 
 
         msg_t in_progress;
 
-        const size_t bufsize;
+        size_t bufsize;
 
         unsigned char *buffer;
 
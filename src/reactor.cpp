@@ -0,0 +1,291 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "reactor.hpp"
+#include "socket_base.hpp"
+#include "config.hpp"
+#include "err.hpp"
+
+#include <new>
+
+zmq::reactor_t::reactor_t () :
+    tag (0xcafef00d),
+    next_timer_id (1)
+{
+}
+
+zmq::reactor_t::~reactor_t ()
+{
+    //  Mark the reactor as dead.
+    tag = 0xdeadbeef;
+
+    cleanup ();
+    for (handlers_t::iterator it = handlers.begin (); it != handlers.end ();
+          ++it)
+        delete *it;
+    for (timers_t::iterator it = timers.begin (); it != timers.end (); ++it)
+        delete it->second;
+}
+
+bool zmq::reactor_t::check_tag ()
+{
+    return tag == 0xcafef00d;
+}
+
+int zmq::reactor_t::add (socket_base_t *socket_, short events_,
+    zmq_reactor_fn *handler_, void *arg_)
+{
+    if (!handler_) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    handler_t *handler = new (std::nothrow) handler_t;
+    alloc_assert (handler);
+    handler->socket = socket_;
+    handler->fd = retired_fd;
+    handler->fn = handler_;
+    handler->arg = arg_;
+    handler->retired = false;
+
+    if (poller.add (socket_, handler, events_) == -1) {
+        delete handler;
+        return -1;
+    }
+    handlers.push_back (handler);
+    return 0;
+}
+
+int zmq::reactor_t::remove (socket_base_t *socket_)
+{
+    if (poller.remove (socket_) == -1)
+        return -1;
+
+    for (handlers_t::iterator it = handlers.begin (); it != handlers.end ();
+          ++it)
+        if ((*it)->socket == socket_) {
+            //  The handler may be referred to by the events being
+            //  dispatched, so it's deleted at the end of the iteration.
+            (*it)->retired = true;
+            retired_handlers.push_back (*it);
+            handlers.erase (it);
+            break;
+        }
+    return 0;
+}
+
+int zmq::reactor_t::add_fd (fd_t fd_, short events_,
+    zmq_reactor_fn *handler_, void *arg_)
+{
+    if (!handler_) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    handler_t *handler = new (std::nothrow) handler_t;
+    alloc_assert (handler);
+    handler->socket = NULL;
+    handler->fd = fd_;
+    handler->fn = handler_;
+    handler->arg = arg_;
+    handler->retired = false;
+
+    if (poller.add_fd (fd_, handler, events_) == -1) {
+        delete handler;
+        return -1;
+    }
+    handlers.push_back (handler);
+    return 0;
+}
+
+int zmq::reactor_t::remove_fd (fd_t fd_)
+{
+    if (poller.remove_fd (fd_) == -1)
+        return -1;
+
+    for (handlers_t::iterator it = handlers.begin (); it != handlers.end ();
+          ++it)
+        if (!(*it)->socket && (*it)->fd == fd_) {
+            (*it)->retired = true;
+            retired_handlers.push_back (*it);
+            handlers.erase (it);
+            break;
+        }
+    return 0;
+}
+
+int zmq::reactor_t::add_timer (long interval_, int times_,
+    zmq_timer_fn *handler_, void *arg_)
+{
+    if (interval_ < 0 || times_ < 0 || !handler_) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    timer_info_t *timer = new (std::nothrow) timer_info_t;
+    alloc_assert (timer);
+    timer->id = next_timer_id++;
+    timer->interval = interval_;
+    timer->times = times_;
+    timer->expiry = clock.now_ms () + interval_;
+    timer->fn = handler_;
+    timer->arg = arg_;
+    timer->retired = false;
+    schedule (timer);
+    return timer->id;
+}
+
+int zmq::reactor_t::cancel_timer (int timer_id_)
+{
+    //  Complexity of this operation is O(n). We assume it is rarely used.
+    for (timers_t::iterator it = timers.begin (); it != timers.end (); ++it)
+        if (it->second->id == timer_id_) {
+            timer_info_t *timer = it->second;
+            timers.erase (it);
+            timer->retired = true;
+            retired_timers.push_back (timer);
+            return 0;
+        }
+
+    errno = EINVAL;
+    return -1;
+}
+
+void zmq::reactor_t::schedule (timer_info_t *timer_)
+{
+    timers.insert (timers_t::value_type (timer_->expiry, timer_));
+}
+
+void zmq::reactor_t::unschedule (timer_info_t *timer_)
+{
+    std::pair <timers_t::iterator, timers_t::iterator> range =
+        timers.equal_range (timer_->expiry);
+    for (timers_t::iterator it = range.first; it != range.second; ++it)
+        if (it->second == timer_) {
+            timers.erase (it);
+            return;
+        }
+    zmq_assert (false);
+}
+
+long zmq::reactor_t::next_timeout ()
+{
+    if (timers.empty ())
+        return -1;
+    const uint64_t now = clock.now_ms ();
+    const uint64_t expiry = timers.begin ()->first;
+    return expiry > now ? (long) (expiry - now) : 0;
+}
+
+int zmq::reactor_t::execute_timers ()
+{
+    //  Fast track.
+    if (timers.empty ())
+        return 0;
+
+    //  Collect the timers that are due first, so that the timers the
+    //  handlers schedule are left for the next iteration.
+    const uint64_t current = clock.now_ms ();
+    std::vector <timer_info_t*> due;
+    for (timers_t::iterator it = timers.begin ();
+          it != timers.end () && it->first <= current; ++it)
+        due.push_back (it->second);
+
+    for (size_t i = 0; i != due.size (); i++) {
+        timer_info_t *timer = due [i];
+
+        //  Cancelled by one of the previous handlers.
+        if (timer->retired)
+            continue;
+
+        const int rc = timer->fn (this, timer->id, timer->arg);
+
+        //  Unless the handler cancelled the timer, schedule its next run.
+        if (!timer->retired) {
+            unschedule (timer);
+            if (timer->times > 0 && --timer->times == 0) {
+                timer->retired = true;
+                retired_timers.push_back (timer);
+            }
+            else {
+                timer->expiry = current + timer->interval;
+                schedule (timer);
+            }
+        }
+
+        if (rc == -1)
+            return -1;
+    }
+    return 0;
+}
+
+void zmq::reactor_t::cleanup ()
+{
+    for (handlers_t::iterator it = retired_handlers.begin ();
+          it != retired_handlers.end (); ++it)
+        delete *it;
+    retired_handlers.clear ();
+    for (std::vector <timer_info_t*>::iterator it = retired_timers.begin ();
+          it != retired_timers.end (); ++it)
+        delete *it;
+    retired_timers.clear ();
+}
+
+int zmq::reactor_t::run_once (long timeout_)
+{
+    //  Don't wait past the next timer.
+    long timeout = next_timeout ();
+    if (timeout_ >= 0 && (timeout < 0 || timeout_ < timeout))
+        timeout = timeout_;
+
+    zmq_poller_event_t events [reactor_max_events];
+    int rc = poller.wait (events, reactor_max_events, timeout);
+    if (rc == -1 && errno != EAGAIN)
+        return -1;
+    const int n = rc == -1 ? 0 : rc;
+
+    int stop = 0;
+    for (int i = 0; i != n && !stop; i++) {
+        handler_t *handler = (handler_t*) events [i].user_data;
+
+        //  Removed by one of the previous handlers.
+        if (handler->retired)
+            continue;
+
+        events [i].user_data = handler->arg;
+        if (handler->fn (this, &events [i], handler->arg) == -1)
+            stop = 1;
+    }
+
+    if (!stop && execute_timers () == -1)
+        stop = 1;
+
+    cleanup ();
+    return stop;
+}
+
+int zmq::reactor_t::run ()
+{
+    while (true) {
+        const int rc = run_once (-1);
+        if (rc != 0)
+            return rc == 1 ? 0 : -1;
+    }
+}
@@ -0,0 +1,136 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_REACTOR_HPP_INCLUDED__
+#define __ZMQ_REACTOR_HPP_INCLUDED__
+
+#include <map>
+#include <vector>
+
+#include "../include/zmq.h"
+#include "socket_poller.hpp"
+#include "clock.hpp"
+#include "fd.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class socket_base_t;
+
+    //  Implementation of the zmq_reactor API. Dispatches callbacks for
+    //  ready sockets, file descriptors and timers. It waits using the
+    //  socket_poller_t, which takes care of the edge-triggered ZMQ_FD, so
+    //  a socket's handler is called for as long as it has the events.
+    //  Like the poller, it's meant to be used from a single thread, either
+    //  by run, or by calling run_once from the application's own loop.
+
+    class reactor_t
+    {
+    public:
+
+        reactor_t ();
+        ~reactor_t ();
+
+        //  Returns false if object is not a reactor.
+        bool check_tag ();
+
+        int add (socket_base_t *socket_, short events_,
+            zmq_reactor_fn *handler_, void *arg_);
+        int remove (socket_base_t *socket_);
+        int add_fd (fd_t fd_, short events_, zmq_reactor_fn *handler_,
+            void *arg_);
+        int remove_fd (fd_t fd_);
+
+        //  Returns the ID of the new timer. 'times_' of 0 means forever.
+        int add_timer (long interval_, int times_, zmq_timer_fn *handler_,
+            void *arg_);
+        int cancel_timer (int timer_id_);
+
+        //  Waits up to timeout_ ms for events, then dispatches at most
+        //  reactor_max_events of them and the timers that are due.
+        //  Returns 1 if a handler asked to stop, 0 otherwise.
+        int run_once (long timeout_);
+
+        //  Calls run_once until a handler asks to stop.
+        int run ();
+
+    private:
+
+        struct handler_t
+        {
+            socket_base_t *socket;
+            fd_t fd;
+            zmq_reactor_fn *fn;
+            void *arg;
+            bool retired;
+        };
+
+        struct timer_info_t
+        {
+            int id;
+            long interval;
+            int times;
+            uint64_t expiry;
+            zmq_timer_fn *fn;
+            void *arg;
+            bool retired;
+        };
+
+        //  Dispatches the timers that are due. Returns -1 if a handler
+        //  asked to stop.
+        int execute_timers ();
+
+        //  Returns the time to wait for the next timer, -1 if none.
+        long next_timeout ();
+
+        void schedule (timer_info_t *timer_);
+        void unschedule (timer_info_t *timer_);
+
+        //  Deletes the handlers and timers removed during an iteration.
+        void cleanup ();
+
+        //  Used to check whether the object is a reactor.
+        uint32_t tag;
+
+        socket_poller_t poller;
+
+        typedef std::vector <handler_t*> handlers_t;
+        handlers_t handlers;
+
+        //  Active timers, sorted by expiry.
+        typedef std::multimap <uint64_t, timer_info_t*> timers_t;
+        timers_t timers;
+        int next_timer_id;
+
+        //  Handlers and timers removed while the reactor may still hold
+        //  pointers to them.
+        handlers_t retired_handlers;
+        std::vector <timer_info_t*> retired_timers;
+
+        clock_t clock;
+
+        reactor_t (const reactor_t&);
+        const reactor_t &operator = (const reactor_t&);
+    };
+
+}
+
+#endif
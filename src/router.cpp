@@ -36,7 +36,8 @@ zmq::router_t::router_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     //  raw_sock functionality in ROUTER is deprecated
     raw_sock (false),       
     probe_router (false),
-    handover(false)
+    handover(false),
+    msgs_dropped (0)
 {
     options.type = ZMQ_ROUTER;
     options.recv_identity = true;
@@ -198,6 +199,7 @@ int zmq::router_t::xsend (msg_t *msg_)
                         errno = EAGAIN;
                         return -1;
                     }
+                    msgs_dropped++;
                 }
             }
             else
@@ -370,6 +372,11 @@ bool zmq::router_t::xhas_out ()
     return true;
 }
 
+uint64_t zmq::router_t::xmsgs_dropped ()
+{
+    return msgs_dropped;
+}
+
 bool zmq::router_t::identify_peer (pipe_t *pipe_)
 {
     msg_t msg;
@@ -54,6 +54,7 @@ namespace zmq
         void xread_activated (zmq::pipe_t *pipe_);
         void xwrite_activated (zmq::pipe_t *pipe_);
         void xpipe_terminated (zmq::pipe_t *pipe_);
+        uint64_t xmsgs_dropped ();
 
     protected:
 
@@ -120,6 +121,9 @@ namespace zmq
         // will be terminated.
         bool handover;
 
+        //  Number of messages dropped because the peer's pipe was full.
+        uint64_t msgs_dropped;
+
         router_t (const router_t&);
         const router_t &operator = (const router_t&);
     };
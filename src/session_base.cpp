@@ -27,6 +27,7 @@
 #include "tipc_connecter.hpp"
 #include "pgm_sender.hpp"
 #include "pgm_receiver.hpp"
+#include "udp_engine.hpp"
 #include "address.hpp"
 
 #include "ctx.hpp"
@@ -78,7 +79,11 @@ zmq::session_base_t::session_base_t (class io_thread_t *io_thread_,
     socket (socket_),
     io_thread (io_thread_),
     has_linger_timer (false),
-    addr (addr_)
+    addr (addr_),
+    last_hwm_event (0),
+    hwm_events (0),
+    last_lwm_event (0),
+    lwm_events (0)
 {
 }
 
@@ -165,6 +170,25 @@ int zmq::session_base_t::write_zap_msg (msg_t *msg_)
     return 0;
 }
 
+bool zmq::session_base_t::find_zap_result (const std::string &key_,
+    std::string &metadata_)
+{
+    if (options.zap_cache_ttl == 0)
+        return false;
+
+    const bool hit = get_ctx ()->get_zap_cache ()->find (key_, metadata_);
+    socket->count_zap_lookup (hit);
+    return hit;
+}
+
+void zmq::session_base_t::store_zap_result (const std::string &key_,
+    const std::string &metadata_)
+{
+    if (options.zap_cache_ttl > 0)
+        get_ctx ()->get_zap_cache ()->insert (key_, metadata_,
+            options.zap_cache_ttl);
+}
+
 void zmq::session_base_t::reset ()
 {
 }
@@ -255,10 +279,45 @@ void zmq::session_base_t::write_activated (pipe_t *pipe_)
         return;
     }
 
+    //  Let the socket know the pipe has drained to the LWM.
+    if (socket->is_monitored (ZMQ_EVENT_LWM_DRAINED)) {
+        lwm_events++;
+        const uint64_t now = clock.now_ms ();
+        if (now - last_lwm_event >= (uint64_t) options.monitor_interval) {
+            std::string endpoint;
+            if (addr)
+                addr->to_string (endpoint);
+            socket->event_lwm_drained (endpoint, lwm_events);
+            last_lwm_event = now;
+            lwm_events = 0;
+        }
+    }
+
     if (engine)
         engine->restart_input ();
 }
 
+void zmq::session_base_t::hwm_reached (pipe_t *pipe_)
+{
+    //  ZAP pipe has no HWM.
+    if (pipe_ != pipe)
+        return;
+
+    if (!socket->is_monitored (ZMQ_EVENT_HWM_REACHED))
+        return;
+
+    hwm_events++;
+    const uint64_t now = clock.now_ms ();
+    if (now - last_hwm_event >= (uint64_t) options.monitor_interval) {
+        std::string endpoint;
+        if (addr)
+            addr->to_string (endpoint);
+        socket->event_hwm_reached (endpoint, hwm_events);
+        last_hwm_event = now;
+        hwm_events = 0;
+    }
+}
+
 void zmq::session_base_t::hiccuped (pipe_t *)
 {
     //  Hiccups are always sent from session to socket, not the other
@@ -281,7 +340,7 @@ int zmq::session_base_t::zap_connect ()
 {
     zmq_assert (zap_pipe == NULL);
 
-    endpoint_t peer = find_endpoint ("inproc://zeromq.zap.01");
+    endpoint_t peer = find_endpoint ("inproc://zeromq.zap.01", options);
     if (peer.socket == NULL) {
         errno = ECONNREFUSED;
         return -1;
@@ -345,6 +404,19 @@ void zmq::session_base_t::process_attach (i_engine *engine_)
         int rc = pipepair (parents, pipes, hwms, conflates);
         errno_assert (rc == 0);
 
+        //  Let the socket spill the messages exceeding the HWM, if required.
+        if (!options.spill_path.empty () && !conflate)
+            pipes [1]->set_spill (options.spill_path, options.spill_maxsize);
+
+        //  Measure the latency if required. The pipes of the accepted
+        //  connections are not labeled with any endpoint.
+        if (options.latency_tracking) {
+            std::string endpoint;
+            if (addr)
+                addr->to_string (endpoint);
+            pipes [1]->set_latency_tracking (endpoint);
+        }
+
         //  Plug the local end of the pipe.
         pipes [0]->set_event_sink (this);
 
@@ -362,7 +434,7 @@ void zmq::session_base_t::process_attach (i_engine *engine_)
     engine->plug (io_thread, this);
 }
 
-void zmq::session_base_t::engine_error ()
+void zmq::session_base_t::engine_error (bool timed_out_)
 {
     //  Engine is dead. Let's forget about it.
     engine = NULL;
@@ -371,8 +443,10 @@ void zmq::session_base_t::engine_error ()
     if (pipe)
         clean_pipes ();
 
+    //  A peer which stopped responding is unlikely to come back soon,
+    //  so its pipe is dropped lest the socket keep routing messages to it.
     if (active)
-        reconnect ();
+        reconnect (timed_out_);
     else
         terminate ();
 
@@ -443,13 +517,15 @@ void zmq::session_base_t::timer_event (int id_)
     pipe->terminate (false);
 }
 
-void zmq::session_base_t::reconnect ()
+void zmq::session_base_t::reconnect (bool drop_pipe_)
 {
     //  For delayed connect situations, terminate the pipe
     //  and reestablish later on
-    if (pipe && options.immediate == 1
-        && addr->protocol != "pgm" && addr->protocol != "epgm") {
-        pipe->hiccup ();
+    if (pipe && (options.immediate == 1 || drop_pipe_)
+        && addr->protocol != "pgm" && addr->protocol != "epgm"
+        && addr->protocol != "udp") {
+        if (options.immediate == 1)
+            pipe->hiccup ();
         pipe->terminate (false);
         terminating_pipes.insert (pipe);
         pipe = NULL;
@@ -458,8 +534,10 @@ void zmq::session_base_t::reconnect ()
     reset ();
 
     //  Reconnect.
-    if (options.reconnect_ivl != -1)
+    if (options.reconnect_ivl != -1) {
+        socket->count_reconnect ();
         start_connecting (true);
+    }
 
     //  For subscriber sockets we hiccup the inbound pipe, which will cause
     //  the socket object to resend all the subscriptions.
@@ -487,7 +565,7 @@ void zmq::session_base_t::start_connecting (bool wait_)
     }
 
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
-    if (addr->protocol == "ipc") {
+    if (addr->protocol == "ipc" || addr->protocol == "shm") {
         ipc_connecter_t *connecter = new (std::nothrow) ipc_connecter_t (
             io_thread, this, options, addr, wait_);
         alloc_assert (connecter);
@@ -505,6 +583,35 @@ void zmq::session_base_t::start_connecting (bool wait_)
     }
 #endif
 
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+    if (addr->protocol == "udp") {
+
+        zmq_assert (options.type == ZMQ_PUB || options.type == ZMQ_XPUB
+                 || options.type == ZMQ_SUB || options.type == ZMQ_XSUB);
+
+        //  As with PGM, there's no concept of 'connect'; the engine is
+        //  attached straight away.
+        const bool send = options.type == ZMQ_PUB || options.type == ZMQ_XPUB;
+        udp_engine_t *engine = new (std::nothrow) udp_engine_t (
+            io_thread, options);
+        alloc_assert (engine);
+
+        int rc = engine->init (addr->resolved.udp_addr, send);
+        if (rc != 0) {
+            //  Typically the port is taken already; there's no peer to
+            //  retry with, so report the failure and stay idle.
+            std::string endpoint;
+            addr->to_string (endpoint);
+            socket->event_bind_failed (endpoint, zmq_errno ());
+            delete engine;
+            return;
+        }
+
+        send_attach (this, engine);
+        return;
+    }
+#endif
+
 #ifdef ZMQ_HAVE_OPENPGM
 
     //  Both PGM and EPGM transports are using the same infrastructure.
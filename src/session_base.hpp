@@ -55,12 +55,16 @@ namespace zmq
         //  Following functions are the interface exposed towards the engine.
         virtual void reset ();
         void flush ();
-        void engine_error ();
+
+        //  Called by the engine when the connection is gone. 'timed_out_'
+        //  is set if the peer stopped responding to heartbeats.
+        void engine_error (bool timed_out_ = false);
 
         //  i_pipe_events interface implementation.
         void read_activated (zmq::pipe_t *pipe_);
         void write_activated (zmq::pipe_t *pipe_);
         void hiccuped (zmq::pipe_t *pipe_);
+        void hwm_reached (zmq::pipe_t *pipe_);
         void pipe_terminated (zmq::pipe_t *pipe_);
 
         //  Delivers a message. Returns 0 if successful; -1 otherwise.
@@ -84,6 +88,15 @@ namespace zmq
         //  The function takes ownership of the message.
         int write_zap_msg (msg_t *msg_);
 
+        //  Looks up the result of an earlier ZAP authentication. Returns
+        //  true and fills in the metadata if it was successful and hasn't
+        //  expired yet. Always false unless ZMQ_ZAP_CACHE_TTL is set.
+        bool find_zap_result (const std::string &key_, std::string &metadata_);
+
+        //  Remembers a successful ZAP authentication.
+        void store_zap_result (const std::string &key_,
+            const std::string &metadata_);
+
         socket_base_t *get_socket ();
 
     protected:
@@ -97,7 +110,7 @@ namespace zmq
 
         void start_connecting (bool wait_);
 
-        void reconnect ();
+        void reconnect (bool drop_pipe_);
 
         //  Handlers for incoming commands.
         void process_plug ();
@@ -154,6 +167,14 @@ namespace zmq
         //  Protocol and address to use when connecting.
         const address_t *addr;
 
+        //  Rate limiting of the HWM and LWM monitor events. Time the last
+        //  one was sent (in milliseconds) and number of occurences since.
+        uint64_t last_hwm_event;
+        int hwm_events;
+        uint64_t last_lwm_event;
+        int lwm_events;
+        clock_t clock;
+
         session_base_t (const session_base_t&);
         const session_base_t &operator = (const session_base_t&);
     };
@@ -0,0 +1,124 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "sha256.hpp"
+#include "stdint.hpp"
+
+static const uint32_t k [64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr (uint32_t x_, int n_)
+{
+    return (x_ >> n_) | (x_ << (32 - n_));
+}
+
+//  Processes one 64-byte block.
+static void transform (uint32_t *state_, const unsigned char *block_)
+{
+    uint32_t w [64];
+    for (int i = 0; i != 16; i++)
+        w [i] = ((uint32_t) block_ [i * 4] << 24) |
+            ((uint32_t) block_ [i * 4 + 1] << 16) |
+            ((uint32_t) block_ [i * 4 + 2] << 8) |
+            ((uint32_t) block_ [i * 4 + 3]);
+    for (int i = 16; i != 64; i++) {
+        const uint32_t s0 =
+            rotr (w [i - 15], 7) ^ rotr (w [i - 15], 18) ^ (w [i - 15] >> 3);
+        const uint32_t s1 =
+            rotr (w [i - 2], 17) ^ rotr (w [i - 2], 19) ^ (w [i - 2] >> 10);
+        w [i] = w [i - 16] + s0 + w [i - 7] + s1;
+    }
+
+    uint32_t a = state_ [0], b = state_ [1], c = state_ [2],
+        d = state_ [3], e = state_ [4], f = state_ [5], g = state_ [6],
+        h = state_ [7];
+    for (int i = 0; i != 64; i++) {
+        const uint32_t t1 = h + (rotr (e, 6) ^ rotr (e, 11) ^ rotr (e, 25)) +
+            ((e & f) ^ (~e & g)) + k [i] + w [i];
+        const uint32_t t2 = (rotr (a, 2) ^ rotr (a, 13) ^ rotr (a, 22)) +
+            ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state_ [0] += a;
+    state_ [1] += b;
+    state_ [2] += c;
+    state_ [3] += d;
+    state_ [4] += e;
+    state_ [5] += f;
+    state_ [6] += g;
+    state_ [7] += h;
+}
+
+void zmq::sha256 (const void *data_, size_t size_, unsigned char *digest_)
+{
+    uint32_t state [8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    const unsigned char *data = (const unsigned char *) data_;
+    size_t left = size_;
+    for (; left >= 64; left -= 64, data += 64)
+        transform (state, data);
+
+    //  Pad the tail with a one bit, zeros and the length in bits.
+    unsigned char block [128];
+    memset (block, 0, sizeof block);
+    memcpy (block, data, left);
+    block [left] = 0x80;
+    const size_t tail = left < 56 ? 64 : 128;
+    const uint64_t bits = (uint64_t) size_ * 8;
+    for (int i = 0; i != 8; i++)
+        block [tail - 1 - i] = (unsigned char) (bits >> (i * 8));
+    transform (state, block);
+    if (tail == 128)
+        transform (state, block + 64);
+
+    for (int i = 0; i != 8; i++) {
+        digest_ [i * 4] = (unsigned char) (state [i] >> 24);
+        digest_ [i * 4 + 1] = (unsigned char) (state [i] >> 16);
+        digest_ [i * 4 + 2] = (unsigned char) (state [i] >> 8);
+        digest_ [i * 4 + 3] = (unsigned char) state [i];
+    }
+}
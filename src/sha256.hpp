@@ -0,0 +1,37 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_SHA256_HPP_INCLUDED__
+#define __ZMQ_SHA256_HPP_INCLUDED__
+
+#include <stddef.h>
+
+namespace zmq
+{
+
+    enum {sha256_digest_size = 32};
+
+    //  Computes the SHA-256 digest (FIPS 180-4) of the data. Used where
+    //  libsodium is not available.
+    void sha256 (const void *data_, size_t size_,
+        unsigned char *digest_);
+
+}
+
+#endif
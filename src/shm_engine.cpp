@@ -0,0 +1,869 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <new>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+
+#include "shm_engine.hpp"
+#include "io_thread.hpp"
+#include "session_base.hpp"
+#include "socket_base.hpp"
+#include "atomic_counter.hpp"
+#include "config.hpp"
+#include "likely.hpp"
+#include "wire.hpp"
+#include "ip.hpp"
+#include "err.hpp"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 1U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 2U
+#endif
+
+namespace zmq
+{
+
+    //  Control block of one direction of a connection. The fields written
+    //  by the writer and those written by the reader are kept on separate
+    //  cache lines. Positions grow freely, wrapping around at 2^32.
+    struct shm_ring_t
+    {
+        //  Position the next record is going to be written at, and whether
+        //  the reader is going to sleep until it moves.
+        volatile uint32_t head;
+        volatile uint32_t reader_waiting;
+        unsigned char head_pad [cache_line_size - 8];
+
+        //  Position up to which the reader is done with the records, and
+        //  whether the writer is waiting for it to move.
+        volatile uint32_t tail;
+        volatile uint32_t writer_waiting;
+        unsigned char tail_pad [cache_line_size - 8];
+    };
+
+    //  Header of a record in a ring, followed by the data, padded to the
+    //  size of the header. Messages that don't fit half of the ring are
+    //  split up into several records.
+    struct shm_record_t
+    {
+        //  Size of the whole message, and the part of it in this record.
+        uint64_t size;
+        uint32_t chunk;
+
+        //  Flags of the message.
+        unsigned char flags;
+
+        //  If set, the rest of the ring is to be skipped.
+        unsigned char wrap;
+
+        unsigned char reserved [2];
+    };
+
+    //  Mapping of the segment of a connection. It's kept by the engine and
+    //  by each message lent to the application.
+    struct shm_segment_t
+    {
+        void *base;
+        size_t size;
+        fd_t wake_fds [2];
+        atomic_counter_t refs;
+    };
+
+    //  A message lent to the application straight out of the ring. It's
+    //  kept by the engine and by the message.
+    struct shm_loan_t
+    {
+        shm_segment_t *segment;
+
+        //  Eventfd of the engine, written when the message is released.
+        fd_t wake_fd;
+
+        //  Position of the record in the ring.
+        uint32_t pos;
+
+        atomic_counter_t released;
+        atomic_counter_t refs;
+    };
+
+}
+
+static void release_segment (zmq::shm_segment_t *segment_)
+{
+    if (segment_->refs.sub (1))
+        return;
+    int rc = munmap (segment_->base, segment_->size);
+    errno_assert (rc == 0);
+    for (int i = 0; i != 2; i++) {
+        rc = close (segment_->wake_fds [i]);
+        errno_assert (rc == 0);
+    }
+    delete segment_;
+}
+
+static void release_loan (zmq::shm_loan_t *loan_)
+{
+    if (loan_->refs.sub (1))
+        return;
+    release_segment (loan_->segment);
+    delete loan_;
+}
+
+//  Space a record with 'chunk_' bytes of data takes in the ring.
+static uint32_t record_size (uint32_t chunk_)
+{
+    const uint32_t align = sizeof (zmq::shm_record_t);
+    return align + (chunk_ + align - 1) / align * align;
+}
+
+//  Mirrors mechanism_t::check_socket_type for the numeric socket types
+//  exchanged in the greeting.
+static bool compatible (int type_, int peer_type_)
+{
+    switch (type_) {
+        case ZMQ_REQ:
+            return peer_type_ == ZMQ_REP || peer_type_ == ZMQ_ROUTER;
+        case ZMQ_REP:
+            return peer_type_ == ZMQ_REQ || peer_type_ == ZMQ_DEALER;
+        case ZMQ_DEALER:
+            return peer_type_ == ZMQ_REP || peer_type_ == ZMQ_DEALER
+                || peer_type_ == ZMQ_ROUTER;
+        case ZMQ_ROUTER:
+            return peer_type_ == ZMQ_REQ || peer_type_ == ZMQ_DEALER
+                || peer_type_ == ZMQ_ROUTER;
+        case ZMQ_PUSH:
+            return peer_type_ == ZMQ_PULL;
+        case ZMQ_PULL:
+            return peer_type_ == ZMQ_PUSH;
+        case ZMQ_PUB:
+        case ZMQ_XPUB:
+            return peer_type_ == ZMQ_SUB || peer_type_ == ZMQ_XSUB;
+        case ZMQ_SUB:
+        case ZMQ_XSUB:
+            return peer_type_ == ZMQ_PUB || peer_type_ == ZMQ_XPUB;
+        case ZMQ_PAIR:
+            return peer_type_ == ZMQ_PAIR;
+        default:
+            break;
+    }
+    return false;
+}
+
+zmq::shm_engine_t::shm_engine_t (fd_t fd_, const options_t &options_,
+      const std::string &endpoint_, bool connecter_) :
+    s (fd_),
+    connecter (connecter_),
+    plugged (false),
+    handshaking (true),
+    greeting_bytes_read (0),
+    peer_type (-1),
+    peer_identity_size (0),
+    segment (NULL),
+    ring_size (0),
+    wake_fd (retired_fd),
+    peer_wake_fd (retired_fd),
+    tx (NULL),
+    tx_data (NULL),
+    tx_offset (0),
+    tx_pending (false),
+    tx_blocked (false),
+    rx (NULL),
+    rx_data (NULL),
+    rx_pos (0),
+    rx_offset (0),
+    rx_pending (false),
+    peer_closed (false),
+    input_stopped (false),
+    output_stopped (true),
+    session (NULL),
+    options (options_),
+    endpoint (endpoint_),
+    socket (NULL)
+{
+    int rc = tx_msg.init ();
+    errno_assert (rc == 0);
+    rc = rx_msg.init ();
+    errno_assert (rc == 0);
+    for (int i = 0; i != 3; i++)
+        segment_fds [i] = retired_fd;
+
+    //  Put the socket into non-blocking mode.
+    unblock_socket (s);
+}
+
+zmq::shm_engine_t::~shm_engine_t ()
+{
+    zmq_assert (!plugged);
+
+    int rc = close (s);
+    errno_assert (rc == 0);
+
+    for (int i = 0; i != 3; i++)
+        if (segment_fds [i] != retired_fd)
+            close (segment_fds [i]);
+
+    //  Messages lent to the application stay valid after the engine is
+    //  gone; so does the segment they live in.
+    for (loans_t::iterator it = loans.begin (); it != loans.end (); ++it)
+        release_loan (*it);
+    if (segment)
+        release_segment (segment);
+
+    rc = tx_msg.close ();
+    errno_assert (rc == 0);
+    rc = rx_msg.close ();
+    errno_assert (rc == 0);
+}
+
+void zmq::shm_engine_t::plug (io_thread_t *io_thread_,
+    session_base_t *session_)
+{
+    zmq_assert (!plugged);
+    plugged = true;
+
+    //  Connect to session object.
+    zmq_assert (!session);
+    zmq_assert (session_);
+    session = session_;
+    socket = session->get_socket ();
+
+    //  Connect to I/O threads poller object.
+    io_object_t::plug (io_thread_);
+    handle = add_fd (s);
+    set_pollin (handle);
+
+    //  The connecting side opens the handshake.
+    if (connecter && create_segment () != 0)
+        error ();
+}
+
+void zmq::shm_engine_t::unplug ()
+{
+    zmq_assert (plugged);
+    plugged = false;
+
+    //  Cancel all fd subscriptions.
+    if (!peer_closed)
+        rm_fd (handle);
+    if (!handshaking)
+        rm_fd (wake_handle);
+
+    //  Disconnect from I/O threads poller object.
+    io_object_t::unplug ();
+
+    session = NULL;
+}
+
+void zmq::shm_engine_t::terminate ()
+{
+    //  Whatever was written to the ring is left for the peer to read.
+    unplug ();
+    delete this;
+}
+
+void zmq::shm_engine_t::in_event ()
+{
+    if (unlikely (handshaking)) {
+        int rc = receive_greeting ();
+        if (rc != 0) {
+            if (errno != EAGAIN)
+                error ();
+            return;
+        }
+        if (!connecter) {
+            rc = map_segment (segment_fds);
+            if (rc == 0)
+                rc = send_greeting (NULL);
+        }
+        if (rc == 0)
+            rc = handshake ();
+        if (rc != 0)
+            error ();
+        return;
+    }
+
+    //  If it wasn't the eventfd that woke us up, it was the socket, which
+    //  the peer only ever closes.
+    uint64_t count;
+    ssize_t nbytes = read (wake_fd, &count, sizeof count);
+    if (nbytes == -1 && !peer_closed) {
+        errno_assert (errno == EAGAIN);
+        unsigned char byte;
+        nbytes = recv (s, &byte, 1, 0);
+        if (nbytes == 1) {
+            error ();
+            return;
+        }
+        if (nbytes == 0
+        ||  (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            rm_fd (handle);
+            peer_closed = true;
+        }
+    }
+
+    if (consume () != 0) {
+        error ();
+        return;
+    }
+    if (tx_blocked)
+        produce ();
+}
+
+void zmq::shm_engine_t::restart_input ()
+{
+    zmq_assert (input_stopped);
+    input_stopped = false;
+    if (consume () != 0)
+        error ();
+}
+
+void zmq::shm_engine_t::restart_output ()
+{
+    output_stopped = false;
+
+    //  Until the handshake is done, or while the ring is full, messages
+    //  are left in the pipe.
+    if (!handshaking && !tx_blocked)
+        produce ();
+}
+
+void zmq::shm_engine_t::zap_msg_available ()
+{
+    //  The shm transport doesn't authenticate the peers.
+    zmq_assert (false);
+}
+
+void zmq::shm_engine_t::error ()
+{
+    zmq_assert (session);
+    socket->event_disconnected (endpoint, s);
+    session->flush ();
+    session->engine_error ();
+    unplug ();
+    delete this;
+}
+
+int zmq::shm_engine_t::create_segment ()
+{
+    fd_t fds [3] = {retired_fd, retired_fd, retired_fd};
+    ring_size = shm_ring_size;
+    const size_t size = 2 * sizeof (shm_ring_t) + 2 * (size_t) ring_size;
+
+    int rc = -1;
+    fds [0] = syscall (SYS_memfd_create, "zmq-shm",
+        MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fds [0] != retired_fd)
+        rc = ftruncate (fds [0], size);
+#ifdef F_ADD_SEALS
+    //  Both sides map the segment; make sure neither can pull it away.
+    if (rc == 0)
+        rc = fcntl (fds [0], F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+#endif
+    for (int i = 1; rc == 0 && i != 3; i++) {
+        fds [i] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fds [i] == retired_fd)
+            rc = -1;
+    }
+    if (rc == 0)
+        rc = send_greeting (fds);
+    if (rc != 0) {
+        int err = errno;
+        for (int i = 0; i != 3; i++)
+            if (fds [i] != retired_fd)
+                close (fds [i]);
+        errno = err;
+        return -1;
+    }
+    return map_segment (fds);
+}
+
+int zmq::shm_engine_t::map_segment (const fd_t *fds_)
+{
+    //  The descriptors are ours to close from now on, whatever happens.
+    fd_t fds [3];
+    memcpy (fds, fds_, sizeof fds);
+    for (int i = 0; i != 3; i++)
+        segment_fds [i] = retired_fd;
+
+    //  The segment has to be what the greeting announced.
+    const size_t size = 2 * sizeof (shm_ring_t) + 2 * (size_t) ring_size;
+    struct stat info;
+    int rc = fstat (fds [0], &info);
+    if (rc == 0 && (ring_size < 4096 || (ring_size & (ring_size - 1)) != 0
+                ||  ring_size > 0x40000000 || (size_t) info.st_size != size)) {
+        errno = EPROTO;
+        rc = -1;
+    }
+#ifdef F_GET_SEALS
+    //  Nor may it shrink under us, lest accessing the mapping fault.
+    const int seals = F_SEAL_SHRINK | F_SEAL_GROW;
+    if (rc == 0 && (fcntl (fds [0], F_GET_SEALS) & seals) != seals) {
+        errno = EPROTO;
+        rc = -1;
+    }
+#endif
+    void *base = MAP_FAILED;
+    if (rc == 0)
+        base = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fds [0], 0);
+
+    //  Once mapped, the eventfds are all that's left to keep.
+    close (fds [0]);
+    if (base == MAP_FAILED) {
+        int err = errno;
+        close (fds [1]);
+        close (fds [2]);
+        errno = err;
+        return -1;
+    }
+
+    segment = new (std::nothrow) shm_segment_t;
+    alloc_assert (segment);
+    segment->base = base;
+    segment->size = size;
+    segment->wake_fds [0] = fds [1];
+    segment->wake_fds [1] = fds [2];
+    segment->refs.set (1);
+
+    //  The first ring goes from the connecting side to the listening one,
+    //  the second one the other way round. Likewise, the first eventfd
+    //  wakes up the connecting side.
+    shm_ring_t *rings = (shm_ring_t*) base;
+    unsigned char *data = (unsigned char*) (rings + 2);
+    const int self = connecter ? 0 : 1;
+    tx = &rings [self];
+    tx_data = data + self * ring_size;
+    rx = &rings [1 - self];
+    rx_data = data + (1 - self) * ring_size;
+    wake_fd = segment->wake_fds [self];
+    peer_wake_fd = segment->wake_fds [1 - self];
+    return 0;
+}
+
+int zmq::shm_engine_t::send_greeting (const fd_t *fds_)
+{
+    unsigned char buffer [sizeof greeting];
+    memset (buffer, 0, sizeof buffer);
+    memcpy (buffer, "ZSHM", 4);
+    buffer [4] = 1;
+    buffer [5] = (unsigned char) options.type;
+    buffer [6] = options.identity_size;
+    put_uint32 (buffer + 8, ring_size);
+    memcpy (buffer + 12, options.identity, options.identity_size);
+
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = sizeof buffer;
+    struct msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char control [CMSG_SPACE (3 * sizeof (fd_t))];
+    if (fds_) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN (3 * sizeof (fd_t));
+        memcpy (CMSG_DATA (cmsg), fds_, 3 * sizeof (fd_t));
+    }
+
+    //  This is the first thing sent over the connection, so the socket
+    //  buffer takes it whole.
+    ssize_t nbytes = sendmsg (s, &msg, MSG_NOSIGNAL);
+    if (nbytes != (ssize_t) sizeof buffer) {
+        if (nbytes != -1)
+            errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+int zmq::shm_engine_t::receive_greeting ()
+{
+    while (greeting_bytes_read < sizeof greeting) {
+        struct iovec iov;
+        iov.iov_base = greeting + greeting_bytes_read;
+        iov.iov_len = sizeof greeting - greeting_bytes_read;
+        struct msghdr msg;
+        memset (&msg, 0, sizeof msg);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        char control [CMSG_SPACE (3 * sizeof (fd_t))];
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+
+        ssize_t nbytes = recvmsg (s, &msg, MSG_CMSG_CLOEXEC);
+        if (nbytes == -1) {
+            if (errno == EWOULDBLOCK || errno == EINTR)
+                errno = EAGAIN;
+            return -1;
+        }
+        if (nbytes == 0) {
+            errno = ECONNRESET;
+            return -1;
+        }
+        greeting_bytes_read += nbytes;
+
+        //  Take over the descriptors of the segment. Only the listening
+        //  side gets any, and only once.
+        bool unexpected = (msg.msg_flags & MSG_CTRUNC) != 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg); cmsg;
+              cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET
+            ||  cmsg->cmsg_type != SCM_RIGHTS)
+                continue;
+            const size_t count =
+                (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (fd_t);
+            fd_t fds [3];
+            memcpy (fds, CMSG_DATA (cmsg), count * sizeof (fd_t));
+            if (connecter || count != 3 || segment_fds [0] != retired_fd) {
+                for (size_t i = 0; i != count; i++)
+                    close (fds [i]);
+                unexpected = true;
+            }
+            else
+                memcpy (segment_fds, fds, sizeof fds);
+        }
+        if (unexpected) {
+            errno = EPROTO;
+            return -1;
+        }
+    }
+
+    if (!connecter && segment_fds [0] == retired_fd) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (!connecter)
+        ring_size = get_uint32 (greeting + 8);
+    return 0;
+}
+
+int zmq::shm_engine_t::handshake ()
+{
+    if (memcmp (greeting, "ZSHM", 4) != 0 || greeting [4] != 1) {
+        errno = EPROTO;
+        return -1;
+    }
+    peer_type = greeting [5];
+    if (!compatible (options.type, peer_type)) {
+        errno = EPROTO;
+        return -1;
+    }
+    peer_identity_size = greeting [6];
+    memcpy (peer_identity, greeting + 12, peer_identity_size);
+
+    if (options.recv_identity) {
+        msg_t identity;
+        int rc = identity.init_size (peer_identity_size);
+        errno_assert (rc == 0);
+        memcpy (identity.data (), peer_identity, peer_identity_size);
+        identity.set_flags (msg_t::identity);
+        rc = session->push_msg (&identity);
+        if (rc != 0) {
+            //  The pipe is being shut down.
+            errno_assert (errno == EAGAIN);
+            identity.close ();
+        }
+        session->flush ();
+    }
+
+    handshaking = false;
+    wake_handle = add_fd (wake_fd);
+    set_pollin (wake_handle);
+
+    if (consume () != 0) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    produce ();
+    return 0;
+}
+
+int zmq::shm_engine_t::consume ()
+{
+    rx->reader_waiting = 0;
+
+    while (!input_stopped) {
+        if (rx_pending) {
+            int rc = session->push_msg (&rx_msg);
+            if (rc != 0) {
+                errno_assert (errno == EAGAIN);
+                input_stopped = true;
+                break;
+            }
+            rx_pending = false;
+        }
+
+        if (rx_pos == rx->head) {
+            if (peer_closed)
+                break;
+
+            //  Tell the writer we're going to sleep, unless something was
+            //  written in the meantime.
+            rx->reader_waiting = 1;
+            __sync_synchronize ();
+            if (rx_pos == rx->head)
+                break;
+            rx->reader_waiting = 0;
+        }
+
+        //  Don't read the record before the head that covers it.
+        const uint32_t filled = rx->head - rx_pos;
+        __sync_synchronize ();
+
+        //  The peer can write to the ring at any time, so the header is
+        //  read once and checked before anything is done with it.
+        const uint32_t index = rx_pos & (ring_size - 1);
+        shm_record_t record;
+        memcpy (&record, rx_data + index, sizeof record);
+        if (unlikely (filled > ring_size)) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (record.wrap) {
+            if (unlikely (ring_size - index > filled)) {
+                errno = EPROTO;
+                return -1;
+            }
+            rx_pos += ring_size - index;
+            continue;
+        }
+        const uint64_t size = record.size;
+        const uint32_t chunk = record.chunk;
+        const unsigned char flags = record.flags;
+        unsigned char *data = rx_data + index + sizeof record;
+
+        //  A record has to lie between our position and the head, and
+        //  the chunks of a message have to add up to its size.
+        const bool valid =
+            chunk <= ring_size / 2 - sizeof record &&
+            record_size (chunk) <= filled &&
+            record_size (chunk) <= ring_size - index &&
+            rx_offset + chunk <= size &&
+            (rx_offset == 0 || size == rx_msg.size ()) &&
+            (options.maxmsgsize < 0 || size <= (uint64_t) options.maxmsgsize);
+        if (unlikely (!valid)) {
+            errno = EPROTO;
+            return -1;
+        }
+
+        if (size == chunk && chunk >= shm_borrow_threshold) {
+
+            //  Large messages are lent to the application. Their space is
+            //  only reused once it's done with them.
+            shm_loan_t *loan = new (std::nothrow) shm_loan_t;
+            alloc_assert (loan);
+            loan->segment = segment;
+            loan->wake_fd = wake_fd;
+            loan->pos = rx_pos;
+            loan->released.set (0);
+            loan->refs.set (2);
+            segment->refs.add (1);
+            loans.push_back (loan);
+
+            int rc = rx_msg.close ();
+            errno_assert (rc == 0);
+            rc = rx_msg.init_data (data, chunk, return_loan, loan);
+            errno_assert (rc == 0);
+            rx_offset = chunk;
+        }
+        else {
+            if (rx_offset == 0) {
+                int rc = rx_msg.close ();
+                errno_assert (rc == 0);
+                rc = size <= (uint64_t) SIZE_MAX ?
+                    rx_msg.init_size ((size_t) size) : -1;
+                if (unlikely (rc != 0)) {
+                    rc = rx_msg.init ();
+                    errno_assert (rc == 0);
+                    errno = ENOMEM;
+                    return -1;
+                }
+            }
+            memcpy ((unsigned char*) rx_msg.data () + rx_offset, data, chunk);
+            rx_offset += chunk;
+        }
+        rx_pos += record_size (chunk);
+
+        if (rx_offset < size)
+            continue;
+        rx_offset = 0;
+        rx_msg.set_flags (flags & msg_t::more);
+        rx_pending = true;
+    }
+
+    session->flush ();
+    release_space ();
+
+    //  Once the peer is gone, the engine goes as soon as everything it
+    //  sent has been delivered.
+    if (peer_closed && !rx_pending && rx_pos == rx->head) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    return 0;
+}
+
+void zmq::shm_engine_t::produce ()
+{
+    bool written = false;
+
+    while (true) {
+        if (!tx_pending) {
+            int rc = session->pull_msg (&tx_msg);
+            if (rc != 0) {
+                errno_assert (errno == EAGAIN);
+                output_stopped = true;
+                break;
+            }
+            tx_pending = true;
+            tx_offset = 0;
+        }
+
+        if (!write_record ()) {
+
+            //  Ask the reader to wake us up once it frees some space,
+            //  unless it just did.
+            tx->writer_waiting = 1;
+            __sync_synchronize ();
+            if (!write_record ()) {
+                tx_blocked = true;
+                break;
+            }
+            tx->writer_waiting = 0;
+        }
+        tx_blocked = false;
+        written = true;
+
+        if (tx_offset == tx_msg.size ()) {
+            tx_pending = false;
+            int rc = tx_msg.close ();
+            errno_assert (rc == 0);
+            rc = tx_msg.init ();
+            errno_assert (rc == 0);
+        }
+    }
+
+    if (written) {
+        __sync_synchronize ();
+        if (tx->reader_waiting) {
+            tx->reader_waiting = 0;
+            wake_peer ();
+        }
+    }
+}
+
+bool zmq::shm_engine_t::write_record ()
+{
+    const size_t remaining = tx_msg.size () - tx_offset;
+    const size_t max_chunk = ring_size / 2 - sizeof (shm_record_t);
+    const uint32_t chunk =
+        (uint32_t) (remaining < max_chunk ? remaining : max_chunk);
+    const uint32_t needed = record_size (chunk);
+
+    //  Records don't wrap around the end of the ring; if this one doesn't
+    //  fit before the end, the rest of the ring is skipped.
+    const uint32_t head = tx->head;
+    const uint32_t available = ring_size - (head - tx->tail);
+    uint32_t index = head & (ring_size - 1);
+    const uint32_t skipped = ring_size - index < needed ? ring_size - index : 0;
+    if (skipped + needed > available)
+        return false;
+
+    //  Don't overwrite the space before the reader is done with it.
+    __sync_synchronize ();
+
+    if (skipped) {
+        ((shm_record_t*) (tx_data + index))->wrap = 1;
+        index = 0;
+    }
+    shm_record_t *record = (shm_record_t*) (tx_data + index);
+    record->size = tx_msg.size ();
+    record->chunk = chunk;
+    record->flags = tx_msg.flags () & msg_t::more;
+    record->wrap = 0;
+    memcpy (record + 1, (unsigned char*) tx_msg.data () + tx_offset, chunk);
+    tx_offset += chunk;
+
+    //  Publish the record.
+    __sync_synchronize ();
+    tx->head = head + skipped + needed;
+    return true;
+}
+
+void zmq::shm_engine_t::release_space ()
+{
+    while (!loans.empty () && loans.front ()->released.get ()) {
+        release_loan (loans.front ());
+        loans.pop_front ();
+    }
+    const uint32_t tail = loans.empty () ? rx_pos : loans.front ()->pos;
+    if (tail == rx->tail)
+        return;
+
+    //  Finish reading the records before handing their space over.
+    __sync_synchronize ();
+    rx->tail = tail;
+    __sync_synchronize ();
+    if (rx->writer_waiting) {
+        rx->writer_waiting = 0;
+        wake_peer ();
+    }
+}
+
+void zmq::shm_engine_t::wake_peer ()
+{
+    const uint64_t inc = 1;
+    ssize_t nbytes = write (peer_wake_fd, &inc, sizeof inc);
+    errno_assert (nbytes == sizeof inc);
+}
+
+void zmq::shm_engine_t::return_loan (void *, void *hint_)
+{
+    shm_loan_t *loan = (shm_loan_t*) hint_;
+    loan->released.add (1);
+
+    //  Wake the engine up, if it's still there, to let the writer have the
+    //  space.
+    const uint64_t inc = 1;
+    ssize_t nbytes = write (loan->wake_fd, &inc, sizeof inc);
+    errno_assert (nbytes == sizeof inc);
+
+    release_loan (loan);
+}
+
+#endif
@@ -0,0 +1,211 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_SHM_ENGINE_HPP_INCLUDED__
+#define __ZMQ_SHM_ENGINE_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <deque>
+#include <string>
+
+#include "fd.hpp"
+#include "i_engine.hpp"
+#include "io_object.hpp"
+#include "msg.hpp"
+#include "options.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class io_thread_t;
+    class session_base_t;
+    class socket_base_t;
+    struct shm_ring_t;
+    struct shm_segment_t;
+    struct shm_loan_t;
+
+    //  Engine of the shm transport. The peers meet over a UNIX domain
+    //  socket. The connecting side creates a shared memory segment holding
+    //  a ring for each direction, and passes it over the socket together
+    //  with an eventfd for each side. From then on messages only go through
+    //  the rings; a side writes the other's eventfd only when the other has
+    //  announced it's going to sleep. The socket is merely watched for the
+    //  peer going away.
+
+    class shm_engine_t : public io_object_t, public i_engine
+    {
+    public:
+
+        shm_engine_t (fd_t fd_, const options_t &options_,
+            const std::string &endpoint_, bool connecter_);
+        ~shm_engine_t ();
+
+        //  i_engine interface implementation.
+        void plug (zmq::io_thread_t *io_thread_,
+           zmq::session_base_t *session_);
+        void terminate ();
+        void restart_input ();
+        void restart_output ();
+        void zap_msg_available ();
+
+        //  i_poll_events interface implementation.
+        void in_event ();
+
+    private:
+
+        //  Unplug the engine from the session.
+        void unplug ();
+
+        //  Function to handle network disconnections.
+        void error ();
+
+        //  Creates the segment and sends the greeting along with it.
+        //  Used by the connecting side.
+        int create_segment ();
+
+        //  Maps the segment received with the peer's greeting.
+        int map_segment (const fd_t *fds_);
+
+        //  Sends the greeting, passing the segment if fds_ isn't NULL.
+        int send_greeting (const fd_t *fds_);
+
+        //  Reads as much of the peer's greeting as is available. Returns 0
+        //  once it's complete, -1 with EAGAIN if more is to come.
+        int receive_greeting ();
+
+        //  Checks the peer's greeting and starts moving messages.
+        int handshake ();
+
+        //  Moves messages from the peer's ring to the session until either
+        //  is exhausted. Returns -1 once the peer is gone and everything it
+        //  sent has been delivered.
+        int consume ();
+
+        //  Moves messages from the session to the ring until either is
+        //  exhausted.
+        void produce ();
+
+        //  Writes (the next part of) tx_msg to the ring. Returns false if
+        //  there's no room for it.
+        bool write_record ();
+
+        //  Lets the writer have the space of the messages that have been
+        //  consumed and the lent ones that have been released.
+        void release_space ();
+
+        //  Wakes the peer up.
+        void wake_peer ();
+
+        //  Called when the application releases a message lent out of
+        //  the ring.
+        static void return_loan (void *data_, void *hint_);
+
+        //  Underlying UNIX domain socket.
+        fd_t s;
+
+        //  True iff this is the connecting side.
+        bool connecter;
+
+        handle_t handle;
+        handle_t wake_handle;
+
+        bool plugged;
+        bool handshaking;
+
+        //  The peer's greeting as received so far.
+        unsigned char greeting [267];
+        size_t greeting_bytes_read;
+
+        //  Socket type and identity of the peer.
+        int peer_type;
+        unsigned char peer_identity_size;
+        unsigned char peer_identity [255];
+
+        //  Descriptors of the segment and of the eventfds, as received
+        //  with the greeting.
+        fd_t segment_fds [3];
+
+        shm_segment_t *segment;
+        uint32_t ring_size;
+        fd_t wake_fd;
+        fd_t peer_wake_fd;
+
+        //  The ring we write to and its data.
+        shm_ring_t *tx;
+        unsigned char *tx_data;
+
+        //  The part of tx_msg already written to the ring, and whether
+        //  there's a message being written at all.
+        msg_t tx_msg;
+        size_t tx_offset;
+        bool tx_pending;
+
+        //  True if the ring was full the last time we tried to write to it.
+        bool tx_blocked;
+
+        //  The ring we read from, its data and our position in it.
+        shm_ring_t *rx;
+        unsigned char *rx_data;
+        uint32_t rx_pos;
+
+        //  Message being assembled from the ring, the part of it received
+        //  so far, and whether it's complete but the session didn't take it.
+        msg_t rx_msg;
+        size_t rx_offset;
+        bool rx_pending;
+
+        //  Messages lent to the application, oldest first. Their space in
+        //  the ring isn't reused until they are released.
+        typedef std::deque <shm_loan_t*> loans_t;
+        loans_t loans;
+
+        //  True once the peer has closed its end of the socket. Remaining
+        //  messages are still delivered.
+        bool peer_closed;
+
+        //  True if the session can't take more messages for now.
+        bool input_stopped;
+
+        //  True if there were no messages to send the last time we looked.
+        bool output_stopped;
+
+        //  The session this engine is attached to.
+        zmq::session_base_t *session;
+
+        options_t options;
+
+        // String representation of endpoint
+        std::string endpoint;
+
+        zmq::socket_base_t *socket;
+
+        shm_engine_t (const shm_engine_t&);
+        const shm_engine_t &operator = (const shm_engine_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -19,7 +19,9 @@
 
 #include <new>
 #include <string>
+#include <sstream>
 #include <algorithm>
+#include <vector>
 
 #include "platform.hpp"
 
@@ -47,13 +49,17 @@
 #include "pipe.hpp"
 #include "err.hpp"
 #include "ctx.hpp"
+#include "curve_keypool.hpp"
 #include "platform.hpp"
 #include "likely.hpp"
 #include "msg.hpp"
+#include "latency.hpp"
 #include "address.hpp"
 #include "ipc_address.hpp"
 #include "tcp_address.hpp"
+#include "tcp_resolver.hpp"
 #include "tipc_address.hpp"
+#include "udp_address.hpp"
 #ifdef ZMQ_HAVE_OPENPGM
 #include "pgm_socket.hpp"
 #endif
@@ -71,6 +77,12 @@
 #include "xsub.hpp"
 #include "stream.hpp"
 
+struct zmq::socket_base_t::latency_totals_t
+{
+    histogram_t in;
+    histogram_t out;
+};
+
 bool zmq::socket_base_t::check_tag ()
 {
     return tag == 0xbaddecaf;
@@ -137,7 +149,19 @@ zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_) :
     ticks (0),
     rcvmore (false),
     monitor_socket (NULL),
-    monitor_events (0)
+    monitor_events (0),
+    msgs_sent (0),
+    bytes_sent (0),
+    msgs_received (0),
+    bytes_received (0),
+    hwm_block_time (0),
+    last_hwm_event (0),
+    hwm_events (0),
+    last_lwm_event (0),
+    lwm_events (0),
+    last_sample (0),
+    sampled_msgs (0),
+    sampled_dropped (0)
 {
     options.socket_id = sid_;
     options.ipv6 = (parent_->get (ZMQ_IPV6) != 0);
@@ -147,6 +171,10 @@ zmq::socket_base_t::~socket_base_t ()
 {
     stop_monitor ();
     zmq_assert (destroyed);
+
+    for (latencies_t::iterator it = latencies.begin ();
+          it != latencies.end (); ++it)
+        delete it->second;
 }
 
 zmq::mailbox_t *zmq::socket_base_t::get_mailbox ()
@@ -188,7 +216,8 @@ int zmq::socket_base_t::check_protocol (const std::string &protocol_)
 {
     //  First check out whether the protcol is something we are aware of.
     if (protocol_ != "inproc" && protocol_ != "ipc" && protocol_ != "tcp" &&
-          protocol_ != "pgm" && protocol_ != "epgm" && protocol_ != "tipc") {
+          protocol_ != "pgm" && protocol_ != "epgm" && protocol_ != "tipc" &&
+          protocol_ != "shm" && protocol_ != "udp") {
         errno = EPROTONOSUPPORT;
         return -1;
     }
@@ -219,10 +248,26 @@ int zmq::socket_base_t::check_protocol (const std::string &protocol_)
     }
 #endif
 
+    //  UDP transport is not available on Windows and OpenVMS.
+#if defined ZMQ_HAVE_WINDOWS || defined ZMQ_HAVE_OPENVMS
+    if (protocol_ == "udp") {
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+#endif
+
+    //  Shared memory transport relies on memfd and eventfd (Linux only).
+#if !defined ZMQ_HAVE_SHM
+    if (protocol_ == "shm") {
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+#endif
+
     //  Check whether socket type and transport protocol match.
     //  Specifically, multicast protocols can't be combined with
     //  bi-directional messaging patterns (socket types).
-    if ((protocol_ == "pgm" || protocol_ == "epgm") &&
+    if ((protocol_ == "pgm" || protocol_ == "epgm" || protocol_ == "udp") &&
           options.type != ZMQ_PUB && options.type != ZMQ_SUB &&
           options.type != ZMQ_XPUB && options.type != ZMQ_XSUB) {
         errno = ENOCOMPATPROTO;
@@ -265,7 +310,15 @@ int zmq::socket_base_t::setsockopt (int option_, const void *optval_,
 
     //  If the socket type doesn't support the option, pass it to
     //  the generic option parser.
-    return options.setsockopt (option_, optval_, optvallen_);
+    rc = options.setsockopt (option_, optval_, optvallen_);
+
+#ifdef HAVE_LIBSODIUM
+    //  Have short-term keys ready by the time the first clients connect.
+    if (rc == 0 && option_ == ZMQ_CURVE_SERVER && options.as_server)
+        get_ctx ()->get_curve_keypool ()->start ();
+#endif
+
+    return rc;
 }
 
 int zmq::socket_base_t::getsockopt (int option_, void *optval_,
@@ -324,6 +377,79 @@ int zmq::socket_base_t::getsockopt (int option_, void *optval_,
         return 0;
     }
 
+    if ((option_ >= ZMQ_STAT_MSGS_SENT && option_ <= ZMQ_STAT_RECONNECTS) ||
+          option_ == ZMQ_STAT_ZAP_CACHE_HITS ||
+          option_ == ZMQ_STAT_ZAP_CACHE_MISSES) {
+        if (*optvallen_ < sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        uint64_t value = 0;
+        switch (option_) {
+            case ZMQ_STAT_MSGS_SENT:
+                value = msgs_sent;
+                break;
+            case ZMQ_STAT_BYTES_SENT:
+                value = bytes_sent;
+                break;
+            case ZMQ_STAT_MSGS_RECEIVED:
+                value = msgs_received;
+                break;
+            case ZMQ_STAT_BYTES_RECEIVED:
+                value = bytes_received;
+                break;
+            case ZMQ_STAT_MSGS_DROPPED:
+                value = xmsgs_dropped ();
+                break;
+            case ZMQ_STAT_QUEUE_DEPTH: {
+
+                //  Get the latest progress of the peers first.
+                int rc = process_commands (0, false);
+                if (rc != 0 && (errno == EINTR || errno == ETERM))
+                    return -1;
+                errno_assert (rc == 0);
+                for (pipes_t::size_type i = 0; i != pipes.size (); ++i)
+                    value += pipes [i]->get_queue_depth ();
+                break;
+            }
+            case ZMQ_STAT_HWM_BLOCK_TIME:
+                value = hwm_block_time;
+                break;
+            case ZMQ_STAT_RECONNECTS:
+                value = reconnects.get ();
+                break;
+            case ZMQ_STAT_ZAP_CACHE_HITS:
+                value = zap_cache_hits.get ();
+                break;
+            case ZMQ_STAT_ZAP_CACHE_MISSES:
+                value = zap_cache_misses.get ();
+                break;
+        }
+        *((uint64_t*) optval_) = value;
+        *optvallen_ = sizeof (uint64_t);
+        return 0;
+    }
+
+    if (option_ == ZMQ_STAT_LATENCY) {
+
+        //  Make sure the newly attached pipes are accounted for.
+        int rc = process_commands (0, false);
+        if (rc != 0 && (errno == EINTR || errno == ETERM))
+            return -1;
+        errno_assert (rc == 0);
+
+        std::string report;
+        latency_report (report);
+        if (*optvallen_ < report.size () + 1) {
+            *optvallen_ = report.size () + 1;
+            errno = EINVAL;
+            return -1;
+        }
+        memcpy (optval_, report.c_str (), report.size () + 1);
+        *optvallen_ = report.size () + 1;
+        return 0;
+    }
+
     return options.getsockopt (option_, optval_, optvallen_);
 }
 
@@ -360,9 +486,9 @@ int zmq::socket_base_t::bind (const char *addr_)
         return rc;
     }
 
-    if (protocol == "pgm" || protocol == "epgm") {
+    if (protocol == "pgm" || protocol == "epgm" || protocol == "udp") {
         //  For convenience's sake, bind can be used interchageable with
-        //  connect for PGM and EPGM transports.
+        //  connect for PGM, EPGM and UDP transports.
         return connect (addr_);
     }
 
@@ -393,9 +519,9 @@ int zmq::socket_base_t::bind (const char *addr_)
     }
 
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
-    if (protocol == "ipc") {
+    if (protocol == "ipc" || protocol == "shm") {
         ipc_listener_t *listener = new (std::nothrow) ipc_listener_t (
-            io_thread, this, options);
+            io_thread, this, options, protocol == "shm");
         alloc_assert (listener);
         int rc = listener->set_address (address.c_str ());
         if (rc != 0) {
@@ -435,6 +561,30 @@ int zmq::socket_base_t::bind (const char *addr_)
     return -1;
 }
 
+int zmq::socket_base_t::bind_shared (const char *addr_, int strategy_)
+{
+    if (strategy_ != ZMQ_PROXY_SHARD_ROUND_ROBIN
+    &&  strategy_ != ZMQ_PROXY_SHARD_HASH) {
+        errno = EINVAL;
+        return -1;
+    }
+    std::string protocol;
+    std::string address;
+    int rc = parse_uri (addr_, protocol, address);
+    if (rc != 0)
+        return -1;
+    if (protocol != "inproc" && protocol != "tcp") {
+        errno = EPROTONOSUPPORT;
+        return -1;
+    }
+
+    //  The endpoint and the listener take a copy of the options.
+    options.shard_strategy = strategy_;
+    rc = bind (addr_);
+    options.shard_strategy = 0;
+    return rc;
+}
+
 int zmq::socket_base_t::connect (const char *addr_)
 {
     if (unlikely (ctx_terminated)) {
@@ -465,7 +615,7 @@ int zmq::socket_base_t::connect (const char *addr_)
         //  is in place we should follow generic pipe creation algorithm.
 
         //  Find the peer endpoint.
-        endpoint_t peer = find_endpoint (addr_);
+        endpoint_t peer = find_endpoint (addr_, options);
 
         // The total HWM for an inproc connection should be the sum of
         // the binder's HWM and the connector's HWM.
@@ -496,6 +646,20 @@ int zmq::socket_base_t::connect (const char *addr_)
         int rc = pipepair (parents, new_pipes, hwms, conflates);
         errno_assert (rc == 0);
 
+        //  If required, spill the messages exceeding the HWM to the disk.
+        //  The peer's spill can be set up only if it's already bound.
+        if (!options.spill_path.empty () && !conflate)
+            new_pipes [0]->set_spill (options.spill_path,
+                options.spill_maxsize);
+        if (peer.socket && !peer.options.spill_path.empty () && !conflate)
+            new_pipes [1]->set_spill (peer.options.spill_path,
+                peer.options.spill_maxsize);
+
+        //  The latency is measured if either of the peers asks for it.
+        if (options.latency_tracking ||
+              (peer.socket && peer.options.latency_tracking))
+            new_pipes [0]->set_latency_tracking (addr_);
+
         //  Attach local end of the pipe to this socket object.
         attach_pipe (new_pipes [0]);
 
@@ -547,6 +711,45 @@ int zmq::socket_base_t::connect (const char *addr_)
         return 0;
     }
 
+    //  A striped tcp connection consists of several connections to the same
+    //  endpoint, each with a session of its own. Sockets that load-balance
+    //  or fair-queue spread the messages over them.
+    if (protocol == "tcp" && options.tcp_stripes > 1 &&
+          (options.type == ZMQ_PUSH || options.type == ZMQ_PULL ||
+           options.type == ZMQ_DEALER)) {
+
+        //  A ROUTER peer would take all but the first of the connections
+        //  for duplicates of it and ignore them.
+        if (options.identity_size > 0) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        const int stripes = options.tcp_stripes;
+        options.tcp_stripes = 1;
+        int connected = 0;
+        while (connected != stripes && connect (addr_) == 0)
+            connected++;
+        options.tcp_stripes = stripes;
+        if (connected == stripes)
+            return 0;
+
+        //  Either all the stripes are there or none. The ones connected so
+        //  far are the last ones filed under the address.
+        const int err = errno;
+        endpoints_t::iterator it = endpoints.upper_bound (std::string (addr_));
+        for (int i = 0; i != connected; i++) {
+            endpoints_t::iterator stripe = it;
+            --stripe;
+            if (stripe->second.second != NULL)
+                stripe->second.second->terminate (false);
+            term_child (stripe->second.first);
+            endpoints.erase (stripe);
+        }
+        errno = err;
+        return -1;
+    }
+
     //  Choose the I/O thread to run the session in.
     io_thread_t *io_thread = choose_io_thread (options.affinity);
     if (!io_thread) {
@@ -559,18 +762,30 @@ int zmq::socket_base_t::connect (const char *addr_)
 
     //  Resolve address (if needed by the protocol)
     if (protocol == "tcp") {
-        paddr->resolved.tcp_addr = new (std::nothrow) tcp_address_t ();
-        alloc_assert (paddr->resolved.tcp_addr);
-        int rc = paddr->resolved.tcp_addr->resolve (
-            address.c_str (), false, options.ipv6);
+        //  Host names are looked up by the connecter in the I/O thread,
+        //  on each connection attempt.
+        int rc = tcp_resolver_t::check (address, options.ipv6);
         if (rc != 0) {
             delete paddr;
             return -1;
         }
+        std::vector <tcp_address_t> addresses;
+        rc = tcp_resolver_t::resolve_numeric (address, options.ipv6,
+            addresses);
+        if (rc == 0) {
+            paddr->resolved.tcp_addr = new (std::nothrow) tcp_address_t (
+                addresses [0]);
+            alloc_assert (paddr->resolved.tcp_addr);
+        }
+        else
+        if (errno != EAGAIN) {
+            delete paddr;
+            return -1;
+        }
     }
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     else
-    if (protocol == "ipc") {
+    if (protocol == "ipc" || protocol == "shm") {
         paddr->resolved.ipc_addr = new (std::nothrow) ipc_address_t ();
         alloc_assert (paddr->resolved.ipc_addr);
         int rc = paddr->resolved.ipc_addr->resolve (address.c_str ());
@@ -579,6 +794,17 @@ int zmq::socket_base_t::connect (const char *addr_)
             return -1;
         }
     }
+    else
+    if (protocol == "udp") {
+        paddr->resolved.udp_addr = new (std::nothrow) udp_address_t ();
+        alloc_assert (paddr->resolved.udp_addr);
+        int rc = paddr->resolved.udp_addr->resolve (address.c_str (),
+            options.type == ZMQ_SUB || options.type == ZMQ_XSUB);
+        if (rc != 0) {
+            delete paddr;
+            return -1;
+        }
+    }
 #endif
 #ifdef ZMQ_HAVE_OPENPGM
     if (protocol == "pgm" || protocol == "epgm") {
@@ -609,9 +835,10 @@ int zmq::socket_base_t::connect (const char *addr_)
         options, paddr);
     errno_assert (session);
 
-    //  PGM does not support subscription forwarding; ask for all data to be
-    //  sent to this pipe.
-    bool subscribe_to_all = protocol == "pgm" || protocol == "epgm";
+    //  PGM and UDP do not support subscription forwarding; ask for all data
+    //  to be sent to this pipe.
+    bool subscribe_to_all = protocol == "pgm" || protocol == "epgm" ||
+        protocol == "udp";
     pipe_t *newpipe = NULL;
 
     if (options.immediate != 1 || subscribe_to_all) {
@@ -632,6 +859,17 @@ int zmq::socket_base_t::connect (const char *addr_)
         rc = pipepair (parents, new_pipes, hwms, conflates);
         errno_assert (rc == 0);
 
+        //  If required, spill the messages exceeding the HWM to the disk.
+        if (!options.spill_path.empty () && !conflate)
+            new_pipes [0]->set_spill (options.spill_path,
+                options.spill_maxsize);
+
+        if (options.latency_tracking) {
+            std::string endpoint;
+            paddr->to_string (endpoint);
+            new_pipes [0]->set_latency_tracking (endpoint);
+        }
+
         //  Attach local end of the pipe to the socket object.
         attach_pipe (new_pipes [0], subscribe_to_all);
         newpipe = new_pipes [0];
@@ -730,6 +968,9 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
         return -1;
     }
 
+    if (!state_sinks.empty ())
+        state_changed ();
+
     //  Process pending commands, if any.
     int rc = process_commands (0, true);
     if (unlikely (rc != 0))
@@ -742,10 +983,20 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
     if (flags_ & ZMQ_SNDMORE)
         msg_->set_flags (msg_t::more);
 
+    //  The message is consumed by xsend so remember its size beforehand.
+    size_t size = msg_->size ();
+
     //  Try to send the message.
     rc = xsend (msg_);
-    if (rc == 0)
+    if (rc == 0) {
+        bytes_sent += size;
+        if (!(flags_ & ZMQ_SNDMORE))
+            msgs_sent++;
+        if (unlikely (monitor_events &
+              (ZMQ_EVENT_MSGS_DROPPED | ZMQ_EVENT_THROUGHPUT)))
+            sample_monitor ();
         return 0;
+    }
     if (unlikely (errno != EAGAIN))
         return -1;
 
@@ -762,23 +1013,34 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
     //  Oops, we couldn't send the message. Wait for the next
     //  command, process it and try to send the message again.
     //  If timeout is reached in the meantime, return EAGAIN.
+    uint64_t block_start = clock.now_us ();
     while (true) {
-        if (unlikely (process_commands (timeout, false) != 0))
-            return -1;
+        rc = process_commands (timeout, false);
+        if (unlikely (rc != 0))
+            break;
         rc = xsend (msg_);
-        if (rc == 0)
+        if (rc == 0 || unlikely (errno != EAGAIN))
             break;
-        if (unlikely (errno != EAGAIN))
-            return -1;
         if (timeout > 0) {
             timeout = (int) (end - clock.now_ms ());
             if (timeout <= 0) {
                 errno = EAGAIN;
-                return -1;
+                rc = -1;
+                break;
             }
         }
     }
-    return 0;
+    hwm_block_time += clock.now_us () - block_start;
+
+    if (rc == 0) {
+        bytes_sent += size;
+        if (!(flags_ & ZMQ_SNDMORE))
+            msgs_sent++;
+        if (unlikely (monitor_events &
+              (ZMQ_EVENT_MSGS_DROPPED | ZMQ_EVENT_THROUGHPUT)))
+            sample_monitor ();
+    }
+    return rc;
 }
 
 int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
@@ -795,6 +1057,9 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
         return -1;
     }
 
+    if (!state_sinks.empty ())
+        state_changed ();
+
     //  Once every inbound_poll_rate messages check for signals and process
     //  incoming commands. This happens only if we are not polling altogether
     //  because there are messages available all the time. If poll occurs,
@@ -873,6 +1138,13 @@ int zmq::socket_base_t::close ()
     //  Mark the socket as dead
     tag = 0xdeadbeef;
     
+    //  From now on the socket is processed by the reaper thread, so the
+    //  objects watching its state have to let go of it.
+    state_sinks_t sinks;
+    sinks.swap (state_sinks);
+    for (state_sinks_t::iterator it = sinks.begin (); it != sinks.end (); ++it)
+        (*it)->socket_closed ();
+
     //  Transfer the ownership of the socket from this application thread
     //  to the reaper thread which will take care of the rest of shutdown
     //  process.
@@ -891,6 +1163,26 @@ bool zmq::socket_base_t::has_out ()
     return xhas_out ();
 }
 
+void zmq::socket_base_t::add_state_sink (i_state_events *sink_)
+{
+    state_sinks.push_back (sink_);
+}
+
+void zmq::socket_base_t::rm_state_sink (i_state_events *sink_)
+{
+    state_sinks_t::iterator it =
+        std::find (state_sinks.begin (), state_sinks.end (), sink_);
+    if (it != state_sinks.end ())
+        state_sinks.erase (it);
+}
+
+void zmq::socket_base_t::state_changed ()
+{
+    for (state_sinks_t::iterator it = state_sinks.begin ();
+          it != state_sinks.end (); ++it)
+        (*it)->state_changed ();
+}
+
 void zmq::socket_base_t::start_reaping (poller_t *poller_)
 {
     //  Plug the socket to the reaper thread.
@@ -942,6 +1234,8 @@ int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
     }
 
     //  Process all available commands.
+    if (rc == 0 && !state_sinks.empty ())
+        state_changed ();
     while (rc == 0) {
         cmd.destination->process_command (cmd);
         rc = mailbox.recv (&cmd, 0);
@@ -1007,6 +1301,11 @@ bool zmq::socket_base_t::xhas_out ()
     return false;
 }
 
+uint64_t zmq::socket_base_t::xmsgs_dropped ()
+{
+    return 0;
+}
+
 int zmq::socket_base_t::xsend (msg_t *)
 {
     errno = ENOTSUP;
@@ -1084,9 +1383,36 @@ void zmq::socket_base_t::read_activated (pipe_t *pipe_)
 
 void zmq::socket_base_t::write_activated (pipe_t *pipe_)
 {
+    //  Pipe is activated for writing only after it has reached the HWM
+    //  and the peer has read enough messages to get below the LWM.
+    if (monitor_events & ZMQ_EVENT_LWM_DRAINED) {
+        lwm_events++;
+        const uint64_t now = clock.now_ms ();
+        if (now - last_lwm_event >= (uint64_t) options.monitor_interval) {
+            std::string endpoint = pipe_endpoint (pipe_);
+            event_lwm_drained (endpoint, lwm_events);
+            last_lwm_event = now;
+            lwm_events = 0;
+        }
+    }
+
     xwrite_activated (pipe_);
 }
 
+void zmq::socket_base_t::hwm_reached (pipe_t *pipe_)
+{
+    if (monitor_events & ZMQ_EVENT_HWM_REACHED) {
+        hwm_events++;
+        const uint64_t now = clock.now_ms ();
+        if (now - last_hwm_event >= (uint64_t) options.monitor_interval) {
+            std::string endpoint = pipe_endpoint (pipe_);
+            event_hwm_reached (endpoint, hwm_events);
+            last_hwm_event = now;
+            hwm_events = 0;
+        }
+    }
+}
+
 void zmq::socket_base_t::hiccuped (pipe_t *pipe_)
 {
     if (options.immediate == 1)
@@ -1101,6 +1427,10 @@ void zmq::socket_base_t::pipe_terminated (pipe_t *pipe_)
     //  Notify the specific socket type about the pipe termination.
     xpipe_terminated (pipe_);
 
+    //  Keep the latencies measured by the pipe.
+    if (pipe_->get_inlatency ())
+        merge_latency (latencies, pipe_);
+
     // Remove pipe from inproc pipes
     for (inprocs_t::iterator it = inprocs.begin(); it != inprocs.end(); ++it) {
         if (it->second == pipe_) {
@@ -1116,6 +1446,119 @@ void zmq::socket_base_t::pipe_terminated (pipe_t *pipe_)
         unregister_term_ack ();
 }
 
+void zmq::socket_base_t::merge_latency (latencies_t &latencies_,
+    pipe_t *pipe_)
+{
+    latency_t *inlatency = pipe_->get_inlatency ();
+    latency_t *outlatency = pipe_->get_outlatency ();
+    zmq_assert (inlatency && outlatency);
+
+    latencies_t::iterator it = latencies_.find (inlatency->get_endpoint ());
+    if (it == latencies_.end ()) {
+        latency_totals_t *totals = new (std::nothrow) latency_totals_t;
+        alloc_assert (totals);
+        it = latencies_.insert (latencies_t::value_type (
+            inlatency->get_endpoint (), totals)).first;
+    }
+    it->second->in.merge (inlatency->histogram);
+    it->second->out.merge (outlatency->histogram);
+}
+
+std::string zmq::socket_base_t::pipe_endpoint (pipe_t *pipe_)
+{
+    for (endpoints_t::iterator it = endpoints.begin ();
+          it != endpoints.end (); ++it)
+        if (it->second.second == pipe_)
+            return it->first;
+    for (inprocs_t::iterator it = inprocs.begin ();
+          it != inprocs.end (); ++it)
+        if (it->second == pipe_)
+            return it->first;
+    return std::string ();
+}
+
+void zmq::socket_base_t::sample_monitor ()
+{
+    const uint64_t now = clock.now_ms ();
+    if (now - last_sample < (uint64_t) options.monitor_interval)
+        return;
+
+    std::string endpoint;
+    if (monitor_events & ZMQ_EVENT_MSGS_DROPPED) {
+        const uint64_t dropped = xmsgs_dropped ();
+        if (dropped != sampled_dropped)
+            event_msgs_dropped (endpoint, (int) (dropped - sampled_dropped));
+        sampled_dropped = dropped;
+    }
+
+    //  Throughput can be computed only once there's a previous sample.
+    const uint64_t msgs = msgs_sent + msgs_received;
+    if ((monitor_events & ZMQ_EVENT_THROUGHPUT) && last_sample &&
+          now > last_sample)
+        event_throughput (endpoint,
+            (int) ((msgs - sampled_msgs) * 1000 / (now - last_sample)));
+    sampled_msgs = msgs;
+    last_sample = now;
+}
+
+//  Appends lines with the number of messages, percentiles and maximum of
+//  the latency, in nanoseconds, for both directions of the endpoint.
+static void report_latency (std::ostringstream &report_,
+    const std::string &endpoint_, zmq::histogram_t &in_,
+    zmq::histogram_t &out_, double ticks_per_ns_)
+{
+    const double quantiles [] = {0.5, 0.9, 0.99, 0.999, 1.0};
+    for (int direction = 0; direction != 2; direction++) {
+        zmq::histogram_t &histogram = direction ? out_ : in_;
+        report_ << endpoint_ << (direction ? " out " : " in ") <<
+            histogram.count ();
+        for (int i = 0; i != 5; i++)
+            report_ << " " << (uint64_t) (histogram.percentile (
+                quantiles [i]) / ticks_per_ns_);
+        report_ << "\n";
+    }
+}
+
+void zmq::socket_base_t::latency_report (std::string &report_)
+{
+    //  Combine the latencies of the terminated pipes with the live ones.
+    latencies_t current;
+    for (latencies_t::iterator it = latencies.begin ();
+          it != latencies.end (); ++it) {
+        latency_totals_t *totals = new (std::nothrow) latency_totals_t;
+        alloc_assert (totals);
+        totals->in.merge (it->second->in);
+        totals->out.merge (it->second->out);
+        current.insert (latencies_t::value_type (it->first, totals));
+    }
+    for (pipes_t::size_type i = 0; i != pipes.size (); ++i)
+        if (pipes [i]->get_inlatency ())
+            merge_latency (current, pipes [i]);
+
+    //  Aggregate for the whole socket goes first. The pipes with no
+    //  endpoint (i.e. accepted connections) are reported only there.
+    latency_totals_t total;
+    for (latencies_t::iterator it = current.begin ();
+          it != current.end (); ++it) {
+        total.in.merge (it->second->in);
+        total.out.merge (it->second->out);
+    }
+
+    const double ticks_per_ns = latency_t::ticks_per_ns ();
+    std::ostringstream report;
+    report_latency (report, "*", total.in, total.out, ticks_per_ns);
+    for (latencies_t::iterator it = current.begin ();
+          it != current.end (); ++it)
+        if (!it->first.empty ())
+            report_latency (report, it->first, it->second->in,
+                it->second->out, ticks_per_ns);
+    report_ = report.str ();
+
+    for (latencies_t::iterator it = current.begin ();
+          it != current.end (); ++it)
+        delete it->second;
+}
+
 void zmq::socket_base_t::extract_flags (msg_t *msg_)
 {
     //  Test whether IDENTITY flag is valid for this socket type.
@@ -1124,6 +1567,14 @@ void zmq::socket_base_t::extract_flags (msg_t *msg_)
   
     //  Remove MORE flag.
     rcvmore = msg_->flags () & msg_t::more ? true : false;
+
+    bytes_received += msg_->size ();
+    if (!rcvmore)
+        msgs_received++;
+
+    if (unlikely (monitor_events &
+          (ZMQ_EVENT_MSGS_DROPPED | ZMQ_EVENT_THROUGHPUT)))
+        sample_monitor ();
 }
 
 int zmq::socket_base_t::monitor (const char *addr_, int events_)
@@ -1157,23 +1608,32 @@ int zmq::socket_base_t::monitor (const char *addr_, int events_)
         return -1;
     }
 
-    // Register events to monitor
-    monitor_events = events_;
-    monitor_socket = zmq_socket (get_ctx (), ZMQ_PAIR);
-    if (monitor_socket == NULL)
+    //  The I/O threads may send events as soon as the socket is in place,
+    //  so it's set up in full first.
+    void *socket = zmq_socket (get_ctx (), ZMQ_PAIR);
+    if (socket == NULL)
         return -1;
 
     // Never block context termination on pending event messages
     int linger = 0;
-    rc = zmq_setsockopt (monitor_socket, ZMQ_LINGER, &linger, sizeof (linger));
-    if (rc == -1)
-         stop_monitor ();
+    rc = zmq_setsockopt (socket, ZMQ_LINGER, &linger, sizeof (linger));
 
     // Spawn the monitor socket endpoint
-    rc = zmq_bind (monitor_socket, addr_);
-    if (rc == -1)
-         stop_monitor ();
-    return rc;
+    if (rc == 0)
+        rc = zmq_bind (socket, addr_);
+    if (rc == -1) {
+        const int err = errno;
+        zmq_close (socket);
+        errno = err;
+        return -1;
+    }
+
+    // Register events to monitor
+    stop_monitor ();
+    scoped_lock_t lock (monitor_sync);
+    monitor_socket = socket;
+    monitor_events = events_;
+    return 0;
 }
 
 void zmq::socket_base_t::event_connected (std::string &addr_, int fd_)
@@ -1276,7 +1736,77 @@ void zmq::socket_base_t::event_disconnected (std::string &addr_, int fd_)
     }
 }
 
+void zmq::socket_base_t::event_hwm_reached (std::string &addr_, int count_)
+{
+    if (monitor_events & ZMQ_EVENT_HWM_REACHED) {
+        zmq_event_t event;
+        event.event = ZMQ_EVENT_HWM_REACHED;
+        event.value = count_;
+        monitor_event (event, addr_);
+    }
+}
+
+void zmq::socket_base_t::event_lwm_drained (std::string &addr_, int count_)
+{
+    if (monitor_events & ZMQ_EVENT_LWM_DRAINED) {
+        zmq_event_t event;
+        event.event = ZMQ_EVENT_LWM_DRAINED;
+        event.value = count_;
+        monitor_event (event, addr_);
+    }
+}
+
+void zmq::socket_base_t::event_handshake_succeeded (std::string &addr_,
+    int duration_)
+{
+    if (monitor_events & ZMQ_EVENT_HANDSHAKE_SUCCEEDED) {
+        zmq_event_t event;
+        event.event = ZMQ_EVENT_HANDSHAKE_SUCCEEDED;
+        event.value = duration_;
+        monitor_event (event, addr_);
+    }
+}
+
+void zmq::socket_base_t::event_msgs_dropped (std::string &addr_, int count_)
+{
+    if (monitor_events & ZMQ_EVENT_MSGS_DROPPED) {
+        zmq_event_t event;
+        event.event = ZMQ_EVENT_MSGS_DROPPED;
+        event.value = count_;
+        monitor_event (event, addr_);
+    }
+}
+
+void zmq::socket_base_t::event_throughput (std::string &addr_, int rate_)
+{
+    if (monitor_events & ZMQ_EVENT_THROUGHPUT) {
+        zmq_event_t event;
+        event.event = ZMQ_EVENT_THROUGHPUT;
+        event.value = rate_;
+        monitor_event (event, addr_);
+    }
+}
+
+void zmq::socket_base_t::count_reconnect ()
+{
+    reconnects.add (1);
+}
+
+void zmq::socket_base_t::count_zap_lookup (bool hit_)
+{
+    if (hit_)
+        zap_cache_hits.add (1);
+    else
+        zap_cache_misses.add (1);
+}
+
 void zmq::socket_base_t::monitor_event (zmq_event_t event_, const std::string& addr_)
+{
+    scoped_lock_t lock (monitor_sync);
+    send_monitor_event (event_, addr_);
+}
+
+void zmq::socket_base_t::send_monitor_event (zmq_event_t event_, const std::string& addr_)
 {
     if (monitor_socket) {
         const uint16_t eid = (uint16_t)event_.event;
@@ -1299,12 +1829,13 @@ void zmq::socket_base_t::monitor_event (zmq_event_t event_, const std::string& a
 
 void zmq::socket_base_t::stop_monitor()
 {
+    scoped_lock_t lock (monitor_sync);
     if (monitor_socket) {
         if (monitor_events & ZMQ_EVENT_MONITOR_STOPPED) {
             zmq_event_t event;
             event.event = ZMQ_EVENT_MONITOR_STOPPED;
             event.value = 0;
-            monitor_event (event, "");
+            send_monitor_event (event, "");
         }
         zmq_close (monitor_socket);
         monitor_socket = NULL;
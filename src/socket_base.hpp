@@ -22,6 +22,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <stdarg.h>
 
 #include "own.hpp"
@@ -30,10 +31,12 @@
 #include "poller.hpp"
 #include "atomic_counter.hpp"
 #include "i_poll_events.hpp"
+#include "i_state_events.hpp"
 #include "mailbox.hpp"
 #include "stdint.hpp"
 #include "clock.hpp"
 #include "pipe.hpp"
+#include "config.hpp"
 
 extern "C"
 {
@@ -75,6 +78,11 @@ namespace zmq
         int setsockopt (int option_, const void *optval_, size_t optvallen_);
         int getsockopt (int option_, void *optval_, size_t *optvallen_);
         int bind (const char *addr_);
+
+        //  Binds an endpoint other sockets may bind as well. Peers connecting
+        //  to it are spread across all of them according to strategy_
+        //  (ZMQ_PROXY_SHARD_*). Only inproc and tcp endpoints can be shared.
+        int bind_shared (const char *addr_, int strategy_);
         int connect (const char *addr_);
         int term_endpoint (const char *addr_);
         int send (zmq::msg_t *msg_, int flags_);
@@ -86,6 +94,13 @@ namespace zmq
         bool has_in ();
         bool has_out ();
 
+        //  Register and unregister an object to be notified whenever the
+        //  socket's events may have changed without its ZMQ_FD being
+        //  signaled, i.e. when the commands were processed or a message was
+        //  sent or received, and when the socket is closed.
+        void add_state_sink (i_state_events *sink_);
+        void rm_state_sink (i_state_events *sink_);
+
         //  Using this function reaper thread ask the socket to regiter with
         //  its poller.
         void start_reaping (poller_t *poller_);
@@ -100,12 +115,20 @@ namespace zmq
         void read_activated (pipe_t *pipe_);
         void write_activated (pipe_t *pipe_);
         void hiccuped (pipe_t *pipe_);
+        void hwm_reached (pipe_t *pipe_);
         void pipe_terminated (pipe_t *pipe_);
         void lock();
         void unlock();
 
         int monitor (const char *endpoint_, int events_);
 
+        //  True iff 'event_' is among the events being monitored. Lets
+        //  the I/O threads skip preparing events nobody listens to.
+        bool is_monitored (int event_) const
+        {
+            return (monitor_events & event_) != 0;
+        }
+
         void event_connected (std::string &addr_, int fd_);
         void event_connect_delayed (std::string &addr_, int err_);
         void event_connect_retried (std::string &addr_, int interval_);
@@ -116,6 +139,20 @@ namespace zmq
         void event_closed (std::string &addr_, int fd_);        
         void event_close_failed (std::string &addr_, int fd_);  
         void event_disconnected (std::string &addr_, int fd_); 
+        void event_hwm_reached (std::string &addr_, int count_);
+        void event_lwm_drained (std::string &addr_, int count_);
+        void event_handshake_succeeded (std::string &addr_, int duration_);
+        void event_msgs_dropped (std::string &addr_, int count_);
+        void event_throughput (std::string &addr_, int rate_);
+
+        //  Called by the sessions when they start re-establishing
+        //  the connection. This function can be called from a different
+        //  thread!
+        void count_reconnect ();
+
+        //  Called by the sessions when they look up the ZAP cache.
+        //  This function can be called from a different thread!
+        void count_zap_lookup (bool hit_);
 
     protected:
 
@@ -147,12 +184,20 @@ namespace zmq
         virtual void xhiccuped (pipe_t *pipe_);
         virtual void xpipe_terminated (pipe_t *pipe_) = 0;
 
+        //  Returns the number of messages dropped because of the high
+        //  watermark. The default implementation assumes that the socket
+        //  never drops messages.
+        virtual uint64_t xmsgs_dropped ();
+
         //  Delay actual destruction of the socket.
         void process_destroy ();
 
         // Socket event data dispath
         void monitor_event (zmq_event_t data_, const std::string& addr_);
 
+        //  Sends an event to the monitor socket; monitor_sync must be held.
+        void send_monitor_event (zmq_event_t data_, const std::string& addr_);
+
         // Monitor socket cleanup
         void stop_monitor ();
 
@@ -177,6 +222,24 @@ namespace zmq
         //  to be later retrieved by getsockopt.
         void extract_flags (msg_t *msg_);
 
+        //  Latency histograms of both directions, for a single endpoint.
+        struct latency_totals_t;
+        typedef std::map <std::string, latency_totals_t*> latencies_t;
+
+        //  Adds the latencies measured by the pipe to the map.
+        static void merge_latency (latencies_t &latencies_, pipe_t *pipe_);
+
+        //  Returns the endpoint the pipe was connected to, or empty string
+        //  if not known.
+        std::string pipe_endpoint (pipe_t *pipe_);
+
+        //  Sends the periodic statistics to the monitor if the monitor
+        //  interval has elapsed.
+        void sample_monitor ();
+
+        //  Fills in the text reported via ZMQ_STAT_LATENCY.
+        void latency_report (std::string &report_);
+
         //  Used to check whether the object is a socket.
         uint32_t tag;
 
@@ -224,6 +287,13 @@ namespace zmq
         //  Timestamp of when commands were processed the last time.
         uint64_t last_tsc;
 
+        //  Objects registered by add_state_sink.
+        typedef std::vector <i_state_events*> state_sinks_t;
+        state_sinks_t state_sinks;
+
+        //  Tells the objects registered that the state may have changed.
+        void state_changed ();
+
         //  Number of messages received since last command processing.
         int ticks;
 
@@ -236,12 +306,54 @@ namespace zmq
         // Monitor socket;
         void *monitor_socket;
 
+        //  Serialises the use of the monitor socket, as the events are sent
+        //  from the I/O threads as well as from the socket's own thread.
+        mutex_t monitor_sync;
+
         // Bitmask of events being monitored
         int monitor_events;
 
         // Last socket endpoint resolved URI
         std::string last_endpoint;
 
+        //  Statistics reported via ZMQ_STAT_* options. These are updated
+        //  only by the thread the socket is used from, so there's no need
+        //  for atomic operations.
+        uint64_t msgs_sent;
+        uint64_t bytes_sent;
+        uint64_t msgs_received;
+        uint64_t bytes_received;
+
+        //  Time spent waiting for the HWM to clear in send, in microseconds.
+        uint64_t hwm_block_time;
+
+        //  Number of reconnections. It's updated from the I/O threads and
+        //  thus it is atomic and kept on a cache line of its own so that
+        //  the updates don't slow down the thread using the socket.
+        unsigned char reconnects_pad1 [cache_line_size];
+        atomic_counter64_t reconnects;
+
+        //  ZAP cache lookups, updated from the I/O threads as well.
+        atomic_counter_t zap_cache_hits;
+        atomic_counter_t zap_cache_misses;
+        unsigned char reconnects_pad2 [cache_line_size];
+
+        //  Rate limiting of the monitor events. For HWM and LWM events, the
+        //  time the last one was sent (in milliseconds) and the number of
+        //  occurences since then. For the periodic statistics, the time
+        //  and the values at the last sample.
+        uint64_t last_hwm_event;
+        int hwm_events;
+        uint64_t last_lwm_event;
+        int lwm_events;
+        uint64_t last_sample;
+        uint64_t sampled_msgs;
+        uint64_t sampled_dropped;
+
+        //  Latencies measured by the pipes that were already terminated,
+        //  per endpoint.
+        latencies_t latencies;
+
         socket_base_t (const socket_base_t&);
         const socket_base_t &operator = (const socket_base_t&);
         mutex_t sync;
@@ -0,0 +1,465 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "socket_poller.hpp"
+#include "socket_base.hpp"
+#include "config.hpp"
+#include "clock.hpp"
+#include "err.hpp"
+
+#include <new>
+#include <algorithm>
+
+#if !defined ZMQ_HAVE_WINDOWS
+#include <unistd.h>
+#endif
+
+#if defined ZMQ_USE_EPOLL
+static uint32_t epoll_events (short events_)
+{
+    uint32_t events = 0;
+    if (events_ & ZMQ_POLLIN)
+        events |= EPOLLIN;
+    if (events_ & ZMQ_POLLOUT)
+        events |= EPOLLOUT;
+    return events;
+}
+#endif
+
+zmq::socket_poller_t::socket_poller_t () :
+    tag (0xdecafbad)
+#if defined ZMQ_USE_EPOLL
+    , dirty (NULL)
+#else
+    , need_rebuild (false)
+#endif
+{
+#if defined ZMQ_USE_EPOLL
+    epoll_fd = epoll_create (1);
+    errno_assert (epoll_fd != -1);
+#endif
+}
+
+zmq::socket_poller_t::~socket_poller_t ()
+{
+    //  Mark the poller as dead.
+    tag = 0xdeadbeef;
+
+#if defined ZMQ_USE_EPOLL
+    close (epoll_fd);
+#endif
+    for (items_t::iterator it = items.begin (); it != items.end (); ++it) {
+        if ((*it)->socket)
+            (*it)->socket->rm_state_sink (*it);
+        delete *it;
+    }
+}
+
+bool zmq::socket_poller_t::check_tag ()
+{
+    return tag == 0xdecafbad;
+}
+
+zmq::socket_poller_t::items_t::iterator zmq::socket_poller_t::find (
+    socket_base_t *socket_)
+{
+    items_t::iterator it = items.begin ();
+    while (it != items.end () && (*it)->socket != socket_)
+        ++it;
+    return it;
+}
+
+zmq::socket_poller_t::items_t::iterator zmq::socket_poller_t::find_fd (
+    fd_t fd_)
+{
+    items_t::iterator it = items.begin ();
+    while (it != items.end () && ((*it)->socket || (*it)->fd != fd_))
+        ++it;
+    return it;
+}
+
+int zmq::socket_poller_t::add (socket_base_t *socket_, void *user_data_,
+    short events_)
+{
+    if (find (socket_) != items.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  The file descriptor signaled when the socket's events may change.
+    fd_t fd;
+    size_t fd_size = sizeof fd;
+    int rc = socket_->getsockopt (ZMQ_FD, &fd, &fd_size);
+    if (rc != 0)
+        return -1;
+
+    item_t *item = new (std::nothrow) item_t;
+    alloc_assert (item);
+    item->socket = socket_;
+    item->fd = fd;
+    item->user_data = user_data_;
+    item->events = events_;
+    return add_item (item);
+}
+
+int zmq::socket_poller_t::modify (socket_base_t *socket_, short events_)
+{
+    items_t::iterator it = find (socket_);
+    if (it == items.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+    (*it)->events = events_;
+#if defined ZMQ_USE_EPOLL
+    mark_dirty (*it);
+#else
+    need_rebuild = true;
+#endif
+    return 0;
+}
+
+int zmq::socket_poller_t::remove (socket_base_t *socket_)
+{
+    items_t::iterator it = find (socket_);
+    if (it == items.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+    return remove_item (it);
+}
+
+int zmq::socket_poller_t::add_fd (fd_t fd_, void *user_data_, short events_)
+{
+    if (find_fd (fd_) != items.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    item_t *item = new (std::nothrow) item_t;
+    alloc_assert (item);
+    item->socket = NULL;
+    item->fd = fd_;
+    item->user_data = user_data_;
+    item->events = events_;
+    return add_item (item);
+}
+
+int zmq::socket_poller_t::modify_fd (fd_t fd_, short events_)
+{
+    items_t::iterator it = find_fd (fd_);
+    if (it == items.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+    item_t *item = *it;
+#if defined ZMQ_USE_EPOLL
+    item->ev.events = epoll_events (events_);
+    const int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, item->fd, &item->ev);
+    if (rc == -1)
+        return -1;
+#else
+    need_rebuild = true;
+#endif
+    item->events = events_;
+    return 0;
+}
+
+int zmq::socket_poller_t::remove_fd (fd_t fd_)
+{
+    items_t::iterator it = find_fd (fd_);
+    if (it == items.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+    return remove_item (it);
+}
+
+int zmq::socket_poller_t::add_item (item_t *item_)
+{
+    item_->poller = this;
+#if defined ZMQ_USE_EPOLL
+    item_->dirty = false;
+    item_->prev_dirty = NULL;
+    item_->next_dirty = NULL;
+
+    //  A socket's ZMQ_FD only ever signals readability.
+    item_->ev.events = item_->socket ? EPOLLIN : epoll_events (item_->events);
+    item_->ev.data.ptr = item_;
+    const int rc = epoll_ctl (epoll_fd, EPOLL_CTL_ADD, item_->fd, &item_->ev);
+    if (rc == -1) {
+        delete item_;
+        return -1;
+    }
+#else
+    need_rebuild = true;
+#endif
+    items.push_back (item_);
+
+    //  A newly added socket is checked on the next wait, and from then on
+    //  whenever it tells its state may have changed.
+    if (item_->socket) {
+        item_->socket->add_state_sink (item_);
+#if defined ZMQ_USE_EPOLL
+        mark_dirty (item_);
+#endif
+    }
+    return 0;
+}
+
+int zmq::socket_poller_t::remove_item (items_t::iterator it_)
+{
+    item_t *item = *it_;
+#if defined ZMQ_USE_EPOLL
+    //  The descriptor may have been closed already, which removed it
+    //  from the epoll set.
+    const int rc = epoll_ctl (epoll_fd, EPOLL_CTL_DEL, item->fd, &item->ev);
+    errno_assert (rc != -1 || errno == EBADF || errno == ENOENT);
+    unmark_dirty (item);
+#else
+    need_rebuild = true;
+#endif
+    if (item->socket)
+        item->socket->rm_state_sink (item);
+    items.erase (it_);
+    delete item;
+    return 0;
+}
+
+void zmq::socket_poller_t::item_t::state_changed ()
+{
+#if defined ZMQ_USE_EPOLL
+    poller->mark_dirty (this);
+#endif
+}
+
+void zmq::socket_poller_t::item_t::socket_closed ()
+{
+    //  The socket is gone, so is the item.
+    poller->remove_item (
+        std::find (poller->items.begin (), poller->items.end (), this));
+}
+
+#if defined ZMQ_USE_EPOLL
+void zmq::socket_poller_t::mark_dirty (item_t *item_)
+{
+    if (item_->dirty)
+        return;
+    item_->dirty = true;
+    item_->prev_dirty = NULL;
+    item_->next_dirty = dirty;
+    if (dirty)
+        dirty->prev_dirty = item_;
+    dirty = item_;
+}
+
+void zmq::socket_poller_t::unmark_dirty (item_t *item_)
+{
+    if (!item_->dirty)
+        return;
+    item_->dirty = false;
+    if (item_->prev_dirty)
+        item_->prev_dirty->next_dirty = item_->next_dirty;
+    else
+        dirty = item_->next_dirty;
+    if (item_->next_dirty)
+        item_->next_dirty->prev_dirty = item_->prev_dirty;
+    item_->prev_dirty = NULL;
+    item_->next_dirty = NULL;
+}
+
+int zmq::socket_poller_t::check_socket (item_t *item_, event_t *event_)
+{
+    uint32_t zmq_events;
+    size_t zmq_events_size = sizeof zmq_events;
+    if (item_->socket->getsockopt (ZMQ_EVENTS, &zmq_events,
+          &zmq_events_size) == -1)
+        return -1;
+
+    //  Reading ZMQ_EVENTS may have processed commands and marked the
+    //  socket dirty again, which is pointless as it's just been checked.
+    //  A socket that is ready, though, may stay ready without ZMQ_FD
+    //  being signaled again, so it is checked once more on the next wait.
+    unmark_dirty (item_);
+    const short revents =
+        (short) (zmq_events & item_->events & (ZMQ_POLLIN | ZMQ_POLLOUT));
+    if (!revents)
+        return 0;
+    mark_dirty (item_);
+
+    event_->socket = item_->socket;
+    event_->fd = retired_fd;
+    event_->user_data = item_->user_data;
+    event_->events = revents;
+    return 1;
+}
+#endif
+
+int zmq::socket_poller_t::wait (event_t *events_, int n_events_,
+    long timeout_)
+{
+    if (!events_ || n_events_ < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+#if defined ZMQ_USE_EPOLL
+    zmq::clock_t clock;
+    uint64_t now = 0;
+    uint64_t end = 0;
+    bool first_pass = true;
+
+    while (true) {
+        //  Compute the timeout for the subsequent epoll_wait.
+        int timeout;
+        if (first_pass)
+            timeout = 0;
+        else
+        if (timeout_ < 0)
+            timeout = -1;
+        else
+            timeout = (int) (end - now);
+
+        epoll_event ev_buf [max_io_events];
+        const int n = epoll_wait (epoll_fd, ev_buf, max_io_events, timeout);
+        if (n == -1 && errno == EINTR)
+            return -1;
+        errno_assert (n != -1);
+
+        //  Plain file descriptors report their events directly, the
+        //  signaled sockets are checked below.
+        int found = 0;
+        for (int i = 0; i != n; i++) {
+            item_t *item = (item_t*) ev_buf [i].data.ptr;
+            if (item->socket) {
+                mark_dirty (item);
+                continue;
+            }
+            if (found == n_events_)
+                continue;
+            short revents = 0;
+            if ((item->events & ZMQ_POLLIN) && (ev_buf [i].events & EPOLLIN))
+                revents |= ZMQ_POLLIN;
+            if ((item->events & ZMQ_POLLOUT) &&
+                  (ev_buf [i].events & EPOLLOUT))
+                revents |= ZMQ_POLLOUT;
+            if (ev_buf [i].events & ~(EPOLLIN | EPOLLOUT))
+                revents |= ZMQ_POLLERR;
+            if (revents) {
+                events_ [found].socket = NULL;
+                events_ [found].fd = item->fd;
+                events_ [found].user_data = item->user_data;
+                events_ [found].events = revents;
+                found++;
+            }
+        }
+
+        //  Only the sockets in the dirty list may have become ready. The
+        //  list is detached while they are checked, as checking links the
+        //  ready ones back in for the next wait. The sockets not reached
+        //  stay marked and are linked back in afterwards.
+        item_t *item = dirty;
+        dirty = NULL;
+        int rc = 0;
+        while (item && found != n_events_ && rc != -1) {
+            item_t *next = item->next_dirty;
+            item->dirty = false;
+            item->prev_dirty = NULL;
+            item->next_dirty = NULL;
+            rc = check_socket (item, &events_ [found]);
+            if (rc == -1)
+                mark_dirty (item);
+            else
+                found += rc;
+            item = next;
+        }
+        while (item) {
+            item_t *next = item->next_dirty;
+            item->dirty = false;
+            mark_dirty (item);
+            item = next;
+        }
+        if (rc == -1)
+            return -1;
+
+        //  If there are events to return, we can exit immediately.
+        if (found)
+            return found;
+
+        //  If timout is zero, exit immediately.
+        if (timeout_ == 0)
+            break;
+
+        //  If timeout is infinite we can just loop until we get some events.
+        if (timeout_ < 0) {
+            first_pass = false;
+            continue;
+        }
+
+        //  The timeout is finite and there are no events. In the first pass
+        //  we compute the time when the polling should time out.
+        if (first_pass) {
+            now = clock.now_ms ();
+            end = now + timeout_;
+            first_pass = false;
+            continue;
+        }
+
+        //  Find out whether timeout have expired.
+        now = clock.now_ms ();
+        if (now >= end)
+            break;
+    }
+
+    errno = EAGAIN;
+    return -1;
+#else
+    if (need_rebuild) {
+        pollset.resize (items.size ());
+        for (size_t i = 0; i != items.size (); i++) {
+            pollset [i].socket = items [i]->socket;
+            pollset [i].fd = items [i]->fd;
+            pollset [i].events = items [i]->events;
+            pollset [i].revents = 0;
+        }
+        need_rebuild = false;
+    }
+
+    const int rc = zmq_poll (pollset.empty () ? NULL : &pollset [0],
+        (int) pollset.size (), timeout_);
+    if (rc == -1)
+        return -1;
+
+    int found = 0;
+    for (size_t i = 0; i != pollset.size () && found != n_events_; i++) {
+        if (!pollset [i].revents)
+            continue;
+        events_ [found].socket = items [i]->socket;
+        events_ [found].fd = items [i]->socket ? retired_fd : items [i]->fd;
+        events_ [found].user_data = items [i]->user_data;
+        events_ [found].events = pollset [i].revents;
+        found++;
+    }
+    if (!found) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return found;
+#endif
+}
@@ -0,0 +1,147 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_SOCKET_POLLER_HPP_INCLUDED__
+#define __ZMQ_SOCKET_POLLER_HPP_INCLUDED__
+
+//  poller.hpp decides which polling mechanism to use.
+#include "poller.hpp"
+
+#include <vector>
+
+#if defined ZMQ_USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include "../include/zmq.h"
+#include "fd.hpp"
+#include "i_state_events.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class socket_base_t;
+
+    //  Implementation of the zmq_poller API. Unlike zmq_poll, the set of
+    //  sockets and file descriptors is registered once. Where epoll is
+    //  available the ZMQ_FDs of the sockets are kept in an epoll set, and
+    //  the sockets that were signaled, were found ready the last time or
+    //  have been used since are kept in a list, so waiting checks the
+    //  events of just those sockets.
+    //  The object is not thread safe; it has to be used from the thread
+    //  that uses the sockets registered in it.
+
+    class socket_poller_t
+    {
+    public:
+
+        socket_poller_t ();
+        ~socket_poller_t ();
+
+        typedef zmq_poller_event_t event_t;
+
+        //  Returns false if object is not a poller.
+        bool check_tag ();
+
+        int add (socket_base_t *socket_, void *user_data_, short events_);
+        int modify (socket_base_t *socket_, short events_);
+        int remove (socket_base_t *socket_);
+
+        int add_fd (fd_t fd_, void *user_data_, short events_);
+        int modify_fd (fd_t fd_, short events_);
+        int remove_fd (fd_t fd_);
+
+        //  Fills in up to 'n_events_' events and returns their number.
+        //  Returns -1 and EAGAIN if there are none before the timeout.
+        int wait (event_t *events_, int n_events_, long timeout_);
+
+    private:
+
+        struct item_t : public i_state_events
+        {
+            socket_poller_t *poller;
+            socket_base_t *socket;
+            fd_t fd;
+            void *user_data;
+            short events;
+
+#if defined ZMQ_USE_EPOLL
+            epoll_event ev;
+
+            //  For sockets, true if the item is in the poller's dirty list,
+            //  i.e. if its events have to be checked on the next wait.
+            bool dirty;
+            item_t *prev_dirty;
+            item_t *next_dirty;
+#endif
+
+            //  i_state_events implementation.
+            void state_changed ();
+            void socket_closed ();
+        };
+
+        typedef std::vector <item_t*> items_t;
+
+        items_t::iterator find (socket_base_t *socket_);
+        items_t::iterator find_fd (fd_t fd_);
+
+        int add_item (item_t *item_);
+        int remove_item (items_t::iterator it_);
+
+#if defined ZMQ_USE_EPOLL
+        //  Link the socket into the dirty list unless it's there already,
+        //  and unlink it.
+        void mark_dirty (item_t *item_);
+        void unmark_dirty (item_t *item_);
+
+        //  Checks the events of a registered socket, leaving it in the
+        //  dirty list if it's ready. Returns -1 if the socket can't be used
+        //  anymore.
+        int check_socket (item_t *item_, event_t *event_);
+#endif
+
+        //  Used to check whether the object is a poller.
+        uint32_t tag;
+
+        //  Registered sockets and file descriptors.
+        items_t items;
+
+#if defined ZMQ_USE_EPOLL
+        fd_t epoll_fd;
+
+        //  Intrusive list of the sockets that have to be checked on the next
+        //  wait, because they were signaled, were found ready or were used
+        //  since the last check. The sockets link their items in themselves
+        //  via i_state_events.
+        item_t *dirty;
+#else
+        //  Poll set passed to zmq_poll, rebuilt when the items change.
+        std::vector <zmq_pollitem_t> pollset;
+        bool need_rebuild;
+#endif
+
+        socket_poller_t (const socket_poller_t&);
+        const socket_poller_t &operator = (const socket_poller_t&);
+    };
+
+}
+
+#endif
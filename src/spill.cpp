@@ -0,0 +1,384 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#include <new>
+#include <sstream>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "spill.hpp"
+#include "config.hpp"
+#include "wire.hpp"
+#include "err.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+zmq::spill_t::spill_t (const std::string &path_, int64_t maxsize_) :
+    path (path_),
+    maxsize (maxsize_),
+    next_seqnum (0),
+    commit_seqnum (0),
+    commit_pos (0),
+    stored (0),
+    uncommitted_parts (0),
+    uncommitted_bytes (0),
+    reader_asleep (false)
+{
+}
+
+zmq::spill_t::~spill_t ()
+{
+    clear ();
+}
+
+bool zmq::spill_t::check_write ()
+{
+    sync.lock ();
+
+    bool ok = maxsize < 0 || stored < maxsize;
+
+    //  Segment files are created lazily. If the very first one cannot be
+    //  created the message is refused and the pipe behaves as if there
+    //  was no spill at all.
+    if (ok && segments.empty ())
+        ok = open_segment (spill_segment_size, false) != NULL;
+
+    sync.unlock ();
+    return ok;
+}
+
+bool zmq::spill_t::incomplete ()
+{
+    return uncommitted_parts > 0;
+}
+
+void zmq::spill_t::write (msg_t *msg_)
+{
+    size_t size = msg_->size ();
+
+    sync.lock ();
+    unsigned char *record = append (size);
+    record [1] = msg_->flags () &
+        (msg_t::more | msg_t::command | msg_t::identity);
+    put_uint32 (record + 4, (uint32_t) size);
+    memcpy (record + record_header_size, msg_->data (), size);
+    record [0] = record_marker;
+    stored += size;
+    uncommitted_bytes += size;
+    uncommitted_parts++;
+    sync.unlock ();
+
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init ();
+    errno_assert (rc == 0);
+}
+
+bool zmq::spill_t::commit ()
+{
+    sync.lock ();
+    zmq_assert (!segments.empty ());
+    commit_seqnum = segments.back ()->seqnum;
+    commit_pos = segments.back ()->wpos;
+    uncommitted_parts = 0;
+    uncommitted_bytes = 0;
+    bool awake = !reader_asleep;
+    reader_asleep = false;
+    sync.unlock ();
+    return awake;
+}
+
+void zmq::spill_t::rollback ()
+{
+    if (!uncommitted_parts)
+        return;
+
+    sync.lock ();
+
+    //  Drop the segments created after the last commit.
+    while (segments.size () > 1 && segments.back ()->seqnum > commit_seqnum) {
+        close_segment (segments.back ());
+        segments.pop_back ();
+    }
+
+    //  Erase the uncommitted records, including a possible 'next' marker,
+    //  so that the segment is terminated properly.
+    segment_t *segment = segments.back ();
+    size_t pos = commit_pos;
+    if (segment->seqnum != commit_seqnum || pos < file_header_size)
+        pos = file_header_size;
+    size_t end = segment->wpos + record_header_size;
+    if (end > segment->size)
+        end = segment->size;
+    memset (segment->data + pos, 0, end - pos);
+    segment->wpos = pos;
+
+    stored -= uncommitted_bytes;
+    uncommitted_bytes = 0;
+    uncommitted_parts = 0;
+
+    sync.unlock ();
+}
+
+bool zmq::spill_t::finish ()
+{
+    zmq_assert (!uncommitted_parts);
+
+    sync.lock ();
+    if (segments.empty ())
+        open_segment (spill_segment_size, true);
+    unsigned char *record = append (0);
+    put_uint32 (record + 4, 0);
+    record [0] = finish_marker;
+    sync.unlock ();
+
+    return commit ();
+}
+
+void zmq::spill_t::clear ()
+{
+    sync.lock ();
+    while (!segments.empty ()) {
+        close_segment (segments.front ());
+        segments.pop_front ();
+    }
+    commit_seqnum = next_seqnum;
+    commit_pos = 0;
+    stored = 0;
+    uncommitted_bytes = 0;
+    uncommitted_parts = 0;
+    reader_asleep = false;
+    sync.unlock ();
+}
+
+bool zmq::spill_t::check_read ()
+{
+    sync.lock ();
+    unsigned char marker = next_record ();
+    if (marker == empty_marker)
+        reader_asleep = true;
+    sync.unlock ();
+    return marker == record_marker;
+}
+
+bool zmq::spill_t::read (msg_t *msg_)
+{
+    sync.lock ();
+
+    unsigned char marker = next_record ();
+    if (marker != record_marker) {
+        if (marker == empty_marker)
+            reader_asleep = true;
+        sync.unlock ();
+        return false;
+    }
+
+    segment_t *segment = segments.front ();
+    const unsigned char *record = segment->data + segment->rpos;
+    size_t size = get_uint32 (record + 4);
+
+    int rc = msg_->init_size (size);
+    errno_assert (rc == 0);
+    memcpy (msg_->data (), record + record_header_size, size);
+    msg_->set_flags (record [1]);
+    segment->rpos += record_header_size + size;
+    stored -= size;
+
+    sync.unlock ();
+    return true;
+}
+
+bool zmq::spill_t::read_finish ()
+{
+    sync.lock ();
+
+    if (next_record () != finish_marker) {
+        sync.unlock ();
+        return false;
+    }
+
+    segment_t *segment = segments.front ();
+    segment->rpos += record_header_size;
+
+    //  If everything was consumed, rewind the segment so that it can be
+    //  reused rather than creating a new file for the next overflow.
+    if (segments.size () == 1 && segment->rpos == segment->wpos &&
+          !uncommitted_parts) {
+        memset (segment->data + file_header_size, 0,
+            segment->wpos - file_header_size);
+        segment->wpos = file_header_size;
+        segment->rpos = file_header_size;
+        commit_seqnum = segment->seqnum;
+        commit_pos = file_header_size;
+    }
+
+    sync.unlock ();
+    return true;
+}
+
+unsigned char zmq::spill_t::next_record ()
+{
+    while (!segments.empty ()) {
+        segment_t *segment = segments.front ();
+
+        //  Stop at the end of the committed data.
+        if (segment->seqnum == commit_seqnum && segment->rpos >= commit_pos)
+            return empty_marker;
+
+        unsigned char marker = segment->data [segment->rpos];
+        if (marker != next_marker)
+            return marker;
+
+        //  The data continue in the next segment. This one is not needed
+        //  any more.
+        close_segment (segment);
+        segments.pop_front ();
+    }
+    return empty_marker;
+}
+
+unsigned char *zmq::spill_t::append (size_t size_)
+{
+    size_t needed = record_header_size + size_;
+
+    //  If the record doesn't fit into the current segment, mark the end of
+    //  the segment and continue in a new one. Space for the 'next' marker
+    //  is always kept available.
+    segment_t *segment = segments.back ();
+    if (segment->wpos + needed + record_header_size > segment->size) {
+        segment->data [segment->wpos] = next_marker;
+        seal_segment (segment);
+
+        size_t segment_size = file_header_size + needed + record_header_size;
+        if (segment_size < (size_t) spill_segment_size)
+            segment_size = spill_segment_size;
+
+        //  The message was already accepted, so if the file cannot be
+        //  created keep the data in memory rather than losing them.
+        segment = open_segment (segment_size, true);
+    }
+
+    unsigned char *record = segment->data + segment->wpos;
+    record [1] = 0;
+    record [2] = 0;
+    record [3] = 0;
+    segment->wpos += needed;
+    return record;
+}
+
+zmq::spill_t::segment_t *zmq::spill_t::open_segment (size_t size_,
+    bool fallback_)
+{
+    segment_t *segment = new (std::nothrow) segment_t;
+    alloc_assert (segment);
+    segment->seqnum = next_seqnum;
+    segment->fd = -1;
+    segment->data = NULL;
+    segment->size = size_;
+    segment->wpos = file_header_size;
+    segment->rpos = file_header_size;
+
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+    std::ostringstream name;
+    name << path << "/zmq-spill-" << getpid () << "-" << (void*) this <<
+        "-" << next_seqnum << ".seg";
+    segment->name = name.str ();
+
+    //  The segment is fully initialised under a temporary name so that a
+    //  file with the final name is always a valid segment.
+    std::string tmp_name = segment->name + ".tmp";
+    int fd = open (tmp_name.c_str (), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1) {
+        void *data = MAP_FAILED;
+        if (ftruncate (fd, (off_t) size_) == 0)
+            data = mmap (NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+        if (data != MAP_FAILED) {
+            segment->data = (unsigned char*) data;
+            memcpy (segment->data, "ZMQSPILL", 8);
+            put_uint32 (segment->data + 8, 1);
+            put_uint32 (segment->data + 12, (uint32_t) next_seqnum);
+            if (rename (tmp_name.c_str (), segment->name.c_str ()) == 0)
+                segment->fd = fd;
+            else {
+                int rc = munmap (data, size_);
+                errno_assert (rc == 0);
+                segment->data = NULL;
+            }
+        }
+        if (segment->fd == -1) {
+            int rc = ::close (fd);
+            errno_assert (rc == 0);
+            unlink (tmp_name.c_str ());
+        }
+    }
+#endif
+
+    if (!segment->data) {
+        if (!fallback_) {
+            delete segment;
+            return NULL;
+        }
+        segment->name.clear ();
+        segment->data = (unsigned char*) calloc (size_, 1);
+        alloc_assert (segment->data);
+    }
+
+    next_seqnum++;
+    segments.push_back (segment);
+    return segment;
+}
+
+void zmq::spill_t::close_segment (segment_t *segment_)
+{
+    if (segment_->fd == -1)
+        free (segment_->data);
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+    else {
+        int rc = munmap (segment_->data, segment_->size);
+        errno_assert (rc == 0);
+        rc = ::close (segment_->fd);
+        errno_assert (rc == 0);
+        unlink (segment_->name.c_str ());
+    }
+#endif
+    delete segment_;
+}
+
+void zmq::spill_t::seal_segment (segment_t *segment_)
+{
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+    if (segment_->fd != -1) {
+        int rc = msync (segment_->data, segment_->size, MS_ASYNC);
+        errno_assert (rc == 0);
+    }
+#else
+    (void) segment_;
+#endif
+}
@@ -0,0 +1,189 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_SPILL_HPP_INCLUDED__
+#define __ZMQ_SPILL_HPP_INCLUDED__
+
+#include <deque>
+#include <string>
+#include <stddef.h>
+
+#include "msg.hpp"
+#include "mutex.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Overflow store for messages that don't fit into the pipe because
+    //  the high watermark was reached. The writer end of the pipe appends
+    //  the messages to a sequence of memory-mapped segment files and the
+    //  reader end of the pipe reads them back in the same order. Each
+    //  segment file starts with a small header and contains records of
+    //  the following form:
+    //
+    //      marker (1 byte), flags (1 byte), reserved (2 bytes),
+    //      size (4 bytes, network order), data (size bytes)
+    //
+    //  The marker is written last so that a partially written record is
+    //  never visible. Zero marker means there are no more data yet, 'next'
+    //  marker means the data continue in the next segment and 'finish'
+    //  marker means the reader should resume reading from the pipe.
+    //  Segments are created under a temporary name and renamed once
+    //  initialised, segments are msync'ed when sealed and unlinked as soon
+    //  as they are consumed.
+    //
+    //  Spill is accessed from both the writer and the reader thread and is
+    //  thus guarded by a mutex. It is only used when the pipe overflows so
+    //  the locking doesn't affect the common case.
+
+    class spill_t
+    {
+    public:
+
+        //  Maxsize is the limit on the number of payload bytes stored,
+        //  -1 means no limit.
+        spill_t (const std::string &path_, int64_t maxsize_);
+        ~spill_t ();
+
+        //  Following functions are called from the writer thread.
+
+        //  Checks whether a new message can be spilled.
+        bool check_write ();
+
+        //  Returns true if a message was started but not committed yet.
+        bool incomplete ();
+
+        //  Stores the message part. The message is closed and re-initialised
+        //  to an empty message afterwards.
+        void write (msg_t *msg_);
+
+        //  Makes the parts written so far available to the reader. Returns
+        //  false if the reader is asleep and has to be woken up.
+        bool commit ();
+
+        //  Drops the parts written since the last commit.
+        void rollback ();
+
+        //  Marks the end of the spilled sequence; the reader will resume
+        //  reading from the pipe afterwards. Returns false if the reader
+        //  is asleep and has to be woken up.
+        bool finish ();
+
+        //  Drops all the stored data.
+        void clear ();
+
+        //  Following functions are called from the reader thread.
+
+        //  Returns true if there's a message part to read.
+        bool check_read ();
+
+        //  Reads the next message part. Returns false if there's none.
+        bool read (msg_t *msg_);
+
+        //  Returns true if the end of the spilled sequence was reached.
+        //  The end marker is consumed.
+        bool read_finish ();
+
+    private:
+
+        enum
+        {
+            //  Size of the header at the beginning of each segment file.
+            file_header_size = 16,
+
+            //  Size of the header preceding each message part.
+            record_header_size = 8,
+
+            //  Values of the record marker.
+            empty_marker = 0,
+            record_marker = 1,
+            next_marker = 2,
+            finish_marker = 3
+        };
+
+        struct segment_t
+        {
+            uint64_t seqnum;
+            std::string name;
+            int fd;
+            unsigned char *data;
+            size_t size;
+            size_t wpos;
+            size_t rpos;
+        };
+
+        //  Returns the marker of the next committed record, skipping and
+        //  releasing the fully read segments. If there's no committed
+        //  record, empty_marker is returned.
+        unsigned char next_record ();
+
+        //  Reserves space for a record with 'size_' bytes of payload at
+        //  the end of the last segment, creating a new segment if needed.
+        unsigned char *append (size_t size_);
+
+        //  Creates a new segment at the end of the list. If the file cannot
+        //  be created and 'fallback_' is true, an anonymous in-memory
+        //  segment is used instead. Otherwise NULL is returned.
+        segment_t *open_segment (size_t size_, bool fallback_);
+
+        //  Unmaps and unlinks the segment.
+        void close_segment (segment_t *segment_);
+
+        //  Schedules the data in the segment to be written to the disk.
+        void seal_segment (segment_t *segment_);
+
+        //  Directory to store the segment files in.
+        std::string path;
+
+        //  Maximum number of payload bytes to store, -1 if unlimited.
+        int64_t maxsize;
+
+        //  Segments ordered from the oldest (read from) to the newest
+        //  (written to).
+        std::deque <segment_t*> segments;
+
+        //  Sequence number of the next segment to create.
+        uint64_t next_seqnum;
+
+        //  Position of the end of the last committed record.
+        uint64_t commit_seqnum;
+        size_t commit_pos;
+
+        //  Number of payload bytes currently stored.
+        int64_t stored;
+
+        //  Number of parts and payload bytes written since the last commit.
+        uint64_t uncommitted_parts;
+        int64_t uncommitted_bytes;
+
+        //  True if the reader found no data and went asleep.
+        bool reader_asleep;
+
+        //  Synchronises access from the writer and the reader thread.
+        mutex_t sync;
+
+        spill_t (const spill_t&);
+        const spill_t &operator = (const spill_t&);
+    };
+
+}
+
+#endif
@@ -29,9 +29,15 @@
 #include <netdb.h>
 #include <fcntl.h>
 #endif
+#if defined ZMQ_HAVE_MEMFD
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
 
 #include <string.h>
 #include <new>
+#include <algorithm>
 #include <sstream>
 
 #include "stream_engine.hpp"
@@ -47,12 +53,31 @@
 #include "curve_server.hpp"
 #include "raw_decoder.hpp"
 #include "raw_encoder.hpp"
+#include "crypto_pool.hpp"
+#include "ctx.hpp"
 #include "config.hpp"
+#include "clock.hpp"
 #include "err.hpp"
 #include "ip.hpp"
 #include "likely.hpp"
 #include "wire.hpp"
 
+#if defined ZMQ_HAVE_MEMFD
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 1U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 2U
+#endif
+
+//  Releases the body of a received bulk frame.
+static void unmap_bulk (void *data_, void *hint_)
+{
+    int rc = munmap (data_, (size_t) hint_);
+    errno_assert (rc == 0);
+}
+#endif
+
 zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_, 
                                        const std::string &endpoint_) :
     s (fd_),
@@ -62,6 +87,14 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     outpos (NULL),
     outsize (0),
     encoder (NULL),
+    in_buffer_size (options_.in_batch_size),
+    out_buffer_size (options_.out_batch_size),
+    encoder_buffer_size (options_.out_batch_size),
+    small_reads (0),
+    small_writes (0),
+    output_held (false),
+    held_since (0),
+    coalesce_due (false),
     handshaking (true),
     greeting_size (v2_greeting_size),
     greeting_bytes_read (0),
@@ -75,9 +108,27 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     io_error (false),
     subscription_required (false),
     mechanism (NULL),
+    crypto_pool (NULL),
+    tx_batch (NULL),
+    tx_batch_pos (0),
+    tx_batch_size (0),
+    rx_batch (NULL),
+    rx_batch_pos (0),
+    rx_batch_size (0),
+    rx_batch_decoded (false),
     input_stopped (false),
     output_stopped (false),
-    socket (NULL)
+    socket (NULL),
+    handshake_start (0),
+    unix_socket (false),
+    bulk_threshold (0),
+    has_heartbeat_timer (false),
+    has_timeout_timer (false),
+    has_ttl_timer (false),
+    has_coalesce_timer (false),
+    ping_pending (false),
+    pong_pending (false),
+    pong_context_size (0)
 {
     int rc = tx_msg.init ();
     errno_assert (rc == 0);
@@ -114,6 +165,14 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     }
 #endif
 
+#if defined ZMQ_HAVE_MEMFD
+    //  Frames can be passed as file descriptors over UNIX domain sockets.
+    struct sockaddr_storage ss;
+    socklen_t ss_len = sizeof ss;
+    unix_socket = getsockname (s, (struct sockaddr*) &ss, &ss_len) == 0 &&
+        ss.ss_family == AF_UNIX;
+#endif
+
 #ifdef SO_NOSIGPIPE
     //  Make sure that SIGPIPE signal is not generated when writing to a
     //  connection that was already closed by the peer.
@@ -141,6 +200,34 @@ zmq::stream_engine_t::~stream_engine_t ()
     int rc = tx_msg.close ();
     errno_assert (rc == 0);
 
+    //  Close the descriptors of the bulk frames that didn't make it.
+    while (!tx_fds.empty ()) {
+        rc = close (tx_fds.front ());
+        errno_assert (rc == 0);
+        tx_fds.pop_front ();
+    }
+    while (!rx_fds.empty ()) {
+        rc = close (rx_fds.front ());
+        errno_assert (rc == 0);
+        rx_fds.pop_front ();
+    }
+
+    //  Drop the messages still held in the crypto batches.
+    if (tx_batch) {
+        for (int i = 0; i != crypto_batch_size; i++) {
+            rc = tx_batch [i].close ();
+            errno_assert (rc == 0);
+        }
+        delete [] tx_batch;
+    }
+    if (rx_batch) {
+        for (int i = 0; i != crypto_batch_size; i++) {
+            rc = rx_batch [i].close ();
+            errno_assert (rc == 0);
+        }
+        delete [] rx_batch;
+    }
+
     delete encoder;
     delete decoder;
     delete mechanism;
@@ -165,10 +252,10 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
 
     if (options.raw_sock) {
         // no handshaking for raw sock, instantiate raw encoder and decoders
-        encoder = new (std::nothrow) raw_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) raw_encoder_t (out_buffer_size);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) raw_decoder_t (in_batch_size);
+        decoder = new (std::nothrow) raw_decoder_t (in_buffer_size);
         alloc_assert (decoder);
 
         // disable handshaking for raw socket
@@ -178,6 +265,8 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
         write_msg = &stream_engine_t::push_msg_to_session;
     }
     else {
+        handshake_start = clock_t::now_us ();
+
         //  Send the 'length' and 'flags' fields of the identity message.
         //  The 'length' field is encoded in the long format.
         outpos = greeting_send;
@@ -198,6 +287,24 @@ void zmq::stream_engine_t::unplug ()
     zmq_assert (plugged);
     plugged = false;
 
+    //  Cancel all timers.
+    if (has_heartbeat_timer) {
+        cancel_timer (heartbeat_ivl_timer_id);
+        has_heartbeat_timer = false;
+    }
+    if (has_timeout_timer) {
+        cancel_timer (heartbeat_timeout_timer_id);
+        has_timeout_timer = false;
+    }
+    if (has_ttl_timer) {
+        cancel_timer (heartbeat_ttl_timer_id);
+        has_ttl_timer = false;
+    }
+    if (has_coalesce_timer) {
+        cancel_timer (coalesce_timer_id);
+        has_coalesce_timer = false;
+    }
+
     //  Cancel all fd subscriptions.
     if (!io_error)
         rm_fd (handle);
@@ -215,6 +322,13 @@ void zmq::stream_engine_t::terminate ()
         terminating = true;
         return;
     }
+
+    //  Data held back are written out before the engine goes away.
+    if (!terminating && output_held && !io_error) {
+        terminating = true;
+        out_event ();
+        return;
+    }
     unplug ();
     delete this;
 }
@@ -244,6 +358,8 @@ void zmq::stream_engine_t::in_event ()
         //  Note that buffer can be arbitrarily large. However, we assume
         //  the underlying TCP layer has fixed buffer size and thus the
         //  number of bytes read will be always limited.
+        if (options.adaptive_batch)
+            decoder->resize_buffer (in_buffer_size);
         size_t bufsize = 0;
         decoder->get_buffer (&inpos, &bufsize);
 
@@ -260,6 +376,21 @@ void zmq::stream_engine_t::in_event ()
 
         //  Adjust input size
         insize = static_cast <size_t> (rc);
+
+        //  Reads straight into a large message say nothing about the buffer.
+        if (options.adaptive_batch && bufsize == in_buffer_size)
+            adapt_buffer_size (in_buffer_size, small_reads, insize,
+                options.in_batch_size);
+
+        //  Any data from the peer shows it's alive.
+        if (unlikely (has_timeout_timer)) {
+            cancel_timer (heartbeat_timeout_timer_id);
+            has_timeout_timer = false;
+        }
+        if (unlikely (has_ttl_timer)) {
+            cancel_timer (heartbeat_ttl_timer_id);
+            has_ttl_timer = false;
+        }
     }
 
     int rc = 0;
@@ -277,6 +408,10 @@ void zmq::stream_engine_t::in_event ()
             break;
     }
 
+    //  Pass the messages collected for batch decoding on.
+    if (rc != -1 && rx_batch)
+        rc = push_rx_batch ();
+
     //  Tear down the connection if we have failed to decode input data
     //  or the session has rejected the message.
     if (rc == -1) {
@@ -296,7 +431,8 @@ void zmq::stream_engine_t::out_event ()
     zmq_assert (!io_error);
 
     //  If write buffer is empty, try to read new data from the encoder.
-    if (!outsize) {
+    //  Data held back are topped up with the new messages.
+    if (!outsize || output_held) {
 
         //  Even when we stop polling as soon as there is no
         //  data to send, the poller may invoke out_event one
@@ -306,15 +442,30 @@ void zmq::stream_engine_t::out_event ()
             return;
         }
 
-        outpos = NULL;
-        outsize = encoder->encode (&outpos, 0);
+        //  Data are only held back once the handshake is over, so that
+        //  handshake commands encoded by this call go out right away.
+        const bool coalesce = options.coalesce_ivl > 0 && !handshaking &&
+            (!mechanism || mechanism->is_handshake_complete ());
+
+        if (!outsize) {
+            if (options.adaptive_batch) {
+                encoder->resize_buffer (out_buffer_size);
+                encoder_buffer_size = out_buffer_size;
+            }
+
+            outpos = NULL;
+            outsize = encoder->encode (&outpos, 0);
+        }
 
-        while (outsize < out_batch_size) {
+        //  Data are only ever added within the encoder's own buffer; a
+        //  chunk filling it may be a message body passed zero-copy.
+        while (outsize < encoder_buffer_size) {
             if ((this->*read_msg) (&tx_msg) == -1)
                 break;
             encoder->load_msg (&tx_msg);
             unsigned char *bufptr = outpos + outsize;
-            size_t n = encoder->encode (&bufptr, out_batch_size - outsize);
+            size_t n = encoder->encode (&bufptr,
+                encoder_buffer_size - outsize);
             zmq_assert (n > 0);
             if (outpos == NULL)
                 outpos = bufptr;
@@ -327,6 +478,15 @@ void zmq::stream_engine_t::out_event ()
             reset_pollout (handle);
             return;
         }
+
+        if (coalesce && hold_output ())
+            return;
+
+        //  The buffer size follows the batches actually written, so it
+        //  doesn't change under the data held back.
+        if (options.adaptive_batch)
+            adapt_buffer_size (out_buffer_size, small_writes, outsize,
+                options.out_batch_size);
     }
 
     //  If there are any data to write in write buffer, write as much as
@@ -360,6 +520,111 @@ void zmq::stream_engine_t::out_event ()
             terminate ();
 }
 
+bool zmq::stream_engine_t::hold_output ()
+{
+    const size_t coalesce_size =
+        options.coalesce_size > 0 &&
+            (size_t) options.coalesce_size < out_buffer_size ?
+        (size_t) options.coalesce_size : out_buffer_size;
+    const uint64_t now = clock_t::now_us ();
+    if (!output_held)
+        held_since = now;
+
+    //  Hold the data back unless there's enough of them already or they
+    //  have waited long enough. A full buffer, or a message body passed
+    //  zero-copy, can't be topped up and goes out right away.
+    if (!terminating && !coalesce_due &&
+          outsize < coalesce_size && outsize < encoder_buffer_size &&
+          now - held_since < (uint64_t) options.coalesce_ivl) {
+        if (!output_held) {
+            output_held = true;
+            reset_pollout (handle);
+
+            //  Timers are in milliseconds; round the deadline up.
+            add_timer ((options.coalesce_ivl + 999) / 1000,
+                coalesce_timer_id);
+            has_coalesce_timer = true;
+        }
+        return true;
+    }
+
+    if (output_held) {
+        output_held = false;
+        set_pollout (handle);
+    }
+    if (has_coalesce_timer) {
+        cancel_timer (coalesce_timer_id);
+        has_coalesce_timer = false;
+    }
+    coalesce_due = false;
+    return false;
+}
+
+void zmq::stream_engine_t::adapt_buffer_size (size_t &size_,
+    int &small_ops_, size_t used_, size_t min_size_)
+{
+    //  A full buffer means there's more data waiting; double the size.
+    if (used_ >= size_) {
+        small_ops_ = 0;
+        if (size_ < adaptive_batch_max)
+            size_ = std::min (size_ * 2, (size_t) adaptive_batch_max);
+        return;
+    }
+
+    //  After a run of mostly empty buffers, halve the size.
+    if (used_ < size_ / 4 && size_ > min_size_) {
+        if (++small_ops_ == adaptive_batch_shrink_after) {
+            small_ops_ = 0;
+            size_ = std::max (size_ / 2, min_size_);
+        }
+        return;
+    }
+
+    small_ops_ = 0;
+}
+
+void zmq::stream_engine_t::timer_event (int id_)
+{
+    if (id_ == heartbeat_ivl_timer_id) {
+        add_timer (options.heartbeat_interval, heartbeat_ivl_timer_id);
+        ping_pending = true;
+        if (!has_timeout_timer && options.heartbeat_timeout != 0) {
+            add_timer (options.heartbeat_timeout == -1 ?
+                options.heartbeat_interval : options.heartbeat_timeout,
+                heartbeat_timeout_timer_id);
+            has_timeout_timer = true;
+        }
+        schedule_heartbeat ();
+    }
+    else
+    if (id_ == heartbeat_timeout_timer_id || id_ == heartbeat_ttl_timer_id) {
+        if (id_ == heartbeat_timeout_timer_id)
+            has_timeout_timer = false;
+        else
+            has_ttl_timer = false;
+
+        //  While the input is stopped, the answer may be sitting unread
+        //  in the socket; wait for the next heartbeat instead.
+        if (input_stopped)
+            return;
+
+        //  The session is gone already if the engine is lingering.
+        if (terminating)
+            terminate ();
+        else
+            error (true);
+    }
+    else
+    if (id_ == coalesce_timer_id) {
+        has_coalesce_timer = false;
+        coalesce_due = true;
+        if (!io_error)
+            out_event ();
+    }
+    else
+        zmq_assert (false);
+}
+
 void zmq::stream_engine_t::restart_output ()
 {
     if (unlikely (io_error))
@@ -383,7 +648,9 @@ void zmq::stream_engine_t::restart_input ()
     zmq_assert (session != NULL);
     zmq_assert (decoder != NULL);
 
-    int rc = (this->*write_msg) (decoder->msg ());
+    //  In batch mode the stalled message is held in the batch.
+    int rc = rx_batch ? push_rx_batch () :
+        (this->*write_msg) (decoder->msg ());
     if (rc == -1) {
         if (errno == EAGAIN)
             session->flush ();
@@ -405,6 +672,9 @@ void zmq::stream_engine_t::restart_input ()
             break;
     }
 
+    if (rc != -1 && rx_batch)
+        rc = push_rx_batch ();
+
     if (rc == -1 && errno == EAGAIN)
         session->flush ();
     else
@@ -503,10 +773,10 @@ bool zmq::stream_engine_t::handshake ()
     //  Is the peer using ZMTP/1.0 with no revision number?
     //  If so, we send and receive rest of identity message
     if (greeting_recv [0] != 0xff || !(greeting_recv [9] & 0x01)) {
-        encoder = new (std::nothrow) v1_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v1_encoder_t (out_buffer_size);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) v1_decoder_t (in_batch_size, options.maxmsgsize);
+        decoder = new (std::nothrow) v1_decoder_t (in_buffer_size, options.maxmsgsize);
         alloc_assert (decoder);
 
         //  We have already sent the message header.
@@ -545,34 +815,39 @@ bool zmq::stream_engine_t::handshake ()
     else
     if (greeting_recv [revision_pos] == ZMTP_1_0) {
         encoder = new (std::nothrow) v1_encoder_t (
-            out_batch_size);
+            out_buffer_size);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v1_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_buffer_size, options.maxmsgsize);
         alloc_assert (decoder);
     }
     else
     if (greeting_recv [revision_pos] == ZMTP_2_0) {
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (out_buffer_size);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_buffer_size, options.maxmsgsize);
         alloc_assert (decoder);
     }
     else {
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (out_buffer_size);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_buffer_size, options.maxmsgsize);
         alloc_assert (decoder);
 
         if (memcmp (greeting_recv + 12, "NULL\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
             mechanism = new (std::nothrow)
                 null_mechanism_t (session, peer_address, options);
             alloc_assert (mechanism);
+#if defined ZMQ_HAVE_MEMFD
+            //  Without encryption, bodies can bypass the socket.
+            if (unix_socket)
+                mechanism->offer_bulk ();
+#endif
         }
         else
         if (memcmp (greeting_recv + 12, "PLAIN\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
@@ -687,6 +962,10 @@ void zmq::stream_engine_t::zap_msg_available ()
 
 void zmq::stream_engine_t::mechanism_ready ()
 {
+    if (socket->is_monitored (ZMQ_EVENT_HANDSHAKE_SUCCEEDED))
+        socket->event_handshake_succeeded (endpoint,
+            (int) (clock_t::now_us () - handshake_start));
+
     if (options.recv_identity) {
         msg_t identity;
         mechanism->peer_identity (&identity);
@@ -703,6 +982,35 @@ void zmq::stream_engine_t::mechanism_ready ()
 
     read_msg = &stream_engine_t::pull_and_encode;
     write_msg = &stream_engine_t::decode_and_push;
+
+#if defined ZMQ_HAVE_MEMFD
+    if (options.ipc_bulk_threshold > 0 && mechanism->bulk_agreed ())
+        bulk_threshold = options.ipc_bulk_threshold;
+#endif
+
+    if (options.heartbeat_interval > 0) {
+        add_timer (options.heartbeat_interval, heartbeat_ivl_timer_id);
+        has_heartbeat_timer = true;
+    }
+
+    //  If there are crypto workers and the mechanism can make use of them,
+    //  messages are encoded and decoded in batches.
+    if (mechanism->batch_capable ())
+        crypto_pool = session->get_ctx ()->get_crypto_pool ();
+    if (crypto_pool) {
+        tx_batch = new (std::nothrow) msg_t [crypto_batch_size];
+        alloc_assert (tx_batch);
+        rx_batch = new (std::nothrow) msg_t [crypto_batch_size];
+        alloc_assert (rx_batch);
+        for (int i = 0; i != crypto_batch_size; i++) {
+            int rc = tx_batch [i].init ();
+            errno_assert (rc == 0);
+            rc = rx_batch [i].init ();
+            errno_assert (rc == 0);
+        }
+        read_msg = &stream_engine_t::pull_and_encode_batch;
+        write_msg = &stream_engine_t::queue_for_decode;
+    }
 }
 
 int zmq::stream_engine_t::pull_msg_from_session (msg_t *msg_)
@@ -719,10 +1027,22 @@ int zmq::stream_engine_t::pull_and_encode (msg_t *msg_)
 {
     zmq_assert (mechanism != NULL);
 
+#if defined ZMQ_HAVE_MEMFD
+    //  Descriptors must not trail their frames. Encode no more bulk
+    //  frames than the next write can carry the descriptors of.
+    if (unlikely (tx_fds.size () == ipc_bulk_max_fds)) {
+        errno = EAGAIN;
+        return -1;
+    }
+#endif
     if (session->pull_msg (msg_) == -1)
         return -1;
     if (mechanism->encode (msg_) == -1)
         return -1;
+#if defined ZMQ_HAVE_MEMFD
+    if (bulk_threshold && msg_->size () >= bulk_threshold)
+        send_bulk (msg_);
+#endif
     return 0;
 }
 
@@ -732,6 +1052,20 @@ int zmq::stream_engine_t::decode_and_push (msg_t *msg_)
 
     if (mechanism->decode (msg_) == -1)
         return -1;
+    if (unlikely (msg_->flags () & msg_t::command))
+        return process_heartbeat_command (msg_);
+    if (unlikely (msg_->flags () & msg_t::bulk)) {
+        //  Unless bulk frames were agreed on, the flag is reserved
+        //  and thus ignored.
+#if defined ZMQ_HAVE_MEMFD
+        if (mechanism->bulk_agreed ()) {
+            if (receive_bulk (msg_) == -1)
+                return -1;
+        }
+        else
+#endif
+            msg_->reset_flags (msg_t::bulk);
+    }
     if (session->push_msg (msg_) == -1) {
         if (errno == EAGAIN)
             write_msg = &stream_engine_t::push_one_then_decode_and_push;
@@ -748,6 +1082,153 @@ int zmq::stream_engine_t::push_one_then_decode_and_push (msg_t *msg_)
     return rc;
 }
 
+#if defined ZMQ_HAVE_MEMFD
+void zmq::stream_engine_t::send_bulk (msg_t *msg_)
+{
+    const fd_t fd = syscall (SYS_memfd_create, "zmq-bulk",
+        MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        return;
+
+    const unsigned char *data = (const unsigned char*) msg_->data ();
+    const size_t size = msg_->size ();
+    size_t written = 0;
+    while (written < size) {
+        const ssize_t n = ::write (fd, data + written, size - written);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            //  Out of memory for the memfd; send the frame in band.
+            int rc = close (fd);
+            errno_assert (rc == 0);
+            return;
+        }
+        written += n;
+    }
+
+    int rc;
+#ifdef F_ADD_SEALS
+    //  The receiver maps the memfd; make sure it can't be pulled away.
+    rc = fcntl (fd, F_ADD_SEALS,
+        F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    errno_assert (rc == 0);
+#endif
+    tx_fds.push_back (fd);
+
+    const unsigned char flags = msg_->flags () & msg_t::more;
+    rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init_size (8);
+    errno_assert (rc == 0);
+    put_uint64 ((unsigned char*) msg_->data (), size);
+    msg_->set_flags (flags | msg_t::bulk);
+}
+
+int zmq::stream_engine_t::receive_bulk (msg_t *msg_)
+{
+    if (msg_->size () != 8 || rx_fds.empty ()) {
+        errno = EPROTO;
+        return -1;
+    }
+    const uint64_t size = get_uint64 ((const unsigned char*) msg_->data ());
+    const fd_t fd = rx_fds.front ();
+    rx_fds.pop_front ();
+
+    //  The memfd must hold the whole body and be sealed against shrinking,
+    //  lest accessing the mapping fault later on.
+    struct stat st;
+    bool valid = size > 0 && size <= (uint64_t) SIZE_MAX &&
+        (options.maxmsgsize < 0 || size <= (uint64_t) options.maxmsgsize) &&
+        fstat (fd, &st) == 0 && (uint64_t) st.st_size >= size;
+#ifdef F_GET_SEALS
+    valid = valid && (fcntl (fd, F_GET_SEALS) & F_SEAL_SHRINK);
+#endif
+    void *data = MAP_FAILED;
+    if (valid)
+        data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    int rc = close (fd);
+    errno_assert (rc == 0);
+    if (data == MAP_FAILED) {
+        errno = valid ? ENOMEM : EPROTO;
+        return -1;
+    }
+
+    const unsigned char flags = msg_->flags () & msg_t::more;
+    rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init_data (data, size, unmap_bulk, (void*) (size_t) size);
+    errno_assert (rc == 0);
+    msg_->set_flags (flags);
+    return 0;
+}
+#endif
+
+int zmq::stream_engine_t::pull_and_encode_batch (msg_t *msg_)
+{
+    zmq_assert (mechanism != NULL);
+
+    //  Once the batch is used up, pull as many messages as are available
+    //  and encode them all at once. The nonces are assigned in order.
+    if (tx_batch_pos == tx_batch_size) {
+        tx_batch_pos = 0;
+        tx_batch_size = 0;
+        while (tx_batch_size < crypto_batch_size &&
+              session->pull_msg (&tx_batch [tx_batch_size]) == 0)
+            tx_batch_size++;
+        if (tx_batch_size == 0)
+            return -1;
+        if (mechanism->encode_batch (tx_batch, tx_batch_size,
+              crypto_pool) == -1)
+            return -1;
+    }
+
+    const int rc = msg_->move (tx_batch [tx_batch_pos++]);
+    errno_assert (rc == 0);
+    return 0;
+}
+
+int zmq::stream_engine_t::queue_for_decode (msg_t *msg_)
+{
+    zmq_assert (rx_batch_size < crypto_batch_size);
+
+    const int rc = rx_batch [rx_batch_size++].move (*msg_);
+    errno_assert (rc == 0);
+    if (rx_batch_size == crypto_batch_size)
+        return push_rx_batch ();
+    return 0;
+}
+
+int zmq::stream_engine_t::push_rx_batch ()
+{
+    zmq_assert (mechanism != NULL);
+
+    if (!rx_batch_decoded) {
+        if (mechanism->decode_batch (rx_batch, rx_batch_size,
+              crypto_pool) == -1)
+            return -1;
+        rx_batch_decoded = true;
+    }
+
+    //  Messages are pushed in the order they were received. If the
+    //  session cannot take more, the rest waits for restart_input.
+    while (rx_batch_pos < rx_batch_size) {
+        msg_t *msg = &rx_batch [rx_batch_pos];
+        if (unlikely (msg->flags () & msg_t::command)) {
+            if (process_heartbeat_command (msg) == -1)
+                return -1;
+        }
+        else
+        if (session->push_msg (msg) == -1)
+            return -1;
+        rx_batch_pos++;
+    }
+
+    rx_batch_pos = 0;
+    rx_batch_size = 0;
+    rx_batch_decoded = false;
+    return 0;
+}
+
 int zmq::stream_engine_t::write_subscription_msg (msg_t *msg_)
 {
     msg_t subscription;
@@ -765,12 +1246,89 @@ int zmq::stream_engine_t::write_subscription_msg (msg_t *msg_)
     return push_msg_to_session (msg_);
 }
 
-void zmq::stream_engine_t::error ()
+int zmq::stream_engine_t::produce_heartbeat (msg_t *msg_)
+{
+    zmq_assert (mechanism != NULL);
+
+    //  Messages encoded in a batch carry consecutive nonces;
+    //  the commands must not overtake them.
+    if (tx_batch && tx_batch_pos != tx_batch_size)
+        return pull_and_encode_batch (msg_);
+
+    int rc;
+    if (pong_pending) {
+        rc = msg_->init_size (5 + pong_context_size);
+        errno_assert (rc == 0);
+        unsigned char *data = (unsigned char*) msg_->data ();
+        memcpy (data, "\4PONG", 5);
+        memcpy (data + 5, pong_context, pong_context_size);
+        pong_pending = false;
+    }
+    else {
+        zmq_assert (ping_pending);
+        rc = msg_->init_size (7);
+        errno_assert (rc == 0);
+        unsigned char *data = (unsigned char*) msg_->data ();
+        memcpy (data, "\4PING", 5);
+        put_uint16 (data + 5, (uint16_t) (options.heartbeat_ttl / 100));
+        ping_pending = false;
+    }
+    msg_->set_flags (msg_t::command);
+
+    if (!ping_pending && !pong_pending) {
+        if (tx_batch)
+            read_msg = &stream_engine_t::pull_and_encode_batch;
+        else
+            read_msg = &stream_engine_t::pull_and_encode;
+    }
+
+    return mechanism->encode (msg_);
+}
+
+int zmq::stream_engine_t::process_heartbeat_command (msg_t *msg_)
+{
+    const unsigned char *data = (const unsigned char*) msg_->data ();
+    const size_t size = msg_->size ();
+
+    if (size >= 7 && memcmp (data, "\4PING", 5) == 0) {
+        //  The context is at most 16 bytes long.
+        if (size - 7 > sizeof pong_context) {
+            errno = EPROTO;
+            return -1;
+        }
+        pong_context_size = size - 7;
+        memcpy (pong_context, data + 7, pong_context_size);
+        pong_pending = true;
+
+        //  The peer wants us to drop it if it falls silent for that long.
+        const int ttl = get_uint16 (data + 5) * 100;
+        if (ttl > 0 && !has_ttl_timer) {
+            add_timer (ttl, heartbeat_ttl_timer_id);
+            has_ttl_timer = true;
+        }
+        schedule_heartbeat ();
+    }
+
+    //  PONGs only have to arrive, which they did. Other commands
+    //  are not known yet and are ignored.
+    return 0;
+}
+
+void zmq::stream_engine_t::schedule_heartbeat ()
+{
+    read_msg = &stream_engine_t::produce_heartbeat;
+    if (!io_error && output_stopped) {
+        set_pollout (handle);
+        output_stopped = false;
+    }
+}
+
+void zmq::stream_engine_t::error (bool timed_out_)
 {
     zmq_assert (session);
     socket->event_disconnected (endpoint, s);
     session->flush ();
-    session->engine_error ();
+    session->engine_error (timed_out_);
     unplug ();
     delete this;
 }
@@ -801,7 +1359,43 @@ int zmq::stream_engine_t::write (const void *data_, size_t size_)
 
 #else
 
-    ssize_t nbytes = send (s, data_, size_, 0);
+    ssize_t nbytes;
+#if defined ZMQ_HAVE_MEMFD
+    //  Descriptors of bulk frames go along with the first byte written
+    //  once they are queued, so they never trail their frames.
+    if (!tx_fds.empty ()) {
+        const size_t nfds = std::min (tx_fds.size (),
+            (size_t) ipc_bulk_max_fds);
+        union {
+            struct cmsghdr align;
+            unsigned char buf [CMSG_SPACE (sizeof (int) * ipc_bulk_max_fds)];
+        } control;
+        struct iovec iov = {const_cast <void*> (data_), size_};
+        struct msghdr hdr;
+        memset (&hdr, 0, sizeof hdr);
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = control.buf;
+        hdr.msg_controllen = CMSG_SPACE (sizeof (int) * nfds);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR (&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN (sizeof (int) * nfds);
+        int *fds = (int*) CMSG_DATA (cmsg);
+        for (size_t i = 0; i != nfds; i++)
+            fds [i] = tx_fds [i];
+
+        nbytes = sendmsg (s, &hdr, 0);
+        if (nbytes > 0)
+            for (size_t i = 0; i != nfds; i++) {
+                int rc = close (tx_fds.front ());
+                errno_assert (rc == 0);
+                tx_fds.pop_front ();
+            }
+    }
+    else
+#endif
+    nbytes = send (s, data_, size_, 0);
 
     //  Several errors are OK. When speculative write is being done we may not
     //  be able to write a single byte from the socket. Also, SIGSTOP issued
@@ -857,7 +1451,58 @@ int zmq::stream_engine_t::read (void *data_, size_t size_)
 
 #else
 
-    const ssize_t rc = recv (s, data_, size_, 0);
+    ssize_t rc;
+#if defined ZMQ_HAVE_MEMFD
+    //  Collect the descriptors of bulk frames the peer may pass along.
+    if (unix_socket) {
+        union {
+            struct cmsghdr align;
+            unsigned char buf [CMSG_SPACE (sizeof (int) * ipc_bulk_max_fds)];
+        } control;
+        struct iovec iov = {data_, size_};
+        struct msghdr hdr;
+        memset (&hdr, 0, sizeof hdr);
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = control.buf;
+        hdr.msg_controllen = sizeof control.buf;
+
+        rc = recvmsg (s, &hdr, MSG_CMSG_CLOEXEC);
+        if (rc > 0) {
+            //  Descriptors nobody asked for are closed right away.
+            const bool expected = mechanism && mechanism->bulk_expected ();
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (&hdr); cmsg;
+                  cmsg = CMSG_NXTHDR (&hdr, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET ||
+                      cmsg->cmsg_type != SCM_RIGHTS)
+                    continue;
+                const int *fds = (const int*) CMSG_DATA (cmsg);
+                const size_t nfds =
+                    (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+                for (size_t i = 0; i != nfds; i++) {
+                    if (expected)
+                        rx_fds.push_back (fds [i]);
+                    else {
+                        const int close_rc = close (fds [i]);
+                        errno_assert (close_rc == 0);
+                    }
+                }
+            }
+
+            //  Descriptors were lost, e.g. for lack of room in the
+            //  descriptor table; the frames can't be matched any more.
+            //  Nor does a peer pass more of them at a time than the frames
+            //  read so far and the next write can claim.
+            if ((hdr.msg_flags & MSG_CTRUNC)
+            ||  rx_fds.size () > 2 * ipc_bulk_max_fds) {
+                errno = EPROTO;
+                return -1;
+            }
+        }
+    }
+    else
+#endif
+    rc = recv (s, data_, size_, 0);
 
     //  Several errors are OK. When speculative read is being done we may not
     //  be able to read a single byte from the socket. Also, SIGSTOP issued
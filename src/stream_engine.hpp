@@ -21,6 +21,7 @@
 #define __ZMQ_STREAM_ENGINE_HPP_INCLUDED__
 
 #include <stddef.h>
+#include <deque>
 
 #include "fd.hpp"
 #include "i_engine.hpp"
@@ -44,6 +45,7 @@ namespace zmq
     class msg_t;
     class session_base_t;
     class mechanism_t;
+    class crypto_pool_t;
 
     //  This engine handles any socket with SOCK_STREAM semantics,
     //  e.g. TCP socket or an UNIX domain socket.
@@ -67,14 +69,16 @@ namespace zmq
         //  i_poll_events interface implementation.
         void in_event ();
         void out_event ();
+        void timer_event (int id_);
 
     private:
 
         //  Unplug the engine from the session.
         void unplug ();
 
-        //  Function to handle network disconnections.
-        void error ();
+        //  Function to handle network disconnections. 'timed_out_' is set
+        //  if the peer stopped responding to heartbeats.
+        void error (bool timed_out_ = false);
 
         //  Receives the greeting message from the peer.
         int receive_greeting ();
@@ -105,13 +109,47 @@ namespace zmq
         int decode_and_push (msg_t *msg_);
         int push_one_then_decode_and_push (msg_t *msg_);
 
+        //  Counterparts of the above used when the mechanism processes
+        //  messages in batches on the crypto workers.
+        int pull_and_encode_batch (msg_t *msg_);
+        int queue_for_decode (msg_t *msg_);
+        int push_rx_batch ();
+
         void mechanism_ready ();
 
         int write_subscription_msg (msg_t *msg_);
 
+        //  Produces the pending PING and PONG commands, then hands over
+        //  to the regular pull function.
+        int produce_heartbeat (msg_t *msg_);
+
+        //  Returns true if the encoded data are to be held back for more
+        //  to join them, false if they are to be written out now.
+        bool hold_output ();
+
+        //  Adjusts the buffer size after a read or write of used_ bytes.
+        //  The size doesn't drop below min_size_.
+        static void adapt_buffer_size (size_t &size_, int &small_ops_,
+            size_t used_, size_t min_size_);
+
+        //  Handles a command received after the handshake.
+        int process_heartbeat_command (msg_t *msg_);
+
+        //  Schedules the encoder to be polled for the pending commands.
+        void schedule_heartbeat ();
+
         size_t add_property (unsigned char *ptr,
             const char *name, const void *value, size_t value_len);
 
+        //  Moves the body of an outgoing frame into a memfd passed along
+        //  with the data written next, leaving only its size in the frame.
+        //  The frame is left alone if the memfd cannot be set up.
+        void send_bulk (msg_t *msg_);
+
+        //  Maps the memfd of a received bulk frame as the frame's body.
+        //  Returns -1 with errno set if the frame is malformed.
+        int receive_bulk (msg_t *msg_);
+
         //  Underlying socket.
         fd_t s;
 
@@ -130,6 +168,30 @@ namespace zmq
         size_t outsize;
         i_encoder *encoder;
 
+        //  Sizes of the decoder and encoder buffers. With ZMQ_ADAPTIVE_BATCH
+        //  they follow the traffic, starting from the configured sizes.
+        size_t in_buffer_size;
+        size_t out_buffer_size;
+
+        //  Size of the buffer the encoder was last given. Data held back
+        //  are topped up within it.
+        size_t encoder_buffer_size;
+
+        //  Numbers of reads and writes in a row that used less than
+        //  a quarter of the buffer.
+        int small_reads;
+        int small_writes;
+
+        //  True iff the encoded data are held back to be written along
+        //  with the following messages (ZMQ_COALESCE_IVL).
+        bool output_held;
+
+        //  Time the data have been held back since, in microseconds.
+        uint64_t held_since;
+
+        //  True once the held data are past their deadline.
+        bool coalesce_due;
+
         //  When true, we are still trying to determine whether
         //  the peer is using versioned protocol, and if so, which
         //  version.  When false, normal message flow has started.
@@ -177,6 +239,22 @@ namespace zmq
 
         mechanism_t *mechanism;
 
+        //  Crypto workers, NULL unless messages are processed in batches.
+        crypto_pool_t *crypto_pool;
+
+        //  Encoded messages waiting to be passed to the encoder.
+        msg_t *tx_batch;
+        int tx_batch_pos;
+        int tx_batch_size;
+
+        //  Received messages waiting to be decoded and pushed to the
+        //  session. Once decoded, the messages before rx_batch_pos
+        //  have already been pushed.
+        msg_t *rx_batch;
+        int rx_batch_pos;
+        int rx_batch_size;
+        bool rx_batch_decoded;
+
         //  True iff the engine couldn't consume the last decoded message.
         bool input_stopped;
 
@@ -188,6 +266,42 @@ namespace zmq
 
         std::string peer_address;
 
+        //  Time when the handshake started, in microseconds.
+        uint64_t handshake_start;
+
+        //  True iff the connection runs over a UNIX domain socket, which
+        //  lets frames be passed as file descriptors.
+        bool unix_socket;
+
+        //  Frames at least this large are passed as file descriptors.
+        //  Zero unless the peer agreed to that.
+        size_t bulk_threshold;
+
+        //  Descriptors of bulk frames, in the order of the frames, not
+        //  sent yet and received but not claimed by a frame yet.
+        std::deque <fd_t> tx_fds;
+        std::deque <fd_t> rx_fds;
+
+        enum {
+            heartbeat_ivl_timer_id = 0x80,
+            heartbeat_timeout_timer_id = 0x81,
+            heartbeat_ttl_timer_id = 0x82,
+            coalesce_timer_id = 0x83
+        };
+
+        bool has_heartbeat_timer;
+        bool has_timeout_timer;
+        bool has_ttl_timer;
+        bool has_coalesce_timer;
+
+        //  PING and PONG commands waiting to be sent.
+        bool ping_pending;
+        bool pong_pending;
+
+        //  Context of the last PING received, echoed in the PONG.
+        unsigned char pong_context [16];
+        size_t pong_context_size;
+
         stream_engine_t (const stream_engine_t&);
         const stream_engine_t &operator = (const stream_engine_t&);
     };
@@ -30,6 +30,8 @@
 #include "tcp.hpp"
 #include "address.hpp"
 #include "tcp_address.hpp"
+#include "tcp_resolver.hpp"
+#include "config.hpp"
 #include "session_base.hpp"
 
 #if defined ZMQ_HAVE_WINDOWS
@@ -55,9 +57,11 @@ zmq::tcp_connecter_t::tcp_connecter_t (class io_thread_t *io_thread_,
     io_object_t (io_thread_),
     addr (addr_),
     s (retired_fd),
-    handle_valid (false),
+    resolver (NULL),
+    next_address (0),
     delayed_start (delayed_start_),
     timer_started (false),
+    attempt_timer_started (false),
     session (session_),
     current_reconnect_ivl(options.reconnect_ivl)
 {
@@ -70,7 +74,9 @@ zmq::tcp_connecter_t::tcp_connecter_t (class io_thread_t *io_thread_,
 zmq::tcp_connecter_t::~tcp_connecter_t ()
 {
     zmq_assert (!timer_started);
-    zmq_assert (!handle_valid);
+    zmq_assert (!attempt_timer_started);
+    zmq_assert (!resolver);
+    zmq_assert (attempts.empty ());
     zmq_assert (s == retired_fd);
 }
 
@@ -89,19 +95,40 @@ void zmq::tcp_connecter_t::process_term (int linger_)
         timer_started = false;
     }
 
-    if (handle_valid) {
-        rm_fd (handle);
-        handle_valid = false;
+    if (attempt_timer_started) {
+        cancel_timer (attempt_timer_id);
+        attempt_timer_started = false;
     }
 
-    if (s != retired_fd)
-        close ();
+    //  Don't wait for the lookup to finish.
+    if (resolver) {
+        rm_fd (resolver_handle);
+        resolver->abandon ();
+        resolver = NULL;
+    }
+
+    while (!attempts.empty ())
+        close_attempt (attempts.size () - 1);
 
     own_t::process_term (linger_);
 }
 
 void zmq::tcp_connecter_t::in_event ()
 {
+    //  The host name lookup has finished. There are no connection
+    //  attempts in progress at that time.
+    if (resolver) {
+        rm_fd (resolver_handle);
+        const int rc = resolver->finish (addresses);
+        resolver = NULL;
+        next_address = 0;
+        if (rc == 0)
+            open_next ();
+        else
+            add_reconnect_timer ();
+        return;
+    }
+
     //  We are not polling for incoming data, so we are actually called
     //  because of error here. However, we can get error on out event as well
     //  on some platforms, so we'll simply handle both events in the same way.
@@ -110,17 +137,39 @@ void zmq::tcp_connecter_t::in_event ()
 
 void zmq::tcp_connecter_t::out_event ()
 {
-    fd_t fd = connect ();
-    rm_fd (handle);
-    handle_valid = false;
+    //  Find out which of the connection attempts have finished.
+    fd_t fd = retired_fd;
+    size_t i = 0;
+    while (i < attempts.size ()) {
+        const int rc = check_attempt (attempts [i].s);
+        if (rc == 1) {
+            fd = attempts [i].s;
+            rm_fd (attempts [i].handle);
+            attempts.erase (attempts.begin () + i);
+            break;
+        }
+        if (rc == -1)
+            close_attempt (i);
+        else
+            i++;
+    }
 
-    //  Handle the error condition by attempt to reconnect.
+    //  Handle the error condition by trying the next address, if
+    //  nothing else is in progress.
     if (fd == retired_fd) {
-        close ();
-        add_reconnect_timer();
+        if (attempts.empty ())
+            open_next ();
         return;
     }
 
+    //  The first connection established wins.
+    while (!attempts.empty ())
+        close_attempt (attempts.size () - 1);
+    if (attempt_timer_started) {
+        cancel_timer (attempt_timer_id);
+        attempt_timer_started = false;
+    }
+
     tune_tcp_socket (fd);
     tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt, options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
 
@@ -140,6 +189,11 @@ void zmq::tcp_connecter_t::out_event ()
 
 void zmq::tcp_connecter_t::timer_event (int id_)
 {
+    if (id_ == attempt_timer_id) {
+        attempt_timer_started = false;
+        open_next ();
+        return;
+    }
     zmq_assert (id_ == reconnect_timer_id);
     timer_started = false;
     start_connecting ();
@@ -147,31 +201,67 @@ void zmq::tcp_connecter_t::timer_event (int id_)
 
 void zmq::tcp_connecter_t::start_connecting ()
 {
-    //  Open the connecting socket.
-    int rc = open ();
-
-    //  Connect may succeed in synchronous manner.
-    if (rc == 0) {
-        handle = add_fd (s);
-        handle_valid = true;
-        out_event ();
+    addresses.clear ();
+    next_address = 0;
+
+    //  Numeric addresses are resolved once and for all when connecting.
+    if (addr->resolved.tcp_addr) {
+        addresses.push_back (*addr->resolved.tcp_addr);
+        open_next ();
+        return;
     }
 
-    //  Connection establishment may be delayed. Poll for its completion.
-    else
-    if (rc == -1 && errno == EINPROGRESS) {
-        handle = add_fd (s);
-        handle_valid = true;
-        set_pollout (handle);
-        socket->event_connect_delayed (endpoint, zmq_errno());
+    //  Host names are looked up anew on each attempt so that changes
+    //  to the name service take effect.
+    resolver = tcp_resolver_t::start (addr->address, options.ipv6);
+    resolver_handle = add_fd (resolver->get_fd ());
+    set_pollin (resolver_handle);
+}
+
+void zmq::tcp_connecter_t::open_next ()
+{
+    if (attempt_timer_started) {
+        cancel_timer (attempt_timer_id);
+        attempt_timer_started = false;
     }
 
-    //  Handle any other error condition by eventual reconnect.
-    else {
+    while (next_address < addresses.size ()) {
+
+        //  Open the connecting socket.
+        const int rc = open (addresses [next_address++]);
+
+        //  Connect may succeed in synchronous manner.
+        if (rc == 0) {
+            attempt_t attempt = {s, add_fd (s)};
+            attempts.push_back (attempt);
+            s = retired_fd;
+            out_event ();
+            return;
+        }
+
+        //  Connection establishment may be delayed. Poll for its completion
+        //  and give it a head start before trying the next address.
+        if (rc == -1 && errno == EINPROGRESS) {
+            attempt_t attempt = {s, add_fd (s)};
+            set_pollout (attempt.handle);
+            attempts.push_back (attempt);
+            s = retired_fd;
+            socket->event_connect_delayed (endpoint, zmq_errno());
+            if (next_address < addresses.size ()) {
+                add_timer (tcp_attempt_delay, attempt_timer_id);
+                attempt_timer_started = true;
+            }
+            return;
+        }
+
+        //  Handle any other error condition by trying the next address.
         if (s != retired_fd)
             close ();
-        add_reconnect_timer ();
     }
+
+    //  Once all the addresses failed, reconnect after a while.
+    if (attempts.empty ())
+        add_reconnect_timer ();
 }
 
 void zmq::tcp_connecter_t::add_reconnect_timer()
@@ -202,12 +292,12 @@ int zmq::tcp_connecter_t::get_new_reconnect_ivl ()
     return this_interval;
 }
 
-int zmq::tcp_connecter_t::open ()
+int zmq::tcp_connecter_t::open (const tcp_address_t &address_)
 {
     zmq_assert (s == retired_fd);
 
     //  Create the socket.
-    s = open_socket (addr->resolved.tcp_addr->family (), SOCK_STREAM, IPPROTO_TCP);
+    s = open_socket (address_.family (), SOCK_STREAM, IPPROTO_TCP);
 #ifdef ZMQ_HAVE_WINDOWS
     if (s == INVALID_SOCKET) {
         errno = wsa_error_to_errno (WSAGetLastError ());
@@ -220,7 +310,7 @@ int zmq::tcp_connecter_t::open ()
 
     //  On some systems, IPv4 mapping in IPv6 sockets is disabled by default.
     //  Switch it on in such cases.
-    if (addr->resolved.tcp_addr->family () == AF_INET6)
+    if (address_.family () == AF_INET6)
         enable_ipv4_mapping (s);
 
     // Set the IP Type-Of-Service priority for this socket
@@ -242,8 +332,8 @@ int zmq::tcp_connecter_t::open ()
 
     //  Connect to the remote peer.
     int rc = ::connect (
-        s, addr->resolved.tcp_addr->addr (),
-        addr->resolved.tcp_addr->addrlen ());
+        s, address_.addr (),
+        address_.addrlen ());
 
     //  Connect was successfull immediately.
     if (rc == 0)
@@ -264,9 +354,9 @@ int zmq::tcp_connecter_t::open ()
     return -1;
 }
 
-zmq::fd_t zmq::tcp_connecter_t::connect ()
+int zmq::tcp_connecter_t::check_attempt (fd_t s_)
 {
-    //  Async connect has finished. Check whether an error occurred
+    //  Check whether an error occurred.
     int err = 0;
 #if defined ZMQ_HAVE_HPUX
     int len = sizeof (err);
@@ -274,7 +364,7 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
     socklen_t len = sizeof (err);
 #endif
 
-    int rc = getsockopt (s, SOL_SOCKET, SO_ERROR, (char*) &err, &len);
+    int rc = getsockopt (s_, SOL_SOCKET, SO_ERROR, (char*) &err, &len);
 
     //  Assert if the error was caused by 0MQ bug.
     //  Networking problems are OK. No need to assert.
@@ -289,7 +379,7 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
             err == WSAENETDOWN ||
             err == WSAEACCES ||
             err == WSAEINVAL)
-            return retired_fd;
+            return -1;
         wsa_assert_no (err);
     }
 #else
@@ -308,14 +398,20 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
             errno == ENETUNREACH ||
             errno == ENETDOWN ||
             errno == EINVAL);
-        return retired_fd;
+        return -1;
     }
 #endif
 
-    //  Return the newly connected socket.
-    fd_t result = s;
-    s = retired_fd;
-    return result;
+    //  With several attempts polled at once, the lack of an error doesn't
+    //  mean this one has finished yet.
+    struct sockaddr_storage ss;
+#if defined ZMQ_HAVE_HPUX
+    int ss_len = sizeof (ss);
+#else
+    socklen_t ss_len = sizeof (ss);
+#endif
+    rc = getpeername (s_, (struct sockaddr*) &ss, &ss_len);
+    return rc == 0 ? 1 : 0;
 }
 
 void zmq::tcp_connecter_t::close ()
@@ -331,3 +427,11 @@ void zmq::tcp_connecter_t::close ()
     socket->event_closed (endpoint, s);
     s = retired_fd;
 }
+
+void zmq::tcp_connecter_t::close_attempt (size_t index_)
+{
+    rm_fd (attempts [index_].handle);
+    s = attempts [index_].s;
+    attempts.erase (attempts.begin () + index_);
+    close ();
+}
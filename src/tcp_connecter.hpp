@@ -20,10 +20,13 @@
 #ifndef __TCP_CONNECTER_HPP_INCLUDED__
 #define __TCP_CONNECTER_HPP_INCLUDED__
 
+#include <vector>
+
 #include "fd.hpp"
 #include "own.hpp"
 #include "stdint.hpp"
 #include "io_object.hpp"
+#include "tcp_address.hpp"
 #include "../include/zmq.h"
 
 namespace zmq
@@ -31,6 +34,7 @@ namespace zmq
 
     class io_thread_t;
     class session_base_t;
+    class tcp_resolver_t;
     struct address_t;
 
     class tcp_connecter_t : public own_t, public io_object_t
@@ -46,8 +50,9 @@ namespace zmq
 
     private:
 
-        //  ID of the timer used to delay the reconnection.
-        enum {reconnect_timer_id = 1};
+        //  IDs of the timers used to delay the reconnection and the
+        //  connection attempt to the next address.
+        enum {reconnect_timer_id = 1, attempt_timer_id = 2};
 
         //  Handlers for incoming commands.
         void process_plug ();
@@ -61,6 +66,10 @@ namespace zmq
         //  Internal function to start the actual connection establishment.
         void start_connecting ();
 
+        //  Starts connecting to the next address. Once all the addresses
+        //  failed, waits for a while before starting over.
+        void open_next ();
+
         //  Internal function to add a reconnect timer
         void add_reconnect_timer();
 
@@ -71,34 +80,48 @@ namespace zmq
 
         //  Open TCP connecting socket. Returns -1 in case of error,
         //  0 if connect was successfull immediately. Returns -1 with
-        //  EAGAIN errno if async connect was launched.
-        int open ();
+        //  EINPROGRESS errno if async connect was launched.
+        int open (const tcp_address_t &address_);
 
         //  Close the connecting socket.
         void close ();
 
-        //  Get the file descriptor of newly created connection. Returns
-        //  retired_fd if the connection was unsuccessfull.
-        fd_t connect ();
+        //  Stops the connection attempt at the given position.
+        void close_attempt (size_t index_);
+
+        //  Checks whether the connection attempt has finished. Returns 1
+        //  if connected, 0 if still in progress and -1 if it failed.
+        int check_attempt (fd_t s_);
 
         //  Address to connect to. Owned by session_base_t.
         const address_t *addr;
 
-        //  Underlying socket.
+        //  Socket being opened.
         fd_t s;
 
-        //  Handle corresponding to the listening socket.
-        handle_t handle;
+        //  Lookup of the host name in progress, if any.
+        tcp_resolver_t *resolver;
+        handle_t resolver_handle;
+
+        //  Addresses the endpoint resolved to, and the next one to try.
+        std::vector <tcp_address_t> addresses;
+        size_t next_address;
 
-        //  If true file descriptor is registered with the poller and 'handle'
-        //  contains valid value.
-        bool handle_valid;
+        //  Connection attempts in progress. When the endpoint resolves to
+        //  several addresses, more of them are tried in parallel.
+        struct attempt_t
+        {
+            fd_t s;
+            handle_t handle;
+        };
+        std::vector <attempt_t> attempts;
 
         //  If true, connecter is waiting a while before trying to connect.
         const bool delayed_start;
 
         //  True iff a timer has been started.
         bool timer_started;
+        bool attempt_timer_started;
 
         //  Reference to the session we belong to.
         zmq::session_base_t *session;
@@ -207,6 +207,14 @@ int zmq::tcp_listener_t::set_address (const char *addr_)
 #else
     rc = setsockopt (s, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof (int));
     errno_assert (rc == 0);
+#ifdef SO_REUSEPORT
+    //  Sockets sharing the endpoint each get a listening socket of their
+    //  own; the kernel spreads the incoming connections across them.
+    if (options.shard_strategy) {
+        rc = setsockopt (s, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof (int));
+        errno_assert (rc == 0);
+    }
+#endif
 #endif
 
     address.to_string (endpoint);
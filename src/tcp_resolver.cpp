@@ -0,0 +1,241 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tcp_resolver.hpp"
+#include "platform.hpp"
+#include "err.hpp"
+
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+
+//  Splits "host:port" into its parts, removing the square brackets around
+//  an IPv6 address. Only the characters found in host names and numeric
+//  addresses are allowed in the host.
+static int split_address (const std::string &name_, std::string &host_,
+    std::string &port_)
+{
+    const std::string::size_type delimiter = name_.rfind (':');
+    if (delimiter == std::string::npos) {
+        errno = EINVAL;
+        return -1;
+    }
+    host_ = name_.substr (0, delimiter);
+    port_ = name_.substr (delimiter + 1);
+
+    if (host_.size () >= 2 && host_ [0] == '[' &&
+          host_ [host_.size () - 1] == ']')
+        host_ = host_.substr (1, host_.size () - 2);
+
+    if (host_.empty () || port_.empty () || port_.size () > 5 ||
+          port_.find_first_not_of ("0123456789") != std::string::npos ||
+          atoi (port_.c_str ()) > 65535) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (std::string::size_type i = 0; i != host_.size (); i++) {
+        const char c = host_ [i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '_' ||
+              c == ':' || c == '%')) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int zmq::tcp_resolver_t::check (const std::string &name_, bool ipv6_)
+{
+    std::string host;
+    std::string port;
+    if (split_address (name_, host, port) == -1)
+        return -1;
+
+    //  Only IPv6 addresses have colons in them.
+    if (!ipv6_ && host.find (':') != std::string::npos) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+int zmq::tcp_resolver_t::resolve_numeric (const std::string &name_,
+    bool ipv6_, std::vector <tcp_address_t> &addresses_)
+{
+    return resolve (name_, ipv6_, true, addresses_);
+}
+
+zmq::tcp_resolver_t *zmq::tcp_resolver_t::start (const std::string &name_,
+    bool ipv6_)
+{
+    tcp_resolver_t *resolver = new (std::nothrow) tcp_resolver_t (name_, ipv6_);
+    alloc_assert (resolver);
+    resolver->worker.start (worker_routine, resolver);
+    return resolver;
+}
+
+zmq::tcp_resolver_t::tcp_resolver_t (const std::string &name_, bool ipv6_) :
+    name (name_),
+    ipv6 (ipv6_),
+    rc (-1),
+    err (0),
+    finished (false),
+    abandoned (false)
+{
+}
+
+zmq::tcp_resolver_t::~tcp_resolver_t ()
+{
+}
+
+zmq::fd_t zmq::tcp_resolver_t::get_fd ()
+{
+    return done.get_fd ();
+}
+
+int zmq::tcp_resolver_t::finish (std::vector <tcp_address_t> &addresses_)
+{
+    done.recv ();
+    worker.stop ();
+
+    const int result = rc;
+    const int error = err;
+    addresses_.swap (addresses);
+    delete this;
+
+    if (result == -1)
+        errno = error;
+    return result;
+}
+
+void zmq::tcp_resolver_t::abandon ()
+{
+    sync.lock ();
+    if (!finished) {
+        abandoned = true;
+        worker.detach ();
+        sync.unlock ();
+        return;
+    }
+    sync.unlock ();
+
+    //  The lookup is over; just wait for the thread to exit.
+    worker.stop ();
+    delete this;
+}
+
+void zmq::tcp_resolver_t::worker_routine (void *arg_)
+{
+    tcp_resolver_t *self = (tcp_resolver_t*) arg_;
+
+    std::vector <tcp_address_t> found;
+    const int result = resolve (self->name, self->ipv6, false, found);
+    const int error = errno;
+
+    self->sync.lock ();
+    if (self->abandoned) {
+        self->sync.unlock ();
+        delete self;
+        return;
+    }
+    self->addresses.swap (found);
+    self->rc = result;
+    self->err = error;
+    self->finished = true;
+    self->done.send ();
+    self->sync.unlock ();
+}
+
+int zmq::tcp_resolver_t::resolve (const std::string &name_, bool ipv6_,
+    bool numeric_, std::vector <tcp_address_t> &addresses_)
+{
+    std::string host;
+    std::string port;
+    if (split_address (name_, host, port) == -1)
+        return -1;
+
+    addrinfo req;
+    memset (&req, 0, sizeof (req));
+    req.ai_family = ipv6_? AF_UNSPEC: AF_INET;
+    req.ai_socktype = SOCK_STREAM;
+    req.ai_flags = AI_NUMERICSERV;
+    if (numeric_)
+        req.ai_flags |= AI_NUMERICHOST;
+
+    addrinfo *res;
+    const int rc = getaddrinfo (host.c_str (), port.c_str (), &req, &res);
+    if (rc) {
+        //  Some of the error info is lost, however, there's no way to
+        //  report EAI errors via errno.
+        if (rc == EAI_MEMORY)
+            errno = ENOMEM;
+        else
+        if (numeric_ && rc == EAI_NONAME)
+            errno = EAGAIN;
+        else
+            errno = EINVAL;
+        return -1;
+    }
+
+    //  Alternate between the address families, starting with the family
+    //  of the first, preferred address, so that an unreachable family
+    //  doesn't hold up connecting (RFC 8305).
+    std::vector <tcp_address_t> families [2];
+    const int first_family = res->ai_family;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6)
+            continue;
+        const tcp_address_t address (ai->ai_addr, (socklen_t) ai->ai_addrlen);
+        std::vector <tcp_address_t> &list =
+            families [ai->ai_family == first_family ? 0 : 1];
+        bool duplicate = false;
+        for (size_t i = 0; i != list.size (); i++)
+            if (list [i].addrlen () == address.addrlen () &&
+                  memcmp (list [i].addr (), address.addr (),
+                  address.addrlen ()) == 0)
+                duplicate = true;
+        if (!duplicate)
+            list.push_back (address);
+    }
+    freeaddrinfo (res);
+
+    addresses_.clear ();
+    for (size_t i = 0; i < families [0].size () || i < families [1].size ();
+          i++) {
+        if (i < families [0].size ())
+            addresses_.push_back (families [0][i]);
+        if (i < families [1].size ())
+            addresses_.push_back (families [1][i]);
+    }
+    if (addresses_.empty ()) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
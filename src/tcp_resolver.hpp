@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_TCP_RESOLVER_HPP_INCLUDED__
+#define __ZMQ_TCP_RESOLVER_HPP_INCLUDED__
+
+#include <string>
+#include <vector>
+
+#include "fd.hpp"
+#include "tcp_address.hpp"
+#include "thread.hpp"
+#include "signaler.hpp"
+#include "mutex.hpp"
+
+namespace zmq
+{
+
+    //  Resolves a remote tcp address ("host:port") into the addresses to
+    //  connect to. Host names are looked up on a thread of their own, so
+    //  that a slow resolver doesn't hold up the I/O thread.
+
+    class tcp_resolver_t
+    {
+    public:
+
+        //  Checks the syntax of the address without resolving it.
+        static int check (const std::string &name_, bool ipv6_);
+
+        //  Resolves a numeric address. Returns -1 with errno set to
+        //  EAGAIN if the address is a host name to be looked up.
+        static int resolve_numeric (const std::string &name_, bool ipv6_,
+            std::vector <tcp_address_t> &addresses_);
+
+        //  Starts looking the address up. The lookup is over once the
+        //  file descriptor returned by get_fd () is readable.
+        static tcp_resolver_t *start (const std::string &name_, bool ipv6_);
+
+        fd_t get_fd ();
+
+        //  Retrieves the addresses found by a finished lookup, ordered
+        //  so that the address families alternate, and releases the
+        //  resolver. Returns -1 if the name couldn't be resolved.
+        int finish (std::vector <tcp_address_t> &addresses_);
+
+        //  Releases the resolver without waiting for the lookup to end.
+        void abandon ();
+
+    private:
+
+        tcp_resolver_t (const std::string &name_, bool ipv6_);
+        ~tcp_resolver_t ();
+
+        //  Main routine of the lookup thread.
+        static void worker_routine (void *arg_);
+
+        static int resolve (const std::string &name_, bool ipv6_,
+            bool numeric_, std::vector <tcp_address_t> &addresses_);
+
+        const std::string name;
+        const bool ipv6;
+
+        //  Outcome of the lookup.
+        std::vector <tcp_address_t> addresses;
+        int rc;
+        int err;
+
+        //  Protects the two flags below.
+        mutex_t sync;
+
+        //  True once the lookup is over.
+        bool finished;
+
+        //  True if nobody waits for the lookup anymore. The lookup thread
+        //  then disposes of the resolver itself.
+        bool abandoned;
+
+        signaler_t done;
+        thread_t worker;
+
+        tcp_resolver_t (const tcp_resolver_t&);
+        const tcp_resolver_t &operator = (const tcp_resolver_t&);
+    };
+
+}
+
+#endif
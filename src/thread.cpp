@@ -59,6 +59,12 @@ void zmq::thread_t::stop ()
     win_assert (rc2 != 0);
 }
 
+void zmq::thread_t::detach ()
+{
+    BOOL rc = CloseHandle (descriptor);
+    win_assert (rc != 0);
+}
+
 #else
 
 #include <signal.h>
@@ -97,6 +103,12 @@ void zmq::thread_t::stop ()
     posix_assert (rc);
 }
 
+void zmq::thread_t::detach ()
+{
+    int rc = pthread_detach (descriptor);
+    posix_assert (rc);
+}
+
 #endif
 
 
@@ -55,6 +55,10 @@ namespace zmq
         //  Waits for thread termination.
         void stop ();
 
+        //  Lets the thread run on its own. Its resources are released once
+        //  it terminates. Must not be followed by stop ().
+        void detach ();
+
         //  These are internal members. They should be private, however then
         //  they would not be accessible from the main C routine of the thread.
         thread_fn *tfn;
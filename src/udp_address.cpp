@@ -0,0 +1,123 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "udp_address.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+
+#include <string.h>
+#include <sstream>
+#include <arpa/inet.h>
+
+#include "tcp_address.hpp"
+#include "err.hpp"
+
+zmq::udp_address_t::udp_address_t () :
+    has_iface (false),
+    multicast (false)
+{
+    memset (&address, 0, sizeof (address));
+    iface.s_addr = htonl (INADDR_ANY);
+}
+
+zmq::udp_address_t::~udp_address_t ()
+{
+}
+
+int zmq::udp_address_t::resolve (const char *name_, bool receiver_)
+{
+    std::string name (name_);
+
+    //  Split off the interface used for multicast, if any.
+    const std::string::size_type delimiter = name.find (';');
+    if (delimiter != std::string::npos) {
+        const std::string nic = name.substr (0, delimiter) + ":0";
+        tcp_address_t nic_addr;
+        int rc = nic_addr.resolve (nic.c_str (), true, false);
+        if (rc != 0)
+            return -1;
+        iface = ((const sockaddr_in*) nic_addr.addr ())->sin_addr;
+        has_iface = true;
+        name = name.substr (delimiter + 1);
+    }
+
+    //  Addresses are resolved as hostnames first. Receivers fall back to
+    //  interface names, '*' included.
+    tcp_address_t resolved;
+    int rc = resolved.resolve (name.c_str (), false, false);
+    if (rc != 0 && receiver_)
+        rc = resolved.resolve (name.c_str (), true, false);
+    if (rc != 0)
+        return -1;
+    zmq_assert (resolved.family () == AF_INET);
+    memcpy (&address, resolved.addr (), sizeof address);
+
+    //  Peers have to agree upon the port up front.
+    if (address.sin_port == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    multicast = IN_MULTICAST (ntohl (address.sin_addr.s_addr));
+    return 0;
+}
+
+int zmq::udp_address_t::to_string (std::string &addr_)
+{
+    char buf [INET_ADDRSTRLEN];
+    std::stringstream s;
+    s << "udp://";
+    if (has_iface) {
+        if (!inet_ntop (AF_INET, &iface, buf, sizeof buf)) {
+            addr_.clear ();
+            return -1;
+        }
+        s << buf << ";";
+    }
+    if (!inet_ntop (AF_INET, &address.sin_addr, buf, sizeof buf)) {
+        addr_.clear ();
+        return -1;
+    }
+    s << buf << ":" << ntohs (address.sin_port);
+    addr_ = s.str ();
+    return 0;
+}
+
+const sockaddr *zmq::udp_address_t::addr () const
+{
+    return (const sockaddr*) &address;
+}
+
+socklen_t zmq::udp_address_t::addrlen () const
+{
+    return (socklen_t) sizeof address;
+}
+
+bool zmq::udp_address_t::is_multicast () const
+{
+    return multicast;
+}
+
+const in_addr &zmq::udp_address_t::multicast_interface () const
+{
+    return iface;
+}
+
+#endif
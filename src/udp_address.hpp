@@ -0,0 +1,75 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_UDP_ADDRESS_HPP_INCLUDED__
+#define __ZMQ_UDP_ADDRESS_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+
+#include <string>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace zmq
+{
+
+    class udp_address_t
+    {
+    public:
+
+        udp_address_t ();
+        ~udp_address_t ();
+
+        //  This function translates "[interface;]address:port" into the
+        //  address structures used by the udp engine. The address may be
+        //  a multicast group, which receivers join on the interface given.
+        //  A receiver may use '*' or an interface name as the address.
+        int resolve (const char *name_, bool receiver_);
+
+        //  The opposite to resolve()
+        int to_string (std::string &addr_);
+
+        //  Address datagrams are sent to, or bound to by receivers.
+        const sockaddr *addr () const;
+        socklen_t addrlen () const;
+
+        bool is_multicast () const;
+
+        //  Interface used for multicast, INADDR_ANY unless specified.
+        const in_addr &multicast_interface () const;
+
+    private:
+
+        sockaddr_in address;
+        in_addr iface;
+        bool has_iface;
+        bool multicast;
+
+        udp_address_t (const udp_address_t&);
+        const udp_address_t &operator = (const udp_address_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,380 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "udp_engine.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include "udp_address.hpp"
+#include "session_base.hpp"
+#include "ip.hpp"
+#include "wire.hpp"
+#include "err.hpp"
+
+//  Each frame of a message is preceded by a flags byte and its size
+//  as a 16-bit integer in network byte order.
+static const size_t frame_header_size = 3;
+static const unsigned char frame_more = 0x01;
+
+zmq::udp_engine_t::udp_engine_t (io_thread_t *parent_,
+      const options_t &options_) :
+    io_object_t (parent_),
+    fd (retired_fd),
+    send (false),
+    address_size (0),
+    buffer (NULL),
+    batch_size (0),
+    batch_sent (0),
+    session (NULL),
+    options (options_)
+{
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+}
+
+zmq::udp_engine_t::~udp_engine_t ()
+{
+    if (fd != retired_fd) {
+        int rc = close (fd);
+        errno_assert (rc == 0);
+    }
+    free (buffer);
+    int rc = msg.close ();
+    errno_assert (rc == 0);
+}
+
+int zmq::udp_engine_t::init (const udp_address_t *address_, bool send_)
+{
+    send = send_;
+    fd = open_socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd == retired_fd)
+        return -1;
+    unblock_socket (fd);
+
+    if (options.sndbuf > 0) {
+        int rc = setsockopt (fd, SOL_SOCKET, SO_SNDBUF,
+            (char*) &options.sndbuf, sizeof (int));
+        errno_assert (rc == 0);
+    }
+    if (options.rcvbuf > 0) {
+        int rc = setsockopt (fd, SOL_SOCKET, SO_RCVBUF,
+            (char*) &options.rcvbuf, sizeof (int));
+        errno_assert (rc == 0);
+    }
+
+    if (send) {
+        memcpy (&address, address_->addr (), address_->addrlen ());
+        address_size = address_->addrlen ();
+
+        if (address_->is_multicast ()) {
+            int hops = options.multicast_hops;
+            int rc = setsockopt (fd, IPPROTO_IP, IP_MULTICAST_TTL,
+                (char*) &hops, sizeof hops);
+            errno_assert (rc == 0);
+            rc = setsockopt (fd, IPPROTO_IP, IP_MULTICAST_IF,
+                (char*) &address_->multicast_interface (), sizeof (in_addr));
+            if (rc != 0)
+                return -1;
+        }
+    }
+    else {
+        //  Several receivers on this host may join the same group.
+        sockaddr_in bind_address;
+        memcpy (&bind_address, address_->addr (), sizeof bind_address);
+        if (address_->is_multicast ()) {
+            int flag = 1;
+            int rc = setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+                (char*) &flag, sizeof flag);
+            errno_assert (rc == 0);
+            bind_address.sin_addr.s_addr = htonl (INADDR_ANY);
+        }
+
+        int rc = bind (fd, (const sockaddr*) &bind_address,
+            sizeof bind_address);
+        if (rc != 0)
+            return -1;
+
+        if (address_->is_multicast ()) {
+            ip_mreq mreq;
+            mreq.imr_multiaddr = ((const sockaddr_in*)
+                address_->addr ())->sin_addr;
+            mreq.imr_interface = address_->multicast_interface ();
+            rc = setsockopt (fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                (char*) &mreq, sizeof mreq);
+            if (rc != 0)
+                return -1;
+        }
+    }
+
+    buffer = (unsigned char*) malloc (udp_batch_size * udp_max_datagram);
+    alloc_assert (buffer);
+
+    //  Receivers get a fixed slot of the buffer for each datagram.
+    for (int i = 0; i != udp_batch_size; i++) {
+        iov [i].iov_base = buffer + i * udp_max_datagram;
+        iov [i].iov_len = udp_max_datagram;
+    }
+#if defined ZMQ_HAVE_SENDMMSG
+    memset (msgvec, 0, sizeof msgvec);
+    for (int i = 0; i != udp_batch_size; i++) {
+        msgvec [i].msg_hdr.msg_iov = &iov [i];
+        msgvec [i].msg_hdr.msg_iovlen = 1;
+        if (send) {
+            msgvec [i].msg_hdr.msg_name = &address;
+            msgvec [i].msg_hdr.msg_namelen = address_size;
+        }
+    }
+#endif
+
+    return 0;
+}
+
+void zmq::udp_engine_t::plug (io_thread_t *, session_base_t *session_)
+{
+    zmq_assert (!session);
+    zmq_assert (session_);
+    session = session_;
+
+    handle = add_fd (fd);
+    if (send)
+        set_pollout (handle);
+    else {
+        set_pollin (handle);
+        drop_subscriptions ();
+    }
+}
+
+void zmq::udp_engine_t::unplug ()
+{
+    rm_fd (handle);
+    session = NULL;
+}
+
+void zmq::udp_engine_t::terminate ()
+{
+    unplug ();
+    delete this;
+}
+
+void zmq::udp_engine_t::restart_input ()
+{
+    //  Datagrams are dropped rather than held back, so input never stops.
+}
+
+void zmq::udp_engine_t::restart_output ()
+{
+    if (!send) {
+        drop_subscriptions ();
+        return;
+    }
+    set_pollout (handle);
+    out_event ();
+}
+
+void zmq::udp_engine_t::drop_subscriptions ()
+{
+    while (session->pull_msg (&msg) == 0) {
+        int rc = msg.close ();
+        errno_assert (rc == 0);
+        rc = msg.init ();
+        errno_assert (rc == 0);
+    }
+}
+
+void zmq::udp_engine_t::out_event ()
+{
+    //  Finish the batch the socket had no room for first.
+    if (batch_sent < batch_size) {
+        send_batch ();
+        if (batch_sent < batch_size)
+            return;
+    }
+
+    fill_batch ();
+
+    //  If there are no data to write stop polling for output.
+    if (batch_size == 0) {
+        reset_pollout (handle);
+        return;
+    }
+
+    send_batch ();
+}
+
+void zmq::udp_engine_t::fill_batch ()
+{
+    batch_size = 0;
+    batch_sent = 0;
+
+    unsigned char *pos = buffer;
+    unsigned char *const end = buffer + udp_batch_size * udp_max_datagram;
+
+    //  Any message fits into the room left as long as it is at least
+    //  a full datagram large.
+    while (batch_size < udp_batch_size && end - pos >= udp_max_datagram) {
+        int rc = session->pull_msg (&msg);
+        if (rc != 0) {
+            errno_assert (errno == EAGAIN);
+            break;
+        }
+
+        //  The frames of a message are all available once the first one is.
+        unsigned char *const start = pos;
+        bool fits = true;
+        while (true) {
+            const bool more = msg.flags () & msg_t::more ? true : false;
+            const size_t size = msg.size ();
+            if (fits && (pos - start) + frame_header_size + size <=
+                  udp_max_datagram) {
+                pos [0] = more ? frame_more : 0;
+                put_uint16 (pos + 1, (uint16_t) size);
+                memcpy (pos + frame_header_size, msg.data (), size);
+                pos += frame_header_size + size;
+            }
+            else
+                fits = false;
+
+            rc = msg.close ();
+            errno_assert (rc == 0);
+            rc = msg.init ();
+            errno_assert (rc == 0);
+            if (!more)
+                break;
+            rc = session->pull_msg (&msg);
+            errno_assert (rc == 0);
+        }
+
+        //  Messages exceeding a single datagram are dropped.
+        if (!fits) {
+            pos = start;
+            continue;
+        }
+
+        iov [batch_size].iov_base = start;
+        iov [batch_size].iov_len = pos - start;
+        batch_size++;
+    }
+}
+
+void zmq::udp_engine_t::send_batch ()
+{
+    while (batch_sent < batch_size) {
+#if defined ZMQ_HAVE_SENDMMSG
+        int rc = sendmmsg (fd, msgvec + batch_sent, batch_size - batch_sent,
+            0);
+#else
+        ssize_t rc = sendto (fd, iov [batch_sent].iov_base,
+            iov [batch_sent].iov_len, 0, (const sockaddr*) &address,
+            address_size);
+        if (rc != -1)
+            rc = 1;
+#endif
+        if (rc == -1) {
+            //  Wait for room in the socket buffer.
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                return;
+
+            //  Errors are specific to a datagram, so skip it and go on.
+            batch_sent++;
+            continue;
+        }
+        batch_sent += rc;
+    }
+}
+
+void zmq::udp_engine_t::in_event ()
+{
+    int received = 0;
+
+#if defined ZMQ_HAVE_SENDMMSG
+    received = recvmmsg (fd, msgvec, udp_batch_size, MSG_DONTWAIT, NULL);
+    if (received == -1)
+        return;
+    for (int i = 0; i != received; i++)
+        if (!(msgvec [i].msg_hdr.msg_flags & MSG_TRUNC))
+            decode ((const unsigned char*) iov [i].iov_base,
+                msgvec [i].msg_len);
+#else
+    while (received != udp_batch_size) {
+        ssize_t rc = recv (fd, iov [0].iov_base, udp_max_datagram,
+            MSG_DONTWAIT);
+        if (rc == -1)
+            break;
+        decode ((const unsigned char*) iov [0].iov_base, rc);
+        received++;
+    }
+#endif
+
+    if (received > 0)
+        session->flush ();
+}
+
+void zmq::udp_engine_t::decode (const unsigned char *data_, size_t size_)
+{
+    //  Check the whole datagram before passing any of it on.
+    size_t pos = 0;
+    bool more = true;
+    while (more) {
+        if (size_ - pos < frame_header_size || (data_ [pos] & ~frame_more))
+            return;
+        more = (data_ [pos] & frame_more) != 0;
+        pos += frame_header_size + get_uint16 (data_ + pos + 1);
+        if (pos > size_)
+            return;
+    }
+    if (pos != size_)
+        return;
+
+    pos = 0;
+    more = true;
+    bool first = true;
+    while (more) {
+        more = (data_ [pos] & frame_more) != 0;
+        const size_t size = get_uint16 (data_ + pos + 1);
+        int rc = msg.init_size (size);
+        errno_assert (rc == 0);
+        if (more)
+            msg.set_flags (msg_t::more);
+        memcpy (msg.data (), data_ + pos + frame_header_size, size);
+        pos += frame_header_size + size;
+
+        rc = session->push_msg (&msg);
+        if (rc != 0) {
+            //  The pipe is full; drop the message like PUB does. Once the
+            //  first frame got in, the rest of the message fits as well.
+            errno_assert (errno == EAGAIN);
+            zmq_assert (first);
+            rc = msg.close ();
+            errno_assert (rc == 0);
+            rc = msg.init ();
+            errno_assert (rc == 0);
+            return;
+        }
+        first = false;
+    }
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_UDP_ENGINE_HPP_INCLUDED__
+#define __ZMQ_UDP_ENGINE_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "fd.hpp"
+#include "io_object.hpp"
+#include "i_engine.hpp"
+#include "options.hpp"
+#include "msg.hpp"
+#include "config.hpp"
+
+namespace zmq
+{
+
+    class io_thread_t;
+    class session_base_t;
+    class udp_address_t;
+
+    //  Engine passing each message in a single UDP datagram. Datagrams
+    //  are sent and received in batches; nothing is retransmitted and
+    //  messages that do not fit into the socket buffers are dropped.
+
+    class udp_engine_t : public io_object_t, public i_engine
+    {
+    public:
+
+        udp_engine_t (zmq::io_thread_t *parent_, const options_t &options_);
+        ~udp_engine_t ();
+
+        //  Opens the socket. Senders send datagrams to the address,
+        //  receivers bind to it or join it as a multicast group.
+        int init (const udp_address_t *address_, bool send_);
+
+        //  i_engine interface implementation.
+        void plug (zmq::io_thread_t *io_thread_,
+            zmq::session_base_t *session_);
+        void terminate ();
+        void restart_input ();
+        void restart_output ();
+        void zap_msg_available () {}
+
+        //  i_poll_events interface implementation.
+        void in_event ();
+        void out_event ();
+
+    private:
+
+        //  Unplug the engine from the session.
+        void unplug ();
+
+        //  Pulls messages from the session into the batch of datagrams.
+        void fill_batch ();
+
+        //  Sends the datagrams of the batch not sent yet. Stops early if
+        //  the socket buffer is full.
+        void send_batch ();
+
+        //  Pushes the message held in a datagram to the session. Malformed
+        //  datagrams are ignored.
+        void decode (const unsigned char *data_, size_t size_);
+
+        //  Receivers have no use for the subscriptions sent by the socket.
+        void drop_subscriptions ();
+
+        fd_t fd;
+        handle_t handle;
+        bool send;
+
+        //  Destination of the datagrams sent.
+        sockaddr_storage address;
+        socklen_t address_size;
+
+        //  Room for a full batch of datagrams.
+        unsigned char *buffer;
+
+        //  Batch of datagrams pointing into the buffer.
+        iovec iov [udp_batch_size];
+#if defined ZMQ_HAVE_SENDMMSG
+        mmsghdr msgvec [udp_batch_size];
+#endif
+        int batch_size;
+        int batch_sent;
+
+        msg_t msg;
+
+        session_base_t *session;
+
+        //  Socket options.
+        options_t options;
+
+        udp_engine_t (const udp_engine_t&);
+        const udp_engine_t &operator = (const udp_engine_t&);
+    };
+
+}
+
+#endif
+
+#endif
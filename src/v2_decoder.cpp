@@ -34,6 +34,7 @@
 zmq::v2_decoder_t::v2_decoder_t (size_t bufsize_, int64_t maxmsgsize_) :
     decoder_base_t <v2_decoder_t> (bufsize_),
     msg_flags (0),
+    frame_start (true),
     maxmsgsize (maxmsgsize_)
 {
     int rc = in_progress.init ();
@@ -49,13 +50,62 @@ zmq::v2_decoder_t::~v2_decoder_t ()
     errno_assert (rc == 0);
 }
 
+int zmq::v2_decoder_t::decode (const unsigned char *data_, size_t size_,
+    size_t &bytes_used_)
+{
+    //  A small frame which is all there in the data is decoded right away,
+    //  without copying its header aside and going through the steps. The
+    //  caller comes back for each message, so runs of small frames are
+    //  parsed straight out of the buffer.
+    if (frame_start && size_ >= 2 &&
+          !(data_ [0] & v2_protocol_t::large_flag) &&
+          size_ >= 2 + (size_t) data_ [1]) {
+        const size_t msg_size = data_ [1];
+
+        //  Message size must not exceed the maximum allowed size.
+        if (maxmsgsize >= 0)
+            if (unlikely (msg_size > static_cast <uint64_t> (maxmsgsize))) {
+                bytes_used_ = 0;
+                errno = EMSGSIZE;
+                return -1;
+            }
+
+        //  The message is no larger than 255 bytes; unless that's more than
+        //  fits into a VSM, there's no allocation involved.
+        int rc = in_progress.init_size (msg_size);
+        if (unlikely (rc)) {
+            errno_assert (errno == ENOMEM);
+            rc = in_progress.init ();
+            errno_assert (rc == 0);
+            bytes_used_ = 0;
+            errno = ENOMEM;
+            return -1;
+        }
+        memcpy (in_progress.data (), data_ + 2, msg_size);
+        in_progress.set_flags (msg_flags_of (data_ [0]));
+        bytes_used_ = 2 + msg_size;
+        return 1;
+    }
+
+    return decoder_base_t <v2_decoder_t>::decode (data_, size_, bytes_used_);
+}
+
+unsigned char zmq::v2_decoder_t::msg_flags_of (unsigned char flags_)
+{
+    unsigned char flags = 0;
+    if (flags_ & v2_protocol_t::more_flag)
+        flags |= msg_t::more;
+    if (flags_ & v2_protocol_t::command_flag)
+        flags |= msg_t::command;
+    if (flags_ & v2_protocol_t::bulk_flag)
+        flags |= msg_t::bulk;
+    return flags;
+}
+
 int zmq::v2_decoder_t::flags_ready ()
 {
-    msg_flags = 0;
-    if (tmpbuf [0] & v2_protocol_t::more_flag)
-        msg_flags |= msg_t::more;
-    if (tmpbuf [0] & v2_protocol_t::command_flag)
-        msg_flags |= msg_t::command;
+    frame_start = false;
+    msg_flags = msg_flags_of (tmpbuf [0]);
 
     //  The payload length is either one or eight bytes,
     //  depending on whether the 'large' bit is set.
@@ -138,5 +188,6 @@ int zmq::v2_decoder_t::message_ready ()
     //  Message is completely read. Signal this to the caller
     //  and prepare to decode next message.
     next_step (tmpbuf, 1, &v2_decoder_t::flags_ready);
+    frame_start = true;
     return 1;
 }
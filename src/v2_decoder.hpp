@@ -35,8 +35,16 @@ namespace zmq
         //  i_decoder interface.
         virtual msg_t *msg () { return &in_progress; }
 
+        //  Decodes small frames lying in the data as a whole directly,
+        //  leaving the rest to the state machine.
+        int decode (const unsigned char *data_, size_t size_,
+            size_t &bytes_used_);
+
     private:
 
+        //  Translates the flags of a frame into message flags.
+        static unsigned char msg_flags_of (unsigned char flags_);
+
         int flags_ready ();
         int one_byte_size_ready ();
         int eight_byte_size_ready ();
@@ -46,6 +54,9 @@ namespace zmq
         unsigned char msg_flags;
         msg_t in_progress;
 
+        //  True iff the state machine waits for the flags of the next frame.
+        bool frame_start;
+
         const int64_t maxmsgsize;
 
         v2_decoder_t (const v2_decoder_t&);
@@ -23,7 +23,8 @@
 #include "wire.hpp"
 
 zmq::v2_encoder_t::v2_encoder_t (size_t bufsize_) :
-    encoder_base_t <v2_encoder_t> (bufsize_)
+    encoder_base_t <v2_encoder_t> (bufsize_),
+    deferred (false)
 {
     //  Write 0 bytes to the batch and go to message_ready state.
     next_step (NULL, 0, &v2_encoder_t::message_ready, true);
@@ -33,17 +34,69 @@ zmq::v2_encoder_t::~v2_encoder_t ()
 {
 }
 
-void zmq::v2_encoder_t::message_ready ()
+size_t zmq::v2_encoder_t::encode (unsigned char **data_, size_t size_)
 {
-    //  Encode flags.
-    unsigned char &protocol_flags = tmpbuf [0];
-    protocol_flags = 0;
+    if (deferred) {
+        deferred = false;
+
+        //  If the whole frame fits into the buffer, write flags, size and
+        //  body right away. Otherwise let the state machine split it.
+        unsigned char *buffer = !*data_ ? buf : *data_;
+        const size_t buffersize = !*data_ ? bufsize : size_;
+        const size_t size = in_progress->size ();
+        if (2 + size <= buffersize) {
+            buffer [0] = protocol_flags ();
+            buffer [1] = static_cast <uint8_t> (size);
+            memcpy (buffer + 2, in_progress->data (), size);
+            int rc = in_progress->close ();
+            errno_assert (rc == 0);
+            rc = in_progress->init ();
+            errno_assert (rc == 0);
+            in_progress = NULL;
+            *data_ = buffer;
+            return 2 + size;
+        }
+        message_ready ();
+    }
+    return encoder_base_t <v2_encoder_t>::encode (data_, size_);
+}
+
+void zmq::v2_encoder_t::load_msg (msg_t *msg_)
+{
+    //  Messages with one-byte size are held back until encode is called.
+    //  The state machine is left at the message boundary meanwhile.
+    if (msg_->size () <= 255) {
+        zmq_assert (in_progress == NULL);
+        in_progress = msg_;
+        deferred = true;
+    }
+    else
+        encoder_base_t <v2_encoder_t>::load_msg (msg_);
+}
+
+bool zmq::v2_encoder_t::has_data ()
+{
+    return deferred || encoder_base_t <v2_encoder_t>::has_data ();
+}
+
+unsigned char zmq::v2_encoder_t::protocol_flags () const
+{
+    unsigned char flags = 0;
     if (in_progress->flags () & msg_t::more)
-        protocol_flags |= v2_protocol_t::more_flag;
+        flags |= v2_protocol_t::more_flag;
     if (in_progress->size () > 255)
-        protocol_flags |= v2_protocol_t::large_flag;
+        flags |= v2_protocol_t::large_flag;
     if (in_progress->flags () & msg_t::command)
-        protocol_flags |= v2_protocol_t::command_flag;
+        flags |= v2_protocol_t::command_flag;
+    if (in_progress->flags () & msg_t::bulk)
+        flags |= v2_protocol_t::bulk_flag;
+    return flags;
+}
+
+void zmq::v2_encoder_t::message_ready ()
+{
+    //  Encode flags.
+    tmpbuf [0] = protocol_flags ();
 
     //  Encode the message length. For messages less then 256 bytes,
     //  the length is encoded as 8-bit unsigned integer. For larger
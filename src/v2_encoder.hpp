@@ -33,13 +33,26 @@ namespace zmq
         v2_encoder_t (size_t bufsize_);
         virtual ~v2_encoder_t ();
 
+        //  i_encoder interface implementation. Small messages are written
+        //  out whole, bypassing the state machine.
+        size_t encode (unsigned char **data_, size_t size_);
+        void load_msg (msg_t *msg_);
+        bool has_data ();
+
     private:
 
+        //  Returns the protocol flags for the message in progress.
+        unsigned char protocol_flags () const;
+
         void size_ready ();
         void message_ready ();
 
         unsigned char tmpbuf [9];
 
+        //  True iff the message in progress was loaded but not handed to
+        //  the state machine yet.
+        bool deferred;
+
         v2_encoder_t (const v2_encoder_t&);
         const v2_encoder_t &operator = (const v2_encoder_t&);
     };
@@ -31,7 +31,11 @@ namespace zmq
         {
             more_flag = 1,
             large_flag = 2,
-            command_flag = 4
+            command_flag = 4,
+
+            //  Not part of ZMTP; only used between peers that agreed on
+            //  passing bodies as file descriptors during the handshake.
+            bulk_flag = 8
         };
     };
 }
@@ -112,6 +112,11 @@ void zmq::xpub_t::xpipe_terminated (pipe_t *pipe_)
     dist.pipe_terminated (pipe_);
 }
 
+uint64_t zmq::xpub_t::xmsgs_dropped ()
+{
+    return dist.get_dropped ();
+}
+
 void zmq::xpub_t::mark_as_matching (pipe_t *pipe_, void *arg_)
 {
     xpub_t *self = (xpub_t*) arg_;
@@ -55,6 +55,7 @@ namespace zmq
         void xwrite_activated (zmq::pipe_t *pipe_);
         int xsetsockopt (int option_, const void *optval_, size_t optvallen_);
         void xpipe_terminated (zmq::pipe_t *pipe_);
+        uint64_t xmsgs_dropped ();
 
     private:
 
@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+#include <sodium.h>
+#else
+#include "sha256.hpp"
+#endif
+
+#include "zap_cache.hpp"
+#include "err.hpp"
+
+zmq::zap_cache_t::zap_cache_t () :
+    pruned_size (0)
+{
+}
+
+zmq::zap_cache_t::~zap_cache_t ()
+{
+}
+
+bool zmq::zap_cache_t::find (const std::string &key_, std::string &metadata_)
+{
+    const std::string hashed_key = digest (key_);
+    sync.lock ();
+    bool found = false;
+    entries_t::iterator it = entries.find (hashed_key);
+    if (it != entries.end ()) {
+        if (it->second.expiry > clock.now_ms ()) {
+            metadata_ = it->second.metadata;
+            found = true;
+        }
+        else
+            entries.erase (it);
+    }
+    sync.unlock ();
+    return found;
+}
+
+void zmq::zap_cache_t::insert (const std::string &key_,
+    const std::string &metadata_, int ttl_)
+{
+    const std::string hashed_key = digest (key_);
+    sync.lock ();
+    const uint64_t now = clock.now_ms ();
+    entry_t &entry = entries [hashed_key];
+    entry.expiry = now + ttl_;
+    entry.metadata = metadata_;
+    if (entries.size () >= 2 * pruned_size + 64)
+        prune (now);
+    sync.unlock ();
+}
+
+std::string zmq::zap_cache_t::digest (const std::string &key_)
+{
+#ifdef HAVE_LIBSODIUM
+    unsigned char hash [crypto_generichash_BYTES];
+    const int rc = crypto_generichash (hash, sizeof hash,
+        (const unsigned char *) key_.data (), key_.size (), NULL, 0);
+    zmq_assert (rc == 0);
+#else
+    unsigned char hash [sha256_digest_size];
+    sha256 (key_.data (), key_.size (), hash);
+#endif
+    return std::string ((const char *) hash, sizeof hash);
+}
+
+void zmq::zap_cache_t::prune (uint64_t now_)
+{
+    entries_t::iterator it = entries.begin ();
+    while (it != entries.end ()) {
+        if (it->second.expiry <= now_)
+            entries.erase (it++);
+        else
+            ++it;
+    }
+    pruned_size = entries.size ();
+}
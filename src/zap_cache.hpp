@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_ZAP_CACHE_HPP_INCLUDED__
+#define __ZMQ_ZAP_CACHE_HPP_INCLUDED__
+
+#include <map>
+#include <string>
+
+#include "clock.hpp"
+#include "mutex.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Cache of successful ZAP authentications, shared by all the sockets
+    //  in the context. The key identifies the domain, mechanism, peer
+    //  address and credentials presented; the value is the metadata
+    //  returned by the ZAP handler. Entries are stored under a digest of
+    //  the key, so that credentials such as PLAIN passwords are not kept
+    //  in memory. Entries expire after the time-to-live given when they
+    //  were stored. The cache is accessed from I/O threads.
+
+    class zap_cache_t
+    {
+    public:
+
+        zap_cache_t ();
+        ~zap_cache_t ();
+
+        //  Looks up the key. Returns true and fills in the metadata if
+        //  there's a live entry for it.
+        bool find (const std::string &key_, std::string &metadata_);
+
+        //  Stores the result of an authentication for 'ttl_' milliseconds.
+        void insert (const std::string &key_, const std::string &metadata_,
+            int ttl_);
+
+    private:
+
+        struct entry_t
+        {
+            uint64_t expiry;
+            std::string metadata;
+        };
+
+        //  Returns the digest the entry for the key is stored under.
+        static std::string digest (const std::string &key_);
+
+        //  Drops all the expired entries.
+        void prune (uint64_t now_);
+
+        typedef std::map <std::string, entry_t> entries_t;
+        entries_t entries;
+
+        //  Number of entries left after the last prune. The cache is
+        //  pruned once it grows to twice as much.
+        size_t pruned_size;
+
+        clock_t clock;
+
+        mutex_t sync;
+
+        zap_cache_t (const zap_cache_t&);
+        const zap_cache_t &operator = (const zap_cache_t&);
+    };
+
+}
+
+#endif
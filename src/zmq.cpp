@@ -70,6 +70,10 @@ struct iovec {
 
 #include "proxy.hpp"
 #include "socket_base.hpp"
+#include "socket_poller.hpp"
+#include "reactor.hpp"
+#include "io_proxy.hpp"
+#include "io_thread.hpp"
 #include "stdint.hpp"
 #include "config.hpp"
 #include "likely.hpp"
@@ -1014,6 +1018,222 @@ int zmq_poll (zmq_pollitem_t *items_, int nitems_, long timeout_)
 #undef ZMQ_POLL_BASED_ON_POLL
 #endif
 
+//  The persistent poller
+
+void *zmq_poller_new (void)
+{
+    zmq::socket_poller_t *poller = new (std::nothrow) zmq::socket_poller_t;
+    alloc_assert (poller);
+    return poller;
+}
+
+int zmq_poller_destroy (void **poller_p_)
+{
+    if (!poller_p_ || !*poller_p_ ||
+          !((zmq::socket_poller_t*) *poller_p_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    delete (zmq::socket_poller_t*) *poller_p_;
+    *poller_p_ = NULL;
+    return 0;
+}
+
+int zmq_poller_add (void *poller_, void *s_, void *user_data_, short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->add (
+        (zmq::socket_base_t*) s_, user_data_, events_);
+}
+
+int zmq_poller_modify (void *poller_, void *s_, short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->modify (
+        (zmq::socket_base_t*) s_, events_);
+}
+
+int zmq_poller_remove (void *poller_, void *s_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->remove (
+        (zmq::socket_base_t*) s_);
+}
+
+int zmq_poller_add_fd (void *poller_, zmq::fd_t fd_, void *user_data_,
+    short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->add_fd (
+        fd_, user_data_, events_);
+}
+
+int zmq_poller_modify_fd (void *poller_, zmq::fd_t fd_, short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->modify_fd (fd_, events_);
+}
+
+int zmq_poller_remove_fd (void *poller_, zmq::fd_t fd_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->remove_fd (fd_);
+}
+
+int zmq_poller_wait (void *poller_, zmq_poller_event_t *event_, long timeout_)
+{
+    const int rc = zmq_poller_wait_all (poller_, event_, 1, timeout_);
+    return rc < 0 ? rc : 0;
+}
+
+int zmq_poller_wait_all (void *poller_, zmq_poller_event_t *events_,
+    int n_events_, long timeout_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->wait (
+        events_, n_events_, timeout_);
+}
+
+//  The reactor
+
+void *zmq_reactor_new (void)
+{
+    zmq::reactor_t *reactor = new (std::nothrow) zmq::reactor_t;
+    alloc_assert (reactor);
+    return reactor;
+}
+
+int zmq_reactor_destroy (void **reactor_p_)
+{
+    if (!reactor_p_ || !*reactor_p_ ||
+          !((zmq::reactor_t*) *reactor_p_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    delete (zmq::reactor_t*) *reactor_p_;
+    *reactor_p_ = NULL;
+    return 0;
+}
+
+int zmq_reactor_add (void *reactor_, void *s_, short events_,
+    zmq_reactor_fn *handler_, void *arg_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->add (
+        (zmq::socket_base_t*) s_, events_, handler_, arg_);
+}
+
+int zmq_reactor_remove (void *reactor_, void *s_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->remove ((zmq::socket_base_t*) s_);
+}
+
+int zmq_reactor_add_fd (void *reactor_, zmq::fd_t fd_, short events_,
+    zmq_reactor_fn *handler_, void *arg_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->add_fd (
+        fd_, events_, handler_, arg_);
+}
+
+int zmq_reactor_remove_fd (void *reactor_, zmq::fd_t fd_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->remove_fd (fd_);
+}
+
+int zmq_reactor_add_timer (void *reactor_, long interval_, int times_,
+    zmq_timer_fn *handler_, void *arg_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->add_timer (
+        interval_, times_, handler_, arg_);
+}
+
+int zmq_reactor_cancel_timer (void *reactor_, int timer_id_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->cancel_timer (timer_id_);
+}
+
+int zmq_reactor_run (void *reactor_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->run ();
+}
+
+int zmq_reactor_run_once (void *reactor_, long timeout_)
+{
+    if (!reactor_ || !((zmq::reactor_t*) reactor_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::reactor_t*) reactor_)->run_once (timeout_);
+}
+
 //  The proxy functionality
 
 int zmq_proxy (void *frontend_, void *backend_, void *capture_)
@@ -1041,6 +1261,92 @@ int zmq_proxy_steerable (void *frontend_, void *backend_, void *capture_, void *
         (zmq::socket_base_t*) control_);
 }
 
+int zmq_proxy_detached (void *frontend_, void *backend_, void *capture_,
+    void *control_)
+{
+    if (!frontend_ || !backend_) {
+        errno = EFAULT;
+        return -1;
+    }
+    zmq::socket_base_t *sockets [] = {
+        (zmq::socket_base_t*) frontend_,
+        (zmq::socket_base_t*) backend_,
+        (zmq::socket_base_t*) capture_,
+        (zmq::socket_base_t*) control_
+    };
+    for (int i = 0; i != 4; i++)
+        if (sockets [i] && !sockets [i]->check_tag ()) {
+            errno = ENOTSOCK;
+            return -1;
+        }
+
+    //  All the sockets are handed over to one of the context's I/O threads.
+    zmq::ctx_t *ctx = sockets [0]->get_ctx ();
+    for (int i = 1; i != 4; i++)
+        if (sockets [i] && sockets [i]->get_ctx () != ctx) {
+            errno = EINVAL;
+            return -1;
+        }
+
+    zmq::io_thread_t *io_thread = ctx->choose_io_thread (0);
+    if (!io_thread) {
+        errno = EMTHREAD;
+        return -1;
+    }
+
+    zmq::io_proxy_t *proxy = new (std::nothrow) zmq::io_proxy_t (io_thread,
+        sockets [0], sockets [1], sockets [2], sockets [3]);
+    alloc_assert (proxy);
+    proxy->start ();
+    return 0;
+}
+
+int zmq_proxy_sharded (void **frontends_, void **backends_, int shards_,
+    const char *frontend_endpoint_, const char *backend_endpoint_,
+    int strategy_, void *control_)
+{
+    if (!frontends_ || !backends_) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (shards_ < 1 || (strategy_ != ZMQ_PROXY_SHARD_ROUND_ROBIN
+                    &&  strategy_ != ZMQ_PROXY_SHARD_HASH)) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int i = 0; i != shards_; i++)
+        if (!frontends_ [i] || !backends_ [i]) {
+            errno = EFAULT;
+            return -1;
+        }
+    if (control_ && !((zmq::socket_base_t*) control_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+
+    //  The workers steered by the calling thread talk to it over inproc,
+    //  so all the sockets have to live in the same context.
+    zmq::ctx_t *ctx = ((zmq::socket_base_t*) frontends_ [0])->get_ctx ();
+    for (int i = 0; i != shards_; i++) {
+        zmq::socket_base_t *frontend = (zmq::socket_base_t*) frontends_ [i];
+        zmq::socket_base_t *backend = (zmq::socket_base_t*) backends_ [i];
+        if (!frontend->check_tag () || !backend->check_tag ()) {
+            errno = ENOTSOCK;
+            return -1;
+        }
+        if (frontend->get_ctx () != ctx || backend->get_ctx () != ctx) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    return zmq::proxy_sharded (
+        (zmq::socket_base_t**) frontends_,
+        (zmq::socket_base_t**) backends_,
+        shards_, frontend_endpoint_, backend_endpoint_, strategy_,
+        (zmq::socket_base_t*) control_);
+}
+
 //  The deprecated device functionality
 
 int zmq_device (int /* type */, void *frontend_, void *backend_)
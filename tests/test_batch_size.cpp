@@ -0,0 +1,160 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "testutil.hpp"
+#include <string.h>
+
+//  Sends messages of all sizes from 0 to 599 bytes and checks that they
+//  arrive intact.
+static void send_and_check (void *push, void *pull, int rounds)
+{
+    unsigned char buffer [600];
+    for (int round = 0; round != rounds; round++) {
+        for (int size = 0; size != 600; size++) {
+            for (int i = 0; i != size; i++)
+                buffer [i] = (unsigned char) (size + i);
+            int rc = zmq_send (push, buffer, size, 0);
+            assert (rc == size);
+        }
+        for (int size = 0; size != 600; size++) {
+            int rc = zmq_recv (pull, buffer, sizeof buffer, 0);
+            assert (rc == size);
+            for (int i = 0; i != size; i++)
+                assert (buffer [i] == (unsigned char) (size + i));
+        }
+    }
+}
+
+//  Buffers far smaller than the frames split headers and bodies across
+//  reads and writes.
+static void test_small_batches (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int size = 7;
+    int rc = zmq_setsockopt (pull, ZMQ_IN_BATCH_SIZE, &size, sizeof size);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5601");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    size = 5;
+    rc = zmq_setsockopt (push, ZMQ_OUT_BATCH_SIZE, &size, sizeof size);
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5601");
+    assert (rc == 0);
+
+    send_and_check (push, pull, 2);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+//  Adaptive buffers grow under a burst and shrink back while the traffic
+//  trickles, without losing or mangling anything on the way.
+static void test_adaptive (void *ctx)
+{
+    int adaptive = 1;
+    int size = 64;
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_ADAPTIVE_BATCH, &adaptive,
+        sizeof adaptive);
+    assert (rc == 0);
+    rc = zmq_setsockopt (pull, ZMQ_IN_BATCH_SIZE, &size, sizeof size);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5602");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_ADAPTIVE_BATCH, &adaptive,
+        sizeof adaptive);
+    assert (rc == 0);
+    rc = zmq_setsockopt (push, ZMQ_OUT_BATCH_SIZE, &size, sizeof size);
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5602");
+    assert (rc == 0);
+
+    send_and_check (push, pull, 10);
+
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_send (push, &i, sizeof i, 0);
+        assert (rc == sizeof i);
+        int j;
+        rc = zmq_recv (pull, &j, sizeof j, 0);
+        assert (rc == sizeof j && j == i);
+    }
+
+    send_and_check (push, pull, 1);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+    int value = 0;
+    int rc = zmq_setsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 16777217;
+    rc = zmq_setsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 2;
+    rc = zmq_setsockopt (socket, ZMQ_ADAPTIVE_BATCH, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    size_t value_size = sizeof value;
+    rc = zmq_getsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, &value_size);
+    assert (rc == 0 && value == 8192);
+    rc = zmq_getsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, &value_size);
+    assert (rc == 0 && value == 8192);
+    rc = zmq_getsockopt (socket, ZMQ_ADAPTIVE_BATCH, &value, &value_size);
+    assert (rc == 0 && value == 0);
+    value = 262144;
+    rc = zmq_setsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_getsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, &value_size);
+    assert (rc == 0 && value == 262144);
+    value = 16777216;
+    rc = zmq_setsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    test_small_batches (ctx);
+    test_adaptive (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
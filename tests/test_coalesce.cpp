@@ -0,0 +1,192 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "testutil.hpp"
+#include <string.h>
+#include <stdlib.h>
+
+//  A lone small message goes out once the deadline passes.
+static void test_deadline (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:5603");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int ivl = 50000;
+    rc = zmq_setsockopt (push, ZMQ_COALESCE_IVL, &ivl, sizeof ivl);
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5603");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i != 3; i++) {
+        void *watch = zmq_stopwatch_start ();
+        rc = zmq_send (push, "ABC", 3, 0);
+        assert (rc == 3);
+        char buffer [16];
+        rc = zmq_recv (pull, buffer, sizeof buffer, 0);
+        assert (rc == 3);
+        const unsigned long elapsed = zmq_stopwatch_stop (watch);
+        assert (elapsed >= 40000 && elapsed < 1000000);
+    }
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+//  Enough data held back are written out without waiting for the deadline,
+//  and whatever is held back when the socket closes goes out with it.
+static void test_size (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int timeout = 200;
+    int rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5604");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int ivl = 10000000;
+    rc = zmq_setsockopt (push, ZMQ_COALESCE_IVL, &ivl, sizeof ivl);
+    assert (rc == 0);
+    int size = 100;
+    rc = zmq_setsockopt (push, ZMQ_COALESCE_SIZE, &size, sizeof size);
+    assert (rc == 0);
+    int linger = 1000;
+    rc = zmq_setsockopt (push, ZMQ_LINGER, &linger, sizeof linger);
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5604");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    //  Each message takes 12 bytes on the wire; the ninth one crosses
+    //  the threshold.
+    char buffer [16];
+    for (int i = 0; i != 8; i++) {
+        rc = zmq_send (push, "0123456789", 10, 0);
+        assert (rc == 10);
+    }
+    rc = zmq_recv (pull, buffer, sizeof buffer, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_send (push, "0123456789", 10, 0);
+    assert (rc == 10);
+    for (int i = 0; i != 9; i++) {
+        rc = zmq_recv (pull, buffer, sizeof buffer, 0);
+        assert (rc == 10);
+    }
+
+    rc = zmq_send (push, "ABC", 3, 0);
+    assert (rc == 3);
+    rc = zmq_recv (pull, buffer, sizeof buffer, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_recv (pull, buffer, sizeof buffer, 0);
+    assert (rc == 3);
+
+    close_zero_linger (pull);
+}
+
+//  Data held back combine with buffers that grow and shrink with the
+//  traffic, and with large messages passed straight out of their bodies.
+static void test_adaptive (void *ctx)
+{
+    //  All the messages are sent before any is received.
+    int hwm = 0;
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5606");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    int ivl = 1000;
+    rc = zmq_setsockopt (push, ZMQ_COALESCE_IVL, &ivl, sizeof ivl);
+    assert (rc == 0);
+    int adaptive = 1;
+    rc = zmq_setsockopt (push, ZMQ_ADAPTIVE_BATCH, &adaptive,
+        sizeof adaptive);
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5606");
+    assert (rc == 0);
+
+    const int count = 200000;
+    const size_t large = 100000;
+    unsigned char *buffer = (unsigned char*) malloc (large);
+    assert (buffer);
+    for (int i = 0; i != count; i++) {
+        const size_t size = i % 10000 == 0 ? large : 16;
+        memset (buffer, 0, size);
+        memcpy (buffer, &i, sizeof i);
+        rc = zmq_send (push, buffer, size, 0);
+        assert (rc == (int) size);
+    }
+    for (int i = 0; i != count; i++) {
+        rc = zmq_recv (pull, buffer, large, 0);
+        assert (rc == (i % 10000 == 0 ? (int) large : 16));
+        int seq;
+        memcpy (&seq, buffer, sizeof seq);
+        assert (seq == i);
+    }
+    free (buffer);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+    int value = -1;
+    int rc = zmq_setsockopt (socket, ZMQ_COALESCE_IVL, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (socket, ZMQ_COALESCE_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    size_t value_size = sizeof value;
+    rc = zmq_getsockopt (socket, ZMQ_COALESCE_IVL, &value, &value_size);
+    assert (rc == 0 && value == 0);
+    rc = zmq_getsockopt (socket, ZMQ_COALESCE_SIZE, &value, &value_size);
+    assert (rc == 0 && value == 0);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    test_deadline (ctx);
+    test_size (ctx);
+    test_adaptive (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -19,6 +19,54 @@
 
 #include "testutil.hpp"
 
+//  Host names are looked up in the background; a name that doesn't resolve
+//  neither blocks nor fails the connect.
+static void test_unresolved_name (void *ctx)
+{
+    void *sock = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sock);
+
+    void *watch = zmq_stopwatch_start ();
+    int rc = zmq_connect (sock, "tcp://nonexistent.invalid:1234");
+    assert (rc == 0);
+    assert (zmq_stopwatch_stop (watch) < 100000);
+
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (sock, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    assert (streq (endpoint, "tcp://nonexistent.invalid:1234"));
+
+    close_zero_linger (sock);
+}
+
+//  With IPv6 enabled, localhost may resolve to both ::1 and 127.0.0.1.
+//  The address the peer doesn't listen on must not hold the connection up
+//  until the next reconnection attempt.
+static void test_resolved_name (void *ctx)
+{
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    int rc = zmq_bind (sb, "tcp://127.0.0.1:5596");
+    assert (rc == 0);
+
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    int ipv6 = 1;
+    rc = zmq_setsockopt (sc, ZMQ_IPV6, &ipv6, sizeof ipv6);
+    assert (rc == 0);
+    int ivl = 60000;
+    rc = zmq_setsockopt (sc, ZMQ_RECONNECT_IVL, &ivl, sizeof ivl);
+    assert (rc == 0);
+    rc = zmq_connect (sc, "tcp://localhost:5596");
+    assert (rc == 0);
+
+    bounce (sb, sc);
+
+    close_zero_linger (sc);
+    close_zero_linger (sb);
+}
+
 int main (void)
 {
     setup_test_environment();
@@ -46,6 +94,9 @@ int main (void)
     rc = zmq_close (sock);
     assert (rc == 0);
 
+    test_unresolved_name (ctx);
+    test_resolved_name (ctx);
+
     rc = zmq_ctx_term (ctx);
     assert (rc == 0);
 
@@ -31,6 +31,7 @@ int main (void)
     assert (zmq_ctx_get (ctx, ZMQ_MAX_SOCKETS) == ZMQ_MAX_SOCKETS_DFLT);
     assert (zmq_ctx_get (ctx, ZMQ_IO_THREADS) == ZMQ_IO_THREADS_DFLT);
     assert (zmq_ctx_get (ctx, ZMQ_IPV6) == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CRYPTO_THREADS) == ZMQ_CRYPTO_THREADS_DFLT);
     
     rc = zmq_ctx_set (ctx, ZMQ_IPV6, true);
     assert (zmq_ctx_get (ctx, ZMQ_IPV6) == 1);
@@ -48,5 +49,32 @@ int main (void)
     rc = zmq_ctx_term (ctx);
     assert (rc == 0);
 
+    //  Crypto workers are started with the first socket and must not
+    //  get in the way of connections that don't use encryption.
+    ctx = zmq_ctx_new ();
+    assert (ctx);
+    rc = zmq_ctx_set (ctx, ZMQ_CRYPTO_THREADS, -1);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_CRYPTO_THREADS, 2);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CRYPTO_THREADS) == 2);
+
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    rc = zmq_bind (server, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_connect (client, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+
+    bounce (server, client);
+
+    close_zero_linger (client);
+    close_zero_linger (server);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
     return 0;
 }
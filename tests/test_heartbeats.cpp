@@ -0,0 +1,202 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static void
+set_heartbeats (void *socket, int ivl, int timeout)
+{
+    int rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_IVL, &ivl, sizeof ivl);
+    assert (rc == 0);
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_TIMEOUT, &timeout,
+        sizeof timeout);
+    assert (rc == 0);
+}
+
+static void
+test_options (void *ctx)
+{
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+
+    int value = -1;
+    size_t value_size = sizeof value;
+    int rc = zmq_getsockopt (socket, ZMQ_HEARTBEAT_IVL, &value, &value_size);
+    assert (rc == 0 && value == 0);
+    rc = zmq_getsockopt (socket, ZMQ_HEARTBEAT_TIMEOUT, &value, &value_size);
+    assert (rc == 0 && value == -1);
+
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_IVL, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 6553600;
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_TTL, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 6553599;
+    rc = zmq_setsockopt (socket, ZMQ_HEARTBEAT_TTL, &value, sizeof value);
+    assert (rc == 0);
+    value = 0;
+    rc = zmq_getsockopt (socket, ZMQ_HEARTBEAT_TTL, &value, &value_size);
+    assert (rc == 0 && value == 6553599);
+
+    rc = zmq_close (socket);
+    assert (rc == 0);
+}
+
+//  Heartbeats keep flowing over an idle connection without showing up
+//  as messages on either side.
+static void
+test_idle_connection (void *ctx)
+{
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    set_heartbeats (sb, 20, 200);
+    int ttl = 500;
+    int rc = zmq_setsockopt (sb, ZMQ_HEARTBEAT_TTL, &ttl, sizeof ttl);
+    assert (rc == 0);
+    rc = zmq_bind (sb, "tcp://127.0.0.1:5593");
+    assert (rc == 0);
+
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    set_heartbeats (sc, 30, -1);
+    rc = zmq_connect (sc, "tcp://127.0.0.1:5593");
+    assert (rc == 0);
+
+    bounce (sb, sc);
+    msleep (300);
+
+    char buffer [16];
+    rc = zmq_recv (sb, buffer, sizeof buffer, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_recv (sc, buffer, sizeof buffer, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    bounce (sb, sc);
+
+    close_zero_linger (sc);
+    close_zero_linger (sb);
+}
+
+//  Accepts a connection and completes the ZMTP handshake as a ROUTER,
+//  then never answers again. Returns the connection.
+static int
+accept_silent_peer (int listener)
+{
+    int s = accept (listener, NULL, NULL);
+    assert (s != -1);
+
+    unsigned char greeting [64];
+    memset (greeting, 0, sizeof greeting);
+    greeting [0] = 0xff;
+    greeting [9] = 0x7f;
+    greeting [10] = 3;
+    memcpy (greeting + 12, "NULL", 4);
+    ssize_t rc = send (s, greeting, sizeof greeting, 0);
+    assert (rc == (ssize_t) sizeof greeting);
+
+    const unsigned char ready [] = {
+        0x04, 28, 5, 'R', 'E', 'A', 'D', 'Y',
+        11, 'S', 'o', 'c', 'k', 'e', 't', '-', 'T', 'y', 'p', 'e',
+        0, 0, 0, 6, 'R', 'O', 'U', 'T', 'E', 'R'
+    };
+    rc = send (s, ready, sizeof ready, 0);
+    assert (rc == (ssize_t) sizeof ready);
+    return s;
+}
+
+//  A DEALER drops the pipe to a peer that stopped answering heartbeats,
+//  so its messages all go to the peer that is still alive.
+static void
+test_dead_peer (void *ctx)
+{
+    int listener = socket (AF_INET, SOCK_STREAM, 0);
+    assert (listener != -1);
+    int on = 1;
+    int rc = setsockopt (listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    assert (rc == 0);
+    struct sockaddr_in addr;
+    memset (&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (5594);
+    addr.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    rc = bind (listener, (struct sockaddr*) &addr, sizeof addr);
+    assert (rc == 0);
+    rc = listen (listener, 1);
+    assert (rc == 0);
+
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    rc = zmq_bind (router, "tcp://127.0.0.1:5595");
+    assert (rc == 0);
+
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    set_heartbeats (dealer, 50, 100);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5594");
+    assert (rc == 0);
+    int silent = accept_silent_peer (listener);
+
+    //  Further connection attempts to the silent peer are refused.
+    rc = close (listener);
+    assert (rc == 0);
+
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5595");
+    assert (rc == 0);
+    msleep (500);
+
+    for (int i = 0; i != 10; i++) {
+        rc = zmq_send (dealer, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    int timeout = 1000;
+    rc = zmq_setsockopt (router, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    for (int i = 0; i != 10; i++) {
+        char buffer [255];
+        rc = zmq_recv (router, buffer, sizeof buffer, 0);
+        assert (rc > 0);
+        rc = zmq_recv (router, buffer, sizeof buffer, 0);
+        assert (rc == 3);
+    }
+
+    rc = close (silent);
+    assert (rc == 0);
+    close_zero_linger (dealer);
+    close_zero_linger (router);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_idle_connection (ctx);
+    test_dead_peer (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
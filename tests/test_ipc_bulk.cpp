@@ -0,0 +1,317 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#if defined ZMQ_HAVE_MEMFD
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#define THRESHOLD 65536
+
+static void
+send_pattern (void *socket, size_t size, int seq, int flags)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, size);
+    assert (rc == 0);
+    unsigned char *data = (unsigned char*) zmq_msg_data (&msg);
+    for (size_t i = 0; i != size; i++)
+        data [i] = (unsigned char) (i * 13 + seq);
+    rc = zmq_msg_send (&msg, socket, flags);
+    assert (rc == (int) size);
+}
+
+//  Returns true iff 'data' lies in a mapping of a memfd. Page alignment
+//  alone doesn't tell, as small bodies end up page aligned by chance.
+static bool
+is_mapped (const void *data)
+{
+#if defined ZMQ_HAVE_MEMFD
+    FILE *maps = fopen ("/proc/self/maps", "r");
+    assert (maps);
+    char line [512];
+    bool mapped = false;
+    while (!mapped && fgets (line, sizeof line, maps)) {
+        unsigned long start, end;
+        if (sscanf (line, "%lx-%lx", &start, &end) == 2 &&
+              (unsigned long) data >= start && (unsigned long) data < end)
+            mapped = strstr (line, "memfd:") != NULL;
+    }
+    fclose (maps);
+    return mapped;
+#else
+    (void) data;
+    return false;
+#endif
+}
+
+//  Returns true iff the body was mapped from a passed descriptor rather
+//  than read from the socket.
+static bool
+recv_pattern (void *socket, size_t size, int seq, bool more)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, socket, 0);
+    assert (rc == (int) size);
+    assert (zmq_msg_more (&msg) == (more ? 1 : 0));
+    const unsigned char *data = (const unsigned char*) zmq_msg_data (&msg);
+    for (size_t i = 0; i != size; i++)
+        assert (data [i] == (unsigned char) (i * 13 + seq));
+    const bool mapped = is_mapped (data);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    return mapped;
+}
+
+static void
+test_transfer (void *ctx, const char *endpoint, int threshold,
+    bool expect_mapped)
+{
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    int rc = zmq_bind (sb, endpoint);
+    assert (rc == 0);
+
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_setsockopt (sc, ZMQ_IPC_BULK_THRESHOLD, &threshold,
+        sizeof threshold);
+    assert (rc == 0);
+    rc = zmq_connect (sc, endpoint);
+    assert (rc == 0);
+
+    //  Small frames travel in band around the large one.
+    send_pattern (sc, 10, 1, ZMQ_SNDMORE);
+    send_pattern (sc, 3 * 1024 * 1024, 2, ZMQ_SNDMORE);
+    send_pattern (sc, THRESHOLD - 1, 3, 0);
+    assert (!recv_pattern (sb, 10, 1, true));
+    assert (recv_pattern (sb, 3 * 1024 * 1024, 2, true) == expect_mapped);
+    assert (!recv_pattern (sb, THRESHOLD - 1, 3, false));
+
+    //  Lots of descriptors in flight at once keep their order.
+    for (int i = 0; i != 200; i++)
+        send_pattern (sc, THRESHOLD + i, i, 0);
+    for (int i = 0; i != 200; i++)
+        assert (recv_pattern (sb, THRESHOLD + i, i, false) == expect_mapped);
+
+    //  Only the sender's threshold matters.
+    send_pattern (sb, 1024 * 1024, 4, 0);
+    assert (!recv_pattern (sc, 1024 * 1024, 4, false));
+
+    close_zero_linger (sc);
+    close_zero_linger (sb);
+}
+
+#if defined ZMQ_HAVE_MEMFD
+//  Sends 'data_' over a raw connection, passing 'count_' copies of 'fd_'
+//  along with it.
+static void
+raw_send (int s_, const void *data_, size_t size_, int fd_, int count_)
+{
+    union {
+        struct cmsghdr align;
+        unsigned char buf [CMSG_SPACE (sizeof (int) * 64)];
+    } control;
+    struct iovec iov = {const_cast <void*> (data_), size_};
+    struct msghdr hdr;
+    memset (&hdr, 0, sizeof hdr);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    if (count_ > 0) {
+        assert (count_ <= 64);
+        hdr.msg_control = control.buf;
+        hdr.msg_controllen = CMSG_SPACE (sizeof (int) * count_);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR (&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN (sizeof (int) * count_);
+        int *fds = (int*) CMSG_DATA (cmsg);
+        for (int i = 0; i != count_; i++)
+            fds [i] = fd_;
+    }
+    const ssize_t n = sendmsg (s_, &hdr, 0);
+    assert (n == (ssize_t) size_);
+}
+
+static void
+raw_recv (int s_, unsigned char *data_, size_t size_)
+{
+    while (size_ > 0) {
+        const ssize_t n = recv (s_, data_, size_, 0);
+        assert (n > 0);
+        data_ += n;
+        size_ -= n;
+    }
+}
+
+//  Connects a hand-written ZMTP 3.0 peer to 'path_' and goes through the
+//  handshake, offering bulk frames or not.
+static int
+raw_connect (const char *path_, bool bulk_)
+{
+    const int s = socket (AF_UNIX, SOCK_STREAM, 0);
+    assert (s != -1);
+    struct sockaddr_un addr;
+    memset (&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, path_);
+    int rc = connect (s, (struct sockaddr*) &addr, sizeof addr);
+    assert (rc == 0);
+
+    unsigned char greeting [64];
+    memset (greeting, 0, sizeof greeting);
+    greeting [0] = 0xff;
+    greeting [9] = 0x7f;
+    greeting [10] = 3;
+    memcpy (greeting + 12, "NULL", 4);
+    raw_send (s, greeting, sizeof greeting, -1, 0);
+
+    unsigned char ready [64];
+    size_t size = 2;
+    memcpy (ready + size, "\5READY", 6);
+    size += 6;
+    memcpy (ready + size, "\13Socket-Type\0\0\0\4PAIR", 20);
+    size += 20;
+    if (bulk_) {
+        memcpy (ready + size, "\7Bulk-Fd\0\0\0\0", 12);
+        size += 12;
+    }
+    ready [0] = 0x04;
+    ready [1] = (unsigned char) (size - 2);
+    raw_send (s, ready, size, -1, 0);
+
+    //  Frames sent before the peer's READY command would be taken for
+    //  handshake commands.
+    raw_recv (s, greeting, sizeof greeting);
+    unsigned char command [257];
+    raw_recv (s, command, 2);
+    assert (command [0] == 0x04);
+    raw_recv (s, command + 2, command [1]);
+    return s;
+}
+
+//  Descriptors passed by a peer that didn't agree to bulk frames are
+//  closed straight away, and a peer that did can't pile them up.
+static void
+test_unsolicited_fds (void *ctx, bool bulk)
+{
+    //  Each run binds a path of its own, as the previous listener removes
+    //  its path when it's torn down in the background.
+    const char *path =
+        bulk ? "/tmp/tester_bulk_raw_on" : "/tmp/tester_bulk_raw";
+    char endpoint [64];
+    sprintf (endpoint, "ipc://%s", path);
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    int rc = zmq_bind (sb, endpoint);
+    assert (rc == 0);
+    const int s = raw_connect (path, bulk);
+
+    //  Once a message got through, the handshake is done with.
+    char buf [8];
+    raw_send (s, "\0\2HI", 4, -1, 0);
+    rc = zmq_recv (sb, buf, sizeof buf, 0);
+    assert (rc == 2 && memcmp (buf, "HI", 2) == 0);
+
+    int pipe_fds [2];
+    rc = pipe (pipe_fds);
+    assert (rc == 0);
+    if (!bulk) {
+        raw_send (s, "\0\2FD", 4, pipe_fds [1], 64);
+        rc = zmq_recv (sb, buf, sizeof buf, 0);
+        assert (rc == 2 && memcmp (buf, "FD", 2) == 0);
+
+        //  The copies were closed before the frame was passed on.
+        rc = close (pipe_fds [1]);
+        assert (rc == 0);
+        rc = fcntl (pipe_fds [0], F_SETFL, O_NONBLOCK);
+        assert (rc == 0);
+        rc = (int) read (pipe_fds [0], buf, 1);
+        assert (rc == 0);
+    }
+    else {
+        //  The frames claim none of the descriptors; the peer is dropped
+        //  once they are more than the frames in flight could claim.
+        for (int i = 0; i != 3; i++)
+            raw_send (s, "\0\1X", 3, pipe_fds [1], 64);
+        ssize_t n;
+        while ((n = recv (s, buf, sizeof buf, 0)) > 0)
+            ;
+        assert (n == 0 || errno == ECONNRESET);
+
+        //  Blocks until the engine has closed its copies.
+        rc = close (pipe_fds [1]);
+        assert (rc == 0);
+        rc = (int) read (pipe_fds [0], buf, 1);
+        assert (rc == 0);
+    }
+
+    rc = close (pipe_fds [0]);
+    assert (rc == 0);
+    rc = close (s);
+    assert (rc == 0);
+    close_zero_linger (sb);
+}
+#endif
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *socket = zmq_socket (ctx, ZMQ_PAIR);
+    assert (socket);
+    int threshold = -1;
+    int rc = zmq_setsockopt (socket, ZMQ_IPC_BULK_THRESHOLD, &threshold,
+        sizeof threshold);
+    assert (rc == -1 && errno == EINVAL);
+    threshold = THRESHOLD;
+    rc = zmq_setsockopt (socket, ZMQ_IPC_BULK_THRESHOLD, &threshold,
+        sizeof threshold);
+    assert (rc == 0);
+    threshold = 0;
+    size_t threshold_size = sizeof threshold;
+    rc = zmq_getsockopt (socket, ZMQ_IPC_BULK_THRESHOLD, &threshold,
+        &threshold_size);
+    assert (rc == 0 && threshold == THRESHOLD);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+#if defined ZMQ_HAVE_MEMFD
+    test_transfer (ctx, "ipc:///tmp/tester_bulk", THRESHOLD, true);
+    test_unsolicited_fds (ctx, false);
+    test_unsolicited_fds (ctx, true);
+#endif
+    test_transfer (ctx, "ipc:///tmp/tester_bulk_off", 0, false);
+    test_transfer (ctx, "tcp://127.0.0.1:5592", THRESHOLD, false);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
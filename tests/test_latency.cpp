@@ -0,0 +1,181 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Finds the line for the endpoint and direction in the latency report
+//  and parses the message count and the median latency from it.
+static bool
+get_latency (void *socket, const char *endpoint, const char *direction,
+    uint64_t *count, uint64_t *median)
+{
+    char report [1024];
+    size_t size = sizeof (report);
+    int rc = zmq_getsockopt (socket, ZMQ_STAT_LATENCY, report, &size);
+    assert (rc == 0);
+    assert (size == strlen (report) + 1);
+
+    char prefix [256];
+    sprintf (prefix, "%s %s ", endpoint, direction);
+    for (char *line = report; *line; line = strchr (line, '\n') + 1) {
+        if (strncmp (line, prefix, strlen (prefix)) == 0) {
+            unsigned long long c, p50, p90, p99, p999, max;
+            rc = sscanf (line + strlen (prefix), "%llu %llu %llu %llu %llu %llu",
+                &c, &p50, &p90, &p99, &p999, &max);
+            assert (rc == 6);
+            assert (p50 <= p90 && p90 <= p99 && p99 <= p999 && p999 <= max);
+            *count = c;
+            *median = p50;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+test_inproc (void *ctx)
+{
+    //  Tracking is enabled on one side only, the other one sees the
+    //  measurements as well.
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int tracking = 1;
+    int rc = zmq_setsockopt (push, ZMQ_LATENCY_TRACKING, &tracking,
+        sizeof (tracking));
+    assert (rc == 0);
+    rc = zmq_bind (push, "inproc://latency");
+    assert (rc == 0);
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_connect (pull, "inproc://latency");
+    assert (rc == 0);
+
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_send (push, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+
+    //  Let the messages sit in the queue for a while.
+    msleep (50);
+
+    char buffer [8];
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_recv (pull, buffer, sizeof (buffer), 0);
+        assert (rc == 3);
+    }
+
+    uint64_t count, median;
+    bool found = get_latency (pull, "*", "in", &count, &median);
+    assert (found);
+    assert (count == 100);
+    assert (median >= 25000000);
+    found = get_latency (pull, "inproc://latency", "in", &count, &median);
+    assert (found);
+    assert (count == 100);
+    found = get_latency (push, "*", "out", &count, &median);
+    assert (found);
+    assert (count == 100);
+    found = get_latency (push, "*", "in", &count, &median);
+    assert (found);
+    assert (count == 0);
+
+    //  Buffer too small to hold the report
+    char small [4];
+    size_t size = sizeof (small);
+    rc = zmq_getsockopt (push, ZMQ_STAT_LATENCY, small, &size);
+    assert (rc == -1 && errno == EINVAL);
+    assert (size > sizeof (small));
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_close (push);
+    assert (rc == 0);
+}
+
+static void
+test_tcp (void *ctx)
+{
+    int tracking = 1;
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_LATENCY_TRACKING, &tracking,
+        sizeof (tracking));
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_LATENCY_TRACKING, &tracking,
+        sizeof (tracking));
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+
+    char buffer [8];
+    for (int i = 0; i != 10; i++) {
+        rc = zmq_send (push, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    for (int i = 0; i != 10; i++) {
+        rc = zmq_recv (pull, buffer, sizeof (buffer), 0);
+        assert (rc == 3);
+    }
+
+    //  Connected side reports the endpoint, accepted connections are
+    //  reported in the aggregate only.
+    uint64_t count, median;
+    bool found = get_latency (push, "tcp://127.0.0.1:5560", "out",
+        &count, &median);
+    assert (found);
+    assert (count == 10);
+    found = get_latency (pull, "*", "in", &count, &median);
+    assert (found);
+    assert (count == 10);
+
+    //  Measurements survive the disconnection.
+    rc = zmq_disconnect (push, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+    found = get_latency (push, "tcp://127.0.0.1:5560", "out",
+        &count, &median);
+    assert (found);
+    assert (count == 10);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_close (push);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_inproc (ctx);
+    test_tcp (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,238 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Reads the next event from the monitor, returns false on timeout.
+static bool
+get_event (void *monitor, zmq_event_t *event, std::string *endpoint)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, monitor, 0);
+    if (rc == -1) {
+        assert (zmq_errno () == EAGAIN);
+        zmq_msg_close (&msg);
+        return false;
+    }
+    assert (zmq_msg_more (&msg));
+    const char *data = (const char *) zmq_msg_data (&msg);
+    memcpy (&event->event, data, sizeof (event->event));
+    memcpy (&event->value, data + sizeof (event->event), sizeof (event->value));
+    rc = zmq_msg_recv (&msg, monitor, 0);
+    assert (rc != -1);
+    assert (!zmq_msg_more (&msg));
+    *endpoint = std::string ((const char *) zmq_msg_data (&msg),
+        zmq_msg_size (&msg));
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    return true;
+}
+
+static void *
+open_monitor (void *ctx, void *socket, const char *addr, int events)
+{
+    int rc = zmq_socket_monitor (socket, addr, events);
+    assert (rc == 0);
+    void *monitor = zmq_socket (ctx, ZMQ_PAIR);
+    assert (monitor);
+    int timeout = 1000;
+    rc = zmq_setsockopt (monitor, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_connect (monitor, addr);
+    assert (rc == 0);
+    return monitor;
+}
+
+static void
+test_watermarks (void *ctx)
+{
+    int hwm = 5;
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_bind (pull, "inproc://watermarks");
+    assert (rc == 0);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    int interval = 0;
+    rc = zmq_setsockopt (push, ZMQ_MONITOR_INTERVAL, &interval,
+        sizeof (interval));
+    assert (rc == 0);
+    void *monitor = open_monitor (ctx, push, "inproc://monitor.watermarks",
+        ZMQ_EVENT_HWM_REACHED | ZMQ_EVENT_LWM_DRAINED);
+    rc = zmq_connect (push, "inproc://watermarks");
+    assert (rc == 0);
+
+    //  Fill the pipe up
+    int sent = 0;
+    while (zmq_send (push, "ABC", 3, ZMQ_DONTWAIT) == 3)
+        sent++;
+    assert (sent == 10);
+
+    zmq_event_t event;
+    std::string endpoint;
+    bool found = get_event (monitor, &event, &endpoint);
+    assert (found);
+    assert (event.event == ZMQ_EVENT_HWM_REACHED);
+    assert (event.value == 1);
+    assert (endpoint == "inproc://watermarks");
+
+    //  Drain it and let the sender notice
+    char buffer [8];
+    for (int i = 0; i != sent; i++) {
+        rc = zmq_recv (pull, buffer, sizeof (buffer), 0);
+        assert (rc == 3);
+    }
+    int events;
+    size_t size = sizeof (events);
+    rc = zmq_getsockopt (push, ZMQ_EVENTS, &events, &size);
+    assert (rc == 0);
+    assert (events & ZMQ_POLLOUT);
+
+    found = get_event (monitor, &event, &endpoint);
+    assert (found);
+    assert (event.event == ZMQ_EVENT_LWM_DRAINED);
+    assert (event.value == 1);
+    assert (endpoint == "inproc://watermarks");
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_close (monitor);
+    assert (rc == 0);
+}
+
+static void
+test_dropped (void *ctx)
+{
+    int hwm = 1;
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    int rc = zmq_setsockopt (pub, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    int interval = 10;
+    rc = zmq_setsockopt (pub, ZMQ_MONITOR_INTERVAL, &interval,
+        sizeof (interval));
+    assert (rc == 0);
+    rc = zmq_bind (pub, "inproc://dropped");
+    assert (rc == 0);
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_setsockopt (sub, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "", 0);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "inproc://dropped");
+    assert (rc == 0);
+    void *monitor = open_monitor (ctx, pub, "inproc://monitor.dropped",
+        ZMQ_EVENT_MSGS_DROPPED | ZMQ_EVENT_THROUGHPUT);
+
+    //  First message takes the initial sample, the rest are dropped
+    //  except for the two that fit into the pipe.
+    for (int i = 0; i != 10; i++) {
+        rc = zmq_send (pub, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    msleep (2 * interval);
+    rc = zmq_send (pub, "ABC", 3, 0);
+    assert (rc == 3);
+
+    int dropped = 0;
+    bool throughput = false;
+    zmq_event_t event;
+    std::string endpoint;
+    while (get_event (monitor, &event, &endpoint)) {
+        if (event.event == ZMQ_EVENT_MSGS_DROPPED)
+            dropped += event.value;
+        else {
+            assert (event.event == ZMQ_EVENT_THROUGHPUT);
+            assert (event.value > 0);
+            throughput = true;
+        }
+    }
+    assert (dropped == 9);
+    assert (throughput);
+
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+    rc = zmq_close (monitor);
+    assert (rc == 0);
+}
+
+static void
+test_handshake (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    void *monitor = open_monitor (ctx, push, "inproc://monitor.handshake",
+        ZMQ_EVENT_HANDSHAKE_SUCCEEDED);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+
+    rc = zmq_send (push, "ABC", 3, 0);
+    assert (rc == 3);
+    char buffer [8];
+    rc = zmq_recv (pull, buffer, sizeof (buffer), 0);
+    assert (rc == 3);
+
+    zmq_event_t event;
+    std::string endpoint;
+    bool found = get_event (monitor, &event, &endpoint);
+    assert (found);
+    assert (event.event == ZMQ_EVENT_HANDSHAKE_SUCCEEDED);
+    assert (event.value >= 0 && event.value < 1000000);
+    assert (endpoint == "tcp://127.0.0.1:5560");
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_close (monitor);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_watermarks (ctx);
+    test_dropped (ctx);
+    test_handshake (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,188 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+#if !defined _WIN32
+#include <unistd.h>
+#endif
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *a = zmq_socket (ctx, ZMQ_PAIR);
+    assert (a);
+    int rc = zmq_bind (a, "inproc://a");
+    assert (rc == 0);
+    void *b = zmq_socket (ctx, ZMQ_PAIR);
+    assert (b);
+    rc = zmq_connect (b, "inproc://a");
+    assert (rc == 0);
+
+    void *poller = zmq_poller_new ();
+    assert (poller);
+
+    //  Invalid arguments
+    rc = zmq_poller_add (poller, NULL, NULL, ZMQ_POLLIN);
+    assert (rc == -1 && errno == ENOTSOCK);
+    rc = zmq_poller_add (NULL, b, NULL, ZMQ_POLLIN);
+    assert (rc == -1 && errno == EFAULT);
+    rc = zmq_poller_remove (poller, b);
+    assert (rc == -1 && errno == EINVAL);
+
+    int tag = 42;
+    rc = zmq_poller_add (poller, b, &tag, ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_poller_add (poller, b, &tag, ZMQ_POLLIN);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Nothing to read yet
+    zmq_poller_event_t event;
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_poller_wait (poller, &event, 10);
+    assert (rc == -1 && errno == EAGAIN);
+
+    rc = zmq_send (a, "A", 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, -1);
+    assert (rc == 0);
+    assert (event.socket == b);
+    assert (event.user_data == &tag);
+    assert (event.events == ZMQ_POLLIN);
+
+    //  The socket is reported until the message is read
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == 0);
+    assert (event.socket == b);
+    char buf [8];
+    rc = zmq_recv (b, buf, sizeof buf, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  Using the socket directly must not hide its events
+    rc = zmq_send (a, "B", 1, 0);
+    assert (rc == 1);
+    msleep (SETTLE_TIME);
+    int events;
+    size_t events_size = sizeof events;
+    rc = zmq_getsockopt (b, ZMQ_EVENTS, &events, &events_size);
+    assert (rc == 0);
+    assert (events & ZMQ_POLLIN);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == 0);
+    assert (event.socket == b);
+    rc = zmq_recv (b, buf, sizeof buf, 0);
+    assert (rc == 1);
+
+    //  Changing the events of interest
+    rc = zmq_poller_modify (poller, b, ZMQ_POLLOUT);
+    assert (rc == 0);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == 0);
+    assert (event.socket == b);
+    assert (event.events == ZMQ_POLLOUT);
+
+    //  Several sockets at once
+    rc = zmq_poller_add (poller, a, NULL, ZMQ_POLLOUT);
+    assert (rc == 0);
+    zmq_poller_event_t events_all [4];
+    rc = zmq_poller_wait_all (poller, events_all, 4, 0);
+    assert (rc == 2);
+    rc = zmq_poller_wait_all (poller, events_all, 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_remove (poller, a);
+    assert (rc == 0);
+    rc = zmq_poller_remove (poller, b);
+    assert (rc == 0);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  Closing a socket removes it from the poller
+    void *c = zmq_socket (ctx, ZMQ_PAIR);
+    assert (c);
+    rc = zmq_bind (c, "inproc://c");
+    assert (rc == 0);
+    void *d = zmq_socket (ctx, ZMQ_PAIR);
+    assert (d);
+    rc = zmq_connect (d, "inproc://c");
+    assert (rc == 0);
+    rc = zmq_poller_add (poller, c, NULL, ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_poller_add (poller, d, NULL, ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_send (d, "C", 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, -1);
+    assert (rc == 0);
+    assert (event.socket == c);
+    close_zero_linger (c);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_poller_remove (poller, d);
+    assert (rc == 0);
+    close_zero_linger (d);
+
+#if !defined _WIN32
+    //  Plain file descriptors
+    int fds [2];
+    rc = pipe (fds);
+    assert (rc == 0);
+    rc = zmq_poller_add_fd (poller, fds [0], &tag, ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = write (fds [1], "x", 1);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, 1000);
+    assert (rc == 0);
+    assert (event.socket == NULL);
+    assert (event.fd == fds [0]);
+    assert (event.user_data == &tag);
+    assert (event.events == ZMQ_POLLIN);
+    rc = zmq_poller_modify_fd (poller, fds [0], 0);
+    assert (rc == 0);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_poller_remove_fd (poller, fds [0]);
+    assert (rc == 0);
+    rc = zmq_poller_remove_fd (poller, fds [0]);
+    assert (rc == -1 && errno == EINVAL);
+    close (fds [0]);
+    close (fds [1]);
+#endif
+
+    rc = zmq_poller_destroy (&poller);
+    assert (rc == 0);
+    assert (poller == NULL);
+
+    rc = zmq_close (a);
+    assert (rc == 0);
+    rc = zmq_close (b);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
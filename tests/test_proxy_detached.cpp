@@ -0,0 +1,158 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Asserts that no message arrives on the socket within a while.
+static void
+expect_nothing (void *socket)
+{
+    zmq_pollitem_t items [] = {{ socket, 0, ZMQ_POLLIN, 0 }};
+    int rc = zmq_poll (items, 1, 100);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  The proxy's sockets
+    void *frontend = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (frontend);
+    int rc = zmq_bind (frontend, "inproc://frontend");
+    assert (rc == 0);
+    void *backend = zmq_socket (ctx, ZMQ_DEALER);
+    assert (backend);
+    rc = zmq_bind (backend, "inproc://backend");
+    assert (rc == 0);
+    void *capture = zmq_socket (ctx, ZMQ_PUSH);
+    assert (capture);
+    rc = zmq_bind (capture, "inproc://capture");
+    assert (rc == 0);
+    void *control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (control);
+    rc = zmq_bind (control, "inproc://control");
+    assert (rc == 0);
+
+    //  The application's sockets
+    void *client = zmq_socket (ctx, ZMQ_REQ);
+    assert (client);
+    rc = zmq_connect (client, "inproc://frontend");
+    assert (rc == 0);
+    void *worker = zmq_socket (ctx, ZMQ_REP);
+    assert (worker);
+    rc = zmq_connect (worker, "inproc://backend");
+    assert (rc == 0);
+    void *sink = zmq_socket (ctx, ZMQ_PULL);
+    assert (sink);
+    rc = zmq_connect (sink, "inproc://capture");
+    assert (rc == 0);
+    void *steer = zmq_socket (ctx, ZMQ_PAIR);
+    assert (steer);
+    rc = zmq_connect (steer, "inproc://control");
+    assert (rc == 0);
+
+    rc = zmq_proxy_detached (NULL, backend, NULL, NULL);
+    assert (rc == -1 && errno == EFAULT);
+    rc = zmq_proxy_detached (frontend, backend, capture, control);
+    assert (rc == 0);
+
+    //  Requests and replies pass through
+    for (int i = 0; i != 10; i++) {
+        s_send (client, "ping");
+        char *request = s_recv (worker);
+        assert (streq (request, "ping"));
+        free (request);
+        s_send (worker, "pong");
+        char *reply = s_recv (client);
+        assert (streq (reply, "pong"));
+        free (reply);
+    }
+
+    //  The capture socket gets a copy of every frame: routing id,
+    //  delimiter and body, in both directions
+    int timeout = 1000;
+    rc = zmq_setsockopt (sink, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    for (int frames = 0; frames != 60; frames++) {
+        zmq_msg_t msg;
+        rc = zmq_msg_init (&msg);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&msg, sink, 0);
+        assert (rc >= 0);
+        rc = zmq_msg_close (&msg);
+        assert (rc == 0);
+    }
+    expect_nothing (sink);
+
+    //  Pausing holds the messages back
+    s_send (steer, "PAUSE");
+    msleep (SETTLE_TIME);
+    s_send (client, "ping");
+    expect_nothing (worker);
+    s_send (steer, "RESUME");
+    char *request = s_recv (worker);
+    assert (streq (request, "ping"));
+    free (request);
+    s_send (worker, "pong");
+    char *reply = s_recv (client);
+    assert (streq (reply, "pong"));
+    free (reply);
+
+    //  Terminating closes the proxy's sockets, so the endpoint can be
+    //  bound again
+    s_send (steer, "TERMINATE");
+    msleep (SETTLE_TIME);
+    void *rebound = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (rebound);
+    rc = zmq_bind (rebound, "inproc://frontend");
+    assert (rc == 0);
+    rc = zmq_close (rebound);
+    assert (rc == 0);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (worker);
+    assert (rc == 0);
+    rc = zmq_close (sink);
+    assert (rc == 0);
+    rc = zmq_close (steer);
+    assert (rc == 0);
+
+    //  A proxy still running is closed by the context termination
+    frontend = zmq_socket (ctx, ZMQ_PULL);
+    assert (frontend);
+    rc = zmq_bind (frontend, "inproc://frontend2");
+    assert (rc == 0);
+    backend = zmq_socket (ctx, ZMQ_PUSH);
+    assert (backend);
+    int linger = 0;
+    rc = zmq_setsockopt (backend, ZMQ_LINGER, &linger, sizeof linger);
+    assert (rc == 0);
+    rc = zmq_proxy_detached (frontend, backend, NULL, NULL);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,350 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+#define SHARDS 4
+#define CLIENTS 8
+#define MESSAGES 10
+
+struct sharded_proxy_t
+{
+    void *frontends [SHARDS];
+    void *backends [SHARDS];
+    const char *frontend_endpoint;
+    const char *backend_endpoint;
+    int strategy;
+    void *control;
+};
+
+static void
+proxy_thread (void *arg_)
+{
+    sharded_proxy_t *proxy = (sharded_proxy_t*) arg_;
+    int rc = zmq_proxy_sharded (proxy->frontends, proxy->backends, SHARDS,
+        proxy->frontend_endpoint, proxy->backend_endpoint, proxy->strategy,
+        proxy->control);
+    assert (rc == 0);
+}
+
+//  Without a control socket the proxy runs until the context is
+//  terminated; the shard sockets are closed then so termination completes.
+static void
+unsteered_proxy_thread (void *arg_)
+{
+    sharded_proxy_t *proxy = (sharded_proxy_t*) arg_;
+    int rc = zmq_proxy_sharded (proxy->frontends, proxy->backends, SHARDS,
+        proxy->frontend_endpoint, proxy->backend_endpoint, proxy->strategy,
+        NULL);
+    assert (rc == -1 && errno == ETERM);
+    for (int i = 0; i != SHARDS; i++) {
+        close_zero_linger (proxy->frontends [i]);
+        close_zero_linger (proxy->backends [i]);
+    }
+}
+
+//  Creates the shard sockets; the backends connect to 'sink'.
+static void
+setup_proxy (void *ctx, sharded_proxy_t *proxy, int frontend_type,
+    int backend_type, const char *sink, const char *control)
+{
+    for (int i = 0; i != SHARDS; i++) {
+        proxy->frontends [i] = zmq_socket (ctx, frontend_type);
+        assert (proxy->frontends [i]);
+        proxy->backends [i] = zmq_socket (ctx, backend_type);
+        assert (proxy->backends [i]);
+        int rc = zmq_connect (proxy->backends [i], sink);
+        assert (rc == 0);
+    }
+    proxy->backend_endpoint = NULL;
+    proxy->control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (proxy->control);
+    int rc = zmq_bind (proxy->control, control);
+    assert (rc == 0);
+}
+
+static void
+teardown_proxy (sharded_proxy_t *proxy)
+{
+    for (int i = 0; i != SHARDS; i++) {
+        close_zero_linger (proxy->frontends [i]);
+        close_zero_linger (proxy->backends [i]);
+    }
+    close_zero_linger (proxy->control);
+}
+
+//  Asks the proxy for its aggregated statistics and checks them.
+static void
+check_statistics (void *steer, const uint64_t *expected)
+{
+    int rc = zmq_send (steer, "STATISTICS", 10, 0);
+    assert (rc == 10);
+    for (int i = 0; i != 8; i++) {
+        uint64_t value;
+        rc = zmq_recv (steer, &value, sizeof value, 0);
+        assert (rc == sizeof value);
+        assert (value == expected [i]);
+        int more;
+        size_t more_size = sizeof more;
+        rc = zmq_getsockopt (steer, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0);
+        assert (more == (i < 7));
+    }
+}
+
+//  PUSH clients spread round robin across the shards, all of which feed
+//  a single sink.
+static void
+test_round_robin (void *ctx, const char *frontend_endpoint,
+    const char *sink_endpoint, const char *control_endpoint)
+{
+    void *sink = zmq_socket (ctx, ZMQ_PULL);
+    assert (sink);
+    int rc = zmq_bind (sink, sink_endpoint);
+    assert (rc == 0);
+
+    sharded_proxy_t proxy;
+    setup_proxy (ctx, &proxy, ZMQ_PULL, ZMQ_PUSH, sink_endpoint,
+        control_endpoint);
+    proxy.frontend_endpoint = frontend_endpoint;
+    proxy.strategy = ZMQ_PROXY_SHARD_ROUND_ROBIN;
+    void *steer = zmq_socket (ctx, ZMQ_PAIR);
+    assert (steer);
+    rc = zmq_connect (steer, control_endpoint);
+    assert (rc == 0);
+    void *thread = zmq_threadstart (&proxy_thread, &proxy);
+
+    //  Make sure the frontends are bound before connecting the clients.
+    const uint64_t none [] = {0, 0, 0, 0, 0, 0, 0, 0};
+    check_statistics (steer, none);
+
+    void *clients [CLIENTS];
+    for (int i = 0; i != CLIENTS; i++) {
+        clients [i] = zmq_socket (ctx, ZMQ_PUSH);
+        assert (clients [i]);
+        rc = zmq_connect (clients [i], frontend_endpoint);
+        assert (rc == 0);
+        for (int j = 0; j != MESSAGES; j++) {
+            rc = zmq_send (clients [i], "DATA", 4, 0);
+            assert (rc == 4);
+        }
+    }
+    for (int i = 0; i != CLIENTS * MESSAGES; i++) {
+        char buf [8];
+        rc = zmq_recv (sink, buf, sizeof buf, 0);
+        assert (rc == 4);
+    }
+
+    const uint64_t total = CLIENTS * MESSAGES;
+    const uint64_t expected [] = {total, total * 4, 0, 0, 0, 0, total,
+        total * 4};
+    check_statistics (steer, expected);
+
+    rc = zmq_send (steer, "TERMINATE", 9, 0);
+    assert (rc == 9);
+    zmq_threadclose (thread);
+
+    for (int i = 0; i != CLIENTS; i++)
+        close_zero_linger (clients [i]);
+    teardown_proxy (&proxy);
+    close_zero_linger (steer);
+    close_zero_linger (sink);
+}
+
+//  DEALER clients with identities are hashed to the ROUTER shards; the
+//  replies of an echo service find their way back through the same shard.
+static void
+test_hash (void *ctx)
+{
+    void *echo = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (echo);
+    int rc = zmq_bind (echo, "inproc://echo");
+    assert (rc == 0);
+
+    sharded_proxy_t proxy;
+    setup_proxy (ctx, &proxy, ZMQ_ROUTER, ZMQ_DEALER, "inproc://echo",
+        "inproc://control-hash");
+    proxy.frontend_endpoint = "inproc://frontend-hash";
+    proxy.strategy = ZMQ_PROXY_SHARD_HASH;
+    void *steer = zmq_socket (ctx, ZMQ_PAIR);
+    assert (steer);
+    rc = zmq_connect (steer, "inproc://control-hash");
+    assert (rc == 0);
+    void *thread = zmq_threadstart (&proxy_thread, &proxy);
+
+    //  Make sure the frontends are bound before connecting the clients.
+    const uint64_t none [] = {0, 0, 0, 0, 0, 0, 0, 0};
+    check_statistics (steer, none);
+
+    void *clients [CLIENTS];
+    for (int i = 0; i != CLIENTS; i++) {
+        clients [i] = zmq_socket (ctx, ZMQ_DEALER);
+        assert (clients [i]);
+        char identity [8];
+        sprintf (identity, "C%d", i);
+        rc = zmq_setsockopt (clients [i], ZMQ_IDENTITY, identity,
+            strlen (identity));
+        assert (rc == 0);
+        rc = zmq_connect (clients [i], "inproc://frontend-hash");
+        assert (rc == 0);
+        rc = zmq_send (clients [i], identity, strlen (identity), 0);
+        assert (rc == (int) strlen (identity));
+    }
+
+    //  Echo [shard][client][body] back as it came.
+    for (int i = 0; i != CLIENTS; i++) {
+        zmq_msg_t frames [3];
+        for (int j = 0; j != 3; j++) {
+            rc = zmq_msg_init (&frames [j]);
+            assert (rc == 0);
+            rc = zmq_msg_recv (&frames [j], echo, 0);
+            assert (rc >= 0);
+            assert (zmq_msg_more (&frames [j]) == (j < 2));
+        }
+        for (int j = 0; j != 3; j++) {
+            rc = zmq_msg_send (&frames [j], echo, j < 2 ? ZMQ_SNDMORE : 0);
+            assert (rc >= 0);
+        }
+    }
+
+    for (int i = 0; i != CLIENTS; i++) {
+        char identity [8];
+        sprintf (identity, "C%d", i);
+        char buf [8];
+        rc = zmq_recv (clients [i], buf, sizeof buf, 0);
+        assert (rc == (int) strlen (identity));
+        assert (memcmp (buf, identity, rc) == 0);
+    }
+
+    rc = zmq_send (steer, "TERMINATE", 9, 0);
+    assert (rc == 9);
+    zmq_threadclose (thread);
+
+    for (int i = 0; i != CLIENTS; i++)
+        close_zero_linger (clients [i]);
+    teardown_proxy (&proxy);
+    close_zero_linger (steer);
+    close_zero_linger (echo);
+}
+
+//  With no control socket the proxy only stops when the context goes away.
+static void
+test_no_control ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    void *sink = zmq_socket (ctx, ZMQ_PULL);
+    assert (sink);
+    int rc = zmq_bind (sink, "inproc://sink-unsteered");
+    assert (rc == 0);
+
+    sharded_proxy_t proxy;
+    for (int i = 0; i != SHARDS; i++) {
+        proxy.frontends [i] = zmq_socket (ctx, ZMQ_PULL);
+        assert (proxy.frontends [i]);
+        proxy.backends [i] = zmq_socket (ctx, ZMQ_PUSH);
+        assert (proxy.backends [i]);
+        rc = zmq_connect (proxy.backends [i], "inproc://sink-unsteered");
+        assert (rc == 0);
+    }
+    proxy.frontend_endpoint = "tcp://127.0.0.1:5581";
+    proxy.backend_endpoint = NULL;
+    proxy.strategy = ZMQ_PROXY_SHARD_ROUND_ROBIN;
+    proxy.control = NULL;
+    void *thread = zmq_threadstart (&unsteered_proxy_thread, &proxy);
+
+    //  The clients connect over tcp, so they needn't wait for the bind.
+    void *clients [CLIENTS];
+    for (int i = 0; i != CLIENTS; i++) {
+        clients [i] = zmq_socket (ctx, ZMQ_PUSH);
+        assert (clients [i]);
+        rc = zmq_connect (clients [i], "tcp://127.0.0.1:5581");
+        assert (rc == 0);
+        for (int j = 0; j != MESSAGES; j++) {
+            rc = zmq_send (clients [i], "DATA", 4, 0);
+            assert (rc == 4);
+        }
+    }
+    for (int i = 0; i != CLIENTS * MESSAGES; i++) {
+        char buf [8];
+        rc = zmq_recv (sink, buf, sizeof buf, 0);
+        assert (rc == 4);
+    }
+
+    //  Still running after a while.
+    msleep (SETTLE_TIME);
+    rc = zmq_send (clients [0], "MORE", 4, 0);
+    assert (rc == 4);
+    char buf [8];
+    rc = zmq_recv (sink, buf, sizeof buf, 0);
+    assert (rc == 4 && memcmp (buf, "MORE", 4) == 0);
+
+    for (int i = 0; i != CLIENTS; i++)
+        close_zero_linger (clients [i]);
+    close_zero_linger (sink);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    zmq_threadclose (thread);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_round_robin (ctx, "inproc://frontend", "inproc://sink",
+        "inproc://control");
+    test_round_robin (ctx, "tcp://127.0.0.1:5580", "inproc://sink-tcp",
+        "inproc://control-tcp");
+    test_hash (ctx);
+
+    //  An endpoint bound the usual way can't be shared.
+    void *frontends [1];
+    void *backends [1];
+    frontends [0] = zmq_socket (ctx, ZMQ_PULL);
+    assert (frontends [0]);
+    backends [0] = zmq_socket (ctx, ZMQ_PUSH);
+    assert (backends [0]);
+    void *other = zmq_socket (ctx, ZMQ_PULL);
+    assert (other);
+    int rc = zmq_bind (other, "inproc://taken");
+    assert (rc == 0);
+    rc = zmq_proxy_sharded (frontends, backends, 1, "inproc://taken", NULL,
+        ZMQ_PROXY_SHARD_HASH, NULL);
+    assert (rc == -1 && errno == EADDRINUSE);
+    rc = zmq_proxy_sharded (frontends, backends, 1, "inproc://free", NULL,
+        0, NULL);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_proxy_sharded (frontends, backends, 0, "inproc://free", NULL,
+        ZMQ_PROXY_SHARD_HASH, NULL);
+    assert (rc == -1 && errno == EINVAL);
+
+    close_zero_linger (frontends [0]);
+    close_zero_linger (backends [0]);
+    close_zero_linger (other);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_no_control ();
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+struct proxy_sockets_t
+{
+    void *frontend;
+    void *backend;
+    void *control;
+};
+
+static void
+proxy_thread (void *arg_)
+{
+    proxy_sockets_t *sockets = (proxy_sockets_t*) arg_;
+    int rc = zmq_proxy_steerable (sockets->frontend, sockets->backend, NULL,
+        sockets->control);
+    assert (rc == 0);
+}
+
+//  Sends 'count' two-frame messages of 1 + 4 bytes through the proxy.
+static void
+send_through (void *sender, void *receiver, int count)
+{
+    for (int i = 0; i != count; i++) {
+        int rc = zmq_send (sender, "A", 1, ZMQ_SNDMORE);
+        assert (rc == 1);
+        rc = zmq_send (sender, "BODY", 4, 0);
+        assert (rc == 4);
+    }
+    for (int i = 0; i != count; i++) {
+        char buf [8];
+        int rc = zmq_recv (receiver, buf, sizeof buf, 0);
+        assert (rc == 1);
+        int more;
+        size_t more_size = sizeof more;
+        rc = zmq_getsockopt (receiver, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0 && more);
+        rc = zmq_recv (receiver, buf, sizeof buf, 0);
+        assert (rc == 4);
+    }
+}
+
+//  Asks the proxy for its statistics and checks them.
+static void
+check_statistics (void *steer, const uint64_t *expected)
+{
+    int rc = zmq_send (steer, "STATISTICS", 10, 0);
+    assert (rc == 10);
+    for (int i = 0; i != 8; i++) {
+        uint64_t value;
+        rc = zmq_recv (steer, &value, sizeof value, 0);
+        assert (rc == sizeof value);
+        assert (value == expected [i]);
+        int more;
+        size_t more_size = sizeof more;
+        rc = zmq_getsockopt (steer, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0);
+        assert (more == (i < 7));
+    }
+}
+
+//  Runs traffic through a proxy whose control socket is connected to the
+//  'steer' socket and checks the statistics.
+static void
+run_traffic (void *ctx, void *steer, const char *frontend_addr,
+    const char *backend_addr)
+{
+    void *client = zmq_socket (ctx, ZMQ_PUSH);
+    assert (client);
+    int rc = zmq_connect (client, frontend_addr);
+    assert (rc == 0);
+    void *worker = zmq_socket (ctx, ZMQ_PULL);
+    assert (worker);
+    rc = zmq_connect (worker, backend_addr);
+    assert (rc == 0);
+
+    //  Frames in on the frontend and out on the backend, 5 bytes each
+    send_through (client, worker, 100);
+    const uint64_t expected [] = {200, 500, 0, 0, 0, 0, 200, 500};
+    check_statistics (steer, expected);
+
+    rc = zmq_send (steer, "TERMINATE", 9, 0);
+    assert (rc == 9);
+
+    close_zero_linger (client);
+    close_zero_linger (worker);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Proxy running in an application thread
+    proxy_sockets_t sockets;
+    sockets.frontend = zmq_socket (ctx, ZMQ_PULL);
+    assert (sockets.frontend);
+    int rc = zmq_bind (sockets.frontend, "inproc://frontend");
+    assert (rc == 0);
+    sockets.backend = zmq_socket (ctx, ZMQ_PUSH);
+    assert (sockets.backend);
+    rc = zmq_bind (sockets.backend, "inproc://backend");
+    assert (rc == 0);
+    sockets.control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sockets.control);
+    rc = zmq_bind (sockets.control, "inproc://control");
+    assert (rc == 0);
+    void *steer = zmq_socket (ctx, ZMQ_PAIR);
+    assert (steer);
+    rc = zmq_connect (steer, "inproc://control");
+    assert (rc == 0);
+
+    void *thread = zmq_threadstart (&proxy_thread, &sockets);
+    run_traffic (ctx, steer, "inproc://frontend", "inproc://backend");
+    zmq_threadclose (thread);
+
+    close_zero_linger (sockets.frontend);
+    close_zero_linger (sockets.backend);
+    close_zero_linger (sockets.control);
+    close_zero_linger (steer);
+
+    //  Proxy running in an I/O thread
+    void *frontend = zmq_socket (ctx, ZMQ_PULL);
+    assert (frontend);
+    rc = zmq_bind (frontend, "inproc://frontend2");
+    assert (rc == 0);
+    void *backend = zmq_socket (ctx, ZMQ_PUSH);
+    assert (backend);
+    rc = zmq_bind (backend, "inproc://backend2");
+    assert (rc == 0);
+    void *control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (control);
+    rc = zmq_bind (control, "inproc://control2");
+    assert (rc == 0);
+    steer = zmq_socket (ctx, ZMQ_PAIR);
+    assert (steer);
+    rc = zmq_connect (steer, "inproc://control2");
+    assert (rc == 0);
+
+    rc = zmq_proxy_detached (frontend, backend, NULL, control);
+    assert (rc == 0);
+    run_traffic (ctx, steer, "inproc://frontend2", "inproc://backend2");
+    close_zero_linger (steer);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+static int received = 0;
+static int ticks = 0;
+
+//  Reads one message per call, so it relies on being called again while
+//  there are more messages queued.
+static int
+s_reader (void *, zmq_poller_event_t *event, void *arg)
+{
+    assert (event->events == ZMQ_POLLIN);
+    assert (event->user_data == arg);
+    char buf [8];
+    int rc = zmq_recv (event->socket, buf, sizeof buf, ZMQ_DONTWAIT);
+    assert (rc == 1);
+    received++;
+    if (received == *(int*) arg)
+        return -1;
+    return 0;
+}
+
+static int
+s_remover (void *reactor, zmq_poller_event_t *event, void *)
+{
+    int rc = zmq_reactor_remove (reactor, event->socket);
+    assert (rc == 0);
+    return 0;
+}
+
+static int
+s_ticker (void *, int, void *)
+{
+    ticks++;
+    return 0;
+}
+
+static int
+s_stopper (void *, int, void *)
+{
+    return -1;
+}
+
+static int
+s_canceller (void *reactor, int, void *arg)
+{
+    int rc = zmq_reactor_cancel_timer (reactor, *(int*) arg);
+    assert (rc == 0);
+    return 0;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *a = zmq_socket (ctx, ZMQ_PAIR);
+    assert (a);
+    int rc = zmq_bind (a, "inproc://a");
+    assert (rc == 0);
+    void *b = zmq_socket (ctx, ZMQ_PAIR);
+    assert (b);
+    rc = zmq_connect (b, "inproc://a");
+    assert (rc == 0);
+
+    void *reactor = zmq_reactor_new ();
+    assert (reactor);
+
+    //  Nothing to do
+    rc = zmq_reactor_run_once (reactor, 0);
+    assert (rc == 0);
+
+    //  Socket handlers are called until the messages are read
+    int expected = 3;
+    rc = zmq_reactor_add (reactor, b, ZMQ_POLLIN, s_reader, &expected);
+    assert (rc == 0);
+    rc = zmq_reactor_add (reactor, b, ZMQ_POLLIN, s_reader, &expected);
+    assert (rc == -1 && errno == EINVAL);
+    for (int i = 0; i != 3; i++) {
+        rc = zmq_send (a, "A", 1, 0);
+        assert (rc == 1);
+    }
+    rc = zmq_reactor_run (reactor);
+    assert (rc == 0);
+    assert (received == 3);
+    rc = zmq_reactor_run_once (reactor, 0);
+    assert (rc == 0);
+    assert (received == 3);
+
+    //  Handlers may remove themselves
+    rc = zmq_reactor_remove (reactor, b);
+    assert (rc == 0);
+    rc = zmq_reactor_add (reactor, a, ZMQ_POLLOUT, s_remover, NULL);
+    assert (rc == 0);
+    rc = zmq_reactor_run_once (reactor, 0);
+    assert (rc == 0);
+    rc = zmq_reactor_remove (reactor, a);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Timers run the given number of times
+    int ticker = zmq_reactor_add_timer (reactor, 10, 2, s_ticker, NULL);
+    assert (ticker > 0);
+    int stopper = zmq_reactor_add_timer (reactor, 100, 1, s_stopper, NULL);
+    assert (stopper > 0);
+    rc = zmq_reactor_run (reactor);
+    assert (rc == 0);
+    assert (ticks == 2);
+    rc = zmq_reactor_cancel_timer (reactor, ticker);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Timers can be cancelled from handlers
+    ticks = 0;
+    ticker = zmq_reactor_add_timer (reactor, 10, 0, s_ticker, NULL);
+    assert (ticker > 0);
+    rc = zmq_reactor_add_timer (reactor, 35, 1, s_canceller, &ticker);
+    assert (rc > 0);
+    rc = zmq_reactor_add_timer (reactor, 100, 1, s_stopper, NULL);
+    assert (rc > 0);
+    rc = zmq_reactor_run (reactor);
+    assert (rc == 0);
+    assert (ticks >= 1 && ticks <= 3);
+
+    rc = zmq_reactor_destroy (&reactor);
+    assert (rc == 0);
+    assert (reactor == NULL);
+
+    rc = zmq_close (a);
+    assert (rc == 0);
+    rc = zmq_close (b);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
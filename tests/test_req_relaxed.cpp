@@ -48,7 +48,7 @@ int main (void)
         rc = zmq_setsockopt (rep [peer], ZMQ_RCVTIMEO, &timeout, sizeof (int));
         assert (rc == 0);
 
-        rc = zmq_connect (rep [peer], "tcp://localhost:5555");
+        rc = zmq_connect (rep [peer], "tcp://127.0.0.1:5555");
         assert (rc == 0);
     }
     //  We have to give the connects time to finish otherwise the requests
@@ -79,6 +79,158 @@ static void zap_handler (void *handler)
     zmq_close (handler);
 }
 
+//  Multipart traffic between clients and a server that may each use crypto
+//  worker threads and may each ask for the AEAD cipher.
+#define TRAFFIC_CLIENTS 2
+#define TRAFFIC_MESSAGES 200
+#define TRAFFIC_FRAMES 3
+
+static size_t traffic_size (int seq, int frame)
+{
+    if (frame == 0)
+        return 2;
+    if (frame == 1)
+        return (seq * 37) % 2048;
+    return seq % 50 == 0 ? 100000 : seq % 16;
+}
+
+static unsigned char traffic_byte (int client, int seq, int frame, size_t pos)
+{
+    return (unsigned char) (client * 31 + seq * 7 + frame * 13 + pos);
+}
+
+static void send_traffic (void *socket, int client, int seq)
+{
+    for (int frame = 0; frame != TRAFFIC_FRAMES; frame++) {
+        const size_t size = traffic_size (seq, frame);
+        zmq_msg_t msg;
+        int rc = zmq_msg_init_size (&msg, size);
+        assert (rc == 0);
+        unsigned char *data = (unsigned char *) zmq_msg_data (&msg);
+        for (size_t pos = 0; pos != size; pos++)
+            data [pos] = traffic_byte (client, seq, frame, pos);
+        if (frame == 0) {
+            data [0] = (unsigned char) client;
+            data [1] = (unsigned char) seq;
+        }
+        rc = zmq_msg_send (&msg, socket,
+            frame + 1 < TRAFFIC_FRAMES ? ZMQ_SNDMORE : 0);
+        assert (rc == (int) size);
+    }
+}
+
+//  Receives the frames of one message and checks they are the ones that
+//  'expected' holds next for their client. Returns the client.
+static int recv_traffic (void *socket, int *expected)
+{
+    int client = -1;
+    int seq = -1;
+    for (int frame = 0; frame != TRAFFIC_FRAMES; frame++) {
+        zmq_msg_t msg;
+        int rc = zmq_msg_init (&msg);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&msg, socket, 0);
+        assert (rc >= 0);
+        const unsigned char *data =
+            (const unsigned char *) zmq_msg_data (&msg);
+        if (frame == 0) {
+            assert (rc == 2);
+            client = data [0];
+            seq = data [1];
+            assert (client < TRAFFIC_CLIENTS);
+            assert (seq == (expected [client] & 0xff));
+            seq = expected [client]++;
+        }
+        else {
+            const size_t size = traffic_size (seq, frame);
+            assert (rc == (int) size);
+            for (size_t pos = 0; pos != size; pos++)
+                assert (data [pos] == traffic_byte (client, seq, frame, pos));
+        }
+        assert (zmq_msg_more (&msg) == (frame + 1 < TRAFFIC_FRAMES));
+        rc = zmq_msg_close (&msg);
+        assert (rc == 0);
+    }
+    return client;
+}
+
+static void test_traffic (int client_threads, int server_threads,
+    int client_aead, int server_aead)
+{
+    void *server_ctx = zmq_ctx_new ();
+    assert (server_ctx);
+    int rc = zmq_ctx_set (server_ctx, ZMQ_CRYPTO_THREADS, server_threads);
+    assert (rc == 0);
+    void *client_ctx = zmq_ctx_new ();
+    assert (client_ctx);
+    rc = zmq_ctx_set (client_ctx, ZMQ_CRYPTO_THREADS, client_threads);
+    assert (rc == 0);
+
+    void *server = zmq_socket (server_ctx, ZMQ_ROUTER);
+    assert (server);
+    int as_server = 1;
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, server_secret, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_AEAD, &server_aead, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (server, "tcp://127.0.0.1:9997");
+    assert (rc == 0);
+
+    //  The clients share a long-term key, but each handshake computes its
+    //  own shared secrets; only the server's short-term key pairs come
+    //  from the pool filled ahead of time.
+    void *clients [TRAFFIC_CLIENTS];
+    for (int i = 0; i != TRAFFIC_CLIENTS; i++) {
+        clients [i] = zmq_socket (client_ctx, ZMQ_DEALER);
+        assert (clients [i]);
+        rc = zmq_setsockopt (clients [i], ZMQ_CURVE_SERVERKEY,
+            server_public, 40);
+        assert (rc == 0);
+        rc = zmq_setsockopt (clients [i], ZMQ_CURVE_PUBLICKEY,
+            client_public, 40);
+        assert (rc == 0);
+        rc = zmq_setsockopt (clients [i], ZMQ_CURVE_SECRETKEY,
+            client_secret, 40);
+        assert (rc == 0);
+        rc = zmq_setsockopt (clients [i], ZMQ_CURVE_AEAD, &client_aead,
+            sizeof (int));
+        assert (rc == 0);
+        rc = zmq_connect (clients [i], "tcp://127.0.0.1:9997");
+        assert (rc == 0);
+    }
+
+    for (int seq = 0; seq != TRAFFIC_MESSAGES; seq++)
+        for (int i = 0; i != TRAFFIC_CLIENTS; i++)
+            send_traffic (clients [i], i, seq);
+
+    //  The server checks each client's messages and echoes them back.
+    int received [TRAFFIC_CLIENTS] = {0};
+    for (int i = 0; i != TRAFFIC_CLIENTS * TRAFFIC_MESSAGES; i++) {
+        zmq_msg_t routing_id;
+        rc = zmq_msg_init (&routing_id);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&routing_id, server, 0);
+        assert (rc > 0);
+        const int client = recv_traffic (server, received);
+        rc = zmq_msg_send (&routing_id, server, ZMQ_SNDMORE);
+        assert (rc > 0);
+        send_traffic (server, client, received [client] - 1);
+    }
+
+    for (int i = 0; i != TRAFFIC_CLIENTS; i++) {
+        int echoed [TRAFFIC_CLIENTS] = {0};
+        for (int seq = 0; seq != TRAFFIC_MESSAGES; seq++)
+            assert (recv_traffic (clients [i], echoed) == i);
+        close_zero_linger (clients [i]);
+    }
+    close_zero_linger (server);
+    rc = zmq_ctx_term (client_ctx);
+    assert (rc == 0);
+    rc = zmq_ctx_term (server_ctx);
+    assert (rc == 0);
+}
 
 int main (void)
 {
@@ -208,5 +360,11 @@ int main (void)
     //  Wait until ZAP handler terminates
     zmq_threadclose (zap_thread);
 
+    //  Check message traffic with and without crypto worker threads and
+    //  the AEAD cipher on either side.
+    for (int i = 0; i != 16; i++)
+        test_traffic (i & 1 ? 2 : 0, i & 2 ? 2 : 0, (i & 4) != 0,
+            (i & 8) != 0);
+
     return 0;
 }
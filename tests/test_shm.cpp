@@ -0,0 +1,228 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+#include <string.h>
+#include <stdlib.h>
+
+#define STREAM_MESSAGES 5000
+#define STREAM_SIZE 8192
+
+//  Fills a message body with a pattern derived from its sequence number.
+static void
+fill (unsigned char *data, size_t size, int seq)
+{
+    for (size_t i = 0; i != size; i++)
+        data [i] = (unsigned char) (i * 7 + seq);
+}
+
+static void
+check (const unsigned char *data, size_t size, int seq)
+{
+    for (size_t i = 0; i != size; i++)
+        assert (data [i] == (unsigned char) (i * 7 + seq));
+}
+
+static void
+send_pattern (void *socket, size_t size, int seq, int flags)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, size);
+    assert (rc == 0);
+    fill ((unsigned char*) zmq_msg_data (&msg), size, seq);
+    rc = zmq_msg_send (&msg, socket, flags);
+    assert (rc == (int) size);
+}
+
+static void
+recv_pattern (void *socket, zmq_msg_t *msg, size_t size, int seq)
+{
+    int rc = zmq_msg_recv (msg, socket, 0);
+    assert (rc == (int) size);
+    check ((const unsigned char*) zmq_msg_data (msg), size, seq);
+}
+
+//  Receives the stream sent by test_stream from a separate thread, so that
+//  the sender runs into both the HWM and a full ring.
+static void
+stream_receiver (void *socket_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    for (int i = 0; i != STREAM_MESSAGES; i++)
+        recv_pattern (socket_, &msg, STREAM_SIZE + i % 64, i);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+static void
+test_pair (void *ctx)
+{
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    int rc = zmq_bind (sb, "shm:///tmp/tester_shm");
+    assert (rc == 0);
+
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (sb, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    assert (strcmp (endpoint, "shm:///tmp/tester_shm") == 0);
+
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, "shm:///tmp/tester_shm");
+    assert (rc == 0);
+
+    bounce (sb, sc);
+
+    //  Messages above the borrow threshold are lent straight from the
+    //  ring; keep two of them alive and release them out of order.
+    send_pattern (sc, 100000, 1, 0);
+    send_pattern (sc, 200000, 2, 0);
+    send_pattern (sc, 10, 3, 0);
+    zmq_msg_t first, second, third;
+    rc = zmq_msg_init (&first);
+    assert (rc == 0);
+    rc = zmq_msg_init (&second);
+    assert (rc == 0);
+    rc = zmq_msg_init (&third);
+    assert (rc == 0);
+    recv_pattern (sb, &first, 100000, 1);
+    recv_pattern (sb, &second, 200000, 2);
+    recv_pattern (sb, &third, 10, 3);
+    rc = zmq_msg_close (&second);
+    assert (rc == 0);
+    bounce (sb, sc);
+    rc = zmq_msg_close (&first);
+    assert (rc == 0);
+    rc = zmq_msg_close (&third);
+    assert (rc == 0);
+
+    //  A message larger than half the ring is passed in fragments.
+    size_t huge = 3 * 1024 * 1024 + 17;
+    send_pattern (sb, huge, 4, ZMQ_SNDMORE);
+    send_pattern (sb, 0, 5, 0);
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    recv_pattern (sc, &msg, huge, 4);
+    assert (zmq_msg_more (&msg));
+    recv_pattern (sc, &msg, 0, 5);
+    assert (!zmq_msg_more (&msg));
+
+    //  Lots of traffic wraps the ring many times over.
+    void *thread = zmq_threadstart (&stream_receiver, sb);
+    for (int i = 0; i != STREAM_MESSAGES; i++)
+        send_pattern (sc, STREAM_SIZE + i % 64, i, 0);
+    zmq_threadclose (thread);
+
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+}
+
+static void
+test_router_dealer (void *ctx)
+{
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    int rc = zmq_bind (router, "shm:///tmp/tester_shm_router");
+    assert (rc == 0);
+
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    rc = zmq_setsockopt (dealer, ZMQ_IDENTITY, "A", 1);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "shm:///tmp/tester_shm_router");
+    assert (rc == 0);
+
+    rc = zmq_send (dealer, "hello", 5, 0);
+    assert (rc == 5);
+    char buf [32];
+    rc = zmq_recv (router, buf, sizeof buf, 0);
+    assert (rc == 1 && buf [0] == 'A');
+    rc = zmq_recv (router, buf, sizeof buf, 0);
+    assert (rc == 5 && memcmp (buf, "hello", 5) == 0);
+
+    rc = zmq_send (router, "A", 1, ZMQ_SNDMORE);
+    assert (rc == 1);
+    rc = zmq_send (router, "world", 5, 0);
+    assert (rc == 5);
+    rc = zmq_recv (dealer, buf, sizeof buf, 0);
+    assert (rc == 5 && memcmp (buf, "world", 5) == 0);
+
+    close_zero_linger (dealer);
+    close_zero_linger (router);
+}
+
+//  Peers with incompatible socket types never get to talk.
+static void
+test_incompatible (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "shm:///tmp/tester_shm_pull");
+    assert (rc == 0);
+
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_connect (sub, "shm:///tmp/tester_shm_pull");
+    assert (rc == 0);
+
+    int timeout = 250;
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    char buf [8];
+    rc = zmq_recv (pull, buf, sizeof buf, 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    close_zero_linger (sub);
+    close_zero_linger (pull);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    int rc;
+#if defined ZMQ_HAVE_SHM
+    test_pair (ctx);
+    test_router_dealer (ctx);
+    test_incompatible (ctx);
+#else
+    void *socket = zmq_socket (ctx, ZMQ_PAIR);
+    assert (socket);
+    rc = zmq_bind (socket, "shm:///tmp/tester_shm");
+    assert (rc == -1 && errno == EPROTONOSUPPORT);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+#endif
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
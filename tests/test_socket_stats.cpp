@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+static uint64_t
+get_stat (void *socket, int option)
+{
+    uint64_t value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (socket, option, &value, &size);
+    assert (rc == 0);
+    assert (size == sizeof (value));
+    return value;
+}
+
+static void
+test_traffic (void *ctx)
+{
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int rc = zmq_bind (push, "inproc://traffic");
+    assert (rc == 0);
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_connect (pull, "inproc://traffic");
+    assert (rc == 0);
+
+    //  One single-part and one two-part message
+    rc = zmq_send (push, "ABC", 3, 0);
+    assert (rc == 3);
+    rc = zmq_send (push, "DE", 2, ZMQ_SNDMORE);
+    assert (rc == 2);
+    rc = zmq_send (push, "FGHIJ", 5, 0);
+    assert (rc == 5);
+
+    assert (get_stat (push, ZMQ_STAT_MSGS_SENT) == 2);
+    assert (get_stat (push, ZMQ_STAT_BYTES_SENT) == 10);
+    assert (get_stat (push, ZMQ_STAT_QUEUE_DEPTH) == 2);
+
+    char buffer [8];
+    for (int i = 0; i != 3; i++) {
+        rc = zmq_recv (pull, buffer, sizeof (buffer), 0);
+        assert (rc > 0);
+    }
+    assert (get_stat (pull, ZMQ_STAT_MSGS_RECEIVED) == 2);
+    assert (get_stat (pull, ZMQ_STAT_BYTES_RECEIVED) == 10);
+    assert (get_stat (push, ZMQ_STAT_MSGS_DROPPED) == 0);
+
+    //  The stats are read-only and need 64-bit buffer
+    uint64_t value = 0;
+    rc = zmq_setsockopt (push, ZMQ_STAT_MSGS_SENT, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    int small;
+    size_t size = sizeof (small);
+    rc = zmq_getsockopt (push, ZMQ_STAT_MSGS_SENT, &small, &size);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_close (push);
+    assert (rc == 0);
+}
+
+static void
+test_dropped (void *ctx)
+{
+    int hwm = 5;
+
+    //  PUB drops the messages for the subscriber that doesn't keep up
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    int rc = zmq_setsockopt (pub, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_bind (pub, "inproc://dropped");
+    assert (rc == 0);
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_setsockopt (sub, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "", 0);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "inproc://dropped");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_send (pub, "X", 1, 0);
+        assert (rc == 1);
+    }
+    assert (get_stat (pub, ZMQ_STAT_MSGS_SENT) == 100);
+    uint64_t dropped = get_stat (pub, ZMQ_STAT_MSGS_DROPPED);
+    uint64_t queued = get_stat (pub, ZMQ_STAT_QUEUE_DEPTH);
+    assert (dropped > 0);
+    assert (queued > 0);
+    assert (dropped + queued == 100);
+
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+
+    //  ROUTER drops the messages for the peer whose pipe is full
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    rc = zmq_setsockopt (router, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_bind (router, "inproc://router");
+    assert (rc == 0);
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    rc = zmq_setsockopt (dealer, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (dealer, ZMQ_IDENTITY, "D", 1);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "inproc://router");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_send (router, "D", 1, ZMQ_SNDMORE);
+        assert (rc == 1);
+        rc = zmq_send (router, "X", 1, 0);
+        assert (rc == 1);
+    }
+    assert (get_stat (router, ZMQ_STAT_MSGS_DROPPED) > 0);
+
+    rc = zmq_close (dealer);
+    assert (rc == 0);
+    rc = zmq_close (router);
+    assert (rc == 0);
+}
+
+static void
+test_reconnects (void *ctx)
+{
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int rc = zmq_bind (server, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_connect (client, "tcp://127.0.0.1:5560");
+    assert (rc == 0);
+    bounce (server, client);
+    assert (get_stat (client, ZMQ_STAT_RECONNECTS) == 0);
+
+    //  Closing the server makes the client reconnect
+    rc = zmq_close (server);
+    assert (rc == 0);
+    msleep (SETTLE_TIME * 5);
+    assert (get_stat (client, ZMQ_STAT_RECONNECTS) >= 1);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_traffic (ctx);
+    test_dropped (ctx);
+    test_reconnects (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <dirent.h>
+#include "testutil.hpp"
+
+static const int hwm = 10;
+static const int message_count = 1000;
+
+//  Returns the number of entries in the directory, not counting . and ..
+
+static int
+count_files (const char *path)
+{
+    DIR *dir = opendir (path);
+    assert (dir);
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir (dir)) != NULL)
+        if (strcmp (entry->d_name, ".") && strcmp (entry->d_name, ".."))
+            count++;
+    int rc = closedir (dir);
+    assert (rc == 0);
+    return count;
+}
+
+static void *
+create_push (void *ctx, const char *path, int64_t maxsize)
+{
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (push, ZMQ_SPILL_PATH, path, strlen (path));
+    assert (rc == 0);
+    rc = zmq_setsockopt (push, ZMQ_SPILL_MAXSIZE, &maxsize, sizeof (maxsize));
+    assert (rc == 0);
+    return push;
+}
+
+static void *
+create_pull (void *ctx, const char *endpoint)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_bind (pull, endpoint);
+    assert (rc == 0);
+    return pull;
+}
+
+//  Sends message_count two-part messages without blocking
+
+static void
+send_messages (void *push)
+{
+    char payload [100];
+    memset (payload, 'x', sizeof (payload));
+    for (int i = 0; i < message_count; i++) {
+        int rc = zmq_send (push, &i, sizeof (i), ZMQ_SNDMORE | ZMQ_DONTWAIT);
+        assert (rc == sizeof (i));
+        rc = zmq_send (push, payload, sizeof (payload), ZMQ_DONTWAIT);
+        assert (rc == sizeof (payload));
+    }
+}
+
+//  Checks that all the messages arrive in order
+
+static void
+recv_messages (void *pull)
+{
+    char payload [100];
+    for (int i = 0; i < message_count; i++) {
+        int index;
+        int rc = zmq_recv (pull, &index, sizeof (index), 0);
+        assert (rc == sizeof (index));
+        assert (index == i);
+        int more;
+        size_t more_size = sizeof (more);
+        rc = zmq_getsockopt (pull, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0);
+        assert (more);
+        rc = zmq_recv (pull, payload, sizeof (payload), 0);
+        assert (rc == sizeof (payload));
+    }
+}
+
+static void
+test_spill (void *ctx, const char *path, const char *endpoint)
+{
+    void *pull = create_pull (ctx, endpoint);
+    void *push = create_push (ctx, path, -1);
+    int rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    //  The messages above the HWM go to the spill rather than blocking
+    send_messages (push);
+    assert (count_files (path) > 0);
+    recv_messages (pull);
+
+    //  Spilled messages are still delivered after the socket is closed
+    send_messages (push);
+    rc = zmq_close (push);
+    assert (rc == 0);
+    recv_messages (pull);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+static void
+test_spill_maxsize (void *ctx, const char *path)
+{
+    void *pull = create_pull (ctx, "inproc://maxsize");
+    void *push = create_push (ctx, path, 1000);
+    int rc = zmq_connect (push, "inproc://maxsize");
+    assert (rc == 0);
+
+    //  Once the spill is full, sending blocks again
+    int sent = 0;
+    while (true) {
+        rc = zmq_send (push, "0123456789", 10, ZMQ_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            break;
+        }
+        sent++;
+        assert (sent < message_count);
+    }
+    assert (sent > hwm);
+
+    int linger = 0;
+    rc = zmq_setsockopt (push, ZMQ_LINGER, &linger, sizeof (linger));
+    assert (rc == 0);
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    char path [] = "/tmp/test_spill.XXXXXX";
+    char *dir = mkdtemp (path);
+    assert (dir);
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Check the option defaults and round trip
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    assert (s);
+    int64_t maxsize;
+    size_t size = sizeof (maxsize);
+    int rc = zmq_getsockopt (s, ZMQ_SPILL_MAXSIZE, &maxsize, &size);
+    assert (rc == 0);
+    assert (maxsize == -1);
+    rc = zmq_setsockopt (s, ZMQ_SPILL_PATH, dir, strlen (dir));
+    assert (rc == 0);
+    char buffer [256];
+    size = sizeof (buffer);
+    rc = zmq_getsockopt (s, ZMQ_SPILL_PATH, buffer, &size);
+    assert (rc == 0);
+    assert (size == strlen (dir) + 1);
+    assert (streq (buffer, dir));
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    test_spill (ctx, dir, "inproc://spill");
+    test_spill (ctx, dir, "tcp://127.0.0.1:5560");
+    test_spill_maxsize (ctx, dir);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    //  All the segment files are removed once the pipes are gone
+    assert (count_files (dir) == 0);
+    rc = rmdir (dir);
+    assert (rc == 0);
+
+    return 0 ;
+}
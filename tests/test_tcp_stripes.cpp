@@ -0,0 +1,226 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+#include <string.h>
+#include <set>
+#include <string>
+
+//  A striped DEALER spreads its messages over all of its connections, which
+//  the ROUTER sees as distinct peers.
+static void test_dealer_router (void *ctx)
+{
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    int rc = zmq_bind (router, "tcp://127.0.0.1:5598");
+    assert (rc == 0);
+
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    int stripes = 3;
+    rc = zmq_setsockopt (dealer, ZMQ_TCP_STRIPES, &stripes, sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5598");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i != 30; i++) {
+        rc = zmq_send (dealer, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    std::set <std::string> peers;
+    for (int i = 0; i != 30; i++) {
+        char identity [256];
+        rc = zmq_recv (router, identity, sizeof identity, 0);
+        assert (rc > 0);
+        peers.insert (std::string (identity, rc));
+        char buffer [16];
+        rc = zmq_recv (router, buffer, sizeof buffer, 0);
+        assert (rc == 3);
+    }
+    assert (peers.size () == 3);
+
+    //  The replies come back through any of the connections.
+    for (std::set <std::string>::iterator it = peers.begin ();
+          it != peers.end (); ++it) {
+        rc = zmq_send (router, it->data (), it->size (), ZMQ_SNDMORE);
+        assert (rc == (int) it->size ());
+        rc = zmq_send (router, "DEF", 3, 0);
+        assert (rc == 3);
+    }
+    for (int i = 0; i != 3; i++) {
+        char buffer [16];
+        rc = zmq_recv (dealer, buffer, sizeof buffer, 0);
+        assert (rc == 3 && memcmp (buffer, "DEF", 3) == 0);
+    }
+
+    //  Disconnecting drops all the connections.
+    rc = zmq_disconnect (dealer, "tcp://127.0.0.1:5598");
+    assert (rc == 0);
+    rc = zmq_send (dealer, "ABC", 3, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    close_zero_linger (dealer);
+    close_zero_linger (router);
+}
+
+//  All the messages sent by a striped PUSH arrive, multi-part ones whole.
+static void test_push_pull (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:5599");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int stripes = 4;
+    rc = zmq_setsockopt (push, ZMQ_TCP_STRIPES, &stripes, sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5599");
+    assert (rc == 0);
+
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_send (push, &i, sizeof i, ZMQ_SNDMORE);
+        assert (rc == sizeof i);
+        rc = zmq_send (push, &i, sizeof i, 0);
+        assert (rc == sizeof i);
+    }
+    bool received [1000];
+    memset (received, 0, sizeof received);
+    for (int i = 0; i != 1000; i++) {
+        int first;
+        int second;
+        rc = zmq_recv (pull, &first, sizeof first, 0);
+        assert (rc == sizeof first);
+        int more;
+        size_t more_size = sizeof more;
+        rc = zmq_getsockopt (pull, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0 && more);
+        rc = zmq_recv (pull, &second, sizeof second, 0);
+        assert (rc == sizeof second);
+        assert (first == second && first >= 0 && first < 1000);
+        assert (!received [first]);
+        received [first] = true;
+    }
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+//  Other socket types connect once, lest the messages be duplicated.
+static void test_not_striped (void *ctx)
+{
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    int rc = zmq_bind (pub, "tcp://127.0.0.1:5600");
+    assert (rc == 0);
+
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    int stripes = 3;
+    rc = zmq_setsockopt (sub, ZMQ_TCP_STRIPES, &stripes, sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "", 0);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "tcp://127.0.0.1:5600");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    rc = zmq_send (pub, "ABC", 3, 0);
+    assert (rc == 3);
+    char buffer [16];
+    rc = zmq_recv (sub, buffer, sizeof buffer, 0);
+    assert (rc == 3);
+    msleep (SETTLE_TIME);
+    rc = zmq_recv (sub, buffer, sizeof buffer, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+//  Striped connections can't share an identity, and a failed connect
+//  leaves no stripes behind.
+static void test_identity (void *ctx)
+{
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    int rc = zmq_bind (router, "tcp://127.0.0.1:5605");
+    assert (rc == 0);
+
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    int stripes = 3;
+    rc = zmq_setsockopt (dealer, ZMQ_TCP_STRIPES, &stripes, sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_setsockopt (dealer, ZMQ_IDENTITY, "ID", 2);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5605");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_disconnect (dealer, "tcp://127.0.0.1:5605");
+    assert (rc == -1 && errno == ENOENT);
+
+    //  A single connection may have one.
+    stripes = 1;
+    rc = zmq_setsockopt (dealer, ZMQ_TCP_STRIPES, &stripes, sizeof stripes);
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:5605");
+    assert (rc == 0);
+    rc = zmq_send (dealer, "ABC", 3, 0);
+    assert (rc == 3);
+    char buffer [16];
+    rc = zmq_recv (router, buffer, sizeof buffer, 0);
+    assert (rc == 2 && memcmp (buffer, "ID", 2) == 0);
+    rc = zmq_recv (router, buffer, sizeof buffer, 0);
+    assert (rc == 3);
+
+    close_zero_linger (dealer);
+    close_zero_linger (router);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, 2);
+    assert (rc == 0);
+
+    void *socket = zmq_socket (ctx, ZMQ_DEALER);
+    assert (socket);
+    int stripes = 0;
+    rc = zmq_setsockopt (socket, ZMQ_TCP_STRIPES, &stripes, sizeof stripes);
+    assert (rc == -1 && errno == EINVAL);
+    size_t stripes_size = sizeof stripes;
+    rc = zmq_getsockopt (socket, ZMQ_TCP_STRIPES, &stripes, &stripes_size);
+    assert (rc == 0 && stripes == 1);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    test_dealer_router (ctx);
+    test_push_pull (ctx);
+    test_not_striped (ctx);
+    test_identity (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+#include <string.h>
+
+#define MESSAGES 50
+
+//  Datagrams sent before the subscriber is listening are lost, so keep
+//  probing until one gets through.
+static void
+sync_udp (void *pub, void *sub)
+{
+    int timeout = 50;
+    int rc = zmq_setsockopt (sub, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    char buf [16];
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_send (pub, "Async", 5, 0);
+        assert (rc == 5);
+        rc = zmq_recv (sub, buf, sizeof buf, 0);
+        if (rc == 5)
+            break;
+        assert (rc == -1 && errno == EAGAIN);
+    }
+    assert (rc == 5 && memcmp (buf, "Async", 5) == 0);
+
+    //  Drain the probes still under way.
+    while (zmq_recv (sub, buf, sizeof buf, 0) == 5)
+        ;
+    timeout = 2000;
+    rc = zmq_setsockopt (sub, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+}
+
+static void
+test_unicast (void *ctx)
+{
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    int rc = zmq_bind (sub, "udp://*:5590");
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "A", 1);
+    assert (rc == 0);
+
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    rc = zmq_connect (pub, "udp://127.0.0.1:5590");
+    assert (rc == 0);
+
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (pub, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    assert (strcmp (endpoint, "udp://127.0.0.1:5590") == 0);
+
+    sync_udp (pub, sub);
+
+    //  Messages are filtered by the subscriber; multipart messages travel
+    //  in a single datagram.
+    for (int i = 0; i != MESSAGES; i++) {
+        rc = zmq_send (pub, "B", 1, 0);
+        assert (rc == 1);
+        rc = zmq_send (pub, "A", 1, ZMQ_SNDMORE);
+        assert (rc == 1);
+        rc = zmq_send (pub, &i, sizeof i, 0);
+        assert (rc == sizeof i);
+    }
+    for (int i = 0; i != MESSAGES; i++) {
+        char topic [8];
+        rc = zmq_recv (sub, topic, sizeof topic, 0);
+        assert (rc == 1 && topic [0] == 'A');
+        int more;
+        size_t more_size = sizeof more;
+        rc = zmq_getsockopt (sub, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0 && more);
+        int value;
+        rc = zmq_recv (sub, &value, sizeof value, 0);
+        assert (rc == sizeof value && value == i);
+    }
+
+    //  A message too large for a datagram is dropped.
+    size_t size = 70000;
+    char *data = (char*) malloc (size);
+    assert (data);
+    memset (data, 'A', size);
+    rc = zmq_send (pub, data, size, 0);
+    assert (rc == (int) size);
+    free (data);
+    rc = zmq_send (pub, "AB", 2, 0);
+    assert (rc == 2);
+    char buf [16];
+    rc = zmq_recv (sub, buf, sizeof buf, 0);
+    assert (rc == 2 && memcmp (buf, "AB", 2) == 0);
+
+    close_zero_linger (pub);
+    close_zero_linger (sub);
+}
+
+static void
+test_errors (void *ctx)
+{
+    //  Only publishers and subscribers can use datagrams.
+    void *pair = zmq_socket (ctx, ZMQ_PAIR);
+    assert (pair);
+    int rc = zmq_connect (pair, "udp://127.0.0.1:5591");
+    assert (rc == -1 && errno == ENOCOMPATPROTO);
+    rc = zmq_close (pair);
+    assert (rc == 0);
+
+    void *pub = zmq_socket (ctx, ZMQ_PUB);
+    assert (pub);
+    rc = zmq_connect (pub, "udp://127.0.0.1");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_connect (pub, "udp://127.0.0.1:0");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_connect (pub, "udp://*:5591");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_unicast (ctx);
+    test_errors (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
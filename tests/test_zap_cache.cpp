@@ -0,0 +1,187 @@
+/*
+    Copyright (c) 2007-2013 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Number of requests the ZAP handler has processed.
+static volatile int zap_requests = 0;
+
+static void
+zap_handler (void *handler)
+{
+    //  Process ZAP requests forever
+    while (true) {
+        char *version = s_recv (handler);
+        if (!version)
+            break;          //  Terminating
+        char *sequence = s_recv (handler);
+        char *domain = s_recv (handler);
+        char *address = s_recv (handler);
+        char *identity = s_recv (handler);
+        char *mechanism = s_recv (handler);
+        char *username = s_recv (handler);
+        char *password = s_recv (handler);
+
+        assert (streq (version, "1.0"));
+        assert (streq (mechanism, "PLAIN"));
+        zap_requests++;
+
+        s_sendmore (handler, version);
+        s_sendmore (handler, sequence);
+        if (streq (username, "admin")
+        &&  streq (password, "password")) {
+            s_sendmore (handler, "200");
+            s_sendmore (handler, "OK");
+            s_sendmore (handler, "anonymous");
+            s_send (handler, "");
+        }
+        else {
+            s_sendmore (handler, "400");
+            s_sendmore (handler, "Invalid username or password");
+            s_sendmore (handler, "");
+            s_send (handler, "");
+        }
+        free (version);
+        free (sequence);
+        free (domain);
+        free (address);
+        free (identity);
+        free (mechanism);
+        free (username);
+        free (password);
+    }
+    zmq_close (handler);
+}
+
+static void *
+plain_server (void *ctx, const char *endpoint, const char *domain, int ttl)
+{
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int as_server = 1;
+    int rc = zmq_setsockopt (server, ZMQ_PLAIN_SERVER, &as_server, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_ZAP_DOMAIN, domain, strlen (domain));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_ZAP_CACHE_TTL, &ttl, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (server, endpoint);
+    assert (rc == 0);
+    return server;
+}
+
+static void *
+plain_client (void *ctx, const char *endpoint, const char *password)
+{
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    int rc = zmq_setsockopt (client, ZMQ_PLAIN_USERNAME, "admin", 5);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_PLAIN_PASSWORD, password,
+        strlen (password));
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+    return client;
+}
+
+static uint64_t
+get_stat (void *socket, int option)
+{
+    uint64_t value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (socket, option, &value, &size);
+    assert (rc == 0);
+    assert (size == sizeof (value));
+    return value;
+}
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Spawn ZAP handler
+    //  We create and bind ZAP socket in main thread to avoid case
+    //  where child thread does not start up fast enough.
+    void *handler = zmq_socket (ctx, ZMQ_REP);
+    assert (handler);
+    int rc = zmq_bind (handler, "inproc://zeromq.zap.01");
+    assert (rc == 0);
+    void *zap_thread = zmq_threadstart (&zap_handler, handler);
+
+    //  Caching is off by default
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int ttl = -1;
+    size_t size = sizeof (int);
+    rc = zmq_getsockopt (server, ZMQ_ZAP_CACHE_TTL, &ttl, &size);
+    assert (rc == 0);
+    assert (ttl == 0);
+    ttl = -1;
+    rc = zmq_setsockopt (server, ZMQ_ZAP_CACHE_TTL, &ttl, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (server);
+    assert (rc == 0);
+
+    //  Only the first of the repeated connections goes to the handler
+    server = plain_server (ctx, "tcp://127.0.0.1:5560", "long", 60000);
+    for (int i = 0; i != 3; i++) {
+        void *client = plain_client (ctx, "tcp://127.0.0.1:5560", "password");
+        bounce (server, client);
+        close_zero_linger (client);
+    }
+    assert (zap_requests == 1);
+    assert (get_stat (server, ZMQ_STAT_ZAP_CACHE_MISSES) == 1);
+    assert (get_stat (server, ZMQ_STAT_ZAP_CACHE_HITS) == 2);
+
+    //  Different credentials are not covered by the cached result and
+    //  failed authentications are not cached at all
+    void *client = plain_client (ctx, "tcp://127.0.0.1:5560", "wrongpass");
+    expect_bounce_fail (server, client);
+    close_zero_linger (client);
+    assert (zap_requests >= 2);
+    assert (get_stat (server, ZMQ_STAT_ZAP_CACHE_HITS) == 2);
+    close_zero_linger (server);
+
+    //  Cached results expire
+    zap_requests = 0;
+    server = plain_server (ctx, "tcp://127.0.0.1:5561", "short", 100);
+    client = plain_client (ctx, "tcp://127.0.0.1:5561", "password");
+    bounce (server, client);
+    close_zero_linger (client);
+    zmq_sleep (1);
+    client = plain_client (ctx, "tcp://127.0.0.1:5561", "password");
+    bounce (server, client);
+    close_zero_linger (client);
+    assert (zap_requests == 2);
+    assert (get_stat (server, ZMQ_STAT_ZAP_CACHE_MISSES) == 2);
+    assert (get_stat (server, ZMQ_STAT_ZAP_CACHE_HITS) == 0);
+    close_zero_linger (server);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    //  Wait until ZAP handler terminates
+    zmq_threadclose (zap_thread);
+
+    return 0;
+}